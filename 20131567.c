@@ -3,15 +3,44 @@
  * @brief The starting point of this program.
  */
 
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "json.h"
 #include "mainloop.h"
+#include "opcode.h"
 
 /**
- * @brief Initialize states and start main loop.
- *        Clean up memory when the main loop is over.
+ * @brief          Initialize states and start main loop.
+ *                 Clean up memory when the main loop is over.
+ * @param[in] argc The number of command line arguments.
+ * @param[in] argv An list of command line arguments. '--json' makes every
+ *                 command report in JSON format, and '--isa-ext' enables
+ *                 extension opcodes.
  */
-int main(void)
+int main(int argc, char *argv[])
 {
   mainloop_initialize();
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if(!strcmp("--json", argv[i]))
+    {
+      json_set_enabled(true);
+    }
+    else if(!strcmp("--isa-ext", argv[i]))
+    {
+      opcode_set_extension_enabled(true);
+    }
+    else
+    {
+      json_printf("%s: option '%s' is invalid\n", argv[0], argv[i]);
+      mainloop_terminate();
+      return 1;
+    }
+  }
+
   mainloop_launch();
   mainloop_terminate();
 
@@ -0,0 +1,362 @@
+/**
+ * @file  analyze.c
+ * @brief A handler of analyze related commands. Runs a program fast while
+ *        forking a checkpoint at every interval, and runs each interval
+ *        again with coverage and the cache model on in parallel.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analyze.h"
+
+#include "cache.h"
+#include "coverage.h"
+#include "debugger.h"
+#include "device.h"
+#include "json.h"
+#include "loader.h"
+#include "logger.h"
+#include "replay.h"
+#include "timeline.h"
+
+/**
+ * @brief Structure of results of an interval, written by a worker to
+ *        memory shared with the parent.
+ */
+struct analyze_result
+{
+  /** Cycles counted by the cache model. */
+  unsigned long long cycles;
+  /** Misses counted by the cache model. */
+  unsigned long long misses;
+  /** Coverage of the interval. */
+  unsigned char      bitmap[COVERAGE_BITMAP_LEN];
+};
+
+/**
+ * @brief Equals to 10.
+ */
+static const int DECIMAL = 10;
+
+/**
+ * @brief Cycles of all merged intervals.
+ */
+static unsigned long long _cycles = 0;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief Cache misses of all merged intervals.
+ */
+static unsigned long long _misses = 0;
+
+/**
+ * @brief                   Count running workers.
+ * @param[in]  pids         Process ids of workers. 0 if not running.
+ * @param[in]  worker_count The number of workers.
+ * @param[out] slot         An index of a worker not running, if any.
+ * @return                  The number of running workers.
+ */
+static int analyze_count_running(const pid_t *pids,
+                                 const int   worker_count,
+                                 int         *slot);
+
+/**
+ * @brief          Run the program in intervals of the given number of
+ *                 instructions, and run each interval again in a worker
+ *                 process with coverage and the cache model on.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool analyze_execute_analyze(const char *cmd,
+                                    const int  argc,
+                                    const char *argv[]);
+
+/**
+ * @brief  Return the current time in milliseconds.
+ * @return A monotonic time.
+ */
+static double analyze_get_time(void);
+
+/**
+ * @brief             Run an interval in a worker process, copy its coverage
+ *                    and counts of the cache model to the result, and exit.
+ * @param[in]  count  The number of instructions of the interval.
+ * @param[out] result A result shared with the parent.
+ */
+static void analyze_run_interval(const int             count,
+                                 struct analyze_result *result);
+
+/**
+ * @brief                  Wait for a worker to exit, and merge its coverage
+ *                         and counts of the cache model.
+ * @param[in] pids         Process ids of workers. 0 if not running.
+ * @param[in] results      Results of workers.
+ * @param[in] worker_count The number of workers.
+ * @return                 True if the worker succeeded, false otherwise.
+ */
+static bool analyze_wait_worker(pid_t                       *pids,
+                                const struct analyze_result *results,
+                                const int                   worker_count);
+
+void analyze_execute(const char *cmd,
+                     const int  argc,
+                     const char *argv[])
+{
+  if(!strcmp("analyze", cmd))
+  {
+    _is_command_executed = analyze_execute_analyze(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+static int analyze_count_running(const pid_t *pids,
+                                 const int   worker_count,
+                                 int         *slot)
+{
+  int running_count = 0;
+  for(int i = 0; i < worker_count; ++i)
+  {
+    if(pids[i])
+    {
+      ++running_count;
+    }
+    else
+    {
+      *slot = i;
+    }
+  }
+
+  return running_count;
+}
+
+static bool analyze_execute_analyze(const char *cmd,
+                                    const int  argc,
+                                    const char *argv[])
+{
+  if(1 != argc)
+  {
+    json_printf("analyze: an interval is required\n");
+    return false;
+  }
+
+  char       *endptr  = NULL;
+  const long interval = strtol(argv[0], &endptr, DECIMAL);
+  if('\0' != *endptr || 0 >= interval || INT_MAX < interval)
+  {
+    json_printf("analyze: interval '%s' is invalid\n", argv[0]);
+    return false;
+  }
+
+  if(!debugger_is_loaded())
+  {
+    json_printf("analyze: no program is loaded\n");
+    return false;
+  }
+
+  int worker_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if(1 > worker_count)
+  {
+    worker_count = 1;
+  }
+
+  // Workers write their results to memory shared with this process.
+  struct analyze_result *results = mmap(NULL,
+                                        (size_t)worker_count *
+                                        sizeof(*results),
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_ANONYMOUS,
+                                        -1,
+                                        0);
+  if(MAP_FAILED == results)
+  {
+    json_printf("analyze: cannot map memory for workers\n");
+    return false;
+  }
+  pid_t *pids = calloc(worker_count, sizeof(*pids));
+
+  timeline_begin(cmd);
+  const double start = analyze_get_time();
+
+  // The fast run records nothing. Workers record their own intervals.
+  const bool was_enabled       = coverage_set_enabled(false);
+  const bool was_cache_enabled = cache_set_enabled(false);
+  int        interval_count    = 0;
+  int        failed_count      = 0;
+  int        slot              = 0;
+  bool       is_success        = true;
+  bool       is_running        = true;
+  _cycles = 0;
+  _misses = 0;
+  while(is_running)
+  {
+    if(worker_count == analyze_count_running(pids, worker_count, &slot))
+    {
+      failed_count += !analyze_wait_worker(pids, results, worker_count);
+      analyze_count_running(pids, worker_count, &slot);
+    }
+
+    // A forked process is a checkpoint of the whole machine, whose memory is
+    // copied only when either process writes it.
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(0 == pid)
+    {
+      analyze_run_interval(interval, &results[slot]);
+    }
+    if(0 > pid)
+    {
+      json_printf("analyze: cannot fork a worker\n");
+      is_success = false;
+      break;
+    }
+    pids[slot] = pid;
+    ++interval_count;
+
+    bool is_stopped = false;
+    is_running = debugger_run_slice(interval, &is_stopped) && !is_stopped;
+  }
+  const double fast_time = analyze_get_time() - start;
+
+  while(0 < analyze_count_running(pids, worker_count, &slot))
+  {
+    failed_count += !analyze_wait_worker(pids, results, worker_count);
+  }
+  coverage_set_enabled(was_enabled);
+  cache_set_enabled(was_cache_enabled);
+
+  const double total_time = analyze_get_time() - start;
+  timeline_end(cmd);
+
+  munmap(results, (size_t)worker_count * sizeof(*results));
+  free(pids);
+
+  if(json_is_enabled())
+  {
+    json_begin_object("analyze");
+    json_write_integer("intervals", interval_count);
+    json_write_integer("interval", interval);
+    json_write_integer("workers", worker_count);
+    json_write_integer("failed", failed_count);
+    json_write_integer("cycles", _cycles);
+    json_write_integer("misses", _misses);
+    json_end_object();
+    return is_success;
+  }
+
+  json_printf("Intervals\t%d of %ld instructions\n", interval_count, interval);
+  json_printf("Workers\t\t%d\n", worker_count);
+  json_printf("Fast run\t%.1f ms\n", fast_time);
+  json_printf("Total\t\t%.1f ms\n", total_time);
+  json_printf("Cycles\t\t%llu\n", _cycles);
+  json_printf("Cache misses\t%llu\n", _misses);
+  if(failed_count)
+  {
+    json_printf("analyze: %d intervals failed and are not merged\n",
+                failed_count);
+  }
+
+  return is_success;
+}
+
+static double analyze_get_time(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static void analyze_run_interval(const int             count,
+                                 struct analyze_result *result)
+{
+  // Files shared with the parent must not be moved or written.
+  device_detach();
+  loader_detach();
+  replay_detach();
+  timeline_detach();
+
+  const int null_fd = open("/dev/null", O_WRONLY);
+  if(0 <= null_fd)
+  {
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+  }
+
+  coverage_initialize();
+  coverage_set_enabled(true);
+
+  // Lines of the fast run are stale, so each interval starts cold.
+  cache_initialize();
+  cache_set_enabled(true);
+
+  bool is_stopped = false;
+  debugger_run_slice(count, &is_stopped);
+  coverage_copy_bitmap(result->bitmap);
+  result->cycles = cache_get_cycles();
+  result->misses = cache_get_misses();
+
+  // Exit without flushing or closing files shared with the parent.
+  _exit(EXIT_SUCCESS);
+}
+
+static bool analyze_wait_worker(pid_t                       *pids,
+                                const struct analyze_result *results,
+                                const int                   worker_count)
+{
+  while(true)
+  {
+    int         status = 0;
+    const pid_t pid    = wait(&status);
+    if(0 > pid)
+    {
+      if(EINTR == errno)
+      {
+        continue;
+      }
+
+      // No worker is left.
+      memset(pids, 0, sizeof(*pids) * worker_count);
+      return false;
+    }
+
+    for(int i = 0; i < worker_count; ++i)
+    {
+      if(pid == pids[i])
+      {
+        pids[i] = 0;
+        if(!WIFEXITED(status) || EXIT_SUCCESS != WEXITSTATUS(status))
+        {
+          return false;
+        }
+
+        coverage_merge(results[i].bitmap);
+        _cycles += results[i].cycles;
+        _misses += results[i].misses;
+        return true;
+      }
+    }
+  }
+}
@@ -0,0 +1,21 @@
+/**
+ * @file  analyze.h
+ * @brief A handler of analyze related commands. Runs a program fast while
+ *        forking a checkpoint at every interval, and runs each interval
+ *        again with coverage on in parallel.
+ */
+
+#ifndef __ANALYZE_H__
+#define __ANALYZE_H__
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void analyze_execute(const char *cmd,
+                     const int  argc,
+                     const char *argv[]);
+
+#endif
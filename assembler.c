@@ -4,16 +4,26 @@
  */
 
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "assembler.h"
 
+#include "block.h"
+#include "expression.h"
+#include "json.h"
+#include "literal.h"
 #include "logger.h"
+#include "macro.h"
 #include "opcode.h"
+#include "peephole.h"
 #include "symbol.h"
+#include "timeline.h"
+#include "writer.h"
 
 /**
  * @def   MODIF_RECORD_LEN
@@ -21,6 +31,25 @@
  */
 #define MODIF_RECORD_LEN 10
 
+/**
+ * @def   LINE_RECORD_LEN
+ * @brief The length of an entry of line record. 6 columns of address and
+ *        6 columns of line, both in hex.
+ */
+#define LINE_RECORD_LEN 13
+
+/**
+ * @def   BUFFER_LEN
+ * @brief The length of buffer used for file reading.
+ */
+#define BUFFER_LEN 110
+
+/**
+ * @def   OPERANDS_COUNT
+ * @brief The maximum number of operands.
+ */
+#define OPERANDS_COUNT 2
+
 /**
  * @brief Structure of symbol elements.
  */
@@ -33,10 +62,97 @@ struct modif_record
 };
 
 /**
- * @brief A const variable that holds the length of buffer used for
- *        file reading.
+ * @brief Structure of line record elements. Each element maps the address
+ *        of an instruction to its line in .lst file.
+ */
+struct line_record
+{
+  /** A record content. */
+  char line[LINE_RECORD_LEN];
+  /** A pointer to the next record element. */
+  struct line_record *next;
+};
+
+/**
+ * @brief Structure of a line prepared for pass 2. Lines are read in order,
+ *        encoded in parallel, and written to .lst and .obj files in order.
  */
-static const int BUFFER_LEN = 110;
+struct pass2_line
+{
+  /** A line in .asm file. Tokens point into it. */
+  char                 buffer[BUFFER_LEN];
+  /** An object code encoded from the line. */
+  char                 object_code[BUFFER_LEN];
+  /** A label of the line. */
+  char                 *label;
+  /** A mnemonic of the line. */
+  char                 *mnemonic;
+  /** Operands of the line. */
+  char                 *operands[OPERANDS_COUNT];
+  /** A note of the peephole optimizer, NULL if the line is not rewritten. */
+  const char           *note;
+  /** A keyword of the error, if any. */
+  const char           *error_keyword;
+  /** An error occurred while encoding the line. */
+  enum symbol_error    error;
+  /** A type of the operand folded in pass 1. */
+  enum expression_type type;
+  /** A value of the operand folded in pass 1. */
+  int                  value;
+  /** A line number in .lst file. */
+  int                  line;
+  /** An absolute locctr of the line. */
+  int                  locctr;
+  /** A program block of the line. */
+  int                  block;
+  /** A length of the instruction. */
+  int                  instruction_len;
+  /** A pool of literals the line refers to. */
+  int                  literal_pool;
+  /** A start locctr of the modification record, if any. */
+  int                  modif_start;
+  /** A length of the modification record in half-bytes. 0 if none. */
+  int                  modif_len;
+  /** True if the line is only written to .lst file as a comment. */
+  bool                 is_comment;
+  /** True if the line is encoded. START and END lines are not. */
+  bool                 is_encoded;
+  /** True if the line is an instruction mapped in line records. */
+  bool                 has_line_record;
+  /** True if the text record ends at this line. */
+  bool                 ends_text_record;
+};
+
+/**
+ * @brief Structure of a chunk of lines encoded by a thread.
+ */
+struct pass2_chunk
+{
+  /** The first line of the chunk. */
+  struct pass2_line *lines;
+  /** The number of lines. */
+  int               lines_count;
+  /** A base register value at the first line. */
+  int               base;
+  /** True if BASE is in effect at the first line. */
+  bool              is_base_relative_enabled;
+};
+
+/**
+ * @brief Structure of chunks shared by threads. Each thread takes the next
+ *        chunk until none is left.
+ */
+struct pass2_pool
+{
+  /** A lock of next. */
+  pthread_mutex_t    mutex;
+  /** Chunks to be encoded. */
+  struct pass2_chunk *chunks;
+  /** The number of chunks. */
+  int                chunks_count;
+  /** An index of the next chunk to be taken. */
+  int                next;
+};
 
 /**
  * @brief A const variable that holds the extension of asm file.
@@ -48,6 +164,11 @@ static const char *ASM_EXTENSION = "asm";
  */
 static const int ASM_EXTENSION_LEN = 3;
 
+/**
+ * @brief Equals to 0xFFFFF. The address field of format 4 is 20-bits long.
+ */
+static const int ADDRESS_MASK = 0xFFFFF;
+
 /**
  * @brief Equals to 0x000, equals to decimal 0 in unsigned.
  */
@@ -88,7 +209,11 @@ static const char *DIRECTIVES[] = {"START",
                                    "RESB",
                                    "RESW",
                                    "BASE",
-                                   "NOBASE"};
+                                   "NOBASE",
+                                   "LTORG",
+                                   "EQU",
+                                   "ORG",
+                                   "USE"};
 
 /**
  * @brief A const variable that holds the number of assembler directives.
@@ -101,6 +226,11 @@ const int DIRECTIVES_COUNT = (int)(sizeof(DIRECTIVES) /
  */
 static const int HEX = 16;
 
+/**
+ * @brief Equals to 0xFFFFFF. A word is 24-bits long.
+ */
+static const int WORD_MASK = 0xFFFFFF;
+
 /**
  * @brief A const variable that holds the extension of int file.
  */
@@ -111,11 +241,6 @@ static const char *INT_EXTENSION = "int";
  */
 static const int INT_EXTENSION_LEN = 3;
 
-/**
- * @brief A const variable that holds the amount of line increment.
- */
-static const int LINE_INCREMENT = 5;
-
 /**
  * @brief A const variable that holds the extension of lst file.
  */
@@ -126,6 +251,11 @@ static const char *LST_EXTENSION = "lst";
  */
 static const int LST_EXTENSION_LEN = 3;
 
+/**
+ * @brief A const variable that holds the number of entries per line record.
+ */
+static const int LINE_RECORD_ENTRIES_COUNT = 6;
+
 /**
  * @brief A const variable that holds the extension of obj file.
  */
@@ -136,11 +266,6 @@ static const char *OBJ_EXTENSION = "obj";
  */
 static const int OBJ_EXTENSION_LEN = 3;
 
-/**
- * @brief A const variable that holds the manximum number of operands.
- */
-static const int OPERANDS_COUNT = 2;
-
 /**
  * @brief A const variable that holds the manximum length of text record.
  */
@@ -151,14 +276,36 @@ static const int TEXT_RECORD_MAX_LEN = 55;
  */
 static bool _is_command_executed = false;
 
+/**
+ * @brief The number of lines encoded at once by a thread in pass 2. Unit
+ *        tests set it past the number of lines to encode serially.
+ */
+static int _pass2_chunk_len = 256;
+
+/**
+ * @brief                      Create a new line record. It is appended on
+ *                             the given line records list.
+ * @param[in]     line_records A list of line records.
+ * @param[in,out] last         The last line record of the list, which is
+ *                             updated to the new one.
+ * @param[in]     locctr       A locctr of the instruction.
+ * @param[in]     line         A line of the instruction.
+ */
+static void assembler_create_line_record(struct line_record **line_records,
+                                         struct line_record **last,
+                                         const int          locctr,
+                                         const int          line);
+
 /**
  * @brief                   Create a new modification record. It is appended on
  *                          the given modificationi records list.
  * @param[in] modif_records A list of modification records.
  * @param[in] modif_start   A start locctr of modification.
+ * @param[in] modif_len     A length of modification in half-bytes.
  */
 static void assembler_create_modif_record(struct modif_record **modif_records,
-                                          const int           modif_start);
+                                          const int           modif_start,
+                                          const int           modif_len);
 
 /**
  * @brief          Read .asm file and create .obj and .lst files.
@@ -187,12 +334,31 @@ static bool assembler_execute_symbol(const char *cmd,
  */
 static bool assembler_is_mnemonic(const char *str);
 
+/**
+ * @brief                  Release all line records.
+ * @param[in] line_records A list of line records.
+ */
+static void assembler_release_line_records(struct line_record *line_records);
+
 /**
  * @brief                   Release all modification records.
  * @param[in] modif_records A list of modification records.
  */
 static void assembler_release_modif_records(struct modif_record *modif_records);
 
+/**
+ * @brief                     Read the next line of the expanded source.
+ * @param[in,out] index       An index of the line to be read.
+ * @param[out] buffer         A buffer to which the line is copied.
+ * @param[out] line           A line number of the line.
+ * @param[out] is_listed_only True if the line is only written to .lst file.
+ * @return                    False at the end of source, true otherwise.
+ */
+static bool assembler_read_line(int  *index,
+                                char *buffer,
+                                int  *line,
+                                bool *is_listed_only);
+
 /**
  * @brief              Tokenize line into label, mnemonic, and operands.
  * @param[in] buffer   A line to be tokenized.
@@ -209,53 +375,109 @@ static bool assembler_tokenize_line(char *buffer,
 /**
  * @brief                  Create symbol table. The symbol table contains
  *                         pairs of symbol and its locctr.
- * @param[in]  asm_file    A file pointer to an .asm file to be assembled.
  * @param[in]  int_file    A file pointer to an .int file to be written.
  * @param[out] program_len A length of prgram.
  * @return                 True on success, false otherwise.
  */
-static bool assembler_pass1(FILE *asm_file, FILE *int_file, int *program_len);
+static bool assembler_pass1(FILE *int_file, int *program_len);
 
 /**
  * @brief                 Write .lst file and obj file.
- * @param[in] asm_file    A file pointer to an .asm file to be assembled.
+ * @param[in] asm_filename A name of the .asm file to be assembled.
  * @param[in] int_file    A file pointer to an .int file to be read.
  * @param[in] lst_file    A file pointer to an .lst file to be written.
+ *                        NULL if the listing is suppressed.
  * @param[in] obj_file    A file pointer to an .obj file to be written.
  * @param[in] program_len A length of program.
  * @return                 True on success, false otherwise.
  */
-static bool assembler_pass2(FILE *asm_file,
-                            FILE *int_file,
-                            FILE *lst_file,
-                            FILE *obj_file,
-                            int  program_len);
+static bool assembler_pass2(const char *asm_filename,
+                            FILE       *int_file,
+                            FILE       *lst_file,
+                            FILE       *obj_file,
+                            int        program_len);
+
+/**
+ * @brief                              Encode a line to its object code.
+ *                                     Errors are kept in the line instead
+ *                                     of symbol_set_error(), so that lines
+ *                                     can be encoded in any order.
+ * @param[in] pass2_line               A line to be encoded.
+ * @param[in] base                     A base register value, updated by
+ *                                     BASE.
+ * @param[in] is_base_relative_enabled True if BASE is in effect, updated by
+ *                                     BASE and NOBASE.
+ */
+static void assembler_pass2_encode_line(struct pass2_line *pass2_line,
+                                        int               *base,
+                                        bool              *is_base_relative_enabled);
+
+/**
+ * @brief                 Split lines into chunks and encode them on threads.
+ *                        BASE at the first line of each chunk is computed
+ *                        beforehand.
+ * @param[in] lines       Lines to be encoded.
+ * @param[in] lines_count The number of lines.
+ */
+static void assembler_pass2_encode_lines(struct pass2_line *lines,
+                                         const int         lines_count);
+
+/**
+ * @brief                 Return the next line that is not a comment. Skipped
+ *                        comments and the returned line are written to .lst
+ *                        file.
+ * @param[in] lines       Lines read in pass 2.
+ * @param[in] lines_count The number of lines.
+ * @param[in] index       An index of the line to be returned.
+ * @param[in] lst_file    A file pointer to an .lst file to be written.
+ * @return                The next line if exists, NULL otherwise.
+ */
+static struct pass2_line *assembler_pass2_next_line(struct pass2_line *lines,
+                                                    const int         lines_count,
+                                                    int               *index,
+                                                    FILE              *lst_file);
+
+/**
+ * @brief                  Read lines from the expanded source and .int file
+ *                         and tokenize them, until END.
+ * @param[in]  int_file    A file pointer to an .int file to be read.
+ * @param[out] lines_count The number of lines read.
+ * @return                 Lines read. It should be freed by the caller.
+ */
+static struct pass2_line *assembler_pass2_read_lines(FILE *int_file,
+                                                     int  *lines_count);
+
+/**
+ * @brief                Keep the error of the line.
+ * @param[in] pass2_line A line where the error occurred.
+ * @param[in] error      The error occurred.
+ * @param[in] keyword    A keyword of the error.
+ */
+static void assembler_pass2_set_error(struct pass2_line       *pass2_line,
+                                      const enum symbol_error error,
+                                      const char              *keyword);
+
+/**
+ * @brief          Encode chunks of the pool until none is left.
+ * @param[in] pool A pool of chunks.
+ * @return         NULL.
+ */
+static void *assembler_pass2_work(void *pool);
 
 /**
- * @brief                     Read lines from .asm file and .int file and
- *                            tokenize them. Skip empty or comment lines.
- *                            Tokens are written to .lst file.
- * @param[in] asm_file        A file pointer to an .asm file to be read.
- * @param[in] int_file        A file pointer to an .int file to be read.
- * @param[in] lst_file        A file pointer to an .lst file to be written.
- * @param[in] buffer          A line from .asm file.
- * @param[in] line            The current line number.
- * @param[in] locctr          A locctr of the current instruction.
- * @param[in] instruction_len A length of the current instruction.
- * @param[in] label           A label of the current line.
- * @param[in] mnemonic        A mnemonic of the current line.
- * @param[in] operands        A operands of the current line.
+ * @brief                       Write literals of the pool to .lst file and
+ *                              append them to the text record.
+ * @param[in] lst_file          A file pointer to an .lst file to be written.
+ * @param[in] obj_file          A file pointer to an .obj file to be written.
+ * @param[in] pool              A pool number.
+ * @param[in] text_record       A text record to be appended.
+ * @param[in] text_record_start A start locctr of the text record.
  */
-static void assembler_pass2_get_ready_line(FILE *asm_file,
-                                           FILE *int_file,
-                                           FILE *lst_file,
-                                           char *buffer,
-                                           int  *line,
-                                           int  *locctr,
-                                           int  *instruction_len,
-                                           char **label,
-                                           char **mnemonic,
-                                           char *(*operands)[]);
+static void assembler_write_literal_pool(FILE *lst_file,
+                                         FILE *obj_file,
+                                         const int pool,
+                                         char *text_record,
+                                         int  *text_record_start);
 
 /**
  * @brief              Write a comment line to .lst file.
@@ -295,9 +517,11 @@ static void assembler_write_lst_newline(FILE *lst_file);
  * @brief                 Write an object code to .lst file.
  * @param[in] lst_file    A file pointer to an .lst file to be written.
  * @param[in] object_code An object code.
+ * @param[in] note        A note of the peephole optimizer. NULL if none.
  */
 static void assembler_write_lst_object_code(FILE       *lst_file,
-                                            const char *object_code);
+                                            const char *object_code,
+                                            const char *note);
 
 /**
  * @brief                  Write a end record to .obj file.
@@ -318,6 +542,18 @@ static void assembler_write_obj_header(FILE       *obj_file,
                                        const char *program_name,
                                        const int  program_start,
                                        const int  program_len);
+/**
+ * @brief                  Write line records to .obj file. Line records are
+ *                         comment records, so loaders that do not know them
+ *                         just skip them.
+ * @param[in] obj_file     A file pointer to an .obj file to be written.
+ * @param[in] asm_filename A name of the assembled .asm file.
+ * @param[in] line_records A list of line records.
+ */
+static void assembler_write_obj_lines(FILE                     *obj_file,
+                                      const char               *asm_filename,
+                                      const struct line_record *line_records);
+
 /**
  * @brief                   Write modificatoin records to .obj file.
  * @param[in] obj_file      A file pointer to an .obj file to be written.
@@ -337,109 +573,79 @@ static void assembler_write_obj_text(FILE       *obj_file,
                                      const int  text_record_start,
                                      const char *text_record);
 
-void assembler_execute(const char *cmd,
-                       const int  argc,
-                       const char *argv[])
-{
-  if(!strcmp("assemble", cmd))
-  {
-    _is_command_executed = assembler_execute_assemble(cmd, argc, argv);
-  }
-  else if(!strcmp("symbol", cmd))
-  {
-    _is_command_executed = assembler_execute_symbol(cmd, argc, argv);
-  }
-  else
-  {
-    printf("%s: command not found\n", cmd);
-  }
-
-  if(_is_command_executed)
-  {
-    logger_write_log(cmd, argc, argv);
-  }
-}
-
-static void assembler_create_modif_record(struct modif_record **modif_records,
-                                          const int           modif_start)
-{
-  struct modif_record *new_modif_record = malloc(sizeof(*new_modif_record));
-  sprintf(new_modif_record->modif, "M%06X05", modif_start);
-  new_modif_record->next = NULL;
-
-  if(!*modif_records)
-  {
-    *modif_records = new_modif_record;
-  }
-  else
-  {
-    struct modif_record *walk = *modif_records;
-    while(walk->next)
-    {
-      walk = walk->next;
-    }
-    walk->next = new_modif_record;
-  }
-}
-
-static bool assembler_execute_assemble(const char *cmd,
-                                       const int  argc,
-                                       const char *argv[])
+bool assembler_assemble(const char *asm_filename,
+                        const bool is_optimized,
+                        const bool is_listed)
 {
-  if(1 != argc)
+  if(strcmp(ASM_EXTENSION, asm_filename + strlen(asm_filename) - ASM_EXTENSION_LEN))
   {
-    printf("assemble: one argument is required\n");
+    json_printf("assemble: '%s' is not .asm file\n", asm_filename);
     return false;
   }
 
-  if(strcmp(ASM_EXTENSION, argv[0] + strlen(argv[0]) - ASM_EXTENSION_LEN))
+  FILE *asm_file = fopen(asm_filename, "r");
+  if(!asm_file)
   {
-    printf("assemble: '%s' is not .asm file\n", argv[0]);
+    json_printf("assemble: there is no such file '%s'\n", asm_filename);
     return false;
   }
 
-  FILE *asm_file = fopen(argv[0], "r");
-  if(!asm_file)
+  symbol_new_table();
+  literal_new_table();
+  block_new_table();
+  peephole_new_table(is_optimized);
+
+  // Macros are expanded in memory, and both passes read expanded lines.
+  timeline_begin("macro_process");
+  bool is_success = macro_process(asm_file);
+  timeline_end("macro_process");
+  fclose(asm_file);
+  if(!is_success)
   {
-    printf("assemble: there is no such file '%s'\n", argv[0]);
+    symbol_show_error_msg();
     return false;
   }
 
-  char *int_filename = malloc((strlen(argv[0]) + 1) * sizeof(*int_filename));
-  strcpy(int_filename, argv[0]);
+  char *int_filename = malloc((strlen(asm_filename) + 1) * sizeof(*int_filename));
+  strcpy(int_filename, asm_filename);
   strcpy(int_filename + strlen(int_filename) - INT_EXTENSION_LEN, INT_EXTENSION);
   FILE *int_file = fopen(int_filename, "w+");
   if(!int_file)
   {
-    printf("assemble: cannot create '%s' file\n", int_filename);
+    json_printf("assemble: cannot create '%s' file\n", int_filename);
     free(int_filename);
     return false;
   }
 
-  symbol_new_table();
-
   int program_len = 0;
-  bool is_success = assembler_pass1(asm_file, int_file, &program_len);
+  timeline_begin("assembler_pass1");
+  is_success = assembler_pass1(int_file, &program_len);
+  timeline_end("assembler_pass1");
   if(!is_success)
   {
     symbol_show_error_msg();
 
+    fclose(int_file);
     remove(int_filename);
     free(int_filename);
     return false;
   }
   fflush(int_file);
-  rewind(asm_file);
   rewind(int_file);
 
-  char *lst_filename = malloc((strlen(argv[0]) + 1) * sizeof(*lst_filename));
-  strcpy(lst_filename, argv[0]);
+  char *lst_filename = malloc((strlen(asm_filename) + 1) * sizeof(*lst_filename));
+  strcpy(lst_filename, asm_filename);
   strcpy(lst_filename + strlen(lst_filename) - LST_EXTENSION_LEN, LST_EXTENSION);
-  FILE *lst_file = fopen(lst_filename, "w");
-  if(!lst_file)
+  // Without .lst file, pass 2 writes only .obj file. A stale .lst file
+  // would not match the new .obj file.
+  FILE *lst_file = is_listed ? fopen(lst_filename, "w") : NULL;
+  if(!is_listed)
+  {
+    remove(lst_filename);
+  }
+  if(is_listed && !lst_file)
   {
-    printf("assemble: cannot create '%s' file\n", lst_filename);
-    fclose(asm_file);
+    json_printf("assemble: cannot create '%s' file\n", lst_filename);
     fclose(int_file);
     remove(int_filename);
     free(int_filename);
@@ -447,36 +653,55 @@ static bool assembler_execute_assemble(const char *cmd,
     return false;
   }
 
-  char *obj_filename = malloc((strlen(argv[0]) + 1) * sizeof(*obj_filename));
-  strcpy(obj_filename, argv[0]);
+  char *obj_filename = malloc((strlen(asm_filename) + 1) * sizeof(*obj_filename));
+  strcpy(obj_filename, asm_filename);
   strcpy(obj_filename + strlen(obj_filename) - OBJ_EXTENSION_LEN, OBJ_EXTENSION);
   FILE *obj_file = fopen(obj_filename, "w");
   if(!obj_file)
   {
-    printf("assemble: cannot create '%s' file\n", obj_filename);
-    fclose(asm_file);
+    json_printf("assemble: cannot create '%s' file\n", obj_filename);
     fclose(int_file);
-    fclose(lst_file);
+    if(lst_file)
+    {
+      fclose(lst_file);
+      remove(lst_filename);
+    }
     remove(int_filename);
-    remove(lst_filename);
     free(int_filename);
     free(lst_filename);
     free(obj_filename);
     return false;
   }
 
-  is_success = assembler_pass2(asm_file, int_file, lst_file, obj_file, program_len);
-  fclose(asm_file);
+  // Pass 2 formats lines, and the writer thread writes them meanwhile.
+  writer_begin();
+  timeline_begin("assembler_pass2");
+  is_success = assembler_pass2(asm_filename,
+                               int_file,
+                               lst_file,
+                               obj_file,
+                               program_len);
+  timeline_end("assembler_pass2");
+  // Closing flushes the .lst and .obj files that pass 2 buffered.
+  timeline_begin("write files");
+  writer_end();
   fclose(int_file);
-  fclose(lst_file);
+  if(lst_file)
+  {
+    fclose(lst_file);
+  }
   fclose(obj_file);
+  timeline_end("write files");
   remove(int_filename);
   free(int_filename);
   if(!is_success)
   {
     symbol_show_error_msg();
 
-    remove(lst_filename);
+    if(lst_file)
+    {
+      remove(lst_filename);
+    }
     remove(obj_filename);
     free(lst_filename);
     free(obj_filename);
@@ -486,17 +711,118 @@ static bool assembler_execute_assemble(const char *cmd,
   free(obj_filename);
 
   symbol_save_table();
+  peephole_show_summary();
 
   return true;
 }
 
+void assembler_execute(const char *cmd,
+                       const int  argc,
+                       const char *argv[])
+{
+  if(!strcmp("assemble", cmd))
+  {
+    _is_command_executed = assembler_execute_assemble(cmd, argc, argv);
+  }
+  else if(!strcmp("symbol", cmd))
+  {
+    _is_command_executed = assembler_execute_symbol(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+static void assembler_create_line_record(struct line_record **line_records,
+                                         struct line_record **last,
+                                         const int          locctr,
+                                         const int          line)
+{
+  struct line_record *new_line_record = malloc(sizeof(*new_line_record));
+  snprintf(new_line_record->line, sizeof(new_line_record->line), "%06X%06X",
+           locctr, line);
+  new_line_record->next = NULL;
+
+  // Records are appended in order of lines, so the list is never walked.
+  if(!*line_records)
+  {
+    *line_records = new_line_record;
+  }
+  else
+  {
+    (*last)->next = new_line_record;
+  }
+  *last = new_line_record;
+}
+
+static void assembler_create_modif_record(struct modif_record **modif_records,
+                                          const int           modif_start,
+                                          const int           modif_len)
+{
+  struct modif_record *new_modif_record = malloc(sizeof(*new_modif_record));
+  sprintf(new_modif_record->modif, "M%06X%02X", modif_start, modif_len);
+  new_modif_record->next = NULL;
+
+  if(!*modif_records)
+  {
+    *modif_records = new_modif_record;
+  }
+  else
+  {
+    struct modif_record *walk = *modif_records;
+    while(walk->next)
+    {
+      walk = walk->next;
+    }
+    walk->next = new_modif_record;
+  }
+}
+
+static bool assembler_execute_assemble(const char *cmd,
+                                       const int  argc,
+                                       const char *argv[])
+{
+  // Options come before the file name.
+  bool is_optimized = false;
+  bool is_listed    = true;
+  if(1 > argc)
+  {
+    json_printf("assemble: one argument is required\n");
+    return false;
+  }
+  for(int i = 0; i < argc - 1; ++i)
+  {
+    if(!strcmp("-O", argv[i]))
+    {
+      is_optimized = true;
+    }
+    else if(!strcmp("-nolst", argv[i]))
+    {
+      is_listed = false;
+    }
+    else
+    {
+      json_printf("assemble: unknown option '%s'\n", argv[i]);
+      return false;
+    }
+  }
+
+  return assembler_assemble(argv[argc - 1], is_optimized, is_listed);
+}
+
 static bool assembler_execute_symbol(const char *cmd,
                                      const int  argc,
                                      const char *argv[])
 {
   if(0 < argc)
   {
-    printf("assemble: too many arguments\n");
+    json_printf("assemble: too many arguments\n");
     return false;
   }
 
@@ -532,6 +858,17 @@ static bool assembler_is_mnemonic(const char *str)
   return false;
 }
 
+static void assembler_release_line_records(struct line_record *line_records)
+{
+  struct line_record *walk = line_records;
+  while(walk)
+  {
+    struct line_record *del = walk;
+    walk = walk->next;
+    free(del);
+  }
+}
+
 static void assembler_release_modif_records(struct modif_record *modif_records)
 {
   struct modif_record *walk = modif_records;
@@ -543,13 +880,28 @@ static void assembler_release_modif_records(struct modif_record *modif_records)
   }
 }
 
+static bool assembler_read_line(int  *index,
+                                char *buffer,
+                                int  *line,
+                                bool *is_listed_only)
+{
+  const char *text = macro_get_line(*index, line, is_listed_only);
+  if(!text)
+  {
+    return false;
+  }
+  ++*index;
+
+  snprintf(buffer, BUFFER_LEN, "%s", text);
+
+  return true;
+}
+
 static bool assembler_tokenize_line(char *buffer,
                                     char **label,
                                     char **mnemonic,
                                     char *(*operands)[])
 {
-  buffer[strlen(buffer) - 1] = '\0';
-
   if('.' == buffer[0])
   {
     // This line is a comment.
@@ -581,22 +933,27 @@ static bool assembler_tokenize_line(char *buffer,
   return true;
 }
 
-static bool assembler_pass1(FILE *asm_file, FILE *int_file, int *program_len)
+static bool assembler_pass1(FILE *int_file, int *program_len)
 {
   int  program_start             = 0; // The start locctr of this program.
-  int  line                      = 0; // Line is increased by 5.
+  int  line                      = 0;
   int  locctr                    = 0;
   int  instruction_len           = 0;
   char *label                    = NULL;
   char *mnemonic                 = NULL;
   char *operands[OPERANDS_COUNT];
   char buffer[BUFFER_LEN];
+  int  index                     = 0;
+  bool is_listed_only            = false;
+  int  org_locctr                = -1; // The locctr saved by ORG.
 
   // Read lines until meet the first non-empty and non-comment line.
-  while(fgets(buffer, BUFFER_LEN, asm_file))
+  // Lines removed by the peephole optimizer are skipped like comments.
+  while(assembler_read_line(&index, buffer, &line, &is_listed_only))
   {
-    line += LINE_INCREMENT;
-    if(assembler_tokenize_line(buffer, &label, &mnemonic, &operands))
+    if(!is_listed_only &&
+       assembler_tokenize_line(buffer, &label, &mnemonic, &operands) &&
+       peephole_optimize(index - 1, label, &mnemonic, &operands, locctr))
     {
       if(!strcmp("START", mnemonic))
       {
@@ -606,37 +963,52 @@ static bool assembler_pass1(FILE *asm_file, FILE *int_file, int *program_len)
           return false;
         }
 
-        locctr = strtol(operands[0], NULL, HEX);
+        program_start = strtol(operands[0], NULL, HEX);
 
-        fprintf(int_file, "%d\t%X\t%X\n", line, locctr, instruction_len);
+        // The START line has the absolute start address.
+        fprintf(int_file,
+                "%d\t%d\t%X\t%X\t%d\t%X\t%d\n",
+                line,
+                SYMBOL_ABSOLUTE_BLOCK,
+                program_start,
+                instruction_len,
+                EXPRESSION_NONE,
+                0,
+                SYMBOL_ABSOLUTE_BLOCK);
 
         // Read lines until meet the first non-empty and non-comment line.
-        while(fgets(buffer, BUFFER_LEN, asm_file))
+        while(assembler_read_line(&index, buffer, &line, &is_listed_only))
         {
-          line += LINE_INCREMENT;
-          if(assembler_tokenize_line(buffer, &label, &mnemonic, &operands))
+          if(!is_listed_only &&
+             assembler_tokenize_line(buffer, &label, &mnemonic, &operands) &&
+             peephole_optimize(index - 1, label, &mnemonic, &operands, locctr))
           {
-            fprintf(int_file, "%d\t%X\t", line, locctr);
+            fprintf(int_file, "%d\t%d\t%X\t", line, block_get_current(), locctr);
             break;
           }
         }
       }
       else
       {
-        locctr = 0;
-
-        fprintf(int_file, "%d\t%X\t%X\n", line, locctr, instruction_len);
+        // This line is the first instruction, whose length is written below.
+        fprintf(int_file, "%d\t%d\t%X\t", line, block_get_current(), locctr);
       }
 
       break;
     }
   }
   // Now, buffer has the first non-comment line after the START line.
-  program_start = locctr;
+  // Locctrs are relative to their blocks until blocks are assigned.
+  locctr = 0;
 
   while(strcmp("END", mnemonic))
   {
-    if(label)
+    // A value of the operand folded in this pass, which pass 2 reuses.
+    enum expression_type type        = EXPRESSION_NONE;
+    int                  value       = 0;
+    int                  value_block = SYMBOL_ABSOLUTE_BLOCK;
+
+    if(label && strcmp("EQU", mnemonic))
     {
       if(symbol_is_exist(label))
       {
@@ -645,14 +1017,47 @@ static bool assembler_pass1(FILE *asm_file, FILE *int_file, int *program_len)
       }
       else
       {
-        if(!symbol_insert_symbol(label, locctr))
+        if(!symbol_insert_symbol(label, locctr, block_get_current()))
         {
-          printf("assemble: symbol '%s' insertion failed\n", label);
+          json_printf("assemble: symbol '%s' insertion failed\n", label);
           return false;
         }
       }
     }
 
+    if(operands[0] && '=' == operands[0][0])
+    {
+      // Literals are placed at the next LTORG or END.
+      if(!literal_insert(operands[0]))
+      {
+        symbol_set_error(INVALID_OPERAND, line, operands[0]);
+        return false;
+      }
+    }
+
+    if(operands[0] && '=' != operands[0][0] &&
+       (!strcmp("WORD", mnemonic) ||
+        (opcode_is_opcode('+' == mnemonic[0] ? &mnemonic[1] : mnemonic) &&
+         3 == opcode_get_format('+' == mnemonic[0] ? &mnemonic[1] : mnemonic))))
+    {
+      // Fold the operand if it has no forward reference. Otherwise, pass 2
+      // evaluates it once all symbols are known.
+      const char *expression = operands[0];
+      if('#' == expression[0] || '@' == expression[0])
+      {
+        ++expression;
+      }
+      if(!expression_evaluate(expression,
+                              locctr,
+                              block_get_current(),
+                              &value,
+                              &type,
+                              &value_block))
+      {
+        type = EXPRESSION_NONE;
+      }
+    }
+
     if(opcode_is_opcode(mnemonic))
     {
       int format = opcode_get_format(mnemonic);
@@ -745,473 +1150,975 @@ static bool assembler_pass1(FILE *asm_file, FILE *int_file, int *program_len)
         return false;
       }
 
-      instruction_len = strtol(operands[0], NULL, DECIMAL);
-    }
-    else if(!strcmp("RESW", mnemonic))
-    {
+      enum expression_type count_type  = EXPRESSION_NONE;
+      int                  count_block = SYMBOL_ABSOLUTE_BLOCK;
+      if(!expression_evaluate(operands[0],
+                              locctr,
+                              block_get_current(),
+                              &instruction_len,
+                              &count_type,
+                              &count_block) ||
+         EXPRESSION_ABSOLUTE != count_type || 0 > instruction_len)
+      {
+        symbol_set_error(INVALID_OPERAND, line, operands[0]);
+        return false;
+      }
+    }
+    else if(!strcmp("RESW", mnemonic))
+    {
       if(!operands[0] || operands[1])
       {
         symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
         return false;
       }
 
-      instruction_len = 3 * strtol(operands[0], NULL, DECIMAL);
+      enum expression_type count_type  = EXPRESSION_NONE;
+      int                  count_block = SYMBOL_ABSOLUTE_BLOCK;
+      if(!expression_evaluate(operands[0],
+                              locctr,
+                              block_get_current(),
+                              &instruction_len,
+                              &count_type,
+                              &count_block) ||
+         EXPRESSION_ABSOLUTE != count_type || 0 > instruction_len)
+      {
+        symbol_set_error(INVALID_OPERAND, line, operands[0]);
+        return false;
+      }
+      instruction_len *= 3;
     }
     else if(!strcmp("BASE", mnemonic) ||
             !strcmp("NOBASE", mnemonic))
     {
       // Do nothing.
     }
+    else if(!strcmp("LTORG", mnemonic))
+    {
+      // The length of LTORG is the length of its pool.
+      instruction_len = literal_assign_pool(locctr, block_get_current()) -
+                        locctr;
+    }
+    else if(!strcmp("EQU", mnemonic))
+    {
+      if(!label)
+      {
+        symbol_set_error(INVALID_OPCODE, line, mnemonic);
+        return false;
+      }
+      if(!operands[0] || operands[1])
+      {
+        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
+        return false;
+      }
+
+      // Symbols in EQU must be defined before, so it is always folded.
+      if(!expression_evaluate(operands[0],
+                              locctr,
+                              block_get_current(),
+                              &value,
+                              &type,
+                              &value_block))
+      {
+        symbol_set_error(INVALID_OPERAND, line, operands[0]);
+        return false;
+      }
+      if(symbol_is_exist(label))
+      {
+        symbol_set_error(DUPLICATE_SYMBOL, line, label);
+        return false;
+      }
+      if(!symbol_insert_symbol(label, value, value_block))
+      {
+        json_printf("assemble: symbol '%s' insertion failed\n", label);
+        return false;
+      }
+    }
+    else if(!strcmp("ORG", mnemonic))
+    {
+      if(operands[1])
+      {
+        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
+        return false;
+      }
+
+      // ORG without operand restores the locctr saved by the last ORG.
+      int new_locctr = org_locctr;
+      if(operands[0])
+      {
+        enum expression_type org_type  = EXPRESSION_NONE;
+        int                  org_block = SYMBOL_ABSOLUTE_BLOCK;
+        if(!expression_evaluate(operands[0],
+                                locctr,
+                                block_get_current(),
+                                &new_locctr,
+                                &org_type,
+                                &org_block) ||
+           EXPRESSION_RELATIVE != org_type ||
+           block_get_current() != org_block)
+        {
+          symbol_set_error(INVALID_OPERAND, line, operands[0]);
+          return false;
+        }
+        org_locctr = locctr;
+      }
+      else if(0 > org_locctr)
+      {
+        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
+        return false;
+      }
+      else
+      {
+        org_locctr = -1;
+      }
+
+      // The length of ORG moves the locctr, and it can be negative.
+      instruction_len = new_locctr - locctr;
+    }
+    else if(!strcmp("USE", mnemonic))
+    {
+      if(operands[1])
+      {
+        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
+        return false;
+      }
+
+      // USE without operand switches to the default block.
+      locctr = block_use(operands[0], locctr);
+    }
     else
     {
       symbol_set_error(INVALID_OPCODE, line, mnemonic);
       return false;
     }
 
-    fprintf(int_file, "%X\n", instruction_len);
+    fprintf(int_file,
+            "%X\t%d\t%X\t%d\n",
+            instruction_len,
+            type,
+            value,
+            value_block);
     locctr += instruction_len;
     instruction_len = 0;
+    block_extend(locctr);
 
     do
     {
-      if(!fgets(buffer, BUFFER_LEN, asm_file))
+      if(!assembler_read_line(&index, buffer, &line, &is_listed_only))
       {
-        printf("assemble: END mnemonic is not found\n");
+        json_printf("assemble: END mnemonic is not found\n");
         return false;
       }
-      line += LINE_INCREMENT;
 
-      // Skip empty or comment lines.
-    } while(!assembler_tokenize_line(buffer, &label, &mnemonic, &operands));
+      // Skip empty, comment, macro definition, or removed lines.
+    } while(is_listed_only ||
+            !assembler_tokenize_line(buffer, &label, &mnemonic, &operands) ||
+            !peephole_optimize(index - 1, label, &mnemonic, &operands, locctr));
 
-    fprintf(int_file, "%d\t%X\t", line, locctr);
+    fprintf(int_file, "%d\t%d\t%X\t", line, block_get_current(), locctr);
   }
 
-  *program_len = locctr - program_start;
+  // The last pool is placed after END.
+  locctr = literal_assign_pool(locctr, block_get_current());
+  block_extend(locctr);
+
+  // Blocks are placed one after another, and symbols and literals in them
+  // are relocated from their blocks to the program.
+  *program_len = block_assign_addresses(program_start) - program_start;
+  for(int block = 0; block < block_get_count(); ++block)
+  {
+    symbol_relocate_block(block, block_get_address(block));
+    literal_relocate_block(block, block_get_address(block));
+  }
 
   return true;
 }
 
-static bool assembler_pass2(FILE *asm_file,
-                            FILE *int_file,
-                            FILE *lst_file,
-                            FILE *obj_file,
-                            int  program_len)
+static bool assembler_pass2(const char *asm_filename,
+                            FILE       *int_file,
+                            FILE       *lst_file,
+                            FILE       *obj_file,
+                            int        program_len)
 {
   int                 program_start             = 0;
-  int                 line                      = 0;
-  int                 locctr                    = 0;
-  int                 instruction_len           = 0;
-  char                *label                    = NULL;
-  char                *mnemonic                 = NULL;
-  char                *operands[OPERANDS_COUNT];
-  char                buffer[BUFFER_LEN];
   char                text_record[BUFFER_LEN];
   int                 text_record_start         = 0;
   bool                write_text_record         = false;
   struct modif_record *modif_records            = NULL;
-  int                 base                      = 0;
-  bool                is_base_relative_enabled  = false;
+  struct line_record  *line_records             = NULL;
+  struct line_record  *last_line_record         = NULL;
+  int                 literal_pool              = 0;
+  int                 index                     = 0;
+  int                 lines_count               = 0;
+  bool                is_success                = true;
+
+  // Lines are read in order, since .int file and the peephole optimizer are
+  // sequential. Once read, each line is encoded independently.
+  struct pass2_line *lines = assembler_pass2_read_lines(int_file, &lines_count);
+  assembler_pass2_encode_lines(lines, lines_count);
 
   // Read the first non-empty and non-comment line.
-  assembler_pass2_get_ready_line(asm_file,
-                                 int_file,
-                                 lst_file,
-                                 buffer,
-                                 &line,
-                                 &locctr,
-                                 &instruction_len,
-                                 &label,
-                                 &mnemonic,
-                                 &operands);
-
-  if(!strcmp("START", mnemonic))
+  struct pass2_line *walk = assembler_pass2_next_line(lines,
+                                                      lines_count,
+                                                      &index,
+                                                      lst_file);
+  if(!walk)
+  {
+    free(lines);
+    return false;
+  }
+
+  if(!strcmp("START", walk->mnemonic))
   {
     // Write header record to .obj file with program name.
-    assembler_write_obj_header(obj_file, label, locctr, program_len);
+    assembler_write_obj_header(obj_file, walk->label, walk->locctr, program_len);
 
-    assembler_write_lst_object_code(lst_file, NULL);
+    assembler_write_lst_object_code(lst_file, NULL, NULL);
 
-    assembler_pass2_get_ready_line(asm_file,
-                                   int_file,
-                                   lst_file,
-                                   buffer,
-                                   &line,
-                                   &locctr,
-                                   &instruction_len,
-                                   &label,
-                                   &mnemonic,
-                                   &operands);
+    walk = assembler_pass2_next_line(lines, lines_count, &index, lst_file);
   }
   else
   {
     // Write header record to .obj file without program name.
-    assembler_write_obj_header(obj_file, NULL, locctr, program_len);
+    assembler_write_obj_header(obj_file, NULL, walk->locctr, program_len);
   }
-  // Now, buffer has the first non-comment line after the START line.
+  // Now, walk is the first non-comment line after the START line.
 
   // Prepare text record that will be written to .obj file.
   memset(text_record, 0, sizeof(text_record));
-  text_record_start = locctr;
+  text_record_start = walk ? walk->locctr : 0;
 
-  // Start assembly.
-  while(strcmp("END", mnemonic))
+  // Write encoded lines in order.
+  while(walk && strcmp("END", walk->mnemonic))
   {
-    char object_code[BUFFER_LEN];
-    int  opcode                  = 0;
-    int  n                       = 0;
-    int  i                       = 0;
-    int  x                       = 0;
-    int  b                       = 0;
-    int  p                       = 0;
-    int  e                       = 0;
-    int  displacement            = 0;
-    int  address                 = 0;
-
-    locctr += instruction_len; // Advance locctr points to the next instruciton.
-
-    memset(object_code, 0, sizeof(object_code));
-    if(!strcmp("BYTE", mnemonic))
+    if(NONE != walk->error)
     {
-      if(!operands[0])
-      {
-        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
-        return false;
-      }
+      symbol_set_error(walk->error, walk->line, walk->error_keyword);
+      is_success = false;
+      break;
+    }
 
-      if('C' == operands[0][0])
-      {
-        for(int i = 2; i < strlen(operands[0]) - 1; ++i)
-        {
-          // Store half-word for one byte.
-          sprintf(&object_code[2 * (i - 2)], "%02X", operands[0][i]);
-        }
-      }
-      else if('X' == operands[0][0])
-      {
-        strncpy(object_code, &operands[0][2], strlen(operands[0]) - 3);
-      }
-      else
-      {
-        symbol_set_error(INVALID_OPERAND, line, operands[0]);
-        return false;
-      }
+    // Advance locctr points to the next instruciton.
+    const int locctr = walk->locctr + walk->instruction_len;
+
+    if(walk->modif_len)
+    {
+      assembler_create_modif_record(&modif_records,
+                                    walk->modif_start,
+                                    walk->modif_len);
     }
-    else if(!strcmp("WORD", mnemonic))
+    if(walk->has_line_record)
     {
-      if(!operands[0])
+      assembler_create_line_record(&line_records,
+                                   &last_line_record,
+                                   walk->locctr,
+                                   walk->line);
+    }
+    write_text_record = walk->ends_text_record;
+
+    if(!strlen(text_record) && strlen(walk->object_code))
+    {
+      // The text record starts at this line, which can be in another block.
+      text_record_start = walk->locctr;
+    }
+    strcat(text_record, walk->object_code);
+    if(TEXT_RECORD_MAX_LEN <= strlen(text_record))
+    {
+      write_text_record = true;
+    }
+
+    // Write text record if there was a variable or text record is full.
+    if(write_text_record)
+    {
+      if(strlen(text_record))
       {
-        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
-        return false;
+        assembler_write_obj_text(obj_file, text_record_start, text_record);
+        memset(text_record, 0, sizeof(text_record));
       }
+      text_record_start = locctr;
+      write_text_record = false;
+    }
+
+    assembler_write_lst_object_code(lst_file, walk->object_code, walk->note);
 
-      sprintf(object_code, "%06X", (unsigned int)strtol(operands[0], NULL, DECIMAL));
+    if(!strcmp("LTORG", walk->mnemonic))
+    {
+      assembler_write_literal_pool(lst_file,
+                                   obj_file,
+                                   literal_pool++,
+                                   text_record,
+                                   &text_record_start);
     }
-    else if(!strcmp("RESB", mnemonic) || !strcmp("RESW", mnemonic))
+
+    walk = assembler_pass2_next_line(lines, lines_count, &index, lst_file);
+  }
+
+  if(is_success)
+  {
+    // Write trailing lines to .lst file.
+    assembler_write_lst_newline(lst_file);
+
+    // Write the last pool after END.
+    assembler_write_literal_pool(lst_file,
+                                 obj_file,
+                                 literal_pool,
+                                 text_record,
+                                 &text_record_start);
+
+    // Write remaining text record, modification record, and end record
+    // to .obj file.
+    assembler_write_obj_text(obj_file, text_record_start, text_record);
+    assembler_write_obj_modif(obj_file, modif_records);
+    assembler_write_obj_lines(obj_file, asm_filename, line_records);
+    assembler_write_obj_end(obj_file, program_start);
+  }
+
+  // Release modification records, line records, and lines.
+  assembler_release_modif_records(modif_records);
+  assembler_release_line_records(line_records);
+  free(lines);
+
+  return is_success;
+}
+
+static void assembler_pass2_encode_line(struct pass2_line *pass2_line,
+                                        int               *base,
+                                        bool              *is_base_relative_enabled)
+{
+  // Tokens are advanced while encoding, so work on copies.
+  char                 *mnemonic                = pass2_line->mnemonic;
+  char                 *operands[OPERANDS_COUNT];
+  char                 *object_code             = pass2_line->object_code;
+  const int            instruction_len          = pass2_line->instruction_len;
+  const int            locctr                   = pass2_line->locctr +
+                                                  instruction_len;
+  enum expression_type type                     = pass2_line->type;
+  int                  value                    = pass2_line->value;
+  int                  value_block              = SYMBOL_ABSOLUTE_BLOCK;
+  int                  opcode                   = 0;
+  int                  n                        = 0;
+  int                  i                        = 0;
+  int                  x                        = 0;
+  int                  b                        = 0;
+  int                  p                        = 0;
+  int                  e                        = 0;
+  int                  displacement             = 0;
+  int                  address                  = 0;
+
+  if(!pass2_line->is_encoded)
+  {
+    return;
+  }
+  memcpy(operands, pass2_line->operands, sizeof(operands));
+
+  if(!strcmp("BYTE", mnemonic))
+  {
+    if(!operands[0])
     {
-      write_text_record = true;
+      assembler_pass2_set_error(pass2_line, REQUIRED_ONE_OPERAND, mnemonic);
+      return;
     }
-    else if(!strcmp("BASE", mnemonic))
+
+    if('C' == operands[0][0])
     {
-      if(!operands[0])
+      for(int i = 2; i < strlen(operands[0]) - 1; ++i)
       {
-        symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
-        return false;
+        // Store half-word for one byte.
+        sprintf(&object_code[2 * (i - 2)], "%02X", operands[0][i]);
       }
+    }
+    else if('X' == operands[0][0])
+    {
+      strncpy(object_code, &operands[0][2], strlen(operands[0]) - 3);
+    }
+    else
+    {
+      assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+      return;
+    }
+  }
+  else if(!strcmp("WORD", mnemonic))
+  {
+    if(!operands[0])
+    {
+      assembler_pass2_set_error(pass2_line, REQUIRED_ONE_OPERAND, mnemonic);
+      return;
+    }
+
+    if(EXPRESSION_NONE == type &&
+       !expression_evaluate(operands[0],
+                            locctr - instruction_len,
+                            pass2_line->block,
+                            &value,
+                            &type,
+                            &value_block))
+    {
+      assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+      return;
+    }
 
-      base = symbol_get_locctr(operands[0]);
-      is_base_relative_enabled = true;
+    sprintf(object_code, "%06X", value & WORD_MASK);
+    if(EXPRESSION_RELATIVE == type)
+    {
+      // The whole word is an address to be relocated.
+      pass2_line->modif_start = locctr - instruction_len;
+      pass2_line->modif_len   = 6;
+    }
+  }
+  else if(!strcmp("RESB", mnemonic) ||
+          !strcmp("RESW", mnemonic) ||
+          !strcmp("ORG", mnemonic) ||
+          !strcmp("USE", mnemonic))
+  {
+    pass2_line->ends_text_record = true;
+  }
+  else if(!strcmp("BASE", mnemonic))
+  {
+    if(!operands[0])
+    {
+      assembler_pass2_set_error(pass2_line, REQUIRED_ONE_OPERAND, mnemonic);
+      return;
     }
-    else if(!strcmp("NOBASE", mnemonic))
+
+    enum expression_type base_type = EXPRESSION_NONE;
+    if(!expression_evaluate(operands[0],
+                            locctr - instruction_len,
+                            pass2_line->block,
+                            base,
+                            &base_type,
+                            &value_block))
     {
-      is_base_relative_enabled = false;
+      assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+      return;
+    }
+    *is_base_relative_enabled = true;
+  }
+  else if(!strcmp("NOBASE", mnemonic))
+  {
+    *is_base_relative_enabled = false;
+  }
+  else if(!strcmp("LTORG", mnemonic))
+  {
+    // The pool is written after this line.
+  }
+  else if(!strcmp("EQU", mnemonic))
+  {
+    // Nothing to do. The symbol is defined in pass 1.
+  }
+  else
+  {
+    if(opcode_is_opcode(mnemonic))
+    {
+      // Nothing to do.
+    }
+    else if('+' == mnemonic[0] && opcode_is_opcode(&mnemonic[1]))
+    {
+      // Format 4.
+      e = 1;
+      ++mnemonic;
     }
     else
     {
-      if(opcode_is_opcode(mnemonic))
+      assembler_pass2_set_error(pass2_line, INVALID_OPCODE, mnemonic);
+      return;
+    }
+
+    opcode       = opcode_get_opcode(mnemonic);
+    int format = opcode_get_format(mnemonic);
+    if(1 == format)
+    {
+      if(e)
       {
-        // Nothing to do.
+        --mnemonic;
+        assembler_pass2_set_error(pass2_line, INVALID_OPCODE, mnemonic);
+        return;
       }
-      else if('+' == mnemonic[0] && opcode_is_opcode(&mnemonic[1]))
+
+      sprintf(object_code, "%02X", opcode);
+    }
+    else if(2 == format)
+    {
+      if(e)
       {
-        // Format 4.
-        e = 1;
-        ++mnemonic;
+        --mnemonic;
+        assembler_pass2_set_error(pass2_line, INVALID_OPCODE, mnemonic);
+        return;
       }
-      else
+
+      if(!operands[0])
       {
-        symbol_set_error(INVALID_OPCODE, line, mnemonic);
-        return false;
+        assembler_pass2_set_error(pass2_line, REQUIRED_ONE_OPERAND, mnemonic);
+        return;
       }
 
-      opcode       = opcode_get_opcode(mnemonic);
-      int format = opcode_get_format(mnemonic);
-      if(1 == format)
+      sprintf(object_code, "%02X", opcode);
+      if(!strcmp("SVC", mnemonic))
       {
-        if(e)
+        // SVC takes a number n in place of r1.
+        char       *endptr = NULL;
+        const long n       = strtol(operands[0], &endptr, DECIMAL);
+        if('\0' != *endptr || 0 > n || 0xF < n)
         {
-          --mnemonic;
-          symbol_set_error(INVALID_OPCODE, line, mnemonic);
-          return false;
+          assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+          return;
         }
-
-        sprintf(object_code, "%02X", opcode);
+        sprintf(&object_code[2], "%1X0", (int)n);
       }
-      else if(2 == format)
+      else
       {
-        if(e)
-        {
-          --mnemonic;
-          symbol_set_error(INVALID_OPCODE, line, mnemonic);
-          return false;
-        }
-
-        if(!operands[0])
-        {
-          symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
-          return false;
-        }
-
-        sprintf(object_code, "%02X", opcode);
         sprintf(&object_code[2], "%1X", symbol_get_locctr(operands[0]));
         sprintf(&object_code[3], "%1X", operands[1] ?
                                         symbol_get_locctr(operands[1]) :
                                         0);
       }
-      else if(3 == format)
+    }
+    else if(3 == format)
+    {
+      if(!strcmp("RSUB", mnemonic))
+      {
+        // RSUB does not require any operand, uniquely.
+        // Simple addressing.
+        n = 1;
+        i = 1;
+      }
+      else if(!operands[0])
+      {
+        // All format 3 or 4 instructions require at least one operand.
+        assembler_pass2_set_error(pass2_line, REQUIRED_ONE_OPERAND, mnemonic);
+        return;
+      }
+      else
       {
-        if(!strcmp("RSUB", mnemonic))
+        if('#' == operands[0][0])
+        {
+          // Immediate addressing.
+          n = 0;
+          i = 1;
+          ++operands[0];
+        }
+        else if('@' == operands[0][0])
+        {
+          // Indirect addressing.
+          n = 1;
+          i = 0;
+          ++operands[0];
+        }
+        else if('=' == operands[0][0])
+        {
+          // Literal, which is addressed like a symbol.
+          n = 1;
+          i = 1;
+        }
+        else
         {
-          // RSUB does not require any operand, uniquely.
           // Simple addressing.
           n = 1;
           i = 1;
         }
-        else if(!operands[0])
+
+        if('=' != operands[0][0] &&
+           EXPRESSION_NONE == type &&
+           !expression_evaluate(operands[0],
+                                locctr - instruction_len,
+                                pass2_line->block,
+                                &value,
+                                &type,
+                                &value_block))
         {
-          // All format 3 or 4 instructions require at least one operand.
-          symbol_set_error(REQUIRED_ONE_OPERAND, line, mnemonic);
-          return false;
+          // Unknown operand.
+          assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+          return;
         }
-        else
+
+        if(operands[1])
         {
-          if('#' == operands[0][0])
-          {
-            // Immediate addressing.
-            n = 0;
-            i = 1;
-            ++operands[0];
-          }
-          else if('@' == operands[0][0])
+          if(!strcmp("X", operands[1]))
           {
-            // Indirect addressing.
-            n = 1;
-            i = 0;
-            ++operands[0];
+            // Indexed addressing.
+            x = 1;
           }
           else
           {
-            if(!symbol_is_exist(operands[0]))
-            {
-              // Unknown operand.
-              symbol_set_error(INVALID_OPERAND, line, operands[0]);
-              return false;
-            }
-
-            // Simple addressing.
-            n = 1;
-            i = 1;
-          }
-
-          if(operands[1])
-          {
-            if(!strcmp("X", operands[1]))
-            {
-              // Indexed addressing.
-              x = 1;
-            }
-            else
-            {
-              // Only register X can used for indexed addressing.
-              symbol_set_error(INVALID_OPERAND, line, operands[0]);
-              return false;
-            }
+            // Only register X can used for indexed addressing.
+            assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+            return;
           }
         }
+      }
 
-        // Calculate displacement or address.
-        if(!strcmp("RSUB", mnemonic))
+      // Calculate displacement or address.
+      if(!strcmp("RSUB", mnemonic))
+      {
+        // RSUB does not have any operand, which is
+        // direct addressing in a sense.
+        b = 0;
+        p = 0;
+        displacement = 0;
+      }
+      else if('=' != operands[0][0] && EXPRESSION_ABSOLUTE == type)
+      {
+        // An absolute value, such as immediate value, is not relocated.
+        // It is direct addressing.
+        b = 0;
+        p = 0;
+        if(e)
         {
-          // RSUB does not have any operand, which is
-          // direct addressing in a sense.
-          b = 0;
-          p = 0;
-          displacement = 0;
+          address = value & ADDRESS_MASK;
         }
-        else if(n == 0 && i == 1 && !symbol_is_exist(operands[0]))
+        else if(BASE_MIN <= value && BASE_MAX >= value)
         {
-          // Immediate addressing with value.
-          // It is also direct addressing.
-          b = 0;
-          p = 0;
-          if(e)
-          {
-            address = strtol(operands[0], NULL, DECIMAL);
-          }
-          else
-          {
-            displacement = strtol(operands[0], NULL, DECIMAL);
-          }
+          displacement = value;
         }
         else
         {
-          int  target_address        = symbol_get_locctr(operands[0]);
-          bool is_addressing_success = false;
-
-          // Try PC-relative addressing first.
-          displacement = target_address - locctr;
-          if(DISPLACEMENT_MIN <= displacement &&
-              DISPLACEMENT_MAX >= displacement)
-          {
-            b = 0;
-            p = 1;
-            is_addressing_success = true;
-          }
+          // The immediate value or the address does not fit in the
+          // displacement field, and needs format 4.
+          assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+          return;
+        }
+      }
+      else
+      {
+        int  target_address        = '=' == operands[0][0] ?
+                                     literal_get_address(operands[0],
+                                                         pass2_line->literal_pool) :
+                                     value;
+        bool is_addressing_success = false;
+
+        // Try PC-relative addressing first. Format 4 always uses
+        // direct addressing, since its address field is not relative.
+        displacement = target_address - locctr;
+        if(!e &&
+           DISPLACEMENT_MIN <= displacement &&
+           DISPLACEMENT_MAX >= displacement)
+        {
+          b = 0;
+          p = 1;
+          is_addressing_success = true;
+        }
 
-          // Try BASE-relative addressing, if PC-relative addressing failed.
-          if(!is_addressing_success)
+        // Try BASE-relative addressing, if PC-relative addressing failed.
+        if(!e && !is_addressing_success)
+        {
+          if(!*is_base_relative_enabled)
           {
-            if(!is_base_relative_enabled)
-            {
-              symbol_set_error(INVALID_OPERAND, line, operands[0]);
-              return false;
-            }
-
-            displacement = target_address - base;
-            if(BASE_MIN <= displacement &&
-                BASE_MAX >= displacement)
-            {
-              b = 1;
-              p = 0;
-              is_addressing_success = true;
-            }
+            assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+            return;
           }
 
-          // Try format 4, if BASE-relative addressing also failed.
-          if(!is_addressing_success)
+          displacement = target_address - *base;
+          if(BASE_MIN <= displacement &&
+              BASE_MAX >= displacement)
           {
-            if(!e)
-            {
-              symbol_set_error(INVALID_OPERAND, line, operands[0]);
-              return false;
-            }
-
-            // Direct addressing.
-            b = 0;
+            b = 1;
             p = 0;
-            address = target_address;
             is_addressing_success = true;
+          }
+        }
 
-            if(!symbol_is_register(operands[0]))
-            {
-              // The operand is nor register neither value.
-              // Mark its locctr in modification record for relocation.
-              assembler_create_modif_record(&modif_records,
-                                            locctr - instruction_len + 1);
-            }
+        // Try format 4, if BASE-relative addressing also failed.
+        if(!is_addressing_success)
+        {
+          if(!e)
+          {
+            assembler_pass2_set_error(pass2_line, INVALID_OPERAND, operands[0]);
+            return;
           }
+
+          // Direct addressing.
+          b = 0;
+          p = 0;
+          address = target_address;
+          is_addressing_success = true;
+
+          // The operand is relative to the program.
+          // Mark its locctr in modification record for relocation.
+          pass2_line->modif_start = locctr - instruction_len + 1;
+          pass2_line->modif_len   = 5;
         }
+      }
 
-        sprintf(object_code, "%02X", opcode + (n << 1) + i);
-        sprintf(&object_code[2], "%1X", (x << 3) + (b << 2) + (p << 1) + e);
-        sprintf(&object_code[3],
-                e ? "%05X" : "%03X",
-                e ? address : displacement & DISPLACEMENT_MASK);
+      sprintf(object_code, "%02X", opcode + (n << 1) + i);
+      sprintf(&object_code[2], "%1X", (x << 3) + (b << 2) + (p << 1) + e);
+      sprintf(&object_code[3],
+              e ? "%05X" : "%03X",
+              e ? address : displacement & DISPLACEMENT_MASK);
+    }
+    else
+    {
+      assembler_pass2_set_error(pass2_line, INVALID_OPCODE, mnemonic);
+      return;
+    }
+
+    pass2_line->has_line_record = true;
+  }
+}
+
+static void assembler_pass2_encode_lines(struct pass2_line *lines,
+                                         const int         lines_count)
+{
+  const int chunks_count = (lines_count + _pass2_chunk_len - 1) /
+                           _pass2_chunk_len;
+  if(!chunks_count)
+  {
+    return;
+  }
+
+  // BASE is the only state carried from line to line. Compute it at the
+  // first line of each chunk, so that chunks are independent.
+  struct pass2_chunk *chunks                   = malloc(chunks_count * sizeof(*chunks));
+  int                base                      = 0;
+  bool               is_base_relative_enabled  = false;
+  for(int i = 0; i < chunks_count; ++i)
+  {
+    chunks[i].lines                    = &lines[i * _pass2_chunk_len];
+    chunks[i].lines_count              = i < chunks_count - 1 ?
+                                         _pass2_chunk_len :
+                                         lines_count - i * _pass2_chunk_len;
+    chunks[i].base                     = base;
+    chunks[i].is_base_relative_enabled = is_base_relative_enabled;
+
+    for(int j = 0; j < chunks[i].lines_count; ++j)
+    {
+      const struct pass2_line *walk = &chunks[i].lines[j];
+      if(!walk->is_encoded)
+      {
+        continue;
       }
-      else
+
+      enum expression_type base_type   = EXPRESSION_NONE;
+      int                  value_block = SYMBOL_ABSOLUTE_BLOCK;
+      if(!strcmp("BASE", walk->mnemonic) &&
+         walk->operands[0] &&
+         expression_evaluate(walk->operands[0],
+                             walk->locctr,
+                             walk->block,
+                             &base,
+                             &base_type,
+                             &value_block))
       {
-        symbol_set_error(INVALID_OPCODE, line, mnemonic);
-        return false;
+        is_base_relative_enabled = true;
+      }
+      else if(!strcmp("NOBASE", walk->mnemonic))
+      {
+        is_base_relative_enabled = false;
       }
     }
+  }
 
-    strcat(text_record, object_code);
-    if(TEXT_RECORD_MAX_LEN <= strlen(text_record))
-    {
-      write_text_record = true;
-    }
+  struct pass2_pool pool = {.chunks       = chunks,
+                            .chunks_count = chunks_count,
+                            .next         = 0};
+  pthread_mutex_init(&pool.mutex, NULL);
 
-    // Write text record if there was a variable or text record is full.
-    if(write_text_record)
+  // The calling thread also takes chunks, so a program of one chunk, or a
+  // failure to create threads, does not need any other thread.
+  long threads_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if(threads_count > chunks_count)
+  {
+    threads_count = chunks_count;
+  }
+  pthread_t *threads       = NULL;
+  int       created_count  = 0;
+  if(1 < threads_count)
+  {
+    threads = malloc((threads_count - 1) * sizeof(*threads));
+    for(int i = 0; i < threads_count - 1; ++i)
     {
-      if(strlen(text_record))
+      if(!pthread_create(&threads[created_count], NULL, assembler_pass2_work, &pool))
       {
-        assembler_write_obj_text(obj_file, text_record_start, text_record);
-        memset(text_record, 0, sizeof(text_record));
+        ++created_count;
       }
-      text_record_start = locctr;
-      write_text_record = false;
     }
+  }
+  assembler_pass2_work(&pool);
+  for(int i = 0; i < created_count; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_mutex_destroy(&pool.mutex);
+  free(threads);
+  free(chunks);
+}
 
-    assembler_write_lst_object_code(lst_file, object_code);
+static struct pass2_line *assembler_pass2_next_line(struct pass2_line *lines,
+                                                    const int         lines_count,
+                                                    int               *index,
+                                                    FILE              *lst_file)
+{
+  while(*index < lines_count)
+  {
+    struct pass2_line *walk = &lines[(*index)++];
+    if(walk->is_comment)
+    {
+      assembler_write_lst_comment(lst_file, walk->line, walk->buffer);
+      continue;
+    }
 
-    assembler_pass2_get_ready_line(asm_file,
-                                   int_file,
-                                   lst_file,
-                                   buffer,
-                                   &line,
-                                   &locctr,
-                                   &instruction_len,
-                                   &label,
-                                   &mnemonic,
-                                   &operands);
+    // EQU lines show their values instead of locctrs.
+    assembler_write_lst_line(lst_file,
+                             walk->line,
+                             strcmp("EQU", walk->mnemonic) ?
+                             walk->locctr :
+                             walk->value,
+                             walk->label,
+                             walk->mnemonic,
+                             walk->operands[0],
+                             walk->operands[1]);
+    return walk;
   }
 
-  // Write trailing lines to .lst file.
-  assembler_write_lst_newline(lst_file);
+  return NULL;
+}
 
-  // Write remaining text record, modification record, and end record
-  // to .obj file.
-  assembler_write_obj_text(obj_file, text_record_start, text_record);
-  assembler_write_obj_modif(obj_file, modif_records);
-  assembler_write_obj_end(obj_file, program_start);
+static struct pass2_line *assembler_pass2_read_lines(FILE *int_file,
+                                                     int  *lines_count)
+{
+  // Lines are never more than expanded lines, and never moved once read
+  // since tokens point into them.
+  struct pass2_line *lines        = calloc(macro_get_line_count() + 1,
+                                           sizeof(*lines));
+  int               index         = 0;
+  int               literal_pool  = 0;
+  bool              is_first_line = true;
+
+  *lines_count = 0;
+  for(struct pass2_line *walk = lines;
+      assembler_read_line(&index, walk->buffer, &walk->line, &walk->is_comment);
+      walk = &lines[++*lines_count])
+  {
+    if(walk->is_comment ||
+       !assembler_tokenize_line(walk->buffer,
+                                &walk->label,
+                                &walk->mnemonic,
+                                &walk->operands))
+    {
+      walk->is_comment = true;
+      continue;
+    }
+    if(!peephole_apply(index - 1, &walk->mnemonic, &walk->operands))
+    {
+      // The line removed by the peephole optimizer is listed as a comment.
+      char note[BUFFER_LEN];
+      snprintf(note, sizeof(note), ". -O %s", peephole_get_note(index - 1));
+      strcpy(walk->buffer, note);
+      walk->is_comment = true;
+      continue;
+    }
 
-  // Release modification records.
-  assembler_release_modif_records(modif_records);
+    // The END line has neither length nor folded value.
+    int folded_type = EXPRESSION_NONE;
+    int value_block = SYMBOL_ABSOLUTE_BLOCK;
+    walk->block     = SYMBOL_ABSOLUTE_BLOCK;
+    fscanf(int_file,
+           "%d\t%d\t%X\t%X\t%d\t%X\t%d\n",
+           &walk->line,
+           &walk->block,
+           &walk->locctr,
+           &walk->instruction_len,
+           &folded_type,
+           &walk->value,
+           &value_block);
+    walk->type = folded_type;
+
+    // Locctrs and folded values in .int file are relative to their blocks.
+    if(SYMBOL_ABSOLUTE_BLOCK != walk->block)
+    {
+      block_set_current(walk->block);
+      walk->locctr += block_get_address(walk->block);
+    }
+    if(EXPRESSION_RELATIVE == walk->type)
+    {
+      walk->value += block_get_address(value_block);
+    }
 
-  return true;
+    walk->note         = peephole_get_note(index - 1);
+    walk->error        = NONE;
+    walk->literal_pool = literal_pool;
+    walk->is_encoded   = !(is_first_line && !strcmp("START", walk->mnemonic)) &&
+                         strcmp("END", walk->mnemonic);
+    if(!strcmp("LTORG", walk->mnemonic))
+    {
+      ++literal_pool;
+    }
+    is_first_line = false;
+
+    if(!strcmp("END", walk->mnemonic))
+    {
+      ++*lines_count;
+      break;
+    }
+  }
+
+  return lines;
+}
+
+static void assembler_pass2_set_error(struct pass2_line       *pass2_line,
+                                      const enum symbol_error error,
+                                      const char              *keyword)
+{
+  pass2_line->error         = error;
+  pass2_line->error_keyword = keyword;
 }
 
-static void assembler_pass2_get_ready_line(FILE *asm_file,
-                                           FILE *int_file,
-                                           FILE *lst_file,
-                                           char *buffer,
-                                           int  *line,
-                                           int  *locctr,
-                                           int  *instruction_len,
-                                           char **label,
-                                           char **mnemonic,
-                                           char *(*operands)[])
+static void *assembler_pass2_work(void *pool)
 {
-  while(fgets(buffer, BUFFER_LEN, asm_file))
+  struct pass2_pool *chunks_pool = pool;
+
+  while(true)
   {
-    if(assembler_tokenize_line(buffer, label, mnemonic, operands))
+    pthread_mutex_lock(&chunks_pool->mutex);
+    const int next = chunks_pool->next < chunks_pool->chunks_count ?
+                     chunks_pool->next++ :
+                     -1;
+    pthread_mutex_unlock(&chunks_pool->mutex);
+    if(0 > next)
     {
-      fscanf(int_file, "%d\t%X\t%X\n", line, locctr, instruction_len);
-      assembler_write_lst_line(lst_file,
-                               *line,
-                               *locctr,
-                               *label,
-                               *mnemonic,
-                               (*operands)[0],
-                               (*operands)[1]);
       break;
     }
-    else
+
+    struct pass2_chunk *chunk                   = &chunks_pool->chunks[next];
+    int                base                     = chunk->base;
+    bool               is_base_relative_enabled = chunk->is_base_relative_enabled;
+    for(int i = 0; i < chunk->lines_count; ++i)
+    {
+      assembler_pass2_encode_line(&chunk->lines[i],
+                                  &base,
+                                  &is_base_relative_enabled);
+    }
+  }
+
+  return NULL;
+}
+
+static void assembler_write_literal_pool(FILE      *lst_file,
+                                         FILE      *obj_file,
+                                         const int pool,
+                                         char      *text_record,
+                                         int       *text_record_start)
+{
+  int        address     = 0;
+  const char *object_code = NULL;
+  const char *literal     = NULL;
+  for(int i = 0;
+      (literal = literal_get_pool_entry(pool, i, &address, &object_code));
+      ++i)
+  {
+    if(!strlen(text_record))
+    {
+      *text_record_start = address;
+    }
+    else if(TEXT_RECORD_MAX_LEN < strlen(text_record) + strlen(object_code))
     {
-      *line += LINE_INCREMENT;
-      assembler_write_lst_comment(lst_file, *line, buffer);
+      assembler_write_obj_text(obj_file, *text_record_start, text_record);
+      memset(text_record, 0, BUFFER_LEN);
+      *text_record_start = address;
     }
+    strcat(text_record, object_code);
+
+    // Pool lines have no line number since they are not in .asm file.
+    assembler_write_lst_line(lst_file, 0, address, "*", literal, NULL, NULL);
+    assembler_write_lst_object_code(lst_file, object_code, NULL);
   }
 }
 
@@ -1219,7 +2126,7 @@ static void assembler_write_lst_comment(FILE       *lst_file,
                                         const int  line,
                                         const char *buffer)
 {
-  fprintf(lst_file, "%3d\t%3s\t%s\n", line, " ", buffer);
+  writer_printf(lst_file, "%3d\t%3s\t%s\n", line, " ", buffer);
 }
 
 static void assembler_write_lst_line(FILE       *lst_file,
@@ -1230,21 +2137,27 @@ static void assembler_write_lst_line(FILE       *lst_file,
                                      const char *operand1,
                                      const char *operand2)
 {
-  fprintf(lst_file, "%3d", line);
+  char line_column[BUFFER_LEN];
+  char locctr_column[BUFFER_LEN];
+  if(0 < line)
+  {
+    snprintf(line_column, sizeof(line_column), "%3d", line);
+  }
+  else
+  {
+    snprintf(line_column, sizeof(line_column), "%3s", " ");
+  }
   if(strcmp("BASE", mnemonic) &&
      strcmp("NOBASE", mnemonic) &&
+     strcmp("USE", mnemonic) &&
      strcmp("END", mnemonic))
   {
-    fprintf(lst_file, "\t%04X", locctr);
+    snprintf(locctr_column, sizeof(locctr_column), "%04X", locctr);
   }
   else
   {
-    fprintf(lst_file, "\t%4s", " ");
+    snprintf(locctr_column, sizeof(locctr_column), "%4s", " ");
   }
-  fprintf(lst_file, "\t%-6s", label ? label : " ");
-  fprintf(lst_file, "\t%-6s", mnemonic);
-  fprintf(lst_file, "\t%s", operand1 ? : "");
-  fprintf(lst_file, "%2s%s", operand2 ? ", " : " ", operand2 ? operand2 : "");
 
   // Add padding for columns alignment.
   int padding = 14;
@@ -1256,27 +2169,41 @@ static void assembler_write_lst_line(FILE       *lst_file,
   {
     padding -= strlen(operand2);
   }
-  for(int i = 0; i < padding; ++i)
-  {
-    fprintf(lst_file, "%s", " ");
-  }
+
+  // The whole line is one record of the writer.
+  writer_printf(lst_file,
+                "%s\t%s\t%-6s\t%-6s\t%s%2s%s%*s",
+                line_column,
+                locctr_column,
+                label ? label : " ",
+                mnemonic,
+                operand1 ? : "",
+                operand2 ? ", " : " ",
+                operand2 ? operand2 : "",
+                0 < padding ? padding : 0,
+                "");
 }
 
 static void assembler_write_lst_newline(FILE *lst_file)
 {
-  fprintf(lst_file, "\n");
+  writer_printf(lst_file, "\n");
 }
 
 static void assembler_write_lst_object_code(FILE       *lst_file,
-                                            const char *object_code)
+                                            const char *object_code,
+                                            const char *note)
 {
-  fprintf(lst_file, "%-6s\n", object_code ? object_code : "");
+  writer_printf(lst_file,
+                "%-6s%s%s\n",
+                object_code ? object_code : "",
+                note ? "\t. -O " : "",
+                note ? note : "");
 }
 
 static void assembler_write_obj_end(FILE      *obj_file,
                                     const int program_start)
 {
-  fprintf(obj_file, "E%06X\n", program_start);
+  writer_printf(obj_file, "E%06X\n", program_start);
 }
 
 static void assembler_write_obj_header(FILE       *obj_file,
@@ -1284,18 +2211,48 @@ static void assembler_write_obj_header(FILE       *obj_file,
                                        const int  program_start,
                                        const int  program_len)
 {
-  fprintf(obj_file, "H%-6s%06X%06X\n", program_name ? program_name : " ",
+  writer_printf(obj_file, "H%-6s%06X%06X\n", program_name ? program_name : " ",
                                        program_start,
                                        program_len);
 }
 
+static void assembler_write_obj_lines(FILE                     *obj_file,
+                                      const char               *asm_filename,
+                                      const struct line_record *line_records)
+{
+  if(!line_records)
+  {
+    return;
+  }
+
+  writer_printf(obj_file, ".F%s\n", asm_filename);
+
+  int                      count = 0;
+  const struct line_record *walk = line_records;
+  while(walk)
+  {
+    if(0 == count)
+    {
+      writer_printf(obj_file, ".L");
+    }
+    writer_printf(obj_file, "%s", walk->line);
+
+    walk = walk->next;
+    if(LINE_RECORD_ENTRIES_COUNT == ++count || !walk)
+    {
+      writer_printf(obj_file, "\n");
+      count = 0;
+    }
+  }
+}
+
 static void assembler_write_obj_modif(FILE                      *obj_file,
                                       const struct modif_record *modif_records)
 {
   const struct modif_record *walk = modif_records;
   while(walk)
   {
-    fprintf(obj_file, "%s\n", walk->modif);
+    writer_printf(obj_file, "%s\n", walk->modif);
     walk = walk->next;
   }
 }
@@ -1304,8 +2261,7 @@ static void assembler_write_obj_text(FILE       *obj_file,
                                      const int  text_record_start,
                                      const char *text_record)
 {
-  fprintf(obj_file, "T%06X%02X", text_record_start,
-                                 (unsigned int)strlen(text_record) / 2);
-  fputs(text_record, obj_file);
-  fputs("\n", obj_file);
+  writer_printf(obj_file, "T%06X%02X%s\n", text_record_start,
+                                           (unsigned int)strlen(text_record) / 2,
+                                           text_record);
 }
@@ -6,6 +6,17 @@
 #ifndef __ASSEMBLER_H__
 #define __ASSEMBLER_H__
 
+/**
+ * @brief                  Assemble .asm file to .lst and .obj files.
+ * @param[in] asm_filename A name of the .asm file to be assembled.
+ * @param[in] is_optimized True to apply the peephole optimizer.
+ * @param[in] is_listed    True to write .lst file.
+ * @return                 True on success, false otherwise.
+ */
+bool assembler_assemble(const char *asm_filename,
+                        const bool is_optimized,
+                        const bool is_listed);
+
 /**
  * @brief          Receives command and executes the command.
  * @param[in] cmd  A type of the command.
@@ -0,0 +1,30 @@
+. Checksum of 1000 words, 100 times, one word per instruction.
+. The sum is stored to RESULT.
+CHKSUM  START   0
+FIRST   LDT     #3000
+        LDX     #0
+        LDA     #0
+INIT    STA     DATA,X
+        ADD     #1
+        TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     INIT
+OUTER   LDA     #0
+        LDX     #0
+LOOP    ADD     DATA,X
+        TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     LOOP
+        STA     RESULT
+        LDA     COUNT
+        ADD     #1
+        STA     COUNT
+        COMP    #100
+        JLT     OUTER
+        RSUB
+COUNT   WORD    0
+RESULT  RESW    1
+DATA    RESW    1000
+        END     FIRST
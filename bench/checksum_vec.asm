@@ -0,0 +1,45 @@
+. Checksum of 1000 words, 100 times, by vectors of 100 words.
+. Blocks of DATA are added to ACC by VADDW, and ACC is summed at last.
+. The sum is stored to RESULT. Run with --isa-ext.
+CHKVEC  START   0
+FIRST   LDT     #3000
+        LDX     #0
+        LDA     #0
+INIT    STA     DATA,X
+        ADD     #1
+        TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     INIT
+OUTER   LDX     #ACC
+        LDS     #DATA
+        LDT     #300
+        BMOVE
+        LDT     #100
+BLOCK   RMO     S, A
+        ADD     #300
+        RMO     A, S
+        VADDW   S, X
+       +COMP    #LAST
+        JLT     BLOCK
+        LDA     #0
+        LDX     #0
+        LDT     #300
+SUM     ADD     ACC,X
+        TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     SUM
+        STA     RESULT
+        LDA     COUNT
+        ADD     #1
+        STA     COUNT
+        COMP    #100
+        JLT     OUTER
+        RSUB
+COUNT   WORD    0
+RESULT  RESW    1
+ACC     RESW    100
+DATA    RESW    900
+LAST    RESW    100
+        END     FIRST
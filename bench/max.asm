@@ -0,0 +1,34 @@
+. Maximum of 1000 words, 100 times, one word per instruction.
+. The maximum is stored to RESULT.
+MAX     START   0
+FIRST   LDT     #3000
+        LDX     #0
+        LDA     #0
+INIT    ADD     #3823
+        AND     #4095
+        STA     DATA,X
+        TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     INIT
+OUTER   LDA     #0
+        STA     RESULT
+        LDX     #0
+LOOP    LDA     DATA,X
+        COMP    RESULT
+        JLT     NEXT
+        STA     RESULT
+NEXT    TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     LOOP
+        LDA     COUNT
+        ADD     #1
+        STA     COUNT
+        COMP    #100
+        JLT     OUTER
+        RSUB
+COUNT   WORD    0
+RESULT  RESW    1
+DATA    RESW    1000
+        END     FIRST
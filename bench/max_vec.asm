@@ -0,0 +1,49 @@
+. Maximum of 1000 words, 100 times, by vectors of 100 words.
+. Blocks of DATA are folded into ACC by VMAXW, and the maximum of ACC is
+. found at last. The maximum is stored to RESULT. Run with --isa-ext.
+MAXVEC  START   0
+FIRST   LDT     #3000
+        LDX     #0
+        LDA     #0
+INIT    ADD     #3823
+        AND     #4095
+        STA     DATA,X
+        TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     INIT
+OUTER   LDX     #ACC
+        LDS     #DATA
+        LDT     #300
+        BMOVE
+        LDT     #100
+BLOCK   RMO     S, A
+        ADD     #300
+        RMO     A, S
+        VMAXW   S, X
+       +COMP    #LAST
+        JLT     BLOCK
+        LDA     #0
+        STA     RESULT
+        LDX     #0
+        LDT     #300
+FOLD    LDA     ACC,X
+        COMP    RESULT
+        JLT     NEXT
+        STA     RESULT
+NEXT    TIXR    T
+        TIXR    T
+        TIXR    T
+        JLT     FOLD
+        LDA     COUNT
+        ADD     #1
+        STA     COUNT
+        COMP    #100
+        JLT     OUTER
+        RSUB
+COUNT   WORD    0
+RESULT  RESW    1
+ACC     RESW    100
+DATA    RESW    900
+LAST    RESW    100
+        END     FIRST
@@ -0,0 +1,200 @@
+/**
+ * @file  block.c
+ * @brief A table of program blocks used during assembly. Each block has its
+ *        own locctr, and blocks are placed one after another in the order
+ *        of their first USE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "block.h"
+
+/**
+ * @brief Structure of block elements.
+ */
+struct block
+{
+  /** A pointer to the next block element. */
+  struct block *next;
+  /** A block number, which is the order of the first USE. */
+  int          number;
+  /** A locctr saved when another block is used. */
+  int          locctr;
+  /** A length, which is the highest locctr. */
+  int          len;
+  /** A start address. 0 until blocks are assigned. */
+  int          address;
+  /** A name. Empty for the default block. */
+  char         name[];
+};
+
+/**
+ * @brief The number of blocks.
+ */
+static int _count = 0;
+
+/**
+ * @brief The block which lines are assembled into.
+ */
+static struct block *_current = NULL;
+
+/**
+ * @brief The default block, followed by the others in order.
+ */
+static struct block *_head = NULL;
+
+/**
+ * @brief           Create a new block, and append it to the list.
+ * @param[in] name  A name of the block.
+ * @return          The new block.
+ */
+static struct block *block_create(const char *name);
+
+/**
+ * @brief           Find the block of the number.
+ * @param[in] block A block number.
+ * @return          A block if exists, NULL otherwise.
+ */
+static struct block *block_find(const int block);
+
+int block_assign_addresses(const int start)
+{
+  int address = start;
+
+  struct block *walk = _head;
+  while(walk)
+  {
+    walk->address = address;
+    address += walk->len;
+    walk = walk->next;
+  }
+
+  return address;
+}
+
+void block_extend(const int locctr)
+{
+  if(_current && _current->len < locctr)
+  {
+    _current->len = locctr;
+  }
+}
+
+int block_get_address(const int block)
+{
+  struct block *found = block_find(block);
+
+  return found ? found->address : 0;
+}
+
+int block_get_count(void)
+{
+  return _count;
+}
+
+int block_get_current(void)
+{
+  return _current ? _current->number : 0;
+}
+
+void block_initialize(void)
+{
+  _head    = NULL;
+  _current = NULL;
+  _count   = 0;
+}
+
+void block_new_table(void)
+{
+  block_terminate();
+
+  // The default block, which is used until the first USE.
+  _current = block_create("");
+}
+
+void block_set_current(const int block)
+{
+  struct block *found = block_find(block);
+  if(found)
+  {
+    _current = found;
+  }
+}
+
+void block_terminate(void)
+{
+  struct block *walk = _head;
+  while(walk)
+  {
+    struct block *del = walk;
+    walk = walk->next;
+    free(del);
+  }
+
+  block_initialize();
+}
+
+int block_use(const char *name, const int locctr)
+{
+  if(!_current)
+  {
+    return locctr;
+  }
+
+  _current->locctr = locctr;
+  block_extend(locctr);
+
+  if(!name)
+  {
+    name = "";
+  }
+
+  struct block *walk = _head;
+  while(walk && strcmp(name, walk->name))
+  {
+    walk = walk->next;
+  }
+  _current = walk ? walk : block_create(name);
+
+  return _current->locctr;
+}
+
+static struct block *block_create(const char *name)
+{
+  struct block *new_block = malloc(sizeof(*new_block) +
+                                   sizeof(char) * (strlen(name) + 1));
+  new_block->next    = NULL;
+  new_block->number  = _count++;
+  new_block->locctr  = 0;
+  new_block->len     = 0;
+  new_block->address = 0;
+  strcpy(new_block->name, name);
+
+  if(!_head)
+  {
+    _head = new_block;
+  }
+  else
+  {
+    struct block *walk = _head;
+    while(walk->next)
+    {
+      walk = walk->next;
+    }
+    walk->next = new_block;
+  }
+
+  return new_block;
+}
+
+static struct block *block_find(const int block)
+{
+  struct block *walk = _head;
+  while(walk && block != walk->number)
+  {
+    walk = walk->next;
+  }
+
+  return walk;
+}
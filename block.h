@@ -0,0 +1,78 @@
+/**
+ * @file  block.h
+ * @brief A table of program blocks used during assembly. Each block has its
+ *        own locctr, and blocks are placed one after another in the order
+ *        of their first USE.
+ */
+
+#ifndef __BLOCK_H__
+#define __BLOCK_H__
+
+/**
+ * @brief            Place blocks one after another from the start address
+ *                   of the program, once pass 1 is done.
+ * @param[in] start  A start address of the program.
+ * @return           An address right after the last block.
+ */
+int block_assign_addresses(const int start);
+
+/**
+ * @brief            Extend the length of the current block to the locctr,
+ *                   if the block is shorter. ORG can move the locctr
+ *                   backward, so the length is the highest locctr.
+ * @param[in] locctr A locctr of the current block.
+ */
+void block_extend(const int locctr);
+
+/**
+ * @brief            Return the start address of the block.
+ * @param[in] block  A block number.
+ * @return           A start address if exists, 0 otherwise.
+ */
+int block_get_address(const int block);
+
+/**
+ * @brief  Return the block which lines are assembled into.
+ * @return A block number. The default block is 0.
+ */
+int block_get_current(void);
+
+/**
+ * @brief  Return the number of blocks.
+ * @return The number of blocks including the default block.
+ */
+int block_get_count(void);
+
+/**
+ * @brief Initialize block table.
+ */
+void block_initialize(void);
+
+/**
+ * @brief Release the current block table and create a new one, which has
+ *        only the default block.
+ */
+void block_new_table(void);
+
+/**
+ * @brief            Set the block which lines are assembled into. Used in
+ *                   pass 2, in which locctrs are read from .int file.
+ * @param[in] block  A block number.
+ */
+void block_set_current(const int block);
+
+/**
+ * @brief Release all allocated memories.
+ */
+void block_terminate(void);
+
+/**
+ * @brief            Save the locctr of the current block, and switch to the
+ *                   block of the name. The block is created if not exists.
+ * @param[in] name   A name of the block. NULL for the default block.
+ * @param[in] locctr A locctr of the current block.
+ * @return           A locctr of the block switched to.
+ */
+int block_use(const char *name, const int locctr);
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * @file  cache.c
+ * @brief A model of the cache and timing of the machine. Counts cycles and
+ *        misses of memory accessed by a run while it is enabled.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cache.h"
+
+#include "json.h"
+#include "logger.h"
+
+/**
+ * @def   CACHE_SET_COUNT
+ * @brief The number of sets of the cache. Must be a power of 2.
+ */
+#define CACHE_SET_COUNT 0x10
+
+/**
+ * @def   CACHE_WAY_COUNT
+ * @brief The number of lines of a set.
+ */
+#define CACHE_WAY_COUNT 4
+
+/**
+ * @brief The number of cycles to fill a line on a miss.
+ */
+static const int MISS_PENALTY = 20;
+
+/**
+ * @brief The number of cycles counted since the last reset.
+ */
+static unsigned long long _cycles = 0;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief A flag indicating whether the model is enabled or not.
+ */
+static bool _is_enabled = false;
+
+/**
+ * @brief The number of misses counted since the last reset.
+ */
+static unsigned long long _misses = 0;
+
+/**
+ * @brief Line numbers held by each set, from the most recently used.
+ *        -1 if invalid.
+ */
+static int _sets[CACHE_SET_COUNT][CACHE_WAY_COUNT];
+
+/**
+ * @brief          Turn the model on or off for whole runs, or show its
+ *                 counts.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool cache_execute_cache(const char *cmd,
+                                const int  argc,
+                                const char *argv[]);
+
+void cache_access(const int address, const int byte_count)
+{
+  if(!_is_enabled)
+  {
+    return;
+  }
+
+  _cycles += byte_count;
+
+  const int first_line = address / CACHE_LINE_LEN;
+  const int last_line  = (address + byte_count - 1) / CACHE_LINE_LEN;
+  for(int line = first_line; line <= last_line; ++line)
+  {
+    int *set = _sets[line & (CACHE_SET_COUNT - 1)];
+
+    // Find the line, or evict the least recently used one.
+    int way = 0;
+    while(way < CACHE_WAY_COUNT - 1 && line != set[way])
+    {
+      ++way;
+    }
+    if(line != set[way])
+    {
+      ++_misses;
+      _cycles += MISS_PENALTY;
+    }
+
+    memmove(&set[1], &set[0], sizeof(set[0]) * way);
+    set[0] = line;
+  }
+}
+
+void cache_execute(const char *cmd,
+                   const int  argc,
+                   const char *argv[])
+{
+  if(!strcmp("cache", cmd))
+  {
+    _is_command_executed = cache_execute_cache(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+unsigned long long cache_get_cycles(void)
+{
+  return _cycles;
+}
+
+unsigned long long cache_get_misses(void)
+{
+  return _misses;
+}
+
+void cache_initialize(void)
+{
+  memset(_sets, -1, sizeof(_sets));
+  cache_reset_counters();
+  _is_enabled = false;
+}
+
+void cache_reset_counters(void)
+{
+  _cycles = 0;
+  _misses = 0;
+}
+
+bool cache_set_enabled(const bool is_enabled)
+{
+  const bool was_enabled = _is_enabled;
+  _is_enabled = is_enabled;
+
+  return was_enabled;
+}
+
+static bool cache_execute_cache(const char *cmd,
+                                const int  argc,
+                                const char *argv[])
+{
+  if(1 < argc)
+  {
+    json_printf("cache: too many arguments\n");
+    return false;
+  }
+
+  if(0 == argc)
+  {
+    if(json_is_enabled())
+    {
+      json_begin_object("cache");
+      json_write_integer("cycles", _cycles);
+      json_write_integer("misses", _misses);
+      json_end_object();
+      return true;
+    }
+
+    json_printf("cache: %s\n", _is_enabled ? "on" : "off");
+    json_printf("Cycles\t\t%llu\n", _cycles);
+    json_printf("Cache misses\t%llu\n", _misses);
+    return true;
+  }
+
+  if(!strcmp("on", argv[0]))
+  {
+    cache_reset_counters();
+    _is_enabled = true;
+  }
+  else if(!strcmp("off", argv[0]))
+  {
+    // Counts are kept to be shown.
+    _is_enabled = false;
+  }
+  else
+  {
+    json_printf("cache: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+
+  return true;
+}
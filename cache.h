@@ -0,0 +1,65 @@
+/**
+ * @file  cache.h
+ * @brief A model of the cache and timing of the machine. Counts cycles and
+ *        misses of memory accessed by a run while it is enabled.
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+/**
+ * @def   CACHE_LINE_LEN
+ * @brief The number of bytes of a cache line.
+ */
+#define CACHE_LINE_LEN 0x40
+
+/**
+ * @brief                Access memory through the cache. A cycle is taken
+ *                       per byte, and a miss takes more cycles to fill the
+ *                       line. Does nothing if the model is disabled.
+ * @param[in] address    The starting address of memory.
+ * @param[in] byte_count The number of bytes accessed.
+ */
+void cache_access(const int address, const int byte_count);
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void cache_execute(const char *cmd,
+                   const int  argc,
+                   const char *argv[]);
+
+/**
+ * @brief  Return the number of cycles counted since the last reset.
+ * @return A cycle count.
+ */
+unsigned long long cache_get_cycles(void);
+
+/**
+ * @brief  Return the number of misses counted since the last reset.
+ * @return A miss count.
+ */
+unsigned long long cache_get_misses(void);
+
+/**
+ * @brief Initialize cache. All lines are invalidated, and the model is
+ *        disabled.
+ */
+void cache_initialize(void);
+
+/**
+ * @brief Reset counts of cycles and misses. Lines are kept.
+ */
+void cache_reset_counters(void);
+
+/**
+ * @brief                Enable or disable the model.
+ * @param[in] is_enabled True to count accesses of runs.
+ * @return               True if the model was enabled, false otherwise.
+ */
+bool cache_set_enabled(const bool is_enabled);
+
+#endif
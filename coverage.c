@@ -0,0 +1,597 @@
+/**
+ * @file  coverage.c
+ * @brief A handler of coverage related commands. Records which guest
+ *        instructions are executed and maps them back to .lst files.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coverage.h"
+
+#include "external_symbol.h"
+#include "json.h"
+#include "logger.h"
+#include "memspace.h"
+#include "opcode.h"
+
+/**
+ * @def   LST_FIELDS_COUNT
+ * @brief The number of tab separated fields of a .lst line.
+ */
+#define LST_FIELDS_COUNT 5
+
+/**
+ * @brief Structure of coverage unit elements. A unit is either a control
+ *        section or a subroutine.
+ */
+struct coverage_unit
+{
+  /** A pointer to the next unit element. */
+  struct coverage_unit *next;
+  /** The number of executed instructions in the unit. */
+  int                  hit;
+  /** The number of instructions in the unit. */
+  int                  total;
+  /** A flag indicating whether the unit is a control section. */
+  bool                 is_section;
+  /** A name of the unit. */
+  char                 name[];
+};
+
+/**
+ * @brief Structure of JSUB target elements.
+ */
+struct jsub_target
+{
+  /** A pointer to the next target element. */
+  struct jsub_target *next;
+  /** A label that is a target of JSUB. */
+  char               label[];
+};
+
+/**
+ * @brief A const variable that holds the length of buffer used for
+ *        file reading.
+ */
+static const int BUFFER_LEN = 0xFF;
+
+/**
+ * @brief Equals to 16.
+ */
+static const int HEX = 16;
+
+/**
+ * @brief A bitmap of executed instruction addresses. Accumulated across runs
+ *        until cleared.
+ */
+static unsigned char _bitmap[COVERAGE_BITMAP_LEN] = {0,};
+
+/**
+ * @brief A flag indicating whether coverage is recorded or not.
+ */
+static bool _is_coverage_enabled = false;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief               Append new unit at the end of the unit list.
+ * @param[in] units     A list of units.
+ * @param[in] name      A name of the unit.
+ * @param[in] is_section A flag indicating whether the unit is control section.
+ * @return              The appended unit.
+ */
+static struct coverage_unit *coverage_append_unit(struct coverage_unit **units,
+                                                  const char           *name,
+                                                  const bool           is_section);
+
+/**
+ * @brief          Enable, disable, clear, save, merge, or report coverage.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool coverage_execute_coverage(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[]);
+
+/**
+ * @brief             Check if the given address is marked as executed.
+ * @param[in] address An address to be examined.
+ * @return            True if executed, false otherwise.
+ */
+static bool coverage_is_hit(const int address);
+
+/**
+ * @brief             Check if the given label is a target of any JSUB.
+ * @param[in] targets A list of JSUB targets.
+ * @param[in] label   A label to be examined.
+ * @return            True if the label is a JSUB target, false otherwise.
+ */
+static bool coverage_is_jsub_target(const struct jsub_target *targets,
+                                    const char               *label);
+
+/**
+ * @brief              OR the bitmap saved in the given file into the current
+ *                     bitmap. Used to merge results of parallel runs.
+ * @param[in] filename A name of the bitmap file.
+ * @return             True on success, false otherwise.
+ */
+static bool coverage_merge_bitmap(const char *filename);
+
+/**
+ * @brief              Print the listing with hit marks and the percentage of
+ *                     executed instructions per section and subroutine.
+ * @param[in] filename A name of the .lst file.
+ * @param[in] base     A load address of the program. Negative if the address
+ *                     of each section should be looked up in ESTAB.
+ * @return             True on success, false otherwise.
+ */
+static bool coverage_report(const char *filename, const int base);
+
+/**
+ * @brief               Release JSUB targets.
+ * @param[in] targets   A list of JSUB targets.
+ */
+static void coverage_release_jsub_targets(struct jsub_target *targets);
+
+/**
+ * @brief             Release coverage units.
+ * @param[in] units   A list of units.
+ */
+static void coverage_release_units(struct coverage_unit *units);
+
+/**
+ * @brief              Write the current bitmap to the given file.
+ * @param[in] filename A name of the bitmap file.
+ * @return             True on success, false otherwise.
+ */
+static bool coverage_save_bitmap(const char *filename);
+
+/**
+ * @brief              Split a .lst line into tab separated fields. Surrounding
+ *                     blanks of each field are trimmed.
+ * @param[in]  buffer  A .lst line. It is modified during split.
+ * @param[out] fields  A list of fields. Missing fields are set to "".
+ */
+static void coverage_split_lst_line(char *buffer,
+                                    char *fields[LST_FIELDS_COUNT]);
+
+void coverage_copy_bitmap(unsigned char *bitmap)
+{
+  memcpy(bitmap, _bitmap, COVERAGE_BITMAP_LEN);
+}
+
+void coverage_execute(const char *cmd,
+                      const int  argc,
+                      const char *argv[])
+{
+  if(!strcmp("coverage", cmd))
+  {
+    _is_command_executed = coverage_execute_coverage(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void coverage_initialize(void)
+{
+  memset(_bitmap, 0, sizeof(_bitmap));
+  _is_coverage_enabled = false;
+}
+
+void coverage_mark_address(const int address)
+{
+  if(_is_coverage_enabled)
+  {
+    _bitmap[address >> 3] |= 1 << (address & 0x7);
+  }
+}
+
+void coverage_merge(const unsigned char *bitmap)
+{
+  for(int i = 0; i < COVERAGE_BITMAP_LEN; ++i)
+  {
+    _bitmap[i] |= bitmap[i];
+  }
+}
+
+bool coverage_set_enabled(const bool is_enabled)
+{
+  const bool was_enabled = _is_coverage_enabled;
+  _is_coverage_enabled = is_enabled;
+
+  return was_enabled;
+}
+
+static struct coverage_unit *coverage_append_unit(struct coverage_unit **units,
+                                                  const char           *name,
+                                                  const bool           is_section)
+{
+  struct coverage_unit *new_unit = malloc(sizeof(*new_unit) +
+                                          sizeof(char) * (strlen(name) + 1));
+  new_unit->next       = NULL;
+  new_unit->hit        = 0;
+  new_unit->total      = 0;
+  new_unit->is_section = is_section;
+  strcpy(new_unit->name, name);
+
+  if(!*units)
+  {
+    *units = new_unit;
+  }
+  else
+  {
+    struct coverage_unit *walk = *units;
+    while(walk->next)
+    {
+      walk = walk->next;
+    }
+    walk->next = new_unit;
+  }
+
+  return new_unit;
+}
+
+static bool coverage_execute_coverage(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("coverage: %s\n", _is_coverage_enabled ? "on" : "off");
+    return true;
+  }
+
+  if(!strcmp("on", argv[0]) || !strcmp("off", argv[0]) ||
+     !strcmp("clear", argv[0]))
+  {
+    if(1 < argc)
+    {
+      json_printf("coverage: too many arguments\n");
+      return false;
+    }
+
+    if(!strcmp("clear", argv[0]))
+    {
+      memset(_bitmap, 0, sizeof(_bitmap));
+    }
+    else
+    {
+      _is_coverage_enabled = !strcmp("on", argv[0]);
+    }
+
+    return true;
+  }
+  else if(!strcmp("save", argv[0]) || !strcmp("merge", argv[0]))
+  {
+    if(2 != argc)
+    {
+      json_printf("coverage: a file name is required\n");
+      return false;
+    }
+
+    if(!strcmp("save", argv[0]))
+    {
+      return coverage_save_bitmap(argv[1]);
+    }
+    else
+    {
+      return coverage_merge_bitmap(argv[1]);
+    }
+  }
+  else if(!strcmp("report", argv[0]))
+  {
+    if(2 > argc)
+    {
+      json_printf("coverage: a .lst file name is required\n");
+      return false;
+    }
+    if(3 < argc)
+    {
+      json_printf("coverage: too many arguments\n");
+      return false;
+    }
+
+    int base = -1;
+    if(3 == argc)
+    {
+      char *endptr = NULL;
+      base = strtol(argv[2], &endptr, HEX);
+      if('\0' != *endptr || 0 > base)
+      {
+        json_printf("coverage: argument '%s' is invalid\n", argv[2]);
+        return false;
+      }
+    }
+
+    return coverage_report(argv[1], base);
+  }
+  else
+  {
+    json_printf("coverage: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+}
+
+static bool coverage_is_hit(const int address)
+{
+  if(0 > address || COVERAGE_BITMAP_LEN * 8 <= address)
+  {
+    return false;
+  }
+
+  return (_bitmap[address >> 3] >> (address & 0x7)) & 0x1;
+}
+
+static bool coverage_is_jsub_target(const struct jsub_target *targets,
+                                    const char               *label)
+{
+  const struct jsub_target *walk = targets;
+  while(walk)
+  {
+    if(!strcmp(label, walk->label))
+    {
+      return true;
+    }
+
+    walk = walk->next;
+  }
+
+  return false;
+}
+
+static bool coverage_merge_bitmap(const char *filename)
+{
+  FILE *fp = fopen(filename, "rb");
+  if(!fp)
+  {
+    json_printf("coverage: there is no such file '%s'\n", filename);
+    return false;
+  }
+
+  unsigned char *bitmap    = malloc(COVERAGE_BITMAP_LEN);
+  size_t        read_count = fread(bitmap, 1, COVERAGE_BITMAP_LEN, fp);
+  fclose(fp);
+  if(COVERAGE_BITMAP_LEN != read_count)
+  {
+    json_printf("coverage: '%s' is not a coverage file\n", filename);
+    free(bitmap);
+    return false;
+  }
+
+  coverage_merge(bitmap);
+  free(bitmap);
+
+  return true;
+}
+
+static bool coverage_report(const char *filename, const int base)
+{
+  FILE *lst_file = fopen(filename, "r");
+  if(!lst_file)
+  {
+    json_printf("coverage: there is no such file '%s'\n", filename);
+    return false;
+  }
+
+  char               buffer[BUFFER_LEN];
+  char               *fields[LST_FIELDS_COUNT];
+  struct jsub_target *targets = NULL;
+
+  // Collect JSUB targets first; they start subroutines.
+  while(fgets(buffer, BUFFER_LEN, lst_file))
+  {
+    coverage_split_lst_line(buffer, fields);
+
+    const char *mnemonic = fields[3];
+    if('+' == mnemonic[0])
+    {
+      ++mnemonic;
+    }
+    if(strcmp("JSUB", mnemonic))
+    {
+      continue;
+    }
+
+    char *target = strtok(fields[4], " \t,");
+    if(!target)
+    {
+      continue;
+    }
+    if('@' == target[0] || '#' == target[0])
+    {
+      ++target;
+    }
+
+    struct jsub_target *new_target = malloc(sizeof(*new_target) +
+                                            sizeof(char) * (strlen(target) + 1));
+    strcpy(new_target->label, target);
+    new_target->next = targets;
+    targets = new_target;
+  }
+  rewind(lst_file);
+
+  struct coverage_unit *units      = NULL;
+  struct coverage_unit *section    = NULL;
+  struct coverage_unit *subroutine = NULL;
+  int                  section_address = base < 0 ? memspace_get_progaddr() :
+                                                    base;
+
+  while(fgets(buffer, BUFFER_LEN, lst_file))
+  {
+    char line[BUFFER_LEN];
+    strcpy(line, buffer);
+    if(strlen(line) && '\n' == line[strlen(line) - 1])
+    {
+      line[strlen(line) - 1] = '\0';
+    }
+
+    coverage_split_lst_line(buffer, fields);
+
+    const char *label    = fields[2];
+    const char *mnemonic = fields[3];
+    if(!strcmp("START", mnemonic) || !strcmp("CSECT", mnemonic))
+    {
+      section    = coverage_append_unit(&units, label, true);
+      subroutine = NULL;
+
+      if(base < 0)
+      {
+        // ESTAB stores control section names blank padded to 6 letters.
+        char section_name[7] = {0,};
+        snprintf(section_name, sizeof(section_name), "%-6s", label);
+        int address = external_symbol_get_address(section_name);
+        if(0 <= address)
+        {
+          section_address = address;
+        }
+      }
+    }
+
+    if('+' == mnemonic[0])
+    {
+      ++mnemonic;
+    }
+    if(!opcode_is_opcode(mnemonic) || !strlen(fields[1]))
+    {
+      json_printf("  %s\n", line);
+      continue;
+    }
+
+    if(!section)
+    {
+      section = coverage_append_unit(&units, " ", true);
+    }
+    if(!subroutine ||
+       (strlen(label) && coverage_is_jsub_target(targets, label)))
+    {
+      subroutine = coverage_append_unit(&units,
+                                        strlen(label) ? label : section->name,
+                                        false);
+    }
+
+    int  address = section_address + strtol(fields[1], NULL, HEX);
+    bool is_hit  = coverage_is_hit(address);
+
+    ++section->total;
+    ++subroutine->total;
+    if(is_hit)
+    {
+      ++section->hit;
+      ++subroutine->hit;
+    }
+
+    json_printf("%c %s\n", is_hit ? '+' : '-', line);
+  }
+  fclose(lst_file);
+
+  json_printf("\n");
+  json_printf("Unit    \tHit\tTotal\tCoverage\n");
+  json_printf("----------------------------------------\n");
+  struct coverage_unit *walk = units;
+  while(walk)
+  {
+    char unit_name[BUFFER_LEN];
+    snprintf(unit_name, sizeof(unit_name), "%s%s",
+        walk->is_section ? "" : "  ",
+        walk->name);
+    json_printf("%-8s\t%d\t%d\t%6.2f%%\n",
+             unit_name,
+             walk->hit,
+             walk->total,
+             walk->total ? 100.0 * walk->hit / walk->total : 0.0);
+
+    walk = walk->next;
+  }
+
+  coverage_release_units(units);
+  coverage_release_jsub_targets(targets);
+
+  return true;
+}
+
+static void coverage_release_jsub_targets(struct jsub_target *targets)
+{
+  struct jsub_target *walk = targets;
+  while(walk)
+  {
+    struct jsub_target *del = walk;
+    walk = walk->next;
+    free(del);
+  }
+}
+
+static void coverage_release_units(struct coverage_unit *units)
+{
+  struct coverage_unit *walk = units;
+  while(walk)
+  {
+    struct coverage_unit *del = walk;
+    walk = walk->next;
+    free(del);
+  }
+}
+
+static bool coverage_save_bitmap(const char *filename)
+{
+  FILE *fp = fopen(filename, "wb");
+  if(!fp)
+  {
+    json_printf("coverage: cannot create '%s' file\n", filename);
+    return false;
+  }
+
+  fwrite(_bitmap, 1, COVERAGE_BITMAP_LEN, fp);
+  fclose(fp);
+
+  return true;
+}
+
+static void coverage_split_lst_line(char *buffer,
+                                    char *fields[LST_FIELDS_COUNT])
+{
+  int  count = 0;
+  char *walk = buffer;
+  while(count < LST_FIELDS_COUNT && walk)
+  {
+    fields[count++] = walk;
+
+    walk = strchr(walk, '\t');
+    if(walk)
+    {
+      *walk++ = '\0';
+    }
+  }
+  for(int i = count; i < LST_FIELDS_COUNT; ++i)
+  {
+    fields[i] = "";
+  }
+
+  for(int i = 0; i < count; ++i)
+  {
+    // Trim leading and trailing blanks.
+    while(' ' == *fields[i])
+    {
+      ++fields[i];
+    }
+
+    int len = strlen(fields[i]);
+    while(len && (' ' == fields[i][len - 1] || '\n' == fields[i][len - 1]))
+    {
+      fields[i][--len] = '\0';
+    }
+  }
+}
@@ -0,0 +1,58 @@
+/**
+ * @file  coverage.h
+ * @brief A handler of coverage related commands. Records which guest
+ *        instructions are executed and maps them back to .lst files.
+ */
+
+#ifndef __COVERAGE_H__
+#define __COVERAGE_H__
+
+/**
+ * @def   COVERAGE_BITMAP_LEN
+ * @brief One bit per byte of memory. Memory address is represented in
+ *        20 bits, so the bitmap is 128 Kbytes long.
+ */
+#define COVERAGE_BITMAP_LEN ((0xFFFFF + 1) / 8)
+
+/**
+ * @brief            Copy the bitmap of executed instruction addresses.
+ * @param[out] bitmap A bitmap of COVERAGE_BITMAP_LEN bytes.
+ */
+void coverage_copy_bitmap(unsigned char *bitmap);
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void coverage_execute(const char *cmd,
+                      const int  argc,
+                      const char *argv[]);
+
+/**
+ * @brief Initialize coverage bitmap.
+ */
+void coverage_initialize(void);
+
+/**
+ * @brief             Mark the instruction at the given address as executed.
+ *                    Does nothing if coverage is disabled.
+ * @param[in] address An address of the executed instruction.
+ */
+void coverage_mark_address(const int address);
+
+/**
+ * @brief            Merge addresses recorded by another run.
+ * @param[in] bitmap A bitmap of COVERAGE_BITMAP_LEN bytes.
+ */
+void coverage_merge(const unsigned char *bitmap);
+
+/**
+ * @brief                Turn recording on or off.
+ * @param[in] is_enabled True to record executed instructions.
+ * @return               True if recording was on, false otherwise.
+ */
+bool coverage_set_enabled(const bool is_enabled);
+
+#endif
@@ -10,8 +10,18 @@
 
 #include "debugger.h"
 
+#include "cache.h"
+#include "coverage.h"
+#include "device.h"
+#include "heatmap.h"
+#include "json.h"
+#include "line_table.h"
 #include "logger.h"
 #include "memspace.h"
+#include "opcode.h"
+#include "sample.h"
+#include "timeline.h"
+#include "vector.h"
 
 /**
  * @def   REGISTER_FILE_LEN
@@ -19,6 +29,20 @@
  */
 #define REGISTER_FILE_LEN 10
 
+/**
+ * @def   DECODED_CACHE_LEN
+ * @brief The number of entries of the decoded instruction cache. Must be a
+ *        power of 2.
+ */
+#define DECODED_CACHE_LEN 0x1000
+
+/**
+ * @def   VECTOR_CHUNK_WORD_COUNT
+ * @brief The number of words of memory vectors computed at once, in buffers
+ *        on the stack.
+ */
+#define VECTOR_CHUNK_WORD_COUNT 256
+
 /**
  * @brief Structure of breakpoint elements.
  */
@@ -30,6 +54,29 @@ struct breakpoint
   int               address;
 };
 
+/**
+ * @brief Structure of a decoded instruction, cached by its address.
+ */
+struct decoded_instruction
+{
+  /** The address of the instruction. -1 if the entry is invalidated. */
+  int           address;
+  /** The run in which the instruction is decoded. Entries of other runs are
+   *  stale, since memory may be changed by commands between runs. */
+  unsigned int  epoch;
+  /** Registers of format 2, a displacement of format 3, or an address of
+   *  format 4. */
+  int           operand;
+  /** An opcode. */
+  unsigned char opcode;
+  /** A format. 3 for both format 3 and 4. */
+  unsigned char format;
+  /** The length of the instruction in bytes. */
+  unsigned char length;
+  /** Flags n, i, x, b, p, and e, from the 6th bit to the 1st bit. */
+  unsigned char flags;
+};
+
 /**
  * @brief Equals to 0x00000.
  */
@@ -50,11 +97,39 @@ static const int DISPLACEMENT_MASK = 0xFFF;
  */
 static const int DISPLACEMENT_MAX = 0x7FF;
 
+/**
+ * @brief Equals to 10.
+ */
+static const int DECIMAL = 10;
+
 /**
  * @brief Equals to 16.
  */
 static const int HEX = 16;
 
+/**
+ * @brief The amount of line increment. The assembler numbers .lst lines
+ *        by this amount per source line.
+ */
+static const int LINE_INCREMENT = 5;
+
+/**
+ * @brief The number of source lines shown before and after the current line.
+ */
+static const int LIST_LINE_COUNT = 5;
+
+/**
+ * @brief A const variable that means no limit on the number of instructions
+ *        executed by a run.
+ */
+static const int RUN_UNLIMITED = -1;
+
+/**
+ * @brief A const variable that holds the length of buffer used for
+ *        file reading.
+ */
+static const int BUFFER_LEN = 0xFF;
+
 /**
  * @brief An assigned number of each register.
  */
@@ -75,16 +150,43 @@ static const int REGISTER_SW = 9; // Status word; contains a variety of
                                   // information, including a Condition Code.
                                   // (CC)
 
+/**
+ * @brief The maximum length of an instruction in bytes.
+ */
+static const int INSTRUCTION_LEN_MAX = 4;
+
+/**
+ * @brief SVC numbers of counters, read to A.
+ */
+static const int SVC_INSTRUCTIONS = 0; // Instructions executed.
+static const int SVC_CYCLES       = 1; // Cycles of the cache model.
+static const int SVC_MISSES       = 2; // Misses of the cache model.
+
 /**
  * @brief A list of breakpoints. All breakpoints are stored in ascending order.
  */
 static struct breakpoint *_breakpoint_list = NULL;
 
+/**
+ * @brief A cache of decoded instructions, direct-mapped by address.
+ */
+static struct decoded_instruction _decoded_cache[DECODED_CACHE_LEN];
+
+/**
+ * @brief The current run. Incremented to invalidate all cached instructions.
+ */
+static unsigned int _epoch = 0;
+
 /**
  * @brief A flag indicating whether command is executed or not.
  */
 static bool _is_command_executed = false;
 
+/**
+ * @brief The number of instructions executed since this program started.
+ */
+static unsigned long long _executed_count = 0;
+
 /**
  * @brief A starting address of program that currently loaded on memory.
  */
@@ -100,11 +202,74 @@ static int _program_length = 0;
  */
 static unsigned int _registers[REGISTER_FILE_LEN] = {0,};
 
+/**
+ * @brief An access that trapped the current instruction, such as "store".
+ *        NULL if no access trapped.
+ */
+static const char *_trap_access = NULL;
+
+/**
+ * @brief An address accessed by the trapped access.
+ */
+static int _trap_address = 0;
+
+/**
+ * @brief The address of the current instruction.
+ */
+static int _trap_pc = 0;
+
+/**
+ * @brief                Check a block access of the current instruction, and
+ *                       count it as a data access. Blocks out of range or
+ *                       over pages without the given protection trap.
+ *                       Cached instructions overlapping stored blocks are
+ *                       invalidated.
+ * @param[in] access     An access, either "load" or "store".
+ * @param[in] address    The starting address of the block.
+ * @param[in] byte_count The number of bytes of the block.
+ * @return               True if the block can be accessed, false if trapped.
+ */
+static bool debugger_access_block(const char *access,
+                                  const int  address,
+                                  const int  byte_count);
+
+/**
+ * @brief                Count a data access of the current instruction by
+ *                       the cache model and the heatmap.
+ * @param[in] address    The starting address of memory.
+ * @param[in] byte_count The number of bytes accessed.
+ */
+static void debugger_access_data(const int address, const int byte_count);
+
 /**
  * @brief Clear all stored breakpoints.
  */
 static void debugger_clear_breakpoints(void);
 
+/**
+ * @brief               Compute words of memory vectors by the given
+ *                      operation. Both vectors have (T) words, and results
+ *                      are stored to the target.
+ * @param[in] operation An operation on words of the vector extension.
+ * @param[in] source    The address of the source vector.
+ * @param[in] target    The address of the target vector.
+ */
+static void debugger_compute_vector(void (*operation)(unsigned char *,
+                                                      const unsigned char *,
+                                                      const int),
+                                    const int source,
+                                    const int target);
+
+/**
+ * @brief              Fetch and decode an instruction.
+ * @param[in]  address The address of the instruction.
+ * @param[out] decoded A decoded instruction.
+ * @return             True on success, false if the instruction is invalid
+ *                     or its page cannot be executed.
+ */
+static bool debugger_decode_instruction(const int                  address,
+                                        struct decoded_instruction *decoded);
+
 /**
  * @brief          Set or unset breakpoint, or show all breakpoints.
  * @param[in] cmd  A type of the command.
@@ -114,6 +279,22 @@ static void debugger_clear_breakpoints(void);
 static bool debugger_execute_bp(const char *cmd,
                                 const int  argc,
                                 const char *argv[]);
+/**
+ * @brief Fetch, decode, and execute an instruction at PC.
+ * @return True on success, false if the instruction is invalid.
+ */
+static bool debugger_execute_instruction(void);
+
+/**
+ * @brief          Show source lines around PC or around the given line.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool debugger_execute_list(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[]);
+
 /**
  * @brief          Run loaded program and show value of each registers.
  * @param[in] cmd  A type of the command.
@@ -124,6 +305,25 @@ static bool debugger_execute_run(const char *cmd,
                                  const int  argc,
                                  const char *argv[]);
 
+/**
+ * @brief          Run loaded program until it reaches the next source line.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool debugger_execute_step(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[]);
+
+/**
+ * @brief           Return the device number of a device instruction.
+ * @param[in] n     A flag n.
+ * @param[in] value A value of the operand.
+ * @return          The byte at m if the operand is read from memory, and the
+ *                  rightmost byte of the value otherwise.
+ */
+static int debugger_get_device(const unsigned int n, const unsigned int value);
+
 /**
  * @brief            Return a format of the given opcode.
  * @param[in] opcode An opcode to be examined.
@@ -160,6 +360,33 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
                                            const unsigned int n,
                                            const unsigned int i,
                                            int                target_address);
+
+/**
+ * @brief                Invalidate cached instructions overlapping the
+ *                       given range.
+ * @param[in] address    The starting address of the range.
+ * @param[in] byte_count The number of bytes of the range.
+ */
+static void debugger_invalidate_decoded(const int address,
+                                        const int byte_count);
+
+/**
+ * @brief            Check if the given opcode is an enabled extension
+ *                   opcode. Extension opcodes have no flags n and i, so all
+ *                   8 bits of them are the opcode.
+ * @param[in] opcode An 8 bits opcode to be examined.
+ * @return           True if an enabled extension opcode, false otherwise.
+ */
+static bool debugger_is_extension_opcode(const unsigned int opcode);
+
+/**
+ * @brief            Check if the given opcode reads its operand from memory
+ *                   in simple addressing.
+ * @param[in] opcode An opcode to be examined.
+ * @return           True if read, false if only its target address is used.
+ */
+static bool debugger_is_operand_read(const unsigned int opcode);
+
 /**
  * @brief             Check if PC reached any breakpoint.
  * @param[in] address An address that PC has.
@@ -167,6 +394,42 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
  */
 static bool debugger_is_reached_breakpoint(const int address);
 
+/**
+ * @brief               Parse source location in the form of 'file:line'.
+ * @param[in]  location A source location to be parsed.
+ * @param[out] filename A name of the source file.
+ * @param[out] line     A line number.
+ * @return              True on success, false otherwise.
+ */
+static bool debugger_parse_source_location(const char *location,
+                                           char       *filename,
+                                           int        *line);
+
+/**
+ * @brief                 Run loaded program until PC reaches any breakpoint
+ *                        or the end of program.
+ * @param[in]  is_step    Also stop when PC reaches the start of a source line
+ *                        other than the current one.
+ * @param[in]  count      The maximum number of instructions to be executed.
+ *                        RUN_UNLIMITED if there is no limit.
+ * @param[out] is_stopped True if the program stopped before the limit.
+ * @return                True on success, false otherwise.
+ */
+static bool debugger_run(const bool is_step, const int count, bool *is_stopped);
+
+/**
+ * @brief                Store memory of a store instruction. Stores to pages
+ *                       which cannot be written trap. Cached instructions
+ *                       overlapping the stored bytes are invalidated, only
+ *                       if the page can be executed.
+ * @param[in] address    The address of memory to be stored.
+ * @param[in] memory     A memory to store.
+ * @param[in] byte_count The number of bytes to store.
+ */
+static void debugger_store_memory(const int     address,
+                                  unsigned char *memory,
+                                  const int     byte_count);
+
 /**
  * @brief Set breakpoint.
  */
@@ -182,6 +445,21 @@ static void debugger_show_breakpoints(void);
  */
 static void debugger_show_registers(void);
 
+/**
+ * @brief             Show the source location of the given address, if known,
+ *                    and finish the line.
+ * @param[in] address An address to be looked up.
+ */
+static void debugger_show_source_location(const int address);
+
+/**
+ * @brief             Trap the current instruction. The run stops at the
+ *                    instruction.
+ * @param[in] access  An access that trapped, such as "store".
+ * @param[in] address An address accessed.
+ */
+static void debugger_trap(const char *access, const int address);
+
 void debugger_execute(const char *cmd,
                       const int  argc,
                       const char *argv[])
@@ -194,9 +472,17 @@ void debugger_execute(const char *cmd,
   {
     _is_command_executed = debugger_execute_run(cmd, argc, argv);
   }
+  else if(!strcmp("step", cmd))
+  {
+    _is_command_executed = debugger_execute_step(cmd, argc, argv);
+  }
+  else if(!strcmp("list", cmd))
+  {
+    _is_command_executed = debugger_execute_list(cmd, argc, argv);
+  }
   else
   {
-    printf("%s: command not found\n", cmd);
+    json_printf("%s: command not found\n", cmd);
   }
 
   if(_is_command_executed)
@@ -205,6 +491,11 @@ void debugger_execute(const char *cmd,
   }
 }
 
+unsigned long long debugger_get_executed_count(void)
+{
+  return _executed_count;
+}
+
 void debugger_initialize(void)
 {
   debugger_terminate();
@@ -213,12 +504,36 @@ void debugger_initialize(void)
   _program_length = 0;
 }
 
+bool debugger_is_breakpoint_set(void)
+{
+  return _breakpoint_list ? true : false;
+}
+
+bool debugger_is_loaded(void)
+{
+  return 0 != _program_length;
+}
+
 void debugger_prepare_run(const int program_address, const int program_length)
 {
   _registers[REGISTER_L]  = program_length;
   _registers[REGISTER_PC] = program_address;
   _program_address        = program_address;
   _program_length         = program_length;
+
+  // A new program reads devices from the start.
+  device_reset();
+}
+
+bool debugger_run_slice(const int count, bool *is_stopped)
+{
+  if(0 == _program_length)
+  {
+    json_printf("debugger: no program is loaded\n");
+    return false;
+  }
+
+  return debugger_run(false, count, is_stopped);
 }
 
 void debugger_terminate(void)
@@ -232,7 +547,7 @@ static bool debugger_execute_bp(const char *cmd,
 {
   if(1 < argc)
   {
-    printf("debugger: too many arguments\n");
+    json_printf("debugger: too many arguments\n");
     return false;
   }
 
@@ -246,19 +561,38 @@ static bool debugger_execute_bp(const char *cmd,
     {
       debugger_clear_breakpoints();
     }
+    else if(strchr(argv[0], ':'))
+    {
+      char filename[BUFFER_LEN];
+      int  line = 0;
+      if(!debugger_parse_source_location(argv[0], filename, &line))
+      {
+        json_printf("debugger: argument '%s' is invalid\n", argv[0]);
+        return false;
+      }
+
+      int address = line_table_find_address(filename, line);
+      if(0 > address)
+      {
+        json_printf("debugger: no instruction at or after '%s'\n", argv[0]);
+        return false;
+      }
+
+      debugger_set_breakpoint(address);
+    }
     else
     {
       char *endptr = NULL;
       int  address = strtol(argv[0], &endptr, HEX);
       if('\0' != *endptr)
       {
-        printf("debugger: argument '%s' is invalid\n", argv[0]);
+        json_printf("debugger: argument '%s' is invalid\n", argv[0]);
         return false;
       }
       if(ADDRESS_MIN > address ||
          ADDRESS_MAX < address)
       {
-        printf("debugger: address '%X' is out of range\n", address);
+        json_printf("debugger: address '%X' is out of range\n", address);
         return false;
       }
 
@@ -269,6 +603,48 @@ static bool debugger_execute_bp(const char *cmd,
   return true;
 }
 
+static bool debugger_access_block(const char *access,
+                                  const int  address,
+                                  const int  byte_count)
+{
+  if(ADDRESS_MIN > address || ADDRESS_MAX < address + byte_count - 1)
+  {
+    debugger_trap(access, address);
+    return false;
+  }
+
+  const bool is_store   = !strcmp("store", access);
+  const int  protection = is_store ? MEMSPACE_WRITE : MEMSPACE_READ;
+  bool       is_code    = false;
+  for(int page = address / MEMSPACE_PAGE_LEN;
+      page <= (address + byte_count - 1) / MEMSPACE_PAGE_LEN;
+      ++page)
+  {
+    const int flags = memspace_get_protection(page * MEMSPACE_PAGE_LEN);
+    if(!(flags & protection))
+    {
+      const int first = page * MEMSPACE_PAGE_LEN;
+      debugger_trap(access, first > address ? first : address);
+      return false;
+    }
+    is_code = is_code || (flags & MEMSPACE_EXECUTE);
+  }
+
+  if(is_store && is_code)
+  {
+    debugger_invalidate_decoded(address, byte_count);
+  }
+  debugger_access_data(address, byte_count);
+
+  return true;
+}
+
+static void debugger_access_data(const int address, const int byte_count)
+{
+  cache_access(address, byte_count);
+  heatmap_access(address, byte_count);
+}
+
 static void debugger_clear_breakpoints(void)
 {
   if(!_breakpoint_list)
@@ -287,161 +663,356 @@ static void debugger_clear_breakpoints(void)
   _breakpoint_list = NULL;
 }
 
+static bool debugger_execute_list(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[])
+{
+  if(1 < argc)
+  {
+    json_printf("debugger: too many arguments\n");
+    return false;
+  }
+
+  char filename[BUFFER_LEN];
+  int  line = 0;
+  if(1 == argc)
+  {
+    if(!debugger_parse_source_location(argv[0], filename, &line))
+    {
+      json_printf("debugger: argument '%s' is invalid\n", argv[0]);
+      return false;
+    }
+  }
+  else
+  {
+    const char *found_filename = NULL;
+    if(0 > line_table_find_line(_registers[REGISTER_PC], &found_filename, &line))
+    {
+      json_printf("debugger: no source line for '%X'\n",
+                  _registers[REGISTER_PC]);
+      return false;
+    }
+    strcpy(filename, found_filename);
+  }
+
+  FILE *asm_file = fopen(filename, "r");
+  if(!asm_file)
+  {
+    json_printf("debugger: there is no such file '%s'\n", filename);
+    return false;
+  }
+
+  int  first_line   = line - LIST_LINE_COUNT * LINE_INCREMENT;
+  int  last_line    = line + LIST_LINE_COUNT * LINE_INCREMENT;
+  int  current_line = 0;
+  char buffer[BUFFER_LEN];
+  while(fgets(buffer, BUFFER_LEN, asm_file))
+  {
+    current_line += LINE_INCREMENT;
+    if(current_line < first_line)
+    {
+      continue;
+    }
+    if(current_line > last_line)
+    {
+      break;
+    }
+
+    json_printf("%2s %3d\t%s",
+                current_line == line ? "=>" : " ", current_line, buffer);
+    if('\n' != buffer[strlen(buffer) - 1])
+    {
+      json_printf("\n");
+    }
+  }
+  fclose(asm_file);
+
+  return true;
+}
+
 static bool debugger_execute_run(const char *cmd,
                                  const int  argc,
                                  const char *argv[])
 {
   if(0 < argc)
   {
-    printf("debugger: too many arguments\n");
+    json_printf("debugger: too many arguments\n");
     return false;
   }
 
   if(0 == _program_length)
   {
-    printf("debugger: no program is loaded\n");
+    json_printf("debugger: no program is loaded\n");
     return false;
   }
 
-  bool is_break = false;
-  while(!is_break)
+  bool is_stopped = false;
+  timeline_begin(cmd);
+  bool is_success = sample_is_enabled() ?
+                    sample_run() :
+                    debugger_run(false, RUN_UNLIMITED, &is_stopped);
+  timeline_end(cmd);
+
+  return is_success;
+}
+
+static bool debugger_execute_step(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[])
+{
+  if(0 < argc)
   {
-    unsigned char instruction[4] = {0,};
-    memspace_get_memory(instruction, _registers[REGISTER_PC], 3);
+    json_printf("debugger: too many arguments\n");
+    return false;
+  }
 
-    unsigned int opcode = instruction[0] & 0xFC;
-    int          format = debugger_get_format(opcode);
-    if(1 == format)
-    {
-      // Format 1.
-      _registers[REGISTER_PC] += 1;
+  if(0 == _program_length)
+  {
+    json_printf("debugger: no program is loaded\n");
+    return false;
+  }
 
-      debugger_instruction_format1(opcode);
-    }
-    else if(2 == format)
-    {
-      // Format 2.
-      _registers[REGISTER_PC] += 2;
+  bool is_stopped = false;
+  timeline_begin(cmd);
+  bool is_success = debugger_run(true, RUN_UNLIMITED, &is_stopped);
+  timeline_end(cmd);
+
+  return is_success;
+}
+
+static void debugger_compute_vector(void (*operation)(unsigned char *,
+                                                      const unsigned char *,
+                                                      const int),
+                                    const int source,
+                                    const int target)
+{
+  const int word_count = _registers[REGISTER_T];
+  const int byte_count = word_count * VECTOR_WORD_LEN;
+  if(0 == word_count ||
+     !debugger_access_block("load", source, byte_count) ||
+     !debugger_access_block("load", target, byte_count) ||
+     !debugger_access_block("store", target, byte_count))
+  {
+    return;
+  }
+
+  // Chunks are computed away from the overlap, as memmove() does, so both
+  // words are read before any result is stored over them.
+  const bool is_backward = target > source;
+  for(int done = 0; done < word_count; done += VECTOR_CHUNK_WORD_COUNT)
+  {
+    const int chunk_count = word_count - done < VECTOR_CHUNK_WORD_COUNT ?
+                            word_count - done :
+                            VECTOR_CHUNK_WORD_COUNT;
+    const int offset      = (is_backward ?
+                             word_count - done - chunk_count :
+                             done) * VECTOR_WORD_LEN;
+    const int chunk_len   = chunk_count * VECTOR_WORD_LEN;
+
+    unsigned char source_words[VECTOR_CHUNK_WORD_COUNT * VECTOR_WORD_LEN];
+    unsigned char target_words[VECTOR_CHUNK_WORD_COUNT * VECTOR_WORD_LEN];
+    memspace_get_memory(source_words, source + offset, chunk_len);
+    memspace_get_memory(target_words, target + offset, chunk_len);
+    operation(target_words, source_words, chunk_count);
+    memspace_set_memory(target + offset, target_words, chunk_len);
+  }
+}
+
+static bool debugger_decode_instruction(const int                  address,
+                                        struct decoded_instruction *decoded)
+{
+  if(!(memspace_get_protection(address) & MEMSPACE_EXECUTE))
+  {
+    debugger_trap("fetch", address);
+    return false;
+  }
+
+  unsigned char instruction[4] = {0,};
+  memspace_get_memory(instruction, address, 3);
+
+  unsigned int opcode = instruction[0];
+  if(!debugger_is_extension_opcode(opcode))
+  {
+    opcode &= 0xFC;
+  }
+  int format = debugger_get_format(opcode);
+  if(0 == format)
+  {
+    // Invalid opcode.
+    json_printf("debugger: invalid opcode\n");
+    return false;
+  }
+
+  decoded->opcode = opcode;
+  decoded->format = format;
+  decoded->flags  = ((instruction[0] & 0x03) << 4) | (instruction[1] >> 4);
+  if(1 == format)
+  {
+    decoded->length  = 1;
+    decoded->operand = 0;
+  }
+  else if(2 == format)
+  {
+    decoded->length  = 2;
+    decoded->operand = instruction[1];
+  }
+  else if(!(instruction[1] & 0x10))
+  {
+    // Format 3.
+    decoded->length  = 3;
+    decoded->operand = ((instruction[1] & 0x0F) << 8) + instruction[2];
+  }
+  else
+  {
+    // Format 4.
+    // In real design, memory is fetched by the size of register.
+    // (in SIC/XE, it's 3 bytes.) However, in this implementation,
+    // we just fetch one byte for conveinence.
+    memspace_get_memory(&instruction[3], address + 3, 1);
+    decoded->length  = 4;
+    decoded->operand = ((instruction[1] & 0x0F) << 16) +
+                       (instruction[2] << 8) +
+                       instruction[3];
+  }
+  decoded->address = address;
+  decoded->epoch   = _epoch;
+
+  return true;
+}
+
+static bool debugger_execute_instruction(void)
+{
+  _trap_pc = _registers[REGISTER_PC];
+  coverage_mark_address(_registers[REGISTER_PC]);
 
-      int r1 = (instruction[1] >> 4) & 0xF;
-      int r2 = instruction[1] & 0xF;
-      debugger_instruction_format2(opcode, r1, r2);
+  // Instructions are decoded once per run, unless they are stored to.
+  struct decoded_instruction *decoded =
+    &_decoded_cache[_registers[REGISTER_PC] & (DECODED_CACHE_LEN - 1)];
+  if((int)_registers[REGISTER_PC] != decoded->address || _epoch != decoded->epoch)
+  {
+    if(!debugger_decode_instruction(_registers[REGISTER_PC], decoded))
+    {
+      // A trap stops the run, but it is not an error.
+      return NULL != _trap_access;
     }
-    else if(3 == format)
+  }
+  // SVC reads counters, so it is not counted so as not to perturb them.
+  const bool is_counted = 0xB0 != decoded->opcode;
+  if(is_counted)
+  {
+    cache_access(_registers[REGISTER_PC], decoded->length);
+  }
+
+  unsigned int opcode = decoded->opcode;
+  if(1 == decoded->format)
+  {
+    // Format 1.
+    _registers[REGISTER_PC] += 1;
+
+    debugger_instruction_format1(opcode);
+  }
+  else if(2 == decoded->format)
+  {
+    // Format 2.
+    _registers[REGISTER_PC] += 2;
+
+    int r1 = (decoded->operand >> 4) & 0xF;
+    int r2 = decoded->operand & 0xF;
+    debugger_instruction_format2(opcode, r1, r2);
+  }
+  else
+  {
+    unsigned int n = (decoded->flags >> 5) & 1;
+    unsigned int i = (decoded->flags >> 4) & 1;
+    unsigned int x = (decoded->flags >> 3) & 1;
+    unsigned int b = (decoded->flags >> 2) & 1;
+    unsigned int p = (decoded->flags >> 1) & 1;
+    unsigned int e = decoded->flags & 1;
+
+    if(!e)
     {
-      unsigned int n = (instruction[0] & 0x02) ? 1 : 0;
-      unsigned int i = (instruction[0] & 0x01) ? 1 : 0;
-      unsigned int x = (instruction[1] & 0x80) ? 1 : 0;
-      unsigned int b = (instruction[1] & 0x40) ? 1 : 0;
-      unsigned int p = (instruction[1] & 0x20) ? 1 : 0;
-      unsigned int e = (instruction[1] & 0x10) ? 1 : 0;
-
-      if(!e)
-      {
-        // Format 3.
-        _registers[REGISTER_PC] += 3;
+      // Format 3.
+      _registers[REGISTER_PC] += 3;
 
-        int displacement = instruction[1] & 0x0F;
-        displacement     = displacement << 8;
-        displacement     += instruction[2];
+      int displacement = decoded->operand;
 
-        int target_address = 0;
-        if(0 == n && 0 == i)
+      int target_address = 0;
+      if(0 == n && 0 == i)
+      {
+        // A backward compatiblity to SIC machine.
+        target_address = (b << 14) + (p << 13) + (e << 12) + displacement;
+      }
+      else
+      {
+        if(1 == b && 0 == p)
         {
-          // A backward compatiblity to SIC machine.
-          target_address = (b << 14) + (p << 13) + (e << 12) + displacement;
+          // Base relative addressing.
+          target_address = _registers[REGISTER_B] + displacement;
         }
-        else
+        else if(0 == b && 1 == p)
         {
-          if(1 == b && 0 == p)
-          {
-            // Base relative addressing.
-            target_address = _registers[REGISTER_B] + displacement;
-          }
-          else if(0 == b && 1 == p)
-          {
-            // PC relative addressing.
-            if(DISPLACEMENT_MAX < displacement)
-            {
-              // A displacment is a negative value, so perform sign extension.
-              displacement = -(-displacement & DISPLACEMENT_MASK);
-            }
-            target_address = _registers[REGISTER_PC] + displacement;
-          }
-          else if(0 == b && 0 == p)
+          // PC relative addressing.
+          if(DISPLACEMENT_MAX < displacement)
           {
-            target_address = displacement;
-          }
-          else
-          {
-            printf("debugger: invalid addressing\n");
-            return false;
+            // A displacment is a negative value, so perform sign extension.
+            displacement = -(-displacement & DISPLACEMENT_MASK);
           }
+          target_address = _registers[REGISTER_PC] + displacement;
         }
-        if(1 == x)
+        else if(0 == b && 0 == p)
         {
-          // Indexed addressing.
-          target_address += _registers[REGISTER_X];
+          target_address = displacement;
         }
-
-        debugger_instruction_format3_4(opcode, n, i, target_address);
-      }
-      else
-      {
-        // Format 4.
-        // In real design, memory is fetched by the size of register.
-        // (in SIC/XE, it's 3 bytes.) However, in this implementation,
-        // we just fetch one byte for conveinence.
-        memspace_get_memory(&instruction[3], _registers[REGISTER_PC] + 3, 1);
-        _registers[REGISTER_PC] += 4;
-
-        int address = instruction[1] & 0x0F;
-        address     = address << 8;
-        address     += instruction[2];
-        address     = address << 8;
-        address     += instruction[3];
-
-        int target_address = address;
-        if(1 == x)
+        else
         {
-          // Indexed addressing.
-          target_address += _registers[REGISTER_X];
+          json_printf("debugger: invalid addressing\n");
+          return false;
         }
-
-        debugger_instruction_format3_4(opcode, n, i, target_address);
       }
+      if(1 == x)
+      {
+        // Indexed addressing.
+        target_address += _registers[REGISTER_X];
+      }
+
+      debugger_instruction_format3_4(opcode, n, i, target_address);
     }
     else
     {
-      // Invalid opcode.
-      printf("debugger: invalid opcode\n");
-      return false;
-    }
+      // Format 4.
+      _registers[REGISTER_PC] += 4;
 
-    if(_program_address + _program_length <= _registers[REGISTER_PC])
-    {
-      debugger_show_registers();
-      printf("Program finished\n");
+      int target_address = decoded->operand;
+      if(1 == x)
+      {
+        // Indexed addressing.
+        target_address += _registers[REGISTER_X];
+      }
 
-      debugger_initialize();
-      is_break = true;
+      debugger_instruction_format3_4(opcode, n, i, target_address);
     }
-    else if(debugger_is_reached_breakpoint(_registers[REGISTER_PC]))
-    {
-      debugger_show_registers();
-      printf("Breakpoint at %X\n", _registers[REGISTER_PC]);
+  }
 
-      is_break = true;
-    }
-    else
-    {
-      // Continue program execution.
-    }
+  if(_trap_access)
+  {
+    // The trapped instruction is not executed.
+    _registers[REGISTER_PC] = _trap_pc;
+    return true;
+  }
+
+  if(is_counted)
+  {
+    ++_executed_count;
   }
 
   return true;
 }
 
+static int debugger_get_device(const unsigned int n, const unsigned int value)
+{
+  return n ? (value >> 16) & 0xFF : value & 0xFF;
+}
+
 static int debugger_get_format(const unsigned int opcode)
 {
   if(0xC4 == opcode ||
@@ -449,7 +1020,12 @@ static int debugger_get_format(const unsigned int opcode)
      0xF4 == opcode ||
      0xC8 == opcode ||
      0xF0 == opcode ||
-     0xF8 == opcode)
+     0xF8 == opcode ||
+     (debugger_is_extension_opcode(opcode) &&
+      (0xE4 == opcode ||
+       0xE5 == opcode ||
+       0xE6 == opcode ||
+       0xE7 == opcode)))
   {
     // Format 1.
     return 1;
@@ -464,7 +1040,16 @@ static int debugger_get_format(const unsigned int opcode)
           0xA8 == opcode ||
           0x94 == opcode ||
           0xB0 == opcode ||
-          0xB8 == opcode)
+          0xB8 == opcode ||
+          (debugger_is_extension_opcode(opcode) &&
+           (0x8C == opcode ||
+            0x8D == opcode ||
+            0x8E == opcode ||
+            0x8F == opcode ||
+            0xBC == opcode ||
+            0xBD == opcode ||
+            0xBE == opcode ||
+            0xBF == opcode)))
   {
     // Format 2.
     return 2;
@@ -517,7 +1102,7 @@ static int debugger_get_format(const unsigned int opcode)
   }
   else
   {
-    printf("debugger: cannot find opcode '%02X'\n", opcode);
+    json_printf("debugger: cannot find opcode '%02X'\n", opcode);
     return 0;
   }
 }
@@ -555,9 +1140,93 @@ static void debugger_instruction_format1(const unsigned int opcode)
     // TIO: Test I/O channel number (A).
     // This implementation ignores this opcode.
   }
+  else if(0xE4 == opcode)
+  {
+    // BMOVE: (T) bytes at (X) <- (T) bytes at (S). The blocks may overlap.
+    const int length = _registers[REGISTER_T];
+    if(0 < length &&
+       debugger_access_block("load", _registers[REGISTER_S], length) &&
+       debugger_access_block("store", _registers[REGISTER_X], length))
+    {
+      memspace_move_memory(_registers[REGISTER_X],
+                           _registers[REGISTER_S],
+                           length);
+    }
+  }
+  else if(0xE5 == opcode)
+  {
+    // BFILL: (T) bytes at (X) <- (A)[rightmost byte].
+    const int length = _registers[REGISTER_T];
+    if(0 < length &&
+       debugger_access_block("store", _registers[REGISTER_X], length))
+    {
+      memspace_fill_memory(_registers[REGISTER_X],
+                           _registers[REGISTER_A] & 0xFF,
+                           length);
+    }
+  }
+  else if(0xE6 == opcode)
+  {
+    // BCOMP: (T) bytes at (X) : (T) bytes at (S).
+    const int length = _registers[REGISTER_T];
+    int       result = 0;
+    if(0 < length)
+    {
+      if(!debugger_access_block("load", _registers[REGISTER_X], length) ||
+         !debugger_access_block("load", _registers[REGISTER_S], length))
+      {
+        return;
+      }
+      memspace_compare_memory(_registers[REGISTER_X],
+                              _registers[REGISTER_S],
+                              length,
+                              &result);
+    }
+
+    if(0 < result)
+    {
+      _registers[REGISTER_SW] = '>';
+    }
+    else if(0 > result)
+    {
+      _registers[REGISTER_SW] = '<';
+    }
+    else
+    {
+      _registers[REGISTER_SW] = '=';
+    }
+  }
+  else if(0xE7 == opcode)
+  {
+    // BSRCH: X <- address of (A)[rightmost byte] in (T) bytes at (X).
+    //        CC is '=' if found, and '<' otherwise with X unchanged.
+    const int length = _registers[REGISTER_T];
+    int       found  = -1;
+    if(0 < length)
+    {
+      if(!debugger_access_block("load", _registers[REGISTER_X], length))
+      {
+        return;
+      }
+      memspace_search_memory(_registers[REGISTER_X],
+                             _registers[REGISTER_A] & 0xFF,
+                             length,
+                             &found);
+    }
+
+    if(0 <= found)
+    {
+      _registers[REGISTER_X]  = found;
+      _registers[REGISTER_SW] = '=';
+    }
+    else
+    {
+      _registers[REGISTER_SW] = '<';
+    }
+  }
   else
   {
-    printf("debugger: cannot find opcode '%02X'\n", opcode);
+    json_printf("debugger: cannot find opcode '%02X'\n", opcode);
   }
 }
 
@@ -628,7 +1297,20 @@ static void debugger_instruction_format2(const unsigned int opcode,
   else if(0xB0 == opcode)
   {
     // SVC: Generate SVC interrupt. {In assembled instruction, r1 = n}.
-    // This implementation ignores this opcode.
+    // This implementation reads a counter to A instead, as of the start of
+    // the SVC, which is not counted itself. Other n are ignored.
+    if(SVC_INSTRUCTIONS == r1)
+    {
+      _registers[REGISTER_A] = _executed_count & 0xFFFFFF;
+    }
+    else if(SVC_CYCLES == r1)
+    {
+      _registers[REGISTER_A] = cache_get_cycles() & 0xFFFFFF;
+    }
+    else if(SVC_MISSES == r1)
+    {
+      _registers[REGISTER_A] = cache_get_misses() & 0xFFFFFF;
+    }
   }
   else if(0xB8 == opcode)
   {
@@ -649,9 +1331,52 @@ static void debugger_instruction_format2(const unsigned int opcode,
       _registers[REGISTER_SW] = '=';
     }
   }
+  else if(0x8C == opcode)
+  {
+    // PADDB: r2 <- (r2) + (r1), in each byte.
+    _registers[r2] = vector_add_bytes(_registers[r2], _registers[r1]);
+  }
+  else if(0x8D == opcode)
+  {
+    // PCMPB: r2 <- FF where (r2) = (r1), 00 otherwise, in each byte.
+    _registers[r2] = vector_compare_bytes(_registers[r2], _registers[r1]);
+  }
+  else if(0x8E == opcode)
+  {
+    // PMINB: r2 <- the smaller of (r2) and (r1), in each byte.
+    _registers[r2] = vector_min_bytes(_registers[r2], _registers[r1]);
+  }
+  else if(0x8F == opcode)
+  {
+    // PMAXB: r2 <- the larger of (r2) and (r1), in each byte.
+    _registers[r2] = vector_max_bytes(_registers[r2], _registers[r1]);
+  }
+  else if(0xBC == opcode)
+  {
+    // VADDW: (T) words at (r2) <- (T) words at (r2) + (T) words at (r1).
+    debugger_compute_vector(vector_add_words, _registers[r1], _registers[r2]);
+  }
+  else if(0xBD == opcode)
+  {
+    // VCMPW: (T) words at (r2) <- FFFFFF where equal to (T) words at (r1),
+    //        000000 otherwise.
+    debugger_compute_vector(vector_compare_words,
+                            _registers[r1],
+                            _registers[r2]);
+  }
+  else if(0xBE == opcode)
+  {
+    // VMINW: (T) words at (r2) <- the smaller of them and (T) words at (r1).
+    debugger_compute_vector(vector_min_words, _registers[r1], _registers[r2]);
+  }
+  else if(0xBF == opcode)
+  {
+    // VMAXW: (T) words at (r2) <- the larger of them and (T) words at (r1).
+    debugger_compute_vector(vector_max_words, _registers[r1], _registers[r2]);
+  }
   else
   {
-    printf("debugger: cannot find opcode '%02X'\n", opcode);
+    json_printf("debugger: cannot find opcode '%02X'\n", opcode);
   }
 }
 
@@ -665,10 +1390,26 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
   {
     // Indirect addressing.
     unsigned char memory[3] = {0,};
+    if(!(memspace_get_protection(target_address) & MEMSPACE_READ))
+    {
+      debugger_trap("load", target_address);
+      return;
+    }
     memspace_get_memory(memory, target_address, 3);
+    debugger_access_data(target_address, 3);
 
     target_address = (memory[0] << 16) + (memory[1] << 8) + memory[2];
+    if(debugger_is_operand_read(opcode) &&
+       !(memspace_get_protection(target_address) & MEMSPACE_READ))
+    {
+      debugger_trap("load", target_address);
+      return;
+    }
     memspace_get_memory(memory, target_address, 3);
+    if(debugger_is_operand_read(opcode))
+    {
+      debugger_access_data(target_address, 3);
+    }
 
     value = (memory[0] << 16) + (memory[1] << 8) + memory[2];
   }
@@ -681,7 +1422,17 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
   {
     // Simple addressing.
     unsigned char memory[3] = {0,};
+    if(debugger_is_operand_read(opcode) &&
+       !(memspace_get_protection(target_address) & MEMSPACE_READ))
+    {
+      debugger_trap("load", target_address);
+      return;
+    }
     memspace_get_memory(memory, target_address, 3);
+    if(debugger_is_operand_read(opcode))
+    {
+      debugger_access_data(target_address, 3);
+    }
 
     value = (memory[0] << 16) + (memory[1] << 8) + memory[2];
   }
@@ -772,6 +1523,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     // JSUB: L <- (PC); PC <- m.
     _registers[REGISTER_L]  = _registers[REGISTER_PC];
     _registers[REGISTER_PC] = target_address;
+    timeline_enter_subroutine(target_address);
   }
   else if(0x00 == opcode)
   {
@@ -836,13 +1588,14 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
   else if(0xD8 == opcode)
   {
     // RD: A[rightmost byte] <- data from device specified by (m).
-    // This implementation assumes that RD receives 0.
-    _registers[REGISTER_A] = 0;
+    _registers[REGISTER_A] = (_registers[REGISTER_A] & 0xFFFF00) |
+                             device_read(debugger_get_device(n, value));
   }
   else if(0x4C == opcode)
   {
     // RSUB: PC <- (L).
     _registers[REGISTER_PC] = _registers[REGISTER_L];
+    timeline_leave_subroutine();
   }
   else if(0xEC == opcode)
   {
@@ -855,7 +1608,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_A] >> 16) & 0xFF,
                                (_registers[REGISTER_A] >> 8) & 0xFF,
                                _registers[REGISTER_A] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0x78 == opcode)
   {
@@ -863,13 +1616,13 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_B] >> 16) & 0xFF,
                                (_registers[REGISTER_B] >> 8) & 0xFF,
                                _registers[REGISTER_B] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0x54 == opcode)
   {
     // STCH: m <- (A)[rightmost byte].
     unsigned char memory[1] = {_registers[REGISTER_A] & 0xFF};
-    memspace_set_memory(target_address, memory, 1);
+    debugger_store_memory(target_address, memory, 1);
   }
   else if(0x80 == opcode)
   {
@@ -887,7 +1640,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_L] >> 16) & 0xFF,
                                (_registers[REGISTER_L] >> 8) & 0xFF,
                                _registers[REGISTER_L] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0x7C == opcode)
   {
@@ -895,7 +1648,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_S] >> 16) & 0xFF,
                                (_registers[REGISTER_S] >> 8) & 0xFF,
                                _registers[REGISTER_S] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0xE8 == opcode)
   {
@@ -903,7 +1656,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_SW] >> 16) & 0xFF,
                                (_registers[REGISTER_SW] >> 8) & 0xFF,
                                _registers[REGISTER_SW] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0x84 == opcode)
   {
@@ -911,7 +1664,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_T] >> 16) & 0xFF,
                                (_registers[REGISTER_T] >> 8) & 0xFF,
                                _registers[REGISTER_T] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0x10 == opcode)
   {
@@ -919,7 +1672,7 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
     unsigned char memory[3] = {(_registers[REGISTER_X] >> 16) & 0xFF,
                                (_registers[REGISTER_X] >> 8) & 0xFF,
                                _registers[REGISTER_X] & 0xFF};
-    memspace_set_memory(target_address, memory, 3);
+    debugger_store_memory(target_address, memory, 3);
   }
   else if(0x1C == opcode)
   {
@@ -934,8 +1687,10 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
   else if(0xE0 == opcode)
   {
     // TD: Test device specified by (m).
-    // This implementation assumes that device is always ready.
-    _registers[REGISTER_SW] = '<';
+    // CC is set to < if ready, and = if not.
+    _registers[REGISTER_SW] = device_test(debugger_get_device(n, value)) ?
+                              '<' :
+                              '=';
   }
   else if(0x2C == opcode)
   {
@@ -959,14 +1714,75 @@ static void debugger_instruction_format3_4(const unsigned int opcode,
   else if(0xDC == opcode)
   {
     // WD: Device specified by (m) <- (A)[rightmost byte].
-    // This implementation ignores this opcode.
+    device_write(debugger_get_device(n, value), _registers[REGISTER_A] & 0xFF);
   }
   else
   {
-    printf("debugger: cannot find opcode '%02X'\n", opcode);
+    json_printf("debugger: cannot find opcode '%02X'\n", opcode);
   }
 }
 
+static void debugger_invalidate_decoded(const int address,
+                                        const int byte_count)
+{
+  if(DECODED_CACHE_LEN <= byte_count)
+  {
+    // Every entry may overlap, so all of them are made stale at once.
+    ++_epoch;
+    return;
+  }
+
+  // Instructions starting before the range may overlap it.
+  for(int walk = address - INSTRUCTION_LEN_MAX + 1;
+      walk < address + byte_count;
+      ++walk)
+  {
+    struct decoded_instruction *decoded =
+      &_decoded_cache[walk & (DECODED_CACHE_LEN - 1)];
+    if(walk == decoded->address)
+    {
+      decoded->address = -1;
+    }
+  }
+}
+
+static bool debugger_is_extension_opcode(const unsigned int opcode)
+{
+  return opcode_is_extension_enabled() &&
+         (0xE4 == opcode || // BMOVE
+          0xE5 == opcode || // BFILL
+          0xE6 == opcode || // BCOMP
+          0xE7 == opcode || // BSRCH
+          0x8C == opcode || // PADDB
+          0x8D == opcode || // PCMPB
+          0x8E == opcode || // PMINB
+          0x8F == opcode || // PMAXB
+          0xBC == opcode || // VADDW
+          0xBD == opcode || // VCMPW
+          0xBE == opcode || // VMINW
+          0xBF == opcode);  // VMAXW
+}
+
+static bool debugger_is_operand_read(const unsigned int opcode)
+{
+  // Jumps and stores only use their target address.
+  return 0x3C != opcode && // J
+         0x30 != opcode && // JEQ
+         0x34 != opcode && // JGT
+         0x38 != opcode && // JLT
+         0x48 != opcode && // JSUB
+         0xEC != opcode && // SSK
+         0x0C != opcode && // STA
+         0x78 != opcode && // STB
+         0x54 != opcode && // STCH
+         0x80 != opcode && // STF
+         0x14 != opcode && // STL
+         0x7C != opcode && // STS
+         0xE8 != opcode && // STSW
+         0x84 != opcode && // STT
+         0x10 != opcode;   // STX
+}
+
 static bool debugger_is_reached_breakpoint(const int address)
 {
   struct breakpoint *walk = _breakpoint_list;
@@ -983,6 +1799,108 @@ static bool debugger_is_reached_breakpoint(const int address)
   return false;
 }
 
+static bool debugger_parse_source_location(const char *location,
+                                           char       *filename,
+                                           int        *line)
+{
+  const char *separator = strrchr(location, ':');
+  if(!separator || location == separator || BUFFER_LEN <= separator - location)
+  {
+    return false;
+  }
+
+  char *endptr = NULL;
+  *line = strtol(separator + 1, &endptr, DECIMAL);
+  if('\0' != *endptr || separator + 1 == endptr || 0 >= *line)
+  {
+    return false;
+  }
+
+  strncpy(filename, location, separator - location);
+  filename[separator - location] = '\0';
+
+  return true;
+}
+
+static bool debugger_run(const bool is_step, const int count, bool *is_stopped)
+{
+  const char *start_filename = NULL;
+  int        start_line      = 0;
+  int        start_address   = line_table_find_line(_registers[REGISTER_PC],
+                                                    &start_filename,
+                                                    &start_line);
+
+  // Memory may be changed since the last run.
+  ++_epoch;
+
+  bool is_break = false;
+  for(int i = 0; !is_break && (RUN_UNLIMITED == count || i < count); ++i)
+  {
+    if(!debugger_execute_instruction())
+    {
+      return false;
+    }
+
+    if(_trap_access)
+    {
+      debugger_show_registers();
+      json_printf("Trap: %s at %X by PC %X",
+                  _trap_access, _trap_address, _trap_pc);
+      debugger_show_source_location(_trap_pc);
+      _trap_access = NULL;
+
+      is_break = true;
+    }
+    else if(_program_address + _program_length <= _registers[REGISTER_PC])
+    {
+      debugger_show_registers();
+      json_printf("Program finished\n");
+
+      debugger_initialize();
+      is_break = true;
+    }
+    else if(debugger_is_reached_breakpoint(_registers[REGISTER_PC]))
+    {
+      debugger_show_registers();
+      json_printf("Breakpoint at %X", _registers[REGISTER_PC]);
+      debugger_show_source_location(_registers[REGISTER_PC]);
+
+      is_break = true;
+    }
+    else if(is_step)
+    {
+      const char *filename = NULL;
+      int        line      = 0;
+      int        address   = line_table_find_line(_registers[REGISTER_PC],
+                                                  &filename,
+                                                  &line);
+      if(0 > start_address ||
+         (address == _registers[REGISTER_PC] &&
+          (address == start_address ||
+           line != start_line ||
+           filename != start_filename)))
+      {
+        // PC is at the start of a new line, or it came back to the start of
+        // the current line as in a loop. Without line information, step
+        // executes one instruction.
+        debugger_show_registers();
+        json_printf("Step at %X", _registers[REGISTER_PC]);
+        debugger_show_source_location(_registers[REGISTER_PC]);
+
+        is_break = true;
+      }
+    }
+    else
+    {
+      // Continue program execution.
+    }
+  }
+
+  *is_stopped = is_break;
+
+  return true;
+}
+
 static void debugger_set_breakpoint(const int address)
 {
   struct breakpoint *new_bp = malloc(sizeof(*new_bp));
@@ -1020,23 +1938,93 @@ static void debugger_set_breakpoint(const int address)
   }
 }
 
+static void debugger_store_memory(const int     address,
+                                  unsigned char *memory,
+                                  const int     byte_count)
+{
+  if(ADDRESS_MIN <= address && ADDRESS_MAX >= address + byte_count - 1)
+  {
+    const int first_protection = memspace_get_protection(address);
+    const int last_protection  = memspace_get_protection(address + byte_count - 1);
+    if(!(first_protection & last_protection & MEMSPACE_WRITE))
+    {
+      debugger_trap("store", address);
+      return;
+    }
+
+    if((first_protection | last_protection) & MEMSPACE_EXECUTE)
+    {
+      debugger_invalidate_decoded(address, byte_count);
+    }
+  }
+
+  debugger_access_data(address, byte_count);
+  memspace_set_memory(address, memory, byte_count);
+}
+
 static void debugger_show_breakpoints(void)
 {
-  printf("Breakpoints\n");
-  printf("-----------\n");
+  if(json_is_enabled())
+  {
+    json_begin_array("breakpoints");
+    for(struct breakpoint *walk = _breakpoint_list; walk; walk = walk->next)
+    {
+      json_write_integer(NULL, walk->address);
+    }
+    json_end_array();
+    return;
+  }
+
+  json_printf("Breakpoints\n");
+  json_printf("-----------\n");
 
   struct breakpoint *walk = _breakpoint_list;
   while(walk)
   {
-    printf("%X\n", walk->address);
+    json_printf("%X\n", walk->address);
     walk = walk->next;
   }
 }
 
 static void debugger_show_registers(void)
 {
-  printf("A: %06X   X: %06X\n", _registers[REGISTER_A], _registers[REGISTER_X]);
-  printf("L: %06X  PC: %06X\n", _registers[REGISTER_L], _registers[REGISTER_PC]);
-  printf("B: %06X   S: %06X\n", _registers[REGISTER_B], _registers[REGISTER_S]);
-  printf("T: %06X\n", _registers[REGISTER_T]);
+  if(json_is_enabled())
+  {
+    json_begin_object("registers");
+    json_write_integer("A", _registers[REGISTER_A]);
+    json_write_integer("X", _registers[REGISTER_X]);
+    json_write_integer("L", _registers[REGISTER_L]);
+    json_write_integer("B", _registers[REGISTER_B]);
+    json_write_integer("S", _registers[REGISTER_S]);
+    json_write_integer("T", _registers[REGISTER_T]);
+    json_write_integer("PC", _registers[REGISTER_PC]);
+    json_write_integer("SW", _registers[REGISTER_SW]);
+    json_end_object();
+    return;
+  }
+
+  json_printf("A: %06X   X: %06X\n",
+              _registers[REGISTER_A], _registers[REGISTER_X]);
+  json_printf("L: %06X  PC: %06X\n",
+              _registers[REGISTER_L], _registers[REGISTER_PC]);
+  json_printf("B: %06X   S: %06X\n",
+              _registers[REGISTER_B], _registers[REGISTER_S]);
+  json_printf("T: %06X\n", _registers[REGISTER_T]);
+}
+
+static void debugger_show_source_location(const int address)
+{
+  const char *filename = NULL;
+  int        line      = 0;
+  if(0 <= line_table_find_line(address, &filename, &line))
+  {
+    json_printf(" (%s:%d)", filename, line);
+  }
+  json_printf("\n");
+}
+
+static void debugger_trap(const char *access, const int address)
+{
+  _trap_access  = access;
+  _trap_address = address;
 }
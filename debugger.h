@@ -16,11 +16,30 @@ void debugger_execute(const char *cmd,
                       const int  argc,
                       const char *argv[]);
 
+/**
+ * @brief  Return the number of instructions executed since this program
+ *         started. The count is never reset.
+ * @return The number of executed instructions.
+ */
+unsigned long long debugger_get_executed_count(void);
+
 /**
  * @brief Initialize debugger.
  */
 void debugger_initialize(void);
 
+/**
+ * @brief  Check if any breakpoint is set.
+ * @return True if set, false otherwise.
+ */
+bool debugger_is_breakpoint_set(void);
+
+/**
+ * @brief  Check if a program is loaded and not finished.
+ * @return True if loaded, false otherwise.
+ */
+bool debugger_is_loaded(void);
+
 /**
  * @brief                     Set registers value and program length.
  * @param[in] program_address A starting address of loaded program.
@@ -28,6 +47,17 @@ void debugger_initialize(void);
  */
 void debugger_prepare_run(const int program_address, const int program_length);
 
+/**
+ * @brief                 Run loaded program for at most the given number of
+ *                        instructions, until PC reaches any breakpoint or the
+ *                        end of program. Used to run a program in slices.
+ * @param[in]  count      The maximum number of instructions to be executed.
+ * @param[out] is_stopped True if PC reached any breakpoint or the end of
+ *                        program, false if the program can go on.
+ * @return                True on success, false otherwise.
+ */
+bool debugger_run_slice(const int count, bool *is_stopped);
+
 /**
  * @brief Release breakpoints.
  */
@@ -0,0 +1,171 @@
+/**
+ * @file  device.c
+ * @brief Devices of the machine. Each device is backed by a file named after
+ *        its number, such as 'F1.dev' for device F1.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "device.h"
+
+#include "replay.h"
+
+/**
+ * @def   DEVICE_COUNT
+ * @brief The number of devices. A device number is a byte.
+ */
+#define DEVICE_COUNT 0x100
+
+/**
+ * @brief A const variable that holds the length of a device file name.
+ */
+static const int FILENAME_LEN = 0x10;
+
+/**
+ * @brief A flag indicating whether devices are detached from the parent
+ *        process or not.
+ */
+static bool _is_detached = false;
+
+/**
+ * @brief Files of devices that are read. NULL if not opened yet.
+ */
+static FILE *_input_files[DEVICE_COUNT];
+
+/**
+ * @brief Files of devices that are written. NULL if not opened yet.
+ */
+static FILE *_output_files[DEVICE_COUNT];
+
+/**
+ * @brief              Make the file name of the device.
+ * @param[in]  device  A device number.
+ * @param[out] name    A file name of the device.
+ */
+static void device_get_filename(const int device, char *name);
+
+void device_detach(void)
+{
+  // Files are left open but not used, since closing them would flush or
+  // seek files shared with the parent.
+  for(int i = 0; i < DEVICE_COUNT; ++i)
+  {
+    if(_input_files[i])
+    {
+      const long offset = ftell(_input_files[i]);
+      char       name[FILENAME_LEN];
+      device_get_filename(i, name);
+      _input_files[i] = fopen(name, "rb");
+      if(_input_files[i])
+      {
+        fseek(_input_files[i], offset, SEEK_SET);
+      }
+    }
+    _output_files[i] = NULL;
+  }
+  _is_detached = true;
+}
+
+void device_initialize(void)
+{
+  memset(_input_files, 0, sizeof(_input_files));
+  memset(_output_files, 0, sizeof(_output_files));
+  _is_detached = false;
+}
+
+unsigned char device_read(const int device)
+{
+  unsigned char byte = 0;
+  if(replay_take(REPLAY_READ, device, &byte))
+  {
+    return byte;
+  }
+
+  if(!_input_files[device])
+  {
+    char name[FILENAME_LEN];
+    device_get_filename(device, name);
+    _input_files[device] = fopen(name, "rb");
+  }
+  if(_input_files[device])
+  {
+    const int read = fgetc(_input_files[device]);
+    byte = EOF == read ? 0 : read;
+  }
+
+  replay_log(REPLAY_READ, device, byte);
+
+  return byte;
+}
+
+void device_reset(void)
+{
+  for(int i = 0; i < DEVICE_COUNT; ++i)
+  {
+    if(_input_files[i])
+    {
+      fclose(_input_files[i]);
+      _input_files[i] = NULL;
+    }
+    if(_output_files[i])
+    {
+      fclose(_output_files[i]);
+      _output_files[i] = NULL;
+    }
+  }
+}
+
+void device_terminate(void)
+{
+  device_reset();
+}
+
+bool device_test(const int device)
+{
+  unsigned char is_ready = false;
+  if(replay_take(REPLAY_TEST, device, &is_ready))
+  {
+    return is_ready;
+  }
+
+  // A device is ready if its file exists, or if it can be created.
+  char name[FILENAME_LEN];
+  device_get_filename(device, name);
+  is_ready = _input_files[device] ||
+             _output_files[device] ||
+             !access(name, F_OK) ||
+             !access(".", W_OK);
+
+  replay_log(REPLAY_TEST, device, is_ready);
+
+  return is_ready;
+}
+
+void device_write(const int device, const unsigned char byte)
+{
+  if(_is_detached)
+  {
+    return;
+  }
+
+  if(!_output_files[device])
+  {
+    char name[FILENAME_LEN];
+    device_get_filename(device, name);
+    _output_files[device] = fopen(name, "wb");
+    if(!_output_files[device])
+    {
+      return;
+    }
+  }
+
+  fputc(byte, _output_files[device]);
+}
+
+static void device_get_filename(const int device, char *name)
+{
+  snprintf(name, FILENAME_LEN, "%02X.dev", device);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file  device.h
+ * @brief Devices of the machine. Each device is backed by a file named after
+ *        its number, such as 'F1.dev' for device F1.
+ */
+
+#ifndef __DEVICE_H__
+#define __DEVICE_H__
+
+/**
+ * @brief Give devices their own files after fork(), at the same positions,
+ *        so that a child process does not move files of its parent. Writes
+ *        of the child are discarded.
+ */
+void device_detach(void);
+
+/**
+ * @brief Initialize devices.
+ */
+void device_initialize(void);
+
+/**
+ * @brief            Read a byte from the device. Recorded or replayed if
+ *                   record or replay is on.
+ * @param[in] device A device number.
+ * @return           A byte read, or 0 if the device has no more data.
+ */
+unsigned char device_read(const int device);
+
+/**
+ * @brief Close all devices, so that devices are read from the start and
+ *        written from the empty when they are used next.
+ */
+void device_reset(void);
+
+/**
+ * @brief Close all devices.
+ */
+void device_terminate(void);
+
+/**
+ * @brief            Test whether the device is ready. Recorded or replayed
+ *                   if record or replay is on.
+ * @param[in] device A device number.
+ * @return           True if ready, false otherwise.
+ */
+bool device_test(const int device);
+
+/**
+ * @brief            Write a byte to the device.
+ * @param[in] device A device number.
+ * @param[in] byte   A byte to be written.
+ */
+void device_write(const int device, const unsigned char byte);
+
+#endif
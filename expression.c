@@ -0,0 +1,295 @@
+/**
+ * @file  expression.c
+ * @brief An evaluator of operand expressions. Expressions consist of
+ *        symbols, decimal constants, '*' for the current locctr, and
+ *        + - * / with parentheses.
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "expression.h"
+
+#include "symbol.h"
+
+/**
+ * @brief Structure of intermediate values.
+ */
+struct expression_term
+{
+  /** A value. */
+  int value;
+  /** The number of relative terms, where subtracted ones count negative. */
+  int relative_count;
+  /** A program block of the relative terms. */
+  int block;
+};
+
+/**
+ * @brief A const variable that holds the maximum length of a symbol.
+ */
+static const int SYMBOL_LEN = 0x40;
+
+/**
+ * @brief              Add or subtract the right term to the left term.
+ * @param[in,out] term The left term, which has the result.
+ * @param[in]     rhs  The right term.
+ * @param[in]     sign 1 to add, -1 to subtract.
+ * @return             True on success, false if relative terms are in
+ *                     different blocks.
+ */
+static bool expression_combine(struct expression_term       *term,
+                               const struct expression_term *rhs,
+                               const int                    sign);
+
+/**
+ * @brief                      Parse a factor: a symbol, a constant, '*', a
+ *                             negated factor, or a parenthesized sum.
+ * @param[in,out] walk         A pointer to the expression being parsed.
+ * @param[in]     locctr       A locctr of the current line.
+ * @param[in]     locctr_block A program block of the locctr.
+ * @param[out]    term         A parsed value.
+ * @return                     True on success, false otherwise.
+ */
+static bool expression_parse_factor(const char             **walk,
+                                    const int              locctr,
+                                    const int              locctr_block,
+                                    struct expression_term *term);
+
+/**
+ * @brief                      Parse factors joined by * or /.
+ * @param[in,out] walk         A pointer to the expression being parsed.
+ * @param[in]     locctr       A locctr of the current line.
+ * @param[in]     locctr_block A program block of the locctr.
+ * @param[out]    term         A parsed value.
+ * @return                     True on success, false otherwise.
+ */
+static bool expression_parse_product(const char             **walk,
+                                     const int              locctr,
+                                     const int              locctr_block,
+                                     struct expression_term *term);
+
+/**
+ * @brief                      Parse products joined by + or -.
+ * @param[in,out] walk         A pointer to the expression being parsed.
+ * @param[in]     locctr       A locctr of the current line.
+ * @param[in]     locctr_block A program block of the locctr.
+ * @param[out]    term         A parsed value.
+ * @return                     True on success, false otherwise.
+ */
+static bool expression_parse_sum(const char             **walk,
+                                 const int              locctr,
+                                 const int              locctr_block,
+                                 struct expression_term *term);
+
+bool expression_evaluate(const char           *expression,
+                         const int            locctr,
+                         const int            locctr_block,
+                         int                  *value,
+                         enum expression_type *type,
+                         int                  *block)
+{
+  *type  = EXPRESSION_NONE;
+  *block = SYMBOL_ABSOLUTE_BLOCK;
+  if(!expression)
+  {
+    return false;
+  }
+
+  struct expression_term term;
+  const char             *walk = expression;
+  if(!expression_parse_sum(&walk, locctr, locctr_block, &term) ||
+     '\0' != *walk)
+  {
+    return false;
+  }
+
+  if(0 == term.relative_count)
+  {
+    *type = EXPRESSION_ABSOLUTE;
+  }
+  else if(1 == term.relative_count)
+  {
+    *type  = EXPRESSION_RELATIVE;
+    *block = term.block;
+  }
+  else
+  {
+    // Such as the sum of two addresses, which is meaningless.
+    return false;
+  }
+  *value = term.value;
+
+  return true;
+}
+
+static bool expression_combine(struct expression_term       *term,
+                               const struct expression_term *rhs,
+                               const int                    sign)
+{
+  if(term->relative_count && rhs->relative_count && term->block != rhs->block)
+  {
+    // Distances between blocks are unknown until blocks are assigned.
+    return false;
+  }
+
+  if(!term->relative_count)
+  {
+    term->block = rhs->block;
+  }
+  term->value          += sign * rhs->value;
+  term->relative_count += sign * rhs->relative_count;
+  if(!term->relative_count)
+  {
+    term->block = SYMBOL_ABSOLUTE_BLOCK;
+  }
+
+  return true;
+}
+
+static bool expression_parse_factor(const char             **walk,
+                                    const int              locctr,
+                                    const int              locctr_block,
+                                    struct expression_term *term)
+{
+  const char *str = *walk;
+
+  if('-' == *str)
+  {
+    ++str;
+    if(!expression_parse_factor(&str, locctr, locctr_block, term))
+    {
+      return false;
+    }
+    term->value          = -term->value;
+    term->relative_count = -term->relative_count;
+  }
+  else if('(' == *str)
+  {
+    ++str;
+    if(!expression_parse_sum(&str, locctr, locctr_block, term) || ')' != *str)
+    {
+      return false;
+    }
+    ++str;
+  }
+  else if('*' == *str)
+  {
+    // The current locctr.
+    ++str;
+    term->value          = locctr;
+    term->relative_count = 1;
+    term->block          = locctr_block;
+  }
+  else if(isdigit((unsigned char)*str))
+  {
+    term->value          = 0;
+    term->relative_count = 0;
+    term->block          = SYMBOL_ABSOLUTE_BLOCK;
+    while(isdigit((unsigned char)*str))
+    {
+      term->value = 10 * term->value + (*str - '0');
+      ++str;
+    }
+  }
+  else if(isalpha((unsigned char)*str))
+  {
+    char symbol[SYMBOL_LEN];
+    int  len = 0;
+    while(isalnum((unsigned char)*str))
+    {
+      if(SYMBOL_LEN - 1 <= len)
+      {
+        return false;
+      }
+      symbol[len++] = *str++;
+    }
+    symbol[len] = '\0';
+
+    if(symbol_is_register(symbol) || !symbol_is_exist(symbol))
+    {
+      return false;
+    }
+    term->value          = symbol_get_locctr(symbol);
+    term->relative_count = symbol_is_absolute(symbol) ? 0 : 1;
+    term->block          = symbol_get_block(symbol);
+  }
+  else
+  {
+    return false;
+  }
+
+  *walk = str;
+  return true;
+}
+
+static bool expression_parse_product(const char             **walk,
+                                     const int              locctr,
+                                     const int              locctr_block,
+                                     struct expression_term *term)
+{
+  if(!expression_parse_factor(walk, locctr, locctr_block, term))
+  {
+    return false;
+  }
+
+  while('*' == **walk || '/' == **walk)
+  {
+    char                   op = *(*walk)++;
+    struct expression_term rhs;
+    if(!expression_parse_factor(walk, locctr, locctr_block, &rhs))
+    {
+      return false;
+    }
+
+    // Only absolute values can be multiplied or divided.
+    if(term->relative_count || rhs.relative_count)
+    {
+      return false;
+    }
+    if('*' == op)
+    {
+      term->value *= rhs.value;
+    }
+    else
+    {
+      if(0 == rhs.value)
+      {
+        return false;
+      }
+      term->value /= rhs.value;
+    }
+  }
+
+  return true;
+}
+
+static bool expression_parse_sum(const char             **walk,
+                                 const int              locctr,
+                                 const int              locctr_block,
+                                 struct expression_term *term)
+{
+  if(!expression_parse_product(walk, locctr, locctr_block, term))
+  {
+    return false;
+  }
+
+  while('+' == **walk || '-' == **walk)
+  {
+    char                   op = *(*walk)++;
+    struct expression_term rhs;
+    if(!expression_parse_product(walk, locctr, locctr_block, &rhs))
+    {
+      return false;
+    }
+
+    if(!expression_combine(term, &rhs, '+' == op ? 1 : -1))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
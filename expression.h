@@ -0,0 +1,45 @@
+/**
+ * @file  expression.h
+ * @brief An evaluator of operand expressions. Expressions consist of
+ *        symbols, decimal constants, '*' for the current locctr, and
+ *        + - * / with parentheses.
+ */
+
+#ifndef __EXPRESSION_H__
+#define __EXPRESSION_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief An enum of types of expression values.
+ */
+enum expression_type
+{
+  EXPRESSION_NONE,
+  EXPRESSION_ABSOLUTE,
+  EXPRESSION_RELATIVE,
+};
+
+/**
+ * @brief                   Evaluate the expression. The result is relative if
+ *                          relative terms are paired except one, and absolute
+ *                          if all of them are paired.
+ * @param[in]  expression   An expression to be evaluated.
+ * @param[in]  locctr       A locctr of the current line, used for '*'.
+ * @param[in]  locctr_block A program block of the locctr.
+ * @param[out] value        A value of the expression.
+ * @param[out] type         A type of the value. EXPRESSION_NONE on failure.
+ * @param[out] block        A program block of the value if relative,
+ *                          SYMBOL_ABSOLUTE_BLOCK otherwise. Relative terms
+ *                          must be in the same block.
+ * @return                  True on success, false if the expression is
+ *                          invalid or has an undefined symbol.
+ */
+bool expression_evaluate(const char           *expression,
+                         const int            locctr,
+                         const int            locctr_block,
+                         int                  *value,
+                         enum expression_type *type,
+                         int                  *block);
+
+#endif
@@ -10,6 +10,8 @@
 
 #include "external_symbol.h"
 
+#include "json.h"
+
 /**
  * @brief Structure of external symbol elements.
  */
@@ -139,6 +141,22 @@ void external_symbol_insert_symbol(const char *control_section,
   }
 }
 
+void external_symbol_relocate(const int delta)
+{
+  for(struct control_section *section = _external_symbol_table;
+      section;
+      section = section->next)
+  {
+    section->address += delta;
+    for(struct external_symbol *symbol = section->symbols;
+        symbol;
+        symbol = symbol->next)
+    {
+      symbol->address += delta;
+    }
+  }
+}
+
 void external_symbol_show_table(void)
 {
   if(!_external_symbol_table)
@@ -146,27 +164,55 @@ void external_symbol_show_table(void)
     return;
   }
 
-  printf("Control\tSymbol\tAddress\tLength\n");
-  printf("section\tname\n");
-  printf("--------------------------------\n");
+  if(json_is_enabled())
+  {
+    json_begin_array("estab");
+    for(struct control_section *section = _external_symbol_table;
+        section;
+        section = section->next)
+    {
+      json_begin_object(NULL);
+      json_write_string("section", section->symbol);
+      json_write_integer("address", section->address);
+      json_write_integer("length", section->length);
+      json_begin_array("symbols");
+      for(struct external_symbol *symbol = section->symbols;
+          symbol;
+          symbol = symbol->next)
+      {
+        json_begin_object(NULL);
+        json_write_string("name", symbol->symbol);
+        json_write_integer("address", symbol->address);
+        json_end_object();
+      }
+      json_end_array();
+      json_end_object();
+    }
+    json_end_array();
+    return;
+  }
+
+  json_printf("Control\tSymbol\tAddress\tLength\n");
+  json_printf("section\tname\n");
+  json_printf("--------------------------------\n");
 
   int                    total_length = 0;
   struct control_section *section     = _external_symbol_table;
   while(section)
   {
-    printf("%-6s\t%6s\t%2s%04X%s\t%s%04X\n",
-        section->symbol,
-        " ",
-        " ", section->address, " ",
-        " ", section->length);
+    json_printf("%-6s\t%6s\t%2s%04X%s\t%s%04X\n",
+             section->symbol,
+             " ",
+             " ", section->address, " ",
+             " ", section->length);
 
     struct external_symbol *symbol = section->symbols;
     while(symbol)
     {
-      printf("%-6s\t%6s\t%2s%04X\n",
-          " ",
-          symbol->symbol,
-          " ", symbol->address);
+      json_printf("%-6s\t%6s\t%2s%04X\n",
+               " ",
+               symbol->symbol,
+               " ", symbol->address);
 
       symbol = symbol->next;
     }
@@ -175,8 +221,8 @@ void external_symbol_show_table(void)
     section = section->next;
   }
 
-  printf("--------------------------------\n");
-  printf("%6s\t%3sTotal length %s%04X\n", " ", " ", " ", total_length);
+  json_printf("--------------------------------\n");
+  json_printf("%6s\t%3sTotal length %s%04X\n", " ", " ", " ", total_length);
 }
 
 void external_symbol_terminate(void)
@@ -38,6 +38,12 @@ void external_symbol_insert_symbol(const char *control_section,
                                    const char *symbol,
                                    const int address);
 
+/**
+ * @brief           Move all control sections and symbols by the given amount.
+ * @param[in] delta An amount added to addresses.
+ */
+void external_symbol_relocate(const int delta);
+
 /**
  * @brief Print the last successfully created external symbol table.
  */
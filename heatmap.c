@@ -0,0 +1,477 @@
+/**
+ * @file  heatmap.c
+ * @brief A handler of heatmap related commands. Counts data accessed by runs
+ *        per line of memory in windows of instructions, and shows the
+ *        working set over time.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heatmap.h"
+
+#include "cache.h"
+#include "debugger.h"
+#include "json.h"
+#include "logger.h"
+
+/**
+ * @def   HEATMAP_LINE_COUNT
+ * @brief The number of lines of memory. Memory address is represented in
+ *        20 bits.
+ */
+#define HEATMAP_LINE_COUNT ((0xFFFFF + 1) / CACHE_LINE_LEN)
+
+/**
+ * @brief Structure of a line accessed in a window.
+ */
+struct heatmap_cell
+{
+  /** A line number. */
+  int line;
+  /** The number of accesses to the line. */
+  int count;
+};
+
+/**
+ * @brief Structure of a window. Its lines are stored in cells.
+ */
+struct heatmap_window
+{
+  /** An index of the window since the heatmap was turned on. */
+  unsigned long long index;
+  /** An index of the first cell of the window. */
+  int                first_cell;
+  /** The number of lines accessed in the window. */
+  int                line_count;
+};
+
+/**
+ * @brief Equals to 10.
+ */
+static const int DECIMAL = 10;
+
+/**
+ * @brief The maximum value of a pixel of PGM image.
+ */
+static const int PIXEL_MAX = 255;
+
+/**
+ * @brief The number of instructions executed before the heatmap was turned
+ *        on.
+ */
+static unsigned long long _base_count = 0;
+
+/**
+ * @brief Accessed lines of all windows, in the order of windows.
+ */
+static struct heatmap_cell *_cells = NULL;
+
+/**
+ * @brief The number of cells.
+ */
+static int _cell_count = 0;
+
+/**
+ * @brief Counts of accesses of the current window per line.
+ */
+static int _counts[HEATMAP_LINE_COUNT];
+
+/**
+ * @brief An index of the current window.
+ */
+static unsigned long long _current = 0;
+
+/**
+ * @brief The number of instructions of a window.
+ */
+static int _interval = 0;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief A flag indicating whether the heatmap is on or not.
+ */
+static bool _is_enabled = false;
+
+/**
+ * @brief Lines accessed in the current window, in the order of the first
+ *        access.
+ */
+static int _touched[HEATMAP_LINE_COUNT];
+
+/**
+ * @brief The number of lines accessed in the current window.
+ */
+static int _touched_count = 0;
+
+/**
+ * @brief Windows with any access, in the order of time.
+ */
+static struct heatmap_window *_windows = NULL;
+
+/**
+ * @brief The number of windows.
+ */
+static int _window_count = 0;
+
+/**
+ * @brief           Append a value to a list, growing the list by doubling.
+ * @param[in] list  A list of the given number of values.
+ * @param[in] count The number of values in the list.
+ * @param[in] size  The size of a value.
+ * @return          A list which has room for one more value.
+ */
+static void *heatmap_append(void *list, const int count, const size_t size);
+
+/**
+ * @brief Release all windows, and clear counts of the current window.
+ */
+static void heatmap_clear(void);
+
+/**
+ * @brief          Turn the heatmap on or off, save it, or show the working
+ *                 set of each window.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool heatmap_execute_heatmap(const char *cmd,
+                                    const int  argc,
+                                    const char *argv[]);
+
+/**
+ * @brief Store lines of the current window as a window, and clear its
+ *        counts.
+ */
+static void heatmap_flush(void);
+
+/**
+ * @brief              Save windows as PGM image, a row per window and a
+ *                     column per line from the lowest accessed line to the
+ *                     highest one.
+ * @param[in] filename A name of the image file.
+ * @return             True on success, false otherwise.
+ */
+static bool heatmap_save(const char *filename);
+
+/**
+ * @brief Show the number of lines and bytes accessed in each window.
+ */
+static void heatmap_show_working_set(void);
+
+void heatmap_access(const int address, const int byte_count)
+{
+  if(!_is_enabled)
+  {
+    return;
+  }
+
+  // An access belongs to the window of the instruction being executed.
+  const unsigned long long window = (debugger_get_executed_count() -
+                                     _base_count) / _interval;
+  if(window != _current)
+  {
+    heatmap_flush();
+    _current = window;
+  }
+
+  const int first_line = address / CACHE_LINE_LEN;
+  const int last_line  = (address + byte_count - 1) / CACHE_LINE_LEN;
+  for(int line = first_line;
+      line <= last_line && HEATMAP_LINE_COUNT > line;
+      ++line)
+  {
+    if(0 == _counts[line]++)
+    {
+      _touched[_touched_count++] = line;
+    }
+  }
+}
+
+void heatmap_execute(const char *cmd,
+                     const int  argc,
+                     const char *argv[])
+{
+  if(!strcmp("heatmap", cmd))
+  {
+    _is_command_executed = heatmap_execute_heatmap(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void heatmap_initialize(void)
+{
+  memset(_counts, 0, sizeof(_counts));
+  _touched_count = 0;
+  _cells         = NULL;
+  _cell_count    = 0;
+  _windows       = NULL;
+  _window_count  = 0;
+  _is_enabled    = false;
+}
+
+void heatmap_terminate(void)
+{
+  heatmap_clear();
+  _is_enabled = false;
+}
+
+static void *heatmap_append(void *list, const int count, const size_t size)
+{
+  // Grow when the count reaches a power of 2.
+  if(0 == (count & (count - 1)))
+  {
+    list = realloc(list, (count ? 2 * count : 1) * size);
+  }
+
+  return list;
+}
+
+static void heatmap_clear(void)
+{
+  for(int i = 0; i < _touched_count; ++i)
+  {
+    _counts[_touched[i]] = 0;
+  }
+  _touched_count = 0;
+
+  free(_cells);
+  _cells      = NULL;
+  _cell_count = 0;
+  free(_windows);
+  _windows      = NULL;
+  _window_count = 0;
+}
+
+static bool heatmap_execute_heatmap(const char *cmd,
+                                    const int  argc,
+                                    const char *argv[])
+{
+  if(0 == argc)
+  {
+    heatmap_flush();
+    if(0 == _window_count)
+    {
+      json_printf("heatmap: %s, no data is accessed\n",
+                  _is_enabled ? "on" : "off");
+      return true;
+    }
+
+    heatmap_show_working_set();
+    return true;
+  }
+
+  if(!strcmp("on", argv[0]))
+  {
+    if(2 != argc)
+    {
+      json_printf("heatmap: an interval is required\n");
+      return false;
+    }
+
+    char       *endptr  = NULL;
+    const long interval = strtol(argv[1], &endptr, DECIMAL);
+    if('\0' != *endptr || 0 >= interval || INT_MAX < interval)
+    {
+      json_printf("heatmap: interval '%s' is invalid\n", argv[1]);
+      return false;
+    }
+
+    heatmap_clear();
+    _base_count = debugger_get_executed_count();
+    _current    = 0;
+    _interval   = interval;
+    _is_enabled = true;
+    return true;
+  }
+  else if(!strcmp("off", argv[0]))
+  {
+    if(1 < argc)
+    {
+      json_printf("heatmap: too many arguments\n");
+      return false;
+    }
+
+    // Windows are kept to be shown or saved.
+    heatmap_flush();
+    _is_enabled = false;
+    return true;
+  }
+  else if(!strcmp("save", argv[0]))
+  {
+    if(2 != argc)
+    {
+      json_printf("heatmap: a file name is required\n");
+      return false;
+    }
+
+    heatmap_flush();
+    return heatmap_save(argv[1]);
+  }
+  else
+  {
+    json_printf("heatmap: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+}
+
+static void heatmap_flush(void)
+{
+  if(0 == _touched_count)
+  {
+    return;
+  }
+
+  // A window shown or saved before its end is stored again with later
+  // accesses.
+  if(0 < _window_count && _current == _windows[_window_count - 1].index)
+  {
+    const struct heatmap_window *last = &_windows[--_window_count];
+    for(int i = last->first_cell; i < last->first_cell + last->line_count; ++i)
+    {
+      if(0 == _counts[_cells[i].line])
+      {
+        _touched[_touched_count++] = _cells[i].line;
+      }
+      _counts[_cells[i].line] += _cells[i].count;
+    }
+    _cell_count = last->first_cell;
+  }
+
+  _windows = heatmap_append(_windows, _window_count, sizeof(*_windows));
+  struct heatmap_window *window = &_windows[_window_count++];
+  window->index      = _current;
+  window->first_cell = _cell_count;
+  window->line_count = _touched_count;
+
+  for(int i = 0; i < _touched_count; ++i)
+  {
+    const int line = _touched[i];
+    _cells = heatmap_append(_cells, _cell_count, sizeof(*_cells));
+    _cells[_cell_count].line  = line;
+    _cells[_cell_count].count = _counts[line];
+    ++_cell_count;
+
+    _counts[line] = 0;
+  }
+  _touched_count = 0;
+}
+
+static bool heatmap_save(const char *filename)
+{
+  if(0 == _window_count)
+  {
+    json_printf("heatmap: no data is accessed\n");
+    return false;
+  }
+
+  int first_line = HEATMAP_LINE_COUNT;
+  int last_line  = 0;
+  int count_max  = 0;
+  for(int i = 0; i < _cell_count; ++i)
+  {
+    first_line = _cells[i].line < first_line ? _cells[i].line : first_line;
+    last_line  = _cells[i].line > last_line ? _cells[i].line : last_line;
+    count_max  = _cells[i].count > count_max ? _cells[i].count : count_max;
+  }
+
+  FILE *fp = fopen(filename, "wb");
+  if(!fp)
+  {
+    json_printf("heatmap: cannot create '%s' file\n", filename);
+    return false;
+  }
+
+  // Windows without access are black rows.
+  const int                width      = last_line - first_line + 1;
+  const unsigned long long last_index = _windows[_window_count - 1].index;
+  fprintf(fp, "P5\n");
+  fprintf(fp, "# %d bytes per column from %X, %d instructions per row\n",
+          CACHE_LINE_LEN,
+          first_line * CACHE_LINE_LEN,
+          _interval);
+  fprintf(fp, "%d %llu\n%d\n", width, last_index + 1, PIXEL_MAX);
+
+  unsigned char *row = malloc(width);
+  int           walk = 0;
+  for(unsigned long long index = 0; index <= last_index; ++index)
+  {
+    memset(row, 0, width);
+    if(index == _windows[walk].index)
+    {
+      const struct heatmap_window *window = &_windows[walk++];
+      for(int i = 0; i < window->line_count; ++i)
+      {
+        const struct heatmap_cell *cell = &_cells[window->first_cell + i];
+
+        // An accessed line is never black.
+        row[cell->line - first_line] =
+          1 + (long long)(PIXEL_MAX - 1) * cell->count / count_max;
+      }
+    }
+    fwrite(row, 1, width, fp);
+  }
+  free(row);
+  fclose(fp);
+
+  json_printf("heatmap: %d x %llu image of lines from %X to %X\n",
+              width,
+              last_index + 1,
+              first_line * CACHE_LINE_LEN,
+              (last_line + 1) * CACHE_LINE_LEN - 1);
+
+  return true;
+}
+
+static void heatmap_show_working_set(void)
+{
+  int line_max = 0;
+  for(int i = 0; i < _window_count; ++i)
+  {
+    line_max = _windows[i].line_count > line_max ?
+               _windows[i].line_count :
+               line_max;
+  }
+
+  if(json_is_enabled())
+  {
+    json_begin_array("heatmap");
+    for(int i = 0; i < _window_count; ++i)
+    {
+      json_begin_object(NULL);
+      json_write_integer("start", _windows[i].index * _interval);
+      json_write_integer("lines", _windows[i].line_count);
+      json_end_object();
+    }
+    json_end_array();
+    return;
+  }
+
+  json_printf("Start\t\tLines\tBytes\n");
+  for(int i = 0; i < _window_count; ++i)
+  {
+    json_printf("%llu\t\t%d\t%d\n",
+                _windows[i].index * _interval,
+                _windows[i].line_count,
+                _windows[i].line_count * CACHE_LINE_LEN);
+  }
+  json_printf("Largest working set is %d lines (%d bytes) of %d bytes each.\n",
+              line_max,
+              line_max * CACHE_LINE_LEN,
+              CACHE_LINE_LEN);
+}
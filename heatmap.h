@@ -0,0 +1,39 @@
+/**
+ * @file  heatmap.h
+ * @brief A handler of heatmap related commands. Counts data accessed by runs
+ *        per line of memory in windows of instructions, and shows the
+ *        working set over time.
+ */
+
+#ifndef __HEATMAP_H__
+#define __HEATMAP_H__
+
+/**
+ * @brief                Count a data access of a run. Does nothing if the
+ *                       heatmap is off.
+ * @param[in] address    The starting address of memory.
+ * @param[in] byte_count The number of bytes accessed.
+ */
+void heatmap_access(const int address, const int byte_count);
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void heatmap_execute(const char *cmd,
+                     const int  argc,
+                     const char *argv[]);
+
+/**
+ * @brief Initialize heatmap. The heatmap is off.
+ */
+void heatmap_initialize(void);
+
+/**
+ * @brief Release counted windows.
+ */
+void heatmap_terminate(void);
+
+#endif
@@ -0,0 +1,659 @@
+/**
+ * @file  hexfile.c
+ * @brief A handler of hexfile related commands. Imports and exports memory
+ *        as Intel HEX and Motorola S-record files.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hexfile.h"
+
+#include "json.h"
+#include "logger.h"
+#include "memspace.h"
+
+/**
+ * @def   HEXFILE_BUFFER_LEN
+ * @brief The length of buffer of an exported file.
+ */
+#define HEXFILE_BUFFER_LEN 0x10000
+
+/**
+ * @def   HEXFILE_CHUNK_LEN
+ * @brief The number of bytes read from or written to memory at once.
+ */
+#define HEXFILE_CHUNK_LEN 0x1000
+
+/**
+ * @def   HEXFILE_LINE_LEN
+ * @brief The length of the longest line. A record has at most 255 bytes
+ *        after its count.
+ */
+#define HEXFILE_LINE_LEN 0x220
+
+/**
+ * @brief Structure of bytes of contiguous records, which are written to
+ *        memory at once.
+ */
+struct hexfile_chunk
+{
+  /** The starting address of bytes. */
+  int           address;
+  /** The number of bytes. */
+  int           len;
+  /** Bytes of records. */
+  unsigned char data[HEXFILE_CHUNK_LEN];
+};
+
+/**
+ * @brief Hexadecimal digits of values from 0 to 15.
+ */
+static const char DIGITS[] = "0123456789ABCDEF";
+
+/**
+ * @brief Equals to 16.
+ */
+static const int HEX = 16;
+
+/**
+ * @brief Type of a data record of Intel HEX.
+ */
+static const int IHEX_DATA = 0x00;
+
+/**
+ * @brief Type of an end of file record of Intel HEX.
+ */
+static const int IHEX_END = 0x01;
+
+/**
+ * @brief Type of an extended linear address record of Intel HEX.
+ */
+static const int IHEX_LINEAR = 0x04;
+
+/**
+ * @brief Type of an extended segment address record of Intel HEX.
+ */
+static const int IHEX_SEGMENT = 0x02;
+
+/**
+ * @brief The number of bytes of memory.
+ */
+static const int MEMORY_LEN = MEMSPACE_PAGE_LEN * MEMSPACE_PAGE_COUNT;
+
+/**
+ * @brief The number of data bytes of an exported record.
+ */
+static const int RECORD_LEN = 0x20;
+
+/**
+ * @brief The number of bytes addressed by 16 bits.
+ */
+static const int SEGMENT_LEN = 0x10000;
+
+/**
+ * @brief A buffer of an exported file.
+ */
+static char _buffer[HEXFILE_BUFFER_LEN];
+
+/**
+ * @brief Bytes of imported records not yet written to memory.
+ */
+static struct hexfile_chunk _chunk;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief Values of hexadecimal digits by their characters. -1 if not a
+ *        digit.
+ */
+static signed char _values[UCHAR_MAX + 1];
+
+/**
+ * @brief                Append bytes of a record to the chunk. The chunk is
+ *                       written to memory first if the bytes do not follow
+ *                       it or do not fit in it.
+ * @param[in] address    The starting address of bytes.
+ * @param[in] bytes      Bytes of a record.
+ * @param[in] byte_count The number of bytes.
+ */
+static void hexfile_append_chunk(const int           address,
+                                 const unsigned char *bytes,
+                                 const int           byte_count);
+
+/**
+ * @brief                 Decode hexadecimal digits into bytes.
+ * @param[in]  text       Two digits per byte.
+ * @param[out] bytes      Decoded bytes.
+ * @param[in]  byte_count The number of bytes to be decoded.
+ * @return                True on success, false if any character is not
+ *                        a digit.
+ */
+static bool hexfile_decode(const char    *text,
+                           unsigned char *bytes,
+                           const int     byte_count);
+
+/**
+ * @brief                 Encode bytes into hexadecimal digits.
+ * @param[out] text       Two digits per byte. Not NULL-terminated.
+ * @param[in]  bytes      Bytes to be encoded.
+ * @param[in]  byte_count The number of bytes.
+ * @return                The end of encoded digits.
+ */
+static char *hexfile_encode(char                *text,
+                            const unsigned char *bytes,
+                            const int           byte_count);
+
+/**
+ * @brief          Export memory in the given range to a file.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool hexfile_execute_memexport(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[]);
+
+/**
+ * @brief          Import records of a file to memory.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool hexfile_execute_memimport(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[]);
+
+/**
+ * @brief Write the chunk to memory, and empty it.
+ */
+static void hexfile_flush_chunk(void);
+
+/**
+ * @brief                Write a record of Intel HEX.
+ * @param[in] fp         A file to be written.
+ * @param[in] type       A type of the record.
+ * @param[in] address    The lower 16 bits of the address.
+ * @param[in] bytes      Data of the record.
+ * @param[in] byte_count The number of bytes of data.
+ */
+static void hexfile_write_ihex(FILE                *fp,
+                               const int           type,
+                               const int           address,
+                               const unsigned char *bytes,
+                               const int           byte_count);
+
+/**
+ * @brief                   Write a record of Motorola S-record.
+ * @param[in] fp            A file to be written.
+ * @param[in] type          A type of the record, from '0' to '9'.
+ * @param[in] address       The address of the record.
+ * @param[in] address_bytes The number of bytes of the address.
+ * @param[in] bytes         Data of the record.
+ * @param[in] byte_count    The number of bytes of data.
+ */
+static void hexfile_write_srec(FILE                *fp,
+                               const char          type,
+                               const int           address,
+                               const int           address_bytes,
+                               const unsigned char *bytes,
+                               const int           byte_count);
+
+void hexfile_execute(const char *cmd,
+                     const int  argc,
+                     const char *argv[])
+{
+  if(!strcmp("memexport", cmd))
+  {
+    _is_command_executed = hexfile_execute_memexport(cmd, argc, argv);
+  }
+  else if(!strcmp("memimport", cmd))
+  {
+    _is_command_executed = hexfile_execute_memimport(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void hexfile_initialize(void)
+{
+  memset(_values, -1, sizeof(_values));
+  for(int i = 0; i < HEX; ++i)
+  {
+    _values[(unsigned char)DIGITS[i]] = i;
+    _values[tolower((unsigned char)DIGITS[i])] = i;
+  }
+}
+
+static void hexfile_append_chunk(const int           address,
+                                 const unsigned char *bytes,
+                                 const int           byte_count)
+{
+  if(0 < _chunk.len &&
+     (address != _chunk.address + _chunk.len ||
+      HEXFILE_CHUNK_LEN < _chunk.len + byte_count))
+  {
+    hexfile_flush_chunk();
+  }
+  if(0 == _chunk.len)
+  {
+    _chunk.address = address;
+  }
+
+  memcpy(&_chunk.data[_chunk.len], bytes, byte_count);
+  _chunk.len += byte_count;
+}
+
+static bool hexfile_decode(const char    *text,
+                           unsigned char *bytes,
+                           const int     byte_count)
+{
+  for(int i = 0; i < byte_count; ++i)
+  {
+    const int high = _values[(unsigned char)text[2 * i]];
+    const int low  = _values[(unsigned char)text[2 * i + 1]];
+    if(0 > (high | low))
+    {
+      return false;
+    }
+    bytes[i] = (high << 4) | low;
+  }
+
+  return true;
+}
+
+static char *hexfile_encode(char                *text,
+                            const unsigned char *bytes,
+                            const int           byte_count)
+{
+  for(int i = 0; i < byte_count; ++i)
+  {
+    *text++ = DIGITS[bytes[i] >> 4];
+    *text++ = DIGITS[bytes[i] & 0xF];
+  }
+
+  return text;
+}
+
+static bool hexfile_execute_memexport(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[])
+{
+  if(3 > argc)
+  {
+    json_printf("memexport: a file name, start, and end are required\n");
+    return false;
+  }
+  if(4 < argc)
+  {
+    json_printf("memexport: too many arguments\n");
+    return false;
+  }
+
+  const bool is_srec = 4 == argc && !strcmp("srec", argv[3]);
+  if(4 == argc && !is_srec && strcmp("ihex", argv[3]))
+  {
+    json_printf("memexport: format '%s' is invalid\n", argv[3]);
+    return false;
+  }
+
+  char *endptr = NULL;
+  int  start   = strtol(argv[1], &endptr, HEX);
+  if('\0' != *endptr || 0 > start || MEMORY_LEN <= start)
+  {
+    json_printf("memexport: argument '%s' is invalid\n", argv[1]);
+    return false;
+  }
+  int end = strtol(argv[2], &endptr, HEX);
+  if('\0' != *endptr || 0 > end || MEMORY_LEN <= end)
+  {
+    json_printf("memexport: argument '%s' is invalid\n", argv[2]);
+    return false;
+  }
+  if(start > end)
+  {
+    json_printf("memexport: start '%X' is larger than end value '%X'\n",
+                start, end);
+    return false;
+  }
+
+  FILE *fp = fopen(argv[0], "w");
+  if(!fp)
+  {
+    json_printf("memexport: cannot create '%s' file\n", argv[0]);
+    return false;
+  }
+  setvbuf(fp, _buffer, _IOFBF, sizeof(_buffer));
+
+  // S-record has the address of 2 bytes if it fits, 3 bytes otherwise.
+  const int address_bytes = SEGMENT_LEN > end ? 2 : 3;
+  if(is_srec)
+  {
+    const int name_len = (int)strlen(argv[0]) < RECORD_LEN ?
+                         (int)strlen(argv[0]) :
+                         RECORD_LEN;
+    hexfile_write_srec(fp, '0', 0, 2, (const unsigned char *)argv[0], name_len);
+  }
+
+  unsigned char chunk[HEXFILE_CHUNK_LEN];
+  int           segment = 0;
+  for(int chunk_start = start;
+      chunk_start <= end;
+      chunk_start += HEXFILE_CHUNK_LEN)
+  {
+    const int chunk_len = end - chunk_start + 1 < HEXFILE_CHUNK_LEN ?
+                          end - chunk_start + 1 :
+                          HEXFILE_CHUNK_LEN;
+    memspace_get_memory(chunk, chunk_start, chunk_len);
+
+    int record_len = 0;
+    for(int offset = 0; offset < chunk_len; offset += record_len)
+    {
+      const int address = chunk_start + offset;
+      record_len = chunk_len - offset < RECORD_LEN ?
+                   chunk_len - offset :
+                   RECORD_LEN;
+      if(is_srec)
+      {
+        hexfile_write_srec(fp,
+                           '0' + address_bytes - 1,
+                           address,
+                           address_bytes,
+                           &chunk[offset],
+                           record_len);
+        continue;
+      }
+
+      // A record of Intel HEX does not cross 64 Kbytes, where the upper
+      // address changes.
+      if(SEGMENT_LEN - address % SEGMENT_LEN < record_len)
+      {
+        record_len = SEGMENT_LEN - address % SEGMENT_LEN;
+      }
+      if(address / SEGMENT_LEN != segment)
+      {
+        segment = address / SEGMENT_LEN;
+        const unsigned char upper[2] = {segment >> 8, segment & 0xFF};
+        hexfile_write_ihex(fp, IHEX_LINEAR, 0, upper, sizeof(upper));
+      }
+      hexfile_write_ihex(fp,
+                         IHEX_DATA,
+                         address % SEGMENT_LEN,
+                         &chunk[offset],
+                         record_len);
+    }
+  }
+
+  if(is_srec)
+  {
+    hexfile_write_srec(fp, '0' + 11 - address_bytes, 0, address_bytes, NULL, 0);
+  }
+  else
+  {
+    hexfile_write_ihex(fp, IHEX_END, 0, NULL, 0);
+  }
+  fclose(fp);
+
+  json_printf("memexport: %d bytes from %X to %X are exported\n",
+              end - start + 1,
+              start,
+              end);
+
+  return true;
+}
+
+static bool hexfile_execute_memimport(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[])
+{
+  if(1 != argc)
+  {
+    json_printf("memimport: a file name is required\n");
+    return false;
+  }
+
+  FILE *fp = fopen(argv[0], "r");
+  if(!fp)
+  {
+    json_printf("memimport: there is no such file '%s'\n", argv[0]);
+    return false;
+  }
+
+  _chunk.len = 0;
+
+  char          line[HEXFILE_LINE_LEN];
+  unsigned char bytes[HEXFILE_LINE_LEN / 2];
+  int           line_number  = 0;
+  int           record_count = 0;
+  int           byte_count   = 0;
+  int           lowest       = MEMORY_LEN;
+  int           highest      = -1;
+  int           upper        = 0;
+  const char    *error       = NULL;
+  bool          is_ended     = false;
+  while(!error && !is_ended && fgets(line, sizeof(line), fp))
+  {
+    ++line_number;
+    int len = strlen(line);
+    while(0 < len && strchr("\r\n \t", line[len - 1]))
+    {
+      line[--len] = '\0';
+    }
+    if(0 == len)
+    {
+      continue;
+    }
+
+    // A record is a mark, a type of S-record, and digits of bytes, where
+    // the first byte counts the rest of them except checksum of Intel HEX.
+    const bool is_srec     = 'S' == line[0];
+    const int  digit_start = is_srec ? 2 : 1;
+    const int  bytes_count = (len - digit_start) / 2;
+    if((':' != line[0] && !is_srec) ||
+       0 != (len - digit_start) % 2 ||
+       0 == bytes_count ||
+       !hexfile_decode(&line[digit_start], bytes, bytes_count) ||
+       bytes_count != bytes[0] + (is_srec ? 1 : 5))
+    {
+      error = "is not a record";
+      continue;
+    }
+
+    unsigned char checksum = 0;
+    for(int i = 0; i < bytes_count; ++i)
+    {
+      checksum += bytes[i];
+    }
+    if((is_srec ? 0xFF : 0x00) != checksum)
+    {
+      error = "has a wrong checksum";
+      continue;
+    }
+
+    int                 address    = 0;
+    const unsigned char *data      = NULL;
+    int                 data_count = 0;
+    if(is_srec)
+    {
+      // S1, S2, and S3 have data of addresses of 2, 3, and 4 bytes. S7, S8,
+      // and S9 end records.
+      const char type = line[1];
+      if('1' <= type && '3' >= type)
+      {
+        const int address_bytes = type - '0' + 1;
+        for(int i = 0; i < address_bytes; ++i)
+        {
+          address = (address << 8) | bytes[1 + i];
+        }
+        data       = &bytes[1 + address_bytes];
+        data_count = bytes_count - address_bytes - 2;
+      }
+      else if('7' <= type && '9' >= type)
+      {
+        is_ended = true;
+      }
+      else if('0' != type && '5' != type && '6' != type)
+      {
+        error = "has an unknown type";
+      }
+    }
+    else
+    {
+      const int type  = bytes[3];
+      const int value = (bytes[4] << 8) | bytes[5];
+      if(IHEX_DATA == type)
+      {
+        address    = upper + ((bytes[1] << 8) | bytes[2]);
+        data       = &bytes[4];
+        data_count = bytes[0];
+      }
+      else if(IHEX_END == type)
+      {
+        is_ended = true;
+      }
+      else if(IHEX_SEGMENT == type && 2 == bytes[0])
+      {
+        upper = value << 4;
+      }
+      else if(IHEX_LINEAR == type && 2 == bytes[0])
+      {
+        upper = value << 16;
+      }
+      else if(0x03 != type && 0x05 != type)
+      {
+        // Start addresses are ignored.
+        error = "has an unknown type";
+      }
+    }
+
+    if(!data || 0 >= data_count)
+    {
+      continue;
+    }
+    if(0 > address || MEMORY_LEN < address + data_count)
+    {
+      error = "is out of memory";
+      continue;
+    }
+
+    hexfile_append_chunk(address, data, data_count);
+    ++record_count;
+    byte_count += data_count;
+    lowest  = address < lowest ? address : lowest;
+    highest = address + data_count - 1 > highest ?
+              address + data_count - 1 :
+              highest;
+  }
+  fclose(fp);
+
+  // Records before an invalid one are imported.
+  hexfile_flush_chunk();
+  if(error)
+  {
+    json_printf("memimport: line %d of '%s' %s\n", line_number, argv[0], error);
+    return false;
+  }
+
+  if(0 == record_count)
+  {
+    json_printf("memimport: '%s' has no data\n", argv[0]);
+    return true;
+  }
+  json_printf("memimport: %d bytes in %d records from %X to %X are imported\n",
+              byte_count,
+              record_count,
+              lowest,
+              highest);
+
+  return true;
+}
+
+static void hexfile_flush_chunk(void)
+{
+  if(0 < _chunk.len)
+  {
+    memspace_set_memory(_chunk.address, _chunk.data, _chunk.len);
+    _chunk.len = 0;
+  }
+}
+
+static void hexfile_write_ihex(FILE                *fp,
+                               const int           type,
+                               const int           address,
+                               const unsigned char *bytes,
+                               const int           byte_count)
+{
+  const unsigned char header[4] = {byte_count,
+                                   (address >> 8) & 0xFF,
+                                   address & 0xFF,
+                                   type};
+  unsigned char       checksum  = 0;
+  for(int i = 0; i < (int)sizeof(header); ++i)
+  {
+    checksum += header[i];
+  }
+  for(int i = 0; i < byte_count; ++i)
+  {
+    checksum += bytes[i];
+  }
+  checksum = -checksum;
+
+  char line[HEXFILE_LINE_LEN];
+  char *walk = line;
+  *walk++ = ':';
+  walk    = hexfile_encode(walk, header, sizeof(header));
+  walk    = hexfile_encode(walk, bytes, byte_count);
+  walk    = hexfile_encode(walk, &checksum, 1);
+  *walk++ = '\n';
+  fwrite(line, 1, walk - line, fp);
+}
+
+static void hexfile_write_srec(FILE                *fp,
+                               const char          type,
+                               const int           address,
+                               const int           address_bytes,
+                               const unsigned char *bytes,
+                               const int           byte_count)
+{
+  // The count covers the address, data, and checksum.
+  unsigned char header[5] = {address_bytes + byte_count + 1,};
+  for(int i = 0; i < address_bytes; ++i)
+  {
+    header[1 + i] = (address >> (8 * (address_bytes - 1 - i))) & 0xFF;
+  }
+
+  unsigned char checksum = 0;
+  for(int i = 0; i < 1 + address_bytes; ++i)
+  {
+    checksum += header[i];
+  }
+  for(int i = 0; i < byte_count; ++i)
+  {
+    checksum += bytes[i];
+  }
+  checksum = ~checksum;
+
+  char line[HEXFILE_LINE_LEN];
+  char *walk = line;
+  *walk++ = 'S';
+  *walk++ = type;
+  walk    = hexfile_encode(walk, header, 1 + address_bytes);
+  walk    = hexfile_encode(walk, bytes, byte_count);
+  walk    = hexfile_encode(walk, &checksum, 1);
+  *walk++ = '\n';
+  fwrite(line, 1, walk - line, fp);
+}
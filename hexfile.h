@@ -0,0 +1,25 @@
+/**
+ * @file  hexfile.h
+ * @brief A handler of hexfile related commands. Imports and exports memory
+ *        as Intel HEX and Motorola S-record files.
+ */
+
+#ifndef __HEXFILE_H__
+#define __HEXFILE_H__
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void hexfile_execute(const char *cmd,
+                     const int  argc,
+                     const char *argv[]);
+
+/**
+ * @brief Initialize hexfile.
+ */
+void hexfile_initialize(void);
+
+#endif
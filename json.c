@@ -0,0 +1,450 @@
+/**
+ * @file  json.c
+ * @brief A handler of output format related commands. In JSON format, each
+ *        command is reported as one JSON object per line.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+#include "logger.h"
+
+/**
+ * @def   JSON_DEPTH_MAX
+ * @brief The maximum depth of nested arrays and objects in a result.
+ */
+#define JSON_DEPTH_MAX 16
+
+/**
+ * @brief Structure of a growing character buffer.
+ */
+struct json_buffer
+{
+  /** Characters written so far. Not null terminated. */
+  char   *data;
+  /** The number of characters written so far. */
+  size_t len;
+  /** The number of characters that can be written without reallocation. */
+  size_t capacity;
+};
+
+/**
+ * @brief A const variable that holds the initial capacity of buffers.
+ */
+static const size_t JSON_BUFFER_INITIAL_CAPACITY = 0x1000;
+
+/**
+ * @brief The current depth of nested arrays and objects in the result.
+ */
+static int _depth = 0;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief A flag indicating whether JSON format is on or not.
+ */
+static bool _is_enabled = false;
+
+/**
+ * @brief Flags indicating whether nothing is written yet at each depth.
+ *        Used to separate members by comma.
+ */
+static bool _is_first[JSON_DEPTH_MAX];
+
+/**
+ * @brief The number of logs before the current command.
+ */
+static int _log_count = 0;
+
+/**
+ * @brief Output that the current command printed.
+ */
+static char *_messages = NULL;
+
+/**
+ * @brief The length of _messages.
+ */
+static size_t _messages_len = 0;
+
+/**
+ * @brief A buffer in which the JSON object of a command is built.
+ */
+static struct json_buffer _output;
+
+/**
+ * @brief A buffer of the result of the current command.
+ */
+static struct json_buffer _result;
+
+/**
+ * @brief A stream to which json_printf() writes output of the current
+ *        command. NULL if nothing is captured.
+ */
+static FILE *_messages_stream = NULL;
+
+/**
+ * @brief            Append characters to the buffer.
+ * @param[in] buffer A buffer to be appended.
+ * @param[in] str    Characters to be appended.
+ * @param[in] len    The number of characters to be appended.
+ */
+static void json_append(struct json_buffer *buffer,
+                        const char         *str,
+                        const size_t       len);
+
+/**
+ * @brief            Append a quoted and escaped string to the buffer.
+ * @param[in] buffer A buffer to be appended.
+ * @param[in] str    Characters to be appended.
+ * @param[in] len    The number of characters to be appended.
+ */
+static void json_append_string(struct json_buffer *buffer,
+                               const char         *str,
+                               const size_t       len);
+
+/**
+ * @brief          Turn JSON format on or off.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool json_execute_format(const char *cmd,
+                                const int  argc,
+                                const char *argv[]);
+
+/**
+ * @brief         Write a comma if needed and the key of a member.
+ * @param[in] key A key of the member. NULL if it is an element of array.
+ */
+static void json_write_key(const char *key);
+
+void json_execute(const char *cmd,
+                  const int  argc,
+                  const char *argv[])
+{
+  if(!strcmp("format", cmd))
+  {
+    _is_command_executed = json_execute_format(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void json_begin_array(const char *key)
+{
+  if(!_messages_stream)
+  {
+    // Nothing is captured, so there is no result to write to.
+    return;
+  }
+
+  json_write_key(key);
+  json_append(&_result, "[", 1);
+
+  ++_depth;
+  _is_first[_depth] = true;
+}
+
+void json_begin_command(void)
+{
+  if(!_is_enabled)
+  {
+    return;
+  }
+
+  // Output of the command is captured to be reported as messages. The
+  // standard output is left as is, so handlers print through json_printf().
+  _messages_stream = open_memstream(&_messages, &_messages_len);
+  if(!_messages_stream)
+  {
+    return;
+  }
+
+  _result.len  = 0;
+  _depth       = 0;
+  _is_first[0] = true;
+  _log_count   = logger_get_log_count();
+}
+
+void json_begin_object(const char *key)
+{
+  if(!_messages_stream)
+  {
+    // Nothing is captured, so there is no result to write to.
+    return;
+  }
+
+  json_write_key(key);
+  json_append(&_result, "{", 1);
+
+  ++_depth;
+  _is_first[_depth] = true;
+}
+
+void json_end_array(void)
+{
+  if(!_messages_stream)
+  {
+    // Nothing is captured, so there is no result to write to.
+    return;
+  }
+
+  json_append(&_result, "]", 1);
+  --_depth;
+}
+
+void json_end_command(const char *cmd,
+                      const int  argc,
+                      const char *argv[],
+                      const bool is_success)
+{
+  if(!_messages_stream)
+  {
+    return;
+  }
+
+  fclose(_messages_stream);
+  _messages_stream = NULL;
+
+  if(cmd)
+  {
+    // Only successfully executed commands are logged.
+    bool is_ok = is_success && _log_count != logger_get_log_count();
+
+    _output.len = 0;
+    json_append(&_output, "{\"command\":", 11);
+    json_append_string(&_output, cmd, strlen(cmd));
+    json_append(&_output, ",\"args\":[", 9);
+    for(int i = 0; i < argc; ++i)
+    {
+      if(0 < i)
+      {
+        json_append(&_output, ",", 1);
+      }
+      json_append_string(&_output, argv[i], strlen(argv[i]));
+    }
+    json_append(&_output, "],\"ok\":", 7);
+    json_append(&_output, is_ok ? "true" : "false", is_ok ? 4 : 5);
+    json_append(&_output, ",\"result\":{", 11);
+    json_append(&_output, _result.data, _result.len);
+    json_append(&_output, "},\"messages\":[", 14);
+
+    // Each line of output is a message.
+    size_t begin = 0;
+    for(size_t i = 0; i < _messages_len; ++i)
+    {
+      if('\n' == _messages[i] || i + 1 == _messages_len)
+      {
+        size_t end = '\n' == _messages[i] ? i : i + 1;
+        if(0 < begin)
+        {
+          json_append(&_output, ",", 1);
+        }
+        json_append_string(&_output, &_messages[begin], end - begin);
+        begin = i + 1;
+      }
+    }
+    json_append(&_output, "]}\n", 3);
+
+    fwrite(_output.data, 1, _output.len, stdout);
+    fflush(stdout);
+  }
+
+  free(_messages);
+  _messages     = NULL;
+  _messages_len = 0;
+}
+
+void json_end_object(void)
+{
+  if(!_messages_stream)
+  {
+    // Nothing is captured, so there is no result to write to.
+    return;
+  }
+
+  json_append(&_result, "}", 1);
+  --_depth;
+}
+
+void json_initialize(void)
+{
+  json_terminate();
+
+  _is_enabled = false;
+}
+
+bool json_is_enabled(void)
+{
+  return _is_enabled;
+}
+
+void json_printf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  vfprintf(_messages_stream ? _messages_stream : stdout, format, args);
+  va_end(args);
+}
+
+void json_set_enabled(const bool is_enabled)
+{
+  _is_enabled = is_enabled;
+}
+
+void json_terminate(void)
+{
+  free(_output.data);
+  free(_result.data);
+
+  memset(&_output, 0, sizeof(_output));
+  memset(&_result, 0, sizeof(_result));
+}
+
+void json_write_integer(const char *key, const long value)
+{
+  if(!_messages_stream)
+  {
+    // Nothing is captured, so there is no result to write to.
+    return;
+  }
+
+  char number[32];
+  int  len = snprintf(number, sizeof(number), "%ld", value);
+
+  json_write_key(key);
+  json_append(&_result, number, len);
+}
+
+void json_write_string(const char *key, const char *value)
+{
+  if(!_messages_stream)
+  {
+    // Nothing is captured, so there is no result to write to.
+    return;
+  }
+
+  json_write_key(key);
+  json_append_string(&_result, value, strlen(value));
+}
+
+static void json_append(struct json_buffer *buffer,
+                        const char         *str,
+                        const size_t       len)
+{
+  if(buffer->len + len > buffer->capacity)
+  {
+    size_t capacity = buffer->capacity ? buffer->capacity :
+                                         JSON_BUFFER_INITIAL_CAPACITY;
+    while(buffer->len + len > capacity)
+    {
+      capacity *= 2;
+    }
+    buffer->data     = realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+  }
+
+  memcpy(&buffer->data[buffer->len], str, len);
+  buffer->len += len;
+}
+
+static void json_append_string(struct json_buffer *buffer,
+                               const char         *str,
+                               const size_t       len)
+{
+  json_append(buffer, "\"", 1);
+
+  // Runs of characters that need no escape are appended at once.
+  size_t begin = 0;
+  for(size_t i = 0; i < len; ++i)
+  {
+    unsigned char c = str[i];
+    if('"' != c && '\\' != c && 0x20 <= c)
+    {
+      continue;
+    }
+
+    json_append(buffer, &str[begin], i - begin);
+    begin = i + 1;
+
+    char escaped[7];
+    if('"' == c || '\\' == c)
+    {
+      snprintf(escaped, sizeof(escaped), "\\%c", c);
+    }
+    else if('\t' == c)
+    {
+      snprintf(escaped, sizeof(escaped), "\\t");
+    }
+    else
+    {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+    }
+    json_append(buffer, escaped, strlen(escaped));
+  }
+  json_append(buffer, &str[begin], len - begin);
+
+  json_append(buffer, "\"", 1);
+}
+
+static bool json_execute_format(const char *cmd,
+                                const int  argc,
+                                const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("format: %s\n", _is_enabled ? "json" : "text");
+    return true;
+  }
+  if(1 < argc)
+  {
+    json_printf("format: too many arguments\n");
+    return false;
+  }
+
+  if(!strcmp("json", argv[0]))
+  {
+    _is_enabled = true;
+  }
+  else if(!strcmp("text", argv[0]))
+  {
+    _is_enabled = false;
+  }
+  else
+  {
+    json_printf("format: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+
+  return true;
+}
+
+static void json_write_key(const char *key)
+{
+  if(!_is_first[_depth])
+  {
+    json_append(&_result, ",", 1);
+  }
+  _is_first[_depth] = false;
+
+  if(key)
+  {
+    json_append_string(&_result, key, strlen(key));
+    json_append(&_result, ":", 1);
+  }
+}
@@ -0,0 +1,109 @@
+/**
+ * @file  json.h
+ * @brief A handler of output format related commands. In JSON format, each
+ *        command is reported as one JSON object per line.
+ */
+
+#ifndef __JSON_H__
+#define __JSON_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void json_execute(const char *cmd,
+                  const int  argc,
+                  const char *argv[]);
+
+/**
+ * @brief         Begin an array in the result of the current command.
+ * @param[in] key A key of the array. NULL if it is an element of array.
+ */
+void json_begin_array(const char *key);
+
+/**
+ * @brief Start capturing output of a command if JSON format is on.
+ */
+void json_begin_command(void);
+
+/**
+ * @brief         Begin an object in the result of the current command.
+ * @param[in] key A key of the object. NULL if it is an element of array.
+ */
+void json_begin_object(const char *key);
+
+/**
+ * @brief End the array that was begun last.
+ */
+void json_end_array(void);
+
+/**
+ * @brief                Stop capturing output of a command and write the
+ *                       JSON object of the command.
+ * @param[in] cmd        A type of the command. NULL if the input was empty.
+ * @param[in] argc       The number of arguments.
+ * @param[in] argv       An list of arguments.
+ * @param[in] is_success A flag indicating whether the command succeeded.
+ */
+void json_end_command(const char *cmd,
+                      const int  argc,
+                      const char *argv[],
+                      const bool is_success);
+
+/**
+ * @brief End the object that was begun last.
+ */
+void json_end_object(void);
+
+/**
+ * @brief Initialize JSON format to be off.
+ */
+void json_initialize(void);
+
+/**
+ * @brief  Return whether JSON format is on or not.
+ * @return True if JSON format is on, false otherwise.
+ */
+bool json_is_enabled(void);
+
+/**
+ * @brief            Print formatted output of the current command. It is
+ *                   captured as messages if JSON format is on, and printed
+ *                   to the standard output otherwise. Command handlers
+ *                   print through it, so the standard output is never
+ *                   rebound.
+ * @param[in] format A format string of printf().
+ */
+void json_printf(const char *format, ...)
+  __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief                Turn JSON format on or off.
+ * @param[in] is_enabled A flag indicating whether JSON format is on.
+ */
+void json_set_enabled(const bool is_enabled);
+
+/**
+ * @brief Release the buffer.
+ */
+void json_terminate(void);
+
+/**
+ * @brief           Write an integer to the result of the current command.
+ * @param[in] key   A key of the integer. NULL if it is an element of array.
+ * @param[in] value A value of the integer.
+ */
+void json_write_integer(const char *key, const long value);
+
+/**
+ * @brief           Write a string to the result of the current command.
+ * @param[in] key   A key of the string. NULL if it is an element of array.
+ * @param[in] value A value of the string.
+ */
+void json_write_string(const char *key, const char *value);
+
+#endif
@@ -0,0 +1,276 @@
+/**
+ * @file  line_table.c
+ * @brief An address-to-line table used for source level debugging. Filled
+ *        by the loader from line records the assembler writes to .obj files.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "line_table.h"
+
+/**
+ * @brief Structure of line table elements.
+ */
+struct line_entry
+{
+  /** A name of the source file. Points to an element of _files. */
+  const char *filename;
+  /** A line number in the .lst file. */
+  int        line;
+  /** A loaded address of the first byte of the line. */
+  int        address;
+};
+
+/**
+ * @brief Structure of source file name elements.
+ */
+struct line_file
+{
+  /** A pointer to the next file element. */
+  struct line_file *next;
+  /** A name of the source file. */
+  char             name[];
+};
+
+/**
+ * @brief A const variable that holds the initial capacity of line table.
+ */
+static const int LINE_TABLE_INITIAL_CAPACITY = 64;
+
+/**
+ * @brief A list of entries sorted by address once _is_sorted is set.
+ */
+static struct line_entry *_entries = NULL;
+
+/**
+ * @brief The number of entries.
+ */
+static int _entry_count = 0;
+
+/**
+ * @brief The number of entries that can be stored without reallocation.
+ */
+static int _entry_capacity = 0;
+
+/**
+ * @brief A list of source file names referred by entries.
+ */
+static struct line_file *_files = NULL;
+
+/**
+ * @brief A flag indicating whether both indexes are sorted or not.
+ */
+static bool _is_sorted = false;
+
+/**
+ * @brief A list of entries sorted by file name, line, and address.
+ */
+static struct line_entry *_line_index = NULL;
+
+/**
+ * @brief           Compare two entries by address.
+ * @param[in] entry1 The first entry to be compared.
+ * @param[in] entry2 The second entry to be compared.
+ * @return          Negative, zero, or positive as qsort() requires.
+ */
+static int line_table_compare_address(const void *entry1, const void *entry2);
+
+/**
+ * @brief           Compare two entries by file name, line, and address.
+ * @param[in] entry1 The first entry to be compared.
+ * @param[in] entry2 The second entry to be compared.
+ * @return          Negative, zero, or positive as qsort() requires.
+ */
+static int line_table_compare_line(const void *entry1, const void *entry2);
+
+/**
+ * @brief Sort both indexes if there were insertions after the last sort.
+ */
+static void line_table_sort(void);
+
+int line_table_find_address(const char *filename, const int line)
+{
+  line_table_sort();
+
+  // Binary search for the first entry not less than (filename, line).
+  int low  = 0;
+  int high = _entry_count;
+  while(low < high)
+  {
+    int mid  = low + (high - low) / 2;
+    int diff = strcasecmp(_line_index[mid].filename, filename);
+    if(0 == diff)
+    {
+      diff = _line_index[mid].line - line;
+    }
+
+    if(diff < 0)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  if(low == _entry_count || strcasecmp(_line_index[low].filename, filename))
+  {
+    return -1;
+  }
+
+  return _line_index[low].address;
+}
+
+int line_table_find_line(const int  address,
+                         const char **filename,
+                         int        *line)
+{
+  line_table_sort();
+
+  // Binary search for the last entry whose address is not greater than
+  // the given address.
+  int low  = 0;
+  int high = _entry_count;
+  while(low < high)
+  {
+    int mid = low + (high - low) / 2;
+    if(_entries[mid].address <= address)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  if(0 == low)
+  {
+    return -1;
+  }
+
+  *filename = _entries[low - 1].filename;
+  *line     = _entries[low - 1].line;
+  return _entries[low - 1].address;
+}
+
+void line_table_initialize(void)
+{
+  line_table_terminate();
+}
+
+void line_table_insert(const char *filename,
+                       const int  line,
+                       const int  address)
+{
+  struct line_file *file = _files;
+  while(file && strcmp(filename, file->name))
+  {
+    file = file->next;
+  }
+  if(!file)
+  {
+    file = malloc(sizeof(*file) + sizeof(char) * (strlen(filename) + 1));
+    strcpy(file->name, filename);
+    file->next = _files;
+    _files = file;
+  }
+
+  if(_entry_count == _entry_capacity)
+  {
+    _entry_capacity = _entry_capacity ? 2 * _entry_capacity :
+                                        LINE_TABLE_INITIAL_CAPACITY;
+    _entries = realloc(_entries, _entry_capacity * sizeof(*_entries));
+  }
+
+  _entries[_entry_count].filename = file->name;
+  _entries[_entry_count].line     = line;
+  _entries[_entry_count].address  = address;
+  ++_entry_count;
+
+  _is_sorted = false;
+}
+
+void line_table_relocate(const int delta)
+{
+  for(int i = 0; i < _entry_count; ++i)
+  {
+    _entries[i].address += delta;
+  }
+  if(_is_sorted)
+  {
+    for(int i = 0; i < _entry_count; ++i)
+    {
+      _line_index[i].address += delta;
+    }
+  }
+}
+
+void line_table_terminate(void)
+{
+  struct line_file *walk = _files;
+  while(walk)
+  {
+    struct line_file *del = walk;
+    walk = walk->next;
+    free(del);
+  }
+
+  free(_entries);
+  free(_line_index);
+
+  _entries        = NULL;
+  _entry_count    = 0;
+  _entry_capacity = 0;
+  _files          = NULL;
+  _is_sorted      = false;
+  _line_index     = NULL;
+}
+
+static int line_table_compare_address(const void *entry1, const void *entry2)
+{
+  const struct line_entry *e1 = entry1;
+  const struct line_entry *e2 = entry2;
+
+  return e1->address - e2->address;
+}
+
+static int line_table_compare_line(const void *entry1, const void *entry2)
+{
+  const struct line_entry *e1 = entry1;
+  const struct line_entry *e2 = entry2;
+
+  int diff = strcasecmp(e1->filename, e2->filename);
+  if(0 != diff)
+  {
+    return diff;
+  }
+  if(e1->line != e2->line)
+  {
+    return e1->line - e2->line;
+  }
+
+  return e1->address - e2->address;
+}
+
+static void line_table_sort(void)
+{
+  if(_is_sorted)
+  {
+    return;
+  }
+
+  qsort(_entries, _entry_count, sizeof(*_entries), line_table_compare_address);
+
+  _line_index = realloc(_line_index,
+                        (_entry_count ? _entry_count : 1) * sizeof(*_line_index));
+  memcpy(_line_index, _entries, _entry_count * sizeof(*_entries));
+  qsort(_line_index, _entry_count, sizeof(*_line_index), line_table_compare_line);
+
+  _is_sorted = true;
+}
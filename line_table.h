@@ -0,0 +1,59 @@
+/**
+ * @file  line_table.h
+ * @brief An address-to-line table used for source level debugging. Filled
+ *        by the loader from line records the assembler writes to .obj files.
+ */
+
+#ifndef __LINE_TABLE_H__
+#define __LINE_TABLE_H__
+
+/**
+ * @brief               Return the address of the first instruction of the
+ *                      given source line, or of the nearest following line
+ *                      that has an instruction.
+ * @param[in] filename  A name of the source file.
+ * @param[in] line      A line number in the .lst file.
+ * @return              An address if found, -1 otherwise.
+ */
+int line_table_find_address(const char *filename, const int line);
+
+/**
+ * @brief                Find the source line that contains the given address.
+ * @param[in]  address   An address to be searched.
+ * @param[out] filename  A name of the source file.
+ * @param[out] line      A line number in the .lst file.
+ * @return               The starting address of the line if found,
+ *                       -1 otherwise.
+ */
+int line_table_find_line(const int  address,
+                         const char **filename,
+                         int        *line);
+
+/**
+ * @brief Initialize line table.
+ */
+void line_table_initialize(void);
+
+/**
+ * @brief              Insert new entry to line table.
+ * @param[in] filename A name of the source file.
+ * @param[in] line     A line number in the .lst file.
+ * @param[in] address  A loaded address of the first byte of the line.
+ */
+void line_table_insert(const char *filename,
+                       const int  line,
+                       const int  address);
+
+/**
+ * @brief           Move all entries by the given amount. The order of
+ *                  entries does not change.
+ * @param[in] delta An amount added to addresses.
+ */
+void line_table_relocate(const int delta);
+
+/**
+ * @brief Release line table.
+ */
+void line_table_terminate(void);
+
+#endif
@@ -0,0 +1,302 @@
+/**
+ * @file  literal.c
+ * @brief A literal table used during assembly. Literals with the same value
+ *        share one entry in a pool, and pools are placed at LTORG or END.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "literal.h"
+
+/**
+ * @def   LITERAL_TABLE_LEN
+ * @brief The length of literal hash table.
+ */
+#define LITERAL_TABLE_LEN 64
+
+/**
+ * @brief Structure of literal elements.
+ */
+struct literal
+{
+  /** A pointer to the next literal element in the same bucket. */
+  struct literal *next;
+  /** A pointer to the next literal element in insertion order. */
+  struct literal *order_next;
+  /** A pool number. */
+  int            pool;
+  /** An address. -1 until its pool is placed. */
+  int            address;
+  /** A program block in which its pool is placed. */
+  int            block;
+  /** An object code, which is the value in hex. Points into data. */
+  char           *object_code;
+  /** The literal of the first occurence, followed by the object code. */
+  char           data[];
+};
+
+/**
+ * @brief A const variable that holds the maximum length of a value in hex.
+ */
+static const int VALUE_LEN = 0x40;
+
+/**
+ * @brief The pool that literals are inserted to.
+ */
+static int _current_pool = 0;
+
+/**
+ * @brief The first literal in insertion order.
+ */
+static struct literal *_order_head = NULL;
+
+/**
+ * @brief The last literal in insertion order.
+ */
+static struct literal *_order_tail = NULL;
+
+/**
+ * @brief A hash table of literals keyed by their object codes.
+ */
+static struct literal *_table[LITERAL_TABLE_LEN];
+
+/**
+ * @brief                  Convert the literal to its object code.
+ * @param[in]  literal     A literal such as =C'EOF' or =X'05'.
+ * @param[out] object_code An object code of VALUE_LEN length.
+ * @return                 True on success, false if the literal is invalid.
+ */
+static bool literal_convert(const char *literal, char *object_code);
+
+/**
+ * @brief                 Find the literal with the object code in the pool.
+ * @param[in] object_code An object code.
+ * @param[in] pool        A pool number.
+ * @return                A literal if exists, NULL otherwise.
+ */
+static struct literal *literal_find(const char *object_code, const int pool);
+
+/**
+ * @brief                 Return the key of the object code.
+ * @param[in] object_code An object code.
+ * @return                An index of the hash table.
+ */
+static int literal_hash(const char *object_code);
+
+int literal_assign_pool(const int locctr, const int block)
+{
+  int address = locctr;
+
+  struct literal *walk = _order_head;
+  while(walk)
+  {
+    if(_current_pool == walk->pool)
+    {
+      walk->address = address;
+      walk->block   = block;
+      address += strlen(walk->object_code) / 2;
+    }
+    walk = walk->order_next;
+  }
+  ++_current_pool;
+
+  return address;
+}
+
+int literal_get_address(const char *literal, const int pool)
+{
+  char object_code[VALUE_LEN];
+  if(!literal_convert(literal, object_code))
+  {
+    return -1;
+  }
+
+  struct literal *found = literal_find(object_code, pool);
+
+  return found ? found->address : -1;
+}
+
+const char *literal_get_pool_entry(const int  pool,
+                                   const int  index,
+                                   int        *address,
+                                   const char **object_code)
+{
+  int count = 0;
+
+  struct literal *walk = _order_head;
+  while(walk)
+  {
+    if(pool == walk->pool && index == count++)
+    {
+      *address     = walk->address;
+      *object_code = walk->object_code;
+      return walk->data;
+    }
+    walk = walk->order_next;
+  }
+
+  return NULL;
+}
+
+void literal_initialize(void)
+{
+  _order_head = NULL;
+  _order_tail = NULL;
+  memset(_table, 0, sizeof(_table));
+  _current_pool = 0;
+}
+
+bool literal_insert(const char *literal)
+{
+  char object_code[VALUE_LEN];
+  if(!literal_convert(literal, object_code))
+  {
+    return false;
+  }
+
+  if(literal_find(object_code, _current_pool))
+  {
+    // The pool already has the same value.
+    return true;
+  }
+
+  struct literal *new_literal = malloc(sizeof(*new_literal) +
+                                       sizeof(char) * (strlen(literal) + 1 +
+                                                       strlen(object_code) + 1));
+  strcpy(new_literal->data, literal);
+  new_literal->object_code = &new_literal->data[strlen(literal) + 1];
+  strcpy(new_literal->object_code, object_code);
+  new_literal->pool       = _current_pool;
+  new_literal->address    = -1;
+  new_literal->block      = 0;
+  new_literal->order_next = NULL;
+
+  int key = literal_hash(object_code);
+  new_literal->next = _table[key];
+  _table[key]       = new_literal;
+
+  if(!_order_head)
+  {
+    _order_head = new_literal;
+  }
+  else
+  {
+    _order_tail->order_next = new_literal;
+  }
+  _order_tail = new_literal;
+
+  return true;
+}
+
+void literal_new_table(void)
+{
+  literal_terminate();
+  literal_initialize();
+}
+
+void literal_relocate_block(const int block, const int address)
+{
+  struct literal *walk = _order_head;
+  while(walk)
+  {
+    if(block == walk->block && 0 <= walk->address)
+    {
+      walk->address += address;
+    }
+    walk = walk->order_next;
+  }
+}
+
+void literal_terminate(void)
+{
+  struct literal *walk = _order_head;
+  while(walk)
+  {
+    struct literal *del = walk;
+    walk = walk->order_next;
+    free(del);
+  }
+
+  literal_initialize();
+}
+
+static bool literal_convert(const char *literal, char *object_code)
+{
+  int len = strlen(literal);
+  if(5 > len ||
+     '=' != literal[0] ||
+     '\'' != literal[2] ||
+     '\'' != literal[len - 1])
+  {
+    return false;
+  }
+
+  const char *value     = &literal[3];
+  int        value_len = len - 4;
+  if('C' == literal[1])
+  {
+    if(VALUE_LEN <= 2 * value_len)
+    {
+      return false;
+    }
+
+    for(int i = 0; i < value_len; ++i)
+    {
+      // Store half-word for one byte.
+      sprintf(&object_code[2 * i], "%02X", (unsigned char)value[i]);
+    }
+  }
+  else if('X' == literal[1])
+  {
+    if(VALUE_LEN <= value_len || value_len % 2)
+    {
+      return false;
+    }
+
+    for(int i = 0; i < value_len; ++i)
+    {
+      if(!(('0' <= value[i] && '9' >= value[i]) ||
+           ('A' <= value[i] && 'F' >= value[i])))
+      {
+        return false;
+      }
+      object_code[i] = value[i];
+    }
+    object_code[value_len] = '\0';
+  }
+  else
+  {
+    return false;
+  }
+
+  return true;
+}
+
+static struct literal *literal_find(const char *object_code, const int pool)
+{
+  struct literal *walk = _table[literal_hash(object_code)];
+  while(walk)
+  {
+    if(pool == walk->pool && !strcmp(object_code, walk->object_code))
+    {
+      return walk;
+    }
+    walk = walk->next;
+  }
+
+  return NULL;
+}
+
+static int literal_hash(const char *object_code)
+{
+  unsigned int hash = 0;
+  for(int i = 0; object_code[i]; ++i)
+  {
+    hash = 31 * hash + object_code[i];
+  }
+
+  return hash % LITERAL_TABLE_LEN;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file  literal.h
+ * @brief A literal table used during assembly. Literals with the same value
+ *        share one entry in a pool, and pools are placed at LTORG or END.
+ */
+
+#ifndef __LITERAL_H__
+#define __LITERAL_H__
+
+/**
+ * @brief             Place the literals that are not placed yet at the
+ *                    given locctr, and start a new pool.
+ * @param[in] locctr  A locctr of the pool in the block.
+ * @param[in] block   A program block in which the pool is placed.
+ * @return            A locctr right after the pool.
+ */
+int literal_assign_pool(const int locctr, const int block);
+
+/**
+ * @brief             Return the address of the literal in the given pool.
+ * @param[in] literal A literal such as =C'EOF' or =X'05'.
+ * @param[in] pool    A pool number. Pools are numbered from 0 in order.
+ * @return            An address if exists, -1 otherwise.
+ */
+int literal_get_address(const char *literal, const int pool);
+
+/**
+ * @brief                  Return an entry of the given pool.
+ * @param[in]  pool        A pool number.
+ * @param[in]  index       An index of the entry in the pool.
+ * @param[out] address     An address of the entry.
+ * @param[out] object_code An object code of the entry.
+ * @return                 The literal of the entry if exists, NULL otherwise.
+ */
+const char *literal_get_pool_entry(const int  pool,
+                                   const int  index,
+                                   int        *address,
+                                   const char **object_code);
+
+/**
+ * @brief Initialize literal table.
+ */
+void literal_initialize(void);
+
+/**
+ * @brief             Insert the literal to the current pool unless the pool
+ *                    already has a literal with the same value.
+ * @param[in] literal A literal such as =C'EOF' or =X'05'.
+ * @return            True on success, false if the literal is invalid.
+ */
+bool literal_insert(const char *literal);
+
+/**
+ * @brief Release the current literal table and create a new one.
+ */
+void literal_new_table(void);
+
+/**
+ * @brief             Add the start address of the program block to addresses
+ *                    of literals placed in the block.
+ * @param[in] block   A program block.
+ * @param[in] address A start address of the block.
+ */
+void literal_relocate_block(const int block, const int address);
+
+/**
+ * @brief Release all allocated memories.
+ */
+void literal_terminate(void);
+
+#endif
@@ -12,8 +12,67 @@
 
 #include "debugger.h"
 #include "external_symbol.h"
+#include "json.h"
+#include "line_table.h"
 #include "logger.h"
 #include "memspace.h"
+#include "timeline.h"
+
+/**
+ * @def   FILES_MAX
+ * @brief The maximum number of object files loaded at once.
+ */
+#define FILES_MAX 3
+
+/**
+ * @brief Structure of a modification resolved by pass 2, to be applied when
+ *        its page is loaded.
+ */
+struct loader_modification
+{
+  /** The address of the field to be modified. */
+  int  address;
+  /** The length of the field in half-bytes. */
+  int  length;
+  /** Modification flag. (+ or -) */
+  char flag;
+  /** An amount of modification. */
+  int  amount;
+};
+
+/**
+ * @brief Structure of a page of the program loaded lazily.
+ */
+struct loader_page
+{
+  /** Indices of text records overlapping the page, in loading order. */
+  int  *texts;
+  /** The number of text records. */
+  int  text_count;
+  /** Indices of modifications whose field starts in the page. */
+  int  *modifications;
+  /** The number of modifications. */
+  int  modification_count;
+  /** A flag indicating whether a field is modified across the end of the
+   *  page, so that the page and the next one are loaded together. */
+  bool is_straddled;
+};
+
+/**
+ * @brief Structure of a text record indexed by pass 1, to be decoded when
+ *        its page is loaded.
+ */
+struct loader_text
+{
+  /** The index of the object file. */
+  int  file;
+  /** The offset of the record in the object file. */
+  long offset;
+  /** The address of object code. */
+  int  address;
+  /** The length of object code. */
+  int  length;
+};
 
 /**
  * @brief A const variable that holds the length of buffer used for
@@ -26,16 +85,168 @@ static const int BUFFER_LEN = 0xFF;
  */
 static const int DECIMAL = 10;
 
+/**
+ * @brief A const variable that holds the number of bytes read past a
+ *        modified field. A field is read as a word of 3 bytes.
+ */
+static const int FIELD_PADDING = 3;
+
+/**
+ * @brief A const variable that holds the initial capacity of fixups.
+ */
+static const int FIXUP_INITIAL_CAPACITY = 64;
+
 /**
  * @brief Equals to 16.
  */
 static const int HEX = 16;
 
+/**
+ * @brief A const variable that holds the length of a path of an open file.
+ */
+static const int PATH_LEN = 0x20;
+
+/**
+ * @brief A const variable that holds the number of half-bytes of a word.
+ */
+static const int WORD_HALF_BYTES = 6;
+
+/**
+ * @brief Flags indicating whether each page has any instruction of the
+ *        loaded program, by its line records.
+ */
+static bool _code_pages[MEMSPACE_PAGE_COUNT];
+
+/**
+ * @brief The number of page faults of the program loaded lazily.
+ */
+static int _fault_count = 0;
+
+/**
+ * @brief Object files of the program loaded lazily, which are read when
+ *        their pages are loaded.
+ */
+static FILE *_files[FILES_MAX] = {NULL,};
+
+/**
+ * @brief Masks of modified fields in the word at each fixup offset.
+ */
+static int *_fixup_masks = NULL;
+
+/**
+ * @brief Multipliers of the relocation amount at each fixup offset. The
+ *        sign of the modification, shifted to the field in the word.
+ */
+static int *_fixup_multipliers = NULL;
+
+/**
+ * @brief Offsets of modified fields from the start of the loaded program.
+ *        Fixups are kept as separate arrays, so that relocation patches
+ *        them in one loop without any branch.
+ */
+static int *_fixup_offsets = NULL;
+
+/**
+ * @brief The number of fixups.
+ */
+static int _fixup_count = 0;
+
+/**
+ * @brief The number of fixups that can be stored without reallocation.
+ */
+static int _fixup_capacity = 0;
+
+/**
+ * @brief A copy of the linked program as loaded, before it runs. NULL if
+ *        no program is loaded.
+ */
+static unsigned char *_image = NULL;
+
+/**
+ * @brief A starting address of the loaded program.
+ */
+static int _image_address = 0;
+
+/**
+ * @brief A length of the loaded program.
+ */
+static int _image_length = 0;
+
 /**
  * @brief A flag indicating whether command is executed or not.
  */
 static bool _is_command_executed = false;
 
+/**
+ * @brief A flag indicating whether the program is loaded lazily or not.
+ */
+static bool _is_lazy = false;
+
+/**
+ * @brief Modifications of the program loaded lazily.
+ */
+static struct loader_modification *_modifications = NULL;
+
+/**
+ * @brief The number of modifications.
+ */
+static int _modification_count = 0;
+
+/**
+ * @brief The number of pages of the loaded program.
+ */
+static int _page_count = 0;
+
+/**
+ * @brief Pages of the program loaded lazily.
+ */
+static struct loader_page _pages[MEMSPACE_PAGE_COUNT];
+
+/**
+ * @brief Text records of the program loaded lazily.
+ */
+static struct loader_text *_texts = NULL;
+
+/**
+ * @brief The number of text records.
+ */
+static int _text_count = 0;
+
+/**
+ * @brief The number of pages of the loaded program that are loaded.
+ */
+static int _touched_page_count = 0;
+
+/**
+ * @brief             Keep a field modified by a modification record, so
+ *                    that it can be relocated later.
+ * @param[in] address The address of the modified field.
+ * @param[in] length  The length of the field in half-bytes.
+ * @param[in] flag    Modification flag. (+ or -)
+ */
+static void loader_add_fixup(const int  address,
+                             const int  length,
+                             const char flag);
+
+/**
+ * @brief           Append a value to a list, growing the list by doubling.
+ * @param[in] list  A list of the given number of values.
+ * @param[in] count The number of values in the list.
+ * @param[in] size  The size of a value.
+ * @return          A list which has room for one more value.
+ */
+static void *loader_append(void *list, const int count, const size_t size);
+
+/**
+ * @brief          Show pages loaded so far against pages of the program.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool loader_execute_loadstats(const char *cmd,
+                                     const int  argc,
+                                     const char *argv[]);
+
 /**
  * @brief          Perform linking and loading.
  * @param[in] cmd  A type of the command.
@@ -46,21 +257,88 @@ static bool loader_execute_loader(const char *cmd,
                                   const int  argc,
                                   const char *argv[]);
 
+/**
+ * @brief          Move the loaded program to the given address. Only
+ *                 modified fields are patched, and object files are not
+ *                 read again.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool loader_execute_relocate(const char *cmd,
+                                    const int  argc,
+                                    const char *argv[]);
+
+/**
+ * @brief             Keep a modification resolved by pass 2, to be applied
+ *                    when its page is loaded.
+ * @param[in] address The address of the field to be modified.
+ * @param[in] length  The length of the field in half-bytes.
+ * @param[in] flag    Modification flag. (+ or -)
+ * @param[in] amount  An amount of modification.
+ * @return            True on success, false otherwise.
+ */
+static bool loader_index_modification(const int  address,
+                                      const int  length,
+                                      const char flag,
+                                      const int  amount);
+
+/**
+ * @brief                             Keep a text record found by pass 1,
+ *                                    to be decoded when its pages are
+ *                                    loaded.
+ * @param[in] buffer                  The content of text record.
+ * @param[in] file                    The index of the object file.
+ * @param[in] offset                  The offset of the record in the file.
+ * @param[in] control_section_address The starting address of control section.
+ * @return                            True on success, false otherwise.
+ */
+static bool loader_index_text(const char *buffer,
+                              const int  file,
+                              const long offset,
+                              const int  control_section_address);
+
+/**
+ * @brief          Load a page of the program loaded lazily, on its first
+ *                 access. Decode its text records and apply modifications.
+ * @param[in] page The index of the page.
+ */
+static void loader_load_page(const int page);
+
 /**
  * @brief                Create external symbol table.
  * @param[in] file_count The number of object files.
  * @param[in] file_names A list of object file names.
+ * @param[in] is_lazy    True to index text records instead of loading.
  * @return               True on success, false otherwise.
  */
-static bool loader_pass1(const int file_count, const char *file_names[]);
+static bool loader_pass1(const int  file_count,
+                         const char *file_names[],
+                         const bool is_lazy);
 
 /**
  * @brief                Load object code on memory.
  * @param[in] file_count The number of object files.
  * @param[in] file_names A list of object file names.
+ * @param[in] is_lazy    True to keep modifications instead of applying.
  * @return               True on success, false otherwise.
  */
-static bool loader_pass2(const int file_count, const char *file_names[]);
+static bool loader_pass2(const int  file_count,
+                         const char *file_names[],
+                         const bool is_lazy);
+
+/**
+ * @brief Protect pages of the loaded program. Pages without instructions
+ *        cannot be executed. Pages of object files without line records are
+ *        not protected, since their instructions are not known.
+ */
+static void loader_protect_pages(void);
+
+/**
+ * @brief Release the loaded image and its fixups, and pages of the program
+ *        loaded lazily.
+ */
+static void loader_release_image(void);
 
 /**
  * @brief                     Tokenize define record.
@@ -94,6 +372,18 @@ static void loader_tokenize_text_record(const char    *buffer,
                                         int           *object_code_length,
                                         unsigned char *object_code);
 
+/**
+ * @brief                             Tokenize line record and insert its
+ *                                    entries to line table. Pages of the
+ *                                    entries are marked as code pages.
+ * @param[in] buffer                  The content of record to be tokenized.
+ * @param[in] filename                The name of source file of the record.
+ * @param[in] control_section_address The starting address of control section.
+ */
+static void loader_tokenize_line_record(const char *buffer,
+                                        const char *filename,
+                                        const int  control_section_address);
+
 /**
  * @brief                           Tokenize modification record.
  * @param[in]  buffer               The content of record to be tokenized.
@@ -118,17 +408,45 @@ static void loader_tokenize_modification_record(const char *buffer,
 static void loader_tokenize_refer_record(const char *buffer,
                                          int        *external_references);
 
+void loader_detach(void)
+{
+  for(int i = 0; i < FILES_MAX; ++i)
+  {
+    if(_files[i])
+    {
+      // Open the file again by its descriptor, which gives it its own
+      // offset. The old one is left open, since closing it would seek the
+      // file shared with the parent. Pages are read after a seek.
+      char path[PATH_LEN];
+      snprintf(path, sizeof(path), "/proc/self/fd/%d", fileno(_files[i]));
+      FILE *file = fopen(path, "r");
+      if(file)
+      {
+        _files[i] = file;
+      }
+    }
+  }
+}
+
 void loader_execute(const char *cmd,
                     const int  argc,
                     const char *argv[])
 {
-  if(!strcmp("loader", cmd))
+  if(!strcmp("loadstats", cmd))
+  {
+    _is_command_executed = loader_execute_loadstats(cmd, argc, argv);
+  }
+  else if(!strcmp("loader", cmd))
   {
     _is_command_executed = loader_execute_loader(cmd, argc, argv);
   }
+  else if(!strcmp("relocate", cmd))
+  {
+    _is_command_executed = loader_execute_relocate(cmd, argc, argv);
+  }
   else
   {
-    printf("%s: command not found\n", cmd);
+    json_printf("%s: command not found\n", cmd);
   }
 
   if(_is_command_executed)
@@ -137,41 +455,410 @@ void loader_execute(const char *cmd,
   }
 }
 
+void loader_initialize(void)
+{
+  memset(_pages, 0, sizeof(_pages));
+  loader_release_image();
+  memspace_set_fault_handler(loader_load_page);
+}
+
+bool loader_load(const int  file_count,
+                 const char *file_names[],
+                 const bool is_lazy)
+{
+  external_symbol_initialize();
+  line_table_initialize();
+  loader_release_image();
+
+  timeline_begin("loader_pass1");
+  bool is_success = loader_pass1(file_count, file_names, is_lazy);
+  timeline_end("loader_pass1");
+  if(!is_success)
+  {
+    loader_release_image();
+    return false;
+  }
+
+  timeline_begin("loader_pass2");
+  is_success = loader_pass2(file_count, file_names, is_lazy);
+  timeline_end("loader_pass2");
+  if(!is_success)
+  {
+    loader_release_image();
+    return false;
+  }
+
+  loader_protect_pages();
+
+  if(is_lazy)
+  {
+    // Pages are loaded on their first access.
+    _is_lazy = true;
+    for(int page = 0; page < MEMSPACE_PAGE_COUNT; ++page)
+    {
+      if(_pages[page].text_count || _pages[page].modification_count)
+      {
+        memspace_set_pending(page * MEMSPACE_PAGE_LEN, MEMSPACE_PAGE_LEN, true);
+        ++_page_count;
+      }
+    }
+    return true;
+  }
+
+  if(0 < _image_length)
+  {
+    _page_count = (_image_address + _image_length - 1) / MEMSPACE_PAGE_LEN -
+                  _image_address / MEMSPACE_PAGE_LEN + 1;
+  }
+  _touched_page_count = _page_count;
+
+  // Keep the linked program as loaded, to be relocated later.
+  _image = calloc(_image_length + FIELD_PADDING, sizeof(*_image));
+  memspace_get_memory(_image, _image_address, _image_length);
+
+  return true;
+}
+
+void loader_terminate(void)
+{
+  loader_release_image();
+}
+
+static void loader_add_fixup(const int  address,
+                             const int  length,
+                             const char flag)
+{
+  if(_fixup_count == _fixup_capacity)
+  {
+    _fixup_capacity    = _fixup_capacity ? 2 * _fixup_capacity :
+                                           FIXUP_INITIAL_CAPACITY;
+    _fixup_masks       = realloc(_fixup_masks,
+                                 _fixup_capacity * sizeof(*_fixup_masks));
+    _fixup_multipliers = realloc(_fixup_multipliers,
+                                 _fixup_capacity * sizeof(*_fixup_multipliers));
+    _fixup_offsets     = realloc(_fixup_offsets,
+                                 _fixup_capacity * sizeof(*_fixup_offsets));
+  }
+
+  // A field of odd half-bytes starts at the lower half of its first byte.
+  // A field shorter than a word is at the upper bytes of the word.
+  const int shift = 8 * (WORD_HALF_BYTES / 2 - (length + 1) / 2);
+  _fixup_masks[_fixup_count]       = ((1 << (4 * length)) - 1) << shift;
+  _fixup_multipliers[_fixup_count] = ('-' == flag ? -1 : 1) * (1 << shift);
+  _fixup_offsets[_fixup_count]     = address - _image_address;
+  ++_fixup_count;
+}
+
+static void *loader_append(void *list, const int count, const size_t size)
+{
+  // Grow when the count reaches a power of 2.
+  if(0 == (count & (count - 1)))
+  {
+    list = realloc(list, (count ? 2 * count : 1) * size);
+  }
+
+  return list;
+}
+
+static bool loader_execute_loadstats(const char *cmd,
+                                     const int  argc,
+                                     const char *argv[])
+{
+  if(0 < argc)
+  {
+    json_printf("loadstats: too many arguments\n");
+    return false;
+  }
+  if(0 == _page_count)
+  {
+    json_printf("loadstats: no program is loaded\n");
+    return false;
+  }
+
+  if(json_is_enabled())
+  {
+    json_begin_object("loadstats");
+    json_write_integer("touched", _touched_page_count);
+    json_write_integer("pages", _page_count);
+    json_write_integer("faults", _fault_count);
+    json_end_object();
+    return true;
+  }
+
+  json_printf("Pages touched\t%d / %d (%.1f%%)\n",
+              _touched_page_count,
+              _page_count,
+              100.0 * _touched_page_count / _page_count);
+  json_printf("Page faults\t%d\n", _fault_count);
+  json_printf("Page size\t%d bytes\n", MEMSPACE_PAGE_LEN);
+
+  return true;
+}
+
 static bool loader_execute_loader(const char *cmd,
                                   const int  argc,
                                   const char *argv[])
 {
-  if(0 == argc)
+  // -lazy loads pages on their first access.
+  const bool is_lazy      = 0 < argc && !strcmp("-lazy", argv[0]);
+  const int  file_count   = is_lazy ? argc - 1 : argc;
+  const char **file_names = is_lazy ? &argv[1] : argv;
+
+  if(0 == file_count)
   {
-    printf("loader: at least one object file is required\n");
+    json_printf("loader: at least one object file is required\n");
     return false;
   }
-  if(3 < argc)
+  if(FILES_MAX < file_count)
   {
-    printf("loader: at most three object files can be loaded\n");
+    json_printf("loader: at most three object files can be loaded\n");
     return false;
   }
 
-  external_symbol_initialize();
+  if(!loader_load(file_count, file_names, is_lazy))
+  {
+    return false;
+  }
 
-  bool is_success = loader_pass1(argc, argv);
-  if(!is_success)
+  external_symbol_show_table();
+
+  return true;
+}
+
+static bool loader_execute_relocate(const char *cmd,
+                                    const int  argc,
+                                    const char *argv[])
+{
+  if(1 != argc)
+  {
+    json_printf("relocate: one argument is required\n");
+    return false;
+  }
+  if(_is_lazy)
+  {
+    json_printf("relocate: a program loaded lazily cannot be relocated\n");
+    return false;
+  }
+  if(!_image)
   {
+    json_printf("relocate: no program is loaded\n");
     return false;
   }
 
-  is_success = loader_pass2(argc, argv);
+  char *endptr = NULL;
+  int  address = strtol(argv[0], &endptr, HEX);
+  if('\0' != *endptr)
+  {
+    json_printf("relocate: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+
+  // Patch a copy, so that the image is kept if the address is out of range.
+  const int     delta = address - _image_address;
+  unsigned char *image = malloc((_image_length + FIELD_PADDING) * sizeof(*image));
+  memcpy(image, _image, _image_length + FIELD_PADDING);
+
+  timeline_begin(cmd);
+  for(int i = 0; i < _fixup_count; ++i)
+  {
+    unsigned char *field = &image[_fixup_offsets[i]];
+    const int     word   = (field[0] << 16) | (field[1] << 8) | field[2];
+    const int     fixed  = (word & ~_fixup_masks[i]) |
+                           ((word + _fixup_multipliers[i] * delta) &
+                            _fixup_masks[i]);
+    field[0] = (fixed >> 16) & 0xFF;
+    field[1] = (fixed >> 8) & 0xFF;
+    field[2] = fixed & 0xFF;
+  }
+  bool is_success = memspace_set_memory(address, image, _image_length);
+  timeline_end(cmd);
   if(!is_success)
   {
+    free(image);
     return false;
   }
 
+  free(_image);
+  _image         = image;
+  _image_address = address;
+
+  // Code pages are not known at the new address.
+  memset(_code_pages, 0, sizeof(_code_pages));
+  memspace_set_protection(0,
+                          MEMSPACE_PAGE_COUNT * MEMSPACE_PAGE_LEN,
+                          MEMSPACE_READ | MEMSPACE_WRITE | MEMSPACE_EXECUTE);
+
+  memspace_set_progaddr(address);
+  external_symbol_relocate(delta);
+  line_table_relocate(delta);
+  debugger_prepare_run(address, address + _image_length);
+
   external_symbol_show_table();
 
   return true;
 }
 
-static bool loader_pass1(const int file_count, const char *file_names[])
+static bool loader_index_modification(const int  address,
+                                      const int  length,
+                                      const char flag,
+                                      const int  amount)
+{
+  const int last_address = address + (length + 1) / 2 - 1;
+  if(0 > address || MEMSPACE_PAGE_COUNT * MEMSPACE_PAGE_LEN <= last_address)
+  {
+    json_printf("loader: modifying memory at '%05X' failed\n", address);
+    return false;
+  }
+
+  _modifications = loader_append(_modifications,
+                                 _modification_count,
+                                 sizeof(*_modifications));
+  _modifications[_modification_count] = (struct loader_modification){
+    .address = address,
+    .length  = length,
+    .flag    = flag,
+    .amount  = amount
+  };
+
+  struct loader_page *page = &_pages[address / MEMSPACE_PAGE_LEN];
+  page->modifications = loader_append(page->modifications,
+                                      page->modification_count,
+                                      sizeof(*page->modifications));
+  page->modifications[page->modification_count++] = _modification_count++;
+  if(address / MEMSPACE_PAGE_LEN != last_address / MEMSPACE_PAGE_LEN)
+  {
+    page->is_straddled = true;
+  }
+
+  return true;
+}
+
+static bool loader_index_text(const char *buffer,
+                              const int  file,
+                              const long offset,
+                              const int  control_section_address)
+{
+  // Only the address and the length are read. Object code is decoded when
+  // its pages are loaded.
+  char address[7] = {0,};
+  strncpy(address, &buffer[1], 6);
+  char length[3] = {0,};
+  strncpy(length, &buffer[7], 2);
+
+  const struct loader_text text = {
+    .file    = file,
+    .offset  = offset,
+    .address = control_section_address + strtol(address, NULL, HEX),
+    .length  = strtol(length, NULL, HEX)
+  };
+  if(0 == text.length)
+  {
+    return true;
+  }
+  if(MEMSPACE_PAGE_COUNT * MEMSPACE_PAGE_LEN < text.address + text.length)
+  {
+    json_printf("loader: loading text record at '%05X' failed\n", text.address);
+    return false;
+  }
+
+  _texts = loader_append(_texts, _text_count, sizeof(*_texts));
+  _texts[_text_count] = text;
+
+  for(int i = text.address / MEMSPACE_PAGE_LEN;
+      i <= (text.address + text.length - 1) / MEMSPACE_PAGE_LEN;
+      ++i)
+  {
+    struct loader_page *page = &_pages[i];
+    page->texts = loader_append(page->texts,
+                                page->text_count,
+                                sizeof(*page->texts));
+    page->texts[page->text_count++] = _text_count;
+  }
+  ++_text_count;
+
+  return true;
+}
+
+static void loader_load_page(const int page)
+{
+  if(!_is_lazy)
+  {
+    return;
+  }
+
+  // A field modified across a page boundary needs both pages, so such
+  // pages are loaded together.
+  int first = page;
+  int last  = page;
+  while(0 < first && _pages[first - 1].is_straddled)
+  {
+    --first;
+  }
+  while(MEMSPACE_PAGE_COUNT - 1 > last && _pages[last].is_straddled)
+  {
+    ++last;
+  }
+  memspace_set_pending(first * MEMSPACE_PAGE_LEN,
+                       (last - first + 1) * MEMSPACE_PAGE_LEN,
+                       false);
+  ++_fault_count;
+
+  char          buffer[BUFFER_LEN];
+  unsigned char object_code[BUFFER_LEN];
+  for(int i = first; i <= last; ++i)
+  {
+    const int page_start = i * MEMSPACE_PAGE_LEN;
+    const int page_end   = page_start + MEMSPACE_PAGE_LEN;
+    for(int j = 0; j < _pages[i].text_count; ++j)
+    {
+      const struct loader_text *text = &_texts[_pages[i].texts[j]];
+      int                      object_code_address = 0;
+      int                      object_code_length  = 0;
+      fseek(_files[text->file], text->offset, SEEK_SET);
+      if(!fgets(buffer, BUFFER_LEN, _files[text->file]))
+      {
+        json_printf("loader: reading text record at '%05X' failed\n",
+                 text->address);
+        continue;
+      }
+      loader_tokenize_text_record(buffer,
+                                  &object_code_address,
+                                  &object_code_length,
+                                  object_code);
+
+      // Only the part in this page is loaded. The rest is loaded with the
+      // other page.
+      const int start = text->address > page_start ? text->address :
+                                                     page_start;
+      const int end   = text->address + text->length < page_end ?
+                        text->address + text->length :
+                        page_end;
+      memspace_set_memory(start, &object_code[start - text->address], end - start);
+    }
+
+    if(_pages[i].text_count || _pages[i].modification_count)
+    {
+      ++_touched_page_count;
+    }
+  }
+
+  for(int i = first; i <= last; ++i)
+  {
+    for(int j = 0; j < _pages[i].modification_count; ++j)
+    {
+      const struct loader_modification *modification =
+        &_modifications[_pages[i].modifications[j]];
+      memspace_modify_memory(modification->address,
+                             modification->length,
+                             modification->flag,
+                             modification->amount);
+    }
+  }
+}
+
+static bool loader_pass1(const int  file_count,
+                         const char *file_names[],
+                         const bool is_lazy)
 {
   int  program_address         = 0;
   char control_section_name[7] = {0,};
@@ -188,10 +875,14 @@ static bool loader_pass1(const int file_count, const char *file_names[])
     obj_file = fopen(file_names[i], "r");
     if(!obj_file)
     {
-      printf("loader: there is no such file '%s'\n", file_names[i]);
+      json_printf("loader: there is no such file '%s'\n", file_names[i]);
       return false;
     }
 
+    char span_name[BUFFER_LEN];
+    snprintf(span_name, sizeof(span_name), "estab %s", file_names[i]);
+    timeline_begin(span_name);
+
     while(fgets(buffer, BUFFER_LEN, obj_file))
     {
       char record_type = buffer[0];
@@ -210,12 +901,22 @@ static bool loader_pass1(const int file_count, const char *file_names[])
                                            control_section_address,
                                            control_section_length);
 
-    while(fgets(buffer, BUFFER_LEN, obj_file))
+    for(long offset = ftell(obj_file);
+        fgets(buffer, BUFFER_LEN, obj_file);
+        offset = ftell(obj_file))
     {
       buffer[strlen(buffer) - 1] = '\0'; // Replace newline with null byte.
 
       char record_type = buffer[0];
-      if('D' == record_type)
+      if('T' == record_type && is_lazy)
+      {
+        if(!loader_index_text(buffer, i, offset, control_section_address))
+        {
+          fclose(obj_file);
+          return false;
+        }
+      }
+      else if('D' == record_type)
       {
         char symbol_name[7] = {0,};
         int  symbol_address = 0;
@@ -243,31 +944,47 @@ static bool loader_pass1(const int file_count, const char *file_names[])
     control_section_address += control_section_length;
 
     memset(control_section_name, 0, sizeof(control_section_name));
-    fclose(obj_file);
+    if(is_lazy)
+    {
+      // Kept open to read text records when their pages are loaded.
+      _files[i] = obj_file;
+    }
+    else
+    {
+      fclose(obj_file);
+    }
+
+    timeline_end(span_name);
   }
 
   debugger_prepare_run(program_address, control_section_address);
+  _image_address = program_address;
+  _image_length  = control_section_address - program_address;
 
   return true;
 }
 
-static bool loader_pass2(const int file_count, const char *file_names[])
+static bool loader_pass2(const int  file_count,
+                         const char *file_names[],
+                         const bool is_lazy)
 {
   char control_section_name[7]  = {0,};
   int  control_section_length   = 0;
   int  control_section_address  = 0;
   int  external_references[100] = {0,};
   FILE *obj_file                = NULL;
+  char source_filename[BUFFER_LEN];
   char buffer[BUFFER_LEN];
 
   control_section_address = memspace_get_progaddr();
+  memset(source_filename, 0, sizeof(source_filename));
 
   for(int i = 0; i < file_count; ++i)
   {
     obj_file = fopen(file_names[i], "r");
     if(!obj_file)
     {
-      printf("loader: there is no such file '%s'\n", file_names[i]);
+      json_printf("loader: there is no such file '%s'\n", file_names[i]);
       return false;
     }
 
@@ -287,12 +1004,17 @@ static bool loader_pass2(const int file_count, const char *file_names[])
                                   &control_section_length);
     external_references[1] = external_symbol_get_address(control_section_name);
 
+    bool has_line_record = false;
     while(fgets(buffer, BUFFER_LEN, obj_file))
     {
       buffer[strlen(buffer) - 1] = '\0'; // Replace newline with null byte.
 
       char record_type = buffer[0];
-      if('T' == record_type)
+      if('T' == record_type && is_lazy)
+      {
+        // Indexed by pass 1.
+      }
+      else if('T' == record_type)
       {
         int           object_code_address = 0;
         int           object_code_length  = 0;
@@ -307,8 +1029,8 @@ static bool loader_pass2(const int file_count, const char *file_names[])
                                                    object_code_length);
         if(!is_load_success)
         {
-          printf("loader: loading text record at '%05X' failed\n",
-              control_section_address + object_code_address);
+          json_printf("loader: loading text record at '%05X' failed\n",
+                   control_section_address + object_code_address);
           return false;
         }
       }
@@ -323,6 +1045,20 @@ static bool loader_pass2(const int file_count, const char *file_names[])
                                             &modification_length,
                                             &modification_flag,
                                             &reference_num);
+        if(is_lazy)
+        {
+          if(!loader_index_modification(control_section_address +
+                                        modification_address,
+                                        modification_length,
+                                        modification_flag,
+                                        external_references[reference_num]))
+          {
+            fclose(obj_file);
+            return false;
+          }
+          continue;
+        }
+
         bool is_modify_success = memspace_modify_memory(control_section_address +
                                                         modification_address,
                                                         modification_length,
@@ -330,10 +1066,13 @@ static bool loader_pass2(const int file_count, const char *file_names[])
                                                         external_references[reference_num]);
         if(!is_modify_success)
         {
-          printf("loader: modifying memory at '%05X' failed\n",
-              control_section_address + modification_address);
+          json_printf("loader: modifying memory at '%05X' failed\n",
+                   control_section_address + modification_address);
           return false;
         }
+        loader_add_fixup(control_section_address + modification_address,
+                         modification_length,
+                         modification_flag);
       }
       else if('R' == record_type)
       {
@@ -344,6 +1083,18 @@ static bool loader_pass2(const int file_count, const char *file_names[])
       {
         break;
       }
+      else if('.' == record_type && 'F' == buffer[1])
+      {
+        // Line records that follow belong to this source file.
+        strcpy(source_filename, &buffer[2]);
+      }
+      else if('.' == record_type && 'L' == buffer[1])
+      {
+        has_line_record = true;
+        loader_tokenize_line_record(buffer,
+                                    source_filename,
+                                    control_section_address);
+      }
       else
       {
         // When record type is 'D' or comment line.
@@ -351,16 +1102,97 @@ static bool loader_pass2(const int file_count, const char *file_names[])
       }
     }
 
+    if(!has_line_record && 0 < control_section_length)
+    {
+      // Instructions are not known, so all pages may have them.
+      for(int page = control_section_address / MEMSPACE_PAGE_LEN;
+          page <= (control_section_address + control_section_length - 1) /
+                  MEMSPACE_PAGE_LEN &&
+          MEMSPACE_PAGE_COUNT > page;
+          ++page)
+      {
+        _code_pages[page] = true;
+      }
+    }
+
     control_section_address += control_section_length;
 
     memset(control_section_name, 0, sizeof(control_section_name));
     memset(external_references, 0, sizeof(external_references));
+    memset(source_filename, 0, sizeof(source_filename));
     fclose(obj_file);
   }
 
   return true;
 }
 
+static void loader_protect_pages(void)
+{
+  // Pages of the previous program are no longer protected.
+  memspace_set_protection(0,
+                          MEMSPACE_PAGE_COUNT * MEMSPACE_PAGE_LEN,
+                          MEMSPACE_READ | MEMSPACE_WRITE | MEMSPACE_EXECUTE);
+  if(0 >= _image_length)
+  {
+    return;
+  }
+
+  for(int page = _image_address / MEMSPACE_PAGE_LEN;
+      page <= (_image_address + _image_length - 1) / MEMSPACE_PAGE_LEN &&
+      MEMSPACE_PAGE_COUNT > page;
+      ++page)
+  {
+    memspace_set_protection(page * MEMSPACE_PAGE_LEN,
+                            MEMSPACE_PAGE_LEN,
+                            MEMSPACE_READ | MEMSPACE_WRITE |
+                            (_code_pages[page] ? MEMSPACE_EXECUTE : 0));
+  }
+}
+
+static void loader_release_image(void)
+{
+  memset(_code_pages, 0, sizeof(_code_pages));
+  for(int page = 0; page < MEMSPACE_PAGE_COUNT; ++page)
+  {
+    if(_pages[page].text_count || _pages[page].modification_count)
+    {
+      memspace_set_pending(page * MEMSPACE_PAGE_LEN, MEMSPACE_PAGE_LEN, false);
+    }
+    free(_pages[page].texts);
+    free(_pages[page].modifications);
+  }
+  memset(_pages, 0, sizeof(_pages));
+  for(int i = 0; i < FILES_MAX; ++i)
+  {
+    if(_files[i])
+    {
+      fclose(_files[i]);
+      _files[i] = NULL;
+    }
+  }
+  free(_modifications);
+  free(_texts);
+  _modifications      = NULL;
+  _texts              = NULL;
+  _modification_count = 0;
+  _text_count         = 0;
+  _fault_count        = 0;
+  _page_count         = 0;
+  _touched_page_count = 0;
+  _is_lazy            = false;
+
+  free(_image);
+  free(_fixup_masks);
+  free(_fixup_multipliers);
+  free(_fixup_offsets);
+  _image             = NULL;
+  _fixup_masks       = NULL;
+  _fixup_multipliers = NULL;
+  _fixup_offsets     = NULL;
+  _fixup_count       = 0;
+  _fixup_capacity    = 0;
+}
+
 static void loader_tokenize_define_record(const char *buffer,
                                           char       *symbol_name,
                                           int        *symbol_address)
@@ -404,6 +1236,30 @@ static void loader_tokenize_text_record(const char    *buffer,
   }
 }
 
+static void loader_tokenize_line_record(const char *buffer,
+                                        const char *filename,
+                                        const int  control_section_address)
+{
+  // Each entry is 6 columns of address and 6 columns of line.
+  int entry_count = (strlen(buffer) - 2) / 12;
+  for(int i = 0; i < entry_count; ++i)
+  {
+    char address[7] = {0,};
+    strncpy(address, &buffer[2 + i * 12], 6);
+
+    char line[7] = {0,};
+    strncpy(line, &buffer[8 + i * 12], 6);
+
+    const int entry_address = control_section_address +
+                              strtol(address, NULL, HEX);
+    line_table_insert(filename, strtol(line, NULL, HEX), entry_address);
+    if(0 <= entry_address && MEMSPACE_PAGE_COUNT * MEMSPACE_PAGE_LEN > entry_address)
+    {
+      _code_pages[entry_address / MEMSPACE_PAGE_LEN] = true;
+    }
+  }
+}
+
 static void loader_tokenize_modification_record(const char *buffer,
                                                 int        *modification_address,
                                                 int        *modification_length,
@@ -418,6 +1274,16 @@ static void loader_tokenize_modification_record(const char *buffer,
   strncpy(length, &buffer[7], 2);
   *modification_length = strtol(length, NULL, HEX);
 
+  if('\0' == buffer[9])
+  {
+    // A modification record without flag and symbol, as the assembler
+    // writes for relocation. Relocate by the control section address, which
+    // is the reference number 01.
+    *modification_flag = '+';
+    *reference_num     = 1;
+    return;
+  }
+
   *modification_flag = buffer[9];
 
   char num[3] = {0,};
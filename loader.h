@@ -6,6 +6,13 @@
 #ifndef __LOADER_H__
 #define __LOADER_H__
 
+/**
+ * @brief Give a program loaded lazily its own .obj files after fork(), so
+ *        that loading pages in a child process does not move files of its
+ *        parent.
+ */
+void loader_detach(void);
+
 /**
  * @brief          Receives command and executes the command.
  * @param[in] cmd  A type of the command.
@@ -16,4 +23,25 @@ void loader_execute(const char *cmd,
                     const int  argc,
                     const char *argv[]);
 
+/**
+ * @brief Initialize loader.
+ */
+void loader_initialize(void);
+
+/**
+ * @brief                Link and load .obj files on memory at progaddr.
+ * @param[in] file_count The number of .obj files.
+ * @param[in] file_names A list of .obj file names.
+ * @param[in] is_lazy    True to load each page on its first access.
+ * @return               True on success, false otherwise.
+ */
+bool loader_load(const int  file_count,
+                 const char *file_names[],
+                 const bool is_lazy);
+
+/**
+ * @brief Release the loaded image.
+ */
+void loader_terminate(void);
+
 #endif
@@ -7,6 +7,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "json.h"
+
 /**
  * @brief An element of log list.
  */
@@ -28,6 +30,11 @@ static struct log *_log_head;
  */
 static struct log *_log_tail;
 
+/**
+ * @brief The number of logs.
+ */
+static int _log_count = 0;
+
 /**
  * @brief A length of input. Used to set the length of temporal char
  *        array that stores command
@@ -46,6 +53,11 @@ void logger_terminate(void)
   }
 }
 
+const int logger_get_log_count(void)
+{
+  return _log_count;
+}
+
 void logger_initialize(const int input_len)
 {
   INPUT_LEN = input_len;
@@ -59,8 +71,8 @@ const int logger_view_log(void)
   while(walk)
   {
     ++count;
-    printf("%d\t", count);
-    printf("%s\n", walk->command);
+    json_printf("%d\t", count);
+    json_printf("%s\n", walk->command);
 
     walk = walk->next;
   }
@@ -98,4 +110,5 @@ void logger_write_log(const char *cmd, const int argc, const char *argv[])
     _log_tail->next = new_log;
   }
   _log_tail = new_log;
+  ++_log_count;
 }
@@ -6,6 +6,13 @@
 #ifndef __LOGGER_H__
 #define __LOGGER_H__
 
+/**
+ * @brief  Return the number of logs. Since only successfully executed
+ *         commands are logged, it tells whether a command succeeded.
+ * @return The number of logs.
+ */
+const int logger_get_log_count(void);
+
 /**
  * @brief                  Receives the length of input.
  * @param[in] input_length The length of input.
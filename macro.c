@@ -0,0 +1,1642 @@
+/**
+ * @file  macro.c
+ * @brief A macro processor that runs in front of the assembler. It expands
+ *        macro invocations of .asm file into lines that the assembler reads.
+ *        Definitions of included files are cached in .pch sidecar files.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macro.h"
+
+#include "opcode.h"
+#include "symbol.h"
+
+/**
+ * @def   EXPANSION_TABLE_LEN
+ * @brief The length of expansion hash table.
+ */
+#define EXPANSION_TABLE_LEN 256
+
+/**
+ * @def   IF_DEPTH_MAX
+ * @brief The maximum depth of nested IF in a macro body.
+ */
+#define IF_DEPTH_MAX 16
+
+/**
+ * @def   MACRO_TABLE_LEN
+ * @brief The length of macro hash table.
+ */
+#define MACRO_TABLE_LEN 64
+
+/**
+ * @brief Structure of lines of the expanded source.
+ */
+struct source_line
+{
+  /** A content of the line. */
+  char *text;
+  /** A line number in .lst file. */
+  int  line;
+  /** A flag indicating whether the line is only listed or not. */
+  bool is_listed_only;
+};
+
+/**
+ * @brief Structure of macro definition elements.
+ */
+struct macro
+{
+  /** A pointer to the next macro element in the same bucket. */
+  struct macro *next;
+  /** Names of parameters without leading '&'. */
+  char         **params;
+  /** Default values of parameters. Empty if not given. */
+  char         **defaults;
+  /** The number of parameters. */
+  int          param_count;
+  /** Lines between MACRO and MEND. */
+  char         **body;
+  /** The number of lines in the body. */
+  int          body_count;
+  /** A name of the macro. */
+  char         name[];
+};
+
+/**
+ * @brief Structure of memoized expansion elements. Lines have parameters
+ *        substituted and conditions evaluated, but '$' is kept since
+ *        unique labels differ for each invocation.
+ */
+struct macro_expansion
+{
+  /** A pointer to the next expansion element in the same bucket. */
+  struct macro_expansion *next;
+  /** Expanded lines. */
+  char                   **lines;
+  /** The number of expanded lines. */
+  int                    line_count;
+  /** A name of the macro and values of parameters. */
+  char                   key[];
+};
+
+/**
+ * @brief Structure of IF elements in a macro body.
+ */
+struct macro_if
+{
+  /** A flag indicating whether the enclosing lines are expanded or not. */
+  bool is_parent_active;
+  /** A result of the condition. */
+  bool is_true;
+};
+
+/**
+ * @brief A const variable that holds the length of buffer used for
+ *        file reading.
+ */
+static const int BUFFER_LEN = 0x100;
+
+/**
+ * @brief A const variable that holds the extension of include cache files.
+ */
+static const char *CACHE_EXTENSION = ".pch";
+
+/**
+ * @brief A const variable that holds the magic number of include cache
+ *        files. Bump the version when the format changes.
+ */
+static const char CACHE_MAGIC[8] = "SICPCH1";
+
+/**
+ * @brief A const variable that holds the maximum length of a string in
+ *        include cache files. Longer ones mean the file is broken.
+ */
+static const uint32_t CACHE_STRING_MAX_LEN = 0x10000;
+
+/**
+ * @brief Equals to 10.
+ */
+static const int DECIMAL = 10;
+
+/**
+ * @brief A const variable that holds the maximum depth of nested
+ *        invocations.
+ */
+static const int DEPTH_MAX = 16;
+
+/**
+ * @brief A const variable that holds the initial capacity of lines.
+ */
+static const int LINES_INITIAL_CAPACITY = 256;
+
+/**
+ * @brief A line after the label of an invocation, which defines the label at
+ *        the current locctr.
+ */
+static const char *LABEL_DEFINITION = "\tEQU\t*";
+
+/**
+ * @brief A const variable that holds the amount of line increment.
+ */
+static const int LINE_INCREMENT = 5;
+
+/**
+ * @brief A separator of values in keys of expansions.
+ */
+static const char KEY_SEPARATOR = '\x1F';
+
+/**
+ * @brief The number of expansions with unique labels so far.
+ */
+static int _unique_count = 0;
+
+/**
+ * @brief Content hashes of files included so far. A file with the same
+ *        content is included only once.
+ */
+static uint64_t *_included_hashes = NULL;
+
+/**
+ * @brief The number of files included so far.
+ */
+static int _included_count = 0;
+
+/**
+ * @brief A hash table of memoized expansions.
+ */
+static struct macro_expansion *_expansions[EXPANSION_TABLE_LEN];
+
+/**
+ * @brief Lines of the expanded source.
+ */
+static struct source_line *_lines = NULL;
+
+/**
+ * @brief The number of lines.
+ */
+static int _line_count = 0;
+
+/**
+ * @brief The number of lines that can be stored without reallocation.
+ */
+static int _line_capacity = 0;
+
+/**
+ * @brief The number of macro definitions.
+ */
+static int _macro_count = 0;
+
+/**
+ * @brief A hash table of macro definitions.
+ */
+static struct macro *_macros[MACRO_TABLE_LEN];
+
+/**
+ * @brief                    Append a line to the expanded source.
+ * @param[in] text           A content of the line.
+ * @param[in] line           A line number.
+ * @param[in] is_listed_only A flag indicating whether the line is only listed.
+ */
+static void macro_append_line(const char *text,
+                              const int  line,
+                              const bool is_listed_only);
+
+/**
+ * @brief                    Read lines until MEND and define a macro.
+ * @param[in]     asm_file   A file pointer to an .asm file to be read.
+ * @param[in]     name       A name of the macro.
+ * @param[in]     operand    Parameters of the macro, separated by comma.
+ * @param[in]     line       A line number of the MACRO line.
+ * @param[in,out] line_count The number of lines read so far.
+ * @param[in]     is_listed  True if lines of the definition are listed.
+ * @return                   True on success, false otherwise.
+ */
+static bool macro_define(FILE       *asm_file,
+                         const char *name,
+                         const char *operand,
+                         const int  line,
+                         int        *line_count,
+                         const bool is_listed);
+
+/**
+ * @brief                  Evaluate a condition of IF, such as (&EOR NE '').
+ * @param[in]  condition   A condition to be evaluated.
+ * @param[in]  macro       A macro being expanded.
+ * @param[in]  values      Values of parameters.
+ * @param[out] result      A result of the condition.
+ * @return                 True on success, false if the condition is invalid.
+ */
+static bool macro_evaluate_condition(const char         *condition,
+                                     const struct macro *macro,
+                                     char               **values,
+                                     bool               *result);
+
+/**
+ * @brief               Expand an invocation of the macro.
+ * @param[in] macro     A macro to be expanded.
+ * @param[in] label     A label of the invocation. NULL if none.
+ * @param[in] arguments Arguments of the invocation, separated by comma.
+ * @param[in] line      A line number of the invocation.
+ * @param[in] depth     The depth of the invocation.
+ * @return              True on success, false otherwise.
+ */
+static bool macro_expand(const struct macro *macro,
+                         const char         *label,
+                         const char         *arguments,
+                         const int          line,
+                         const int          depth);
+
+/**
+ * @brief           Release the macro definition.
+ * @param[in] macro A macro to be released.
+ */
+static void macro_free(struct macro *macro);
+
+/**
+ * @brief          Find the macro definition.
+ * @param[in] name A name of the macro.
+ * @return         A macro if exists, NULL otherwise.
+ */
+static struct macro *macro_find(const char *name);
+
+/**
+ * @brief         Return FNV-1a hash of the string.
+ * @param[in] str A string to be hashed.
+ * @return        A hash value.
+ */
+static unsigned int macro_hash(const char *str);
+
+/**
+ * @brief          Return 64-bit FNV-1a hash of the content of a file.
+ * @param[in] data A content to be hashed.
+ * @param[in] len  The length of the content.
+ * @return         A hash value.
+ */
+static uint64_t macro_hash_content(const char *data, const size_t len);
+
+/**
+ * @brief             Include definitions of the file, from its cache if
+ *                    the cache has the same content hash.
+ * @param[in] operand An operand of INCLUDE, which is a quoted file name.
+ * @param[in] line    A line number of the INCLUDE line.
+ * @return            True on success, false otherwise.
+ */
+static bool macro_include(const char *operand, const int line);
+
+/**
+ * @brief                   Read definitions from the include cache.
+ *                          Nothing is defined, so a broken cache is just
+ *                          ignored.
+ * @param[in]  filename     A name of the cache file.
+ * @param[in]  hash         A content hash of the included file.
+ * @param[out] lines        Lines to be assembled, such as EQU.
+ * @param[out] line_count   The number of lines.
+ * @param[out] macros       Macros that are not inserted yet.
+ * @param[out] macro_count  The number of macros.
+ * @return                  True if the cache is valid, false otherwise.
+ */
+static bool macro_load_cache(const char     *filename,
+                             const uint64_t hash,
+                             char           ***lines,
+                             int            *line_count,
+                             struct macro   ***macros,
+                             int            *macro_count);
+
+/**
+ * @brief                   Parse the included file. Macros are defined,
+ *                          and the other definitions are returned as lines.
+ * @param[in]  file         A file pointer to the included file.
+ * @param[in]  line         A line number of the INCLUDE line.
+ * @param[out] lines        Lines to be assembled, such as EQU.
+ * @param[out] line_count   The number of lines.
+ * @param[out] names        Names of defined macros.
+ * @param[out] name_count   The number of names.
+ * @return                  True on success, false otherwise.
+ */
+static bool macro_parse_include(FILE      *file,
+                                const int line,
+                                char      ***lines,
+                                int       *line_count,
+                                char      ***names,
+                                int       *name_count);
+
+/**
+ * @brief           Read a string written by macro_write_string().
+ * @param[in]  file A file pointer to a cache file.
+ * @param[out] str  A string read. Should be freed by the caller.
+ * @return          True on success, false otherwise.
+ */
+static bool macro_read_string(FILE *file, char **str);
+
+/**
+ * @brief                  Write definitions of the included file to its
+ *                         cache. Failures are ignored, since the cache is
+ *                         only for speed.
+ * @param[in] filename     A name of the cache file.
+ * @param[in] hash         A content hash of the included file.
+ * @param[in] lines        Lines to be assembled, such as EQU.
+ * @param[in] line_count   The number of lines.
+ * @param[in] names        Names of defined macros.
+ * @param[in] name_count   The number of names.
+ */
+static void macro_save_cache(const char     *filename,
+                             const uint64_t hash,
+                             char           **lines,
+                             const int      line_count,
+                             char           **names,
+                             const int      name_count);
+
+/**
+ * @brief          Write a string with its length.
+ * @param[in] file A file pointer to a cache file.
+ * @param[in] str  A string to be written.
+ */
+static void macro_write_string(FILE *file, const char *str);
+
+/**
+ * @brief            Substitute parameters and evaluate conditions of the
+ *                   macro body. The result is memoized.
+ * @param[in] macro  A macro to be expanded.
+ * @param[in] values Values of parameters.
+ * @param[in] key    A name of the macro and values of parameters.
+ * @param[in] line   A line number of the invocation.
+ * @return           An expansion on success, NULL otherwise.
+ */
+static struct macro_expansion *macro_instantiate(const struct macro *macro,
+                                                 char               **values,
+                                                 const char         *key,
+                                                 const int          line);
+
+/**
+ * @brief          Return a copy of the text whose '$' are replaced by a
+ *                 label prefix unique to the current expansion.
+ * @param[in] text A text to be copied.
+ * @return         A copy of the text. Should be freed by the caller.
+ */
+static char *macro_make_unique(const char *text);
+
+/**
+ * @brief           Expand the line if it invokes a macro, or append it to
+ *                  the expanded source otherwise.
+ * @param[in] text  A content of the line.
+ * @param[in] line  A line number.
+ * @param[in] depth The depth of invocation that produced the line.
+ * @return          True on success, false otherwise.
+ */
+static bool macro_process_line(const char *text,
+                               const int  line,
+                               const int  depth);
+
+/**
+ * @brief Release macro definitions, expansions, and lines.
+ */
+static void macro_release(void);
+
+/**
+ * @brief            Return a copy of the text whose parameters are replaced
+ *                   by their values.
+ * @param[in] text   A text to be copied.
+ * @param[in] macro  A macro being expanded.
+ * @param[in] values Values of parameters.
+ * @return           A copy of the text. Should be freed by the caller.
+ */
+static char *macro_substitute(const char         *text,
+                              const struct macro *macro,
+                              char               **values);
+
+/**
+ * @brief           Copy the first whitespace separated token of the text.
+ * @param[in]  text A text to be tokenized.
+ * @param[out] token A token of BUFFER_LEN length. Empty if none.
+ * @return           A pointer right after the token.
+ */
+static const char *macro_tokenize(const char *text, char *token);
+
+/**
+ * @brief          Return a copy of the text without leading and trailing
+ *                 blanks.
+ * @param[in] text A text to be copied.
+ * @param[in] len  The length of the text.
+ * @return         A copy of the text. Should be freed by the caller.
+ */
+static char *macro_trim(const char *text, const int len);
+
+const char *macro_get_line(const int index, int *line, bool *is_listed_only)
+{
+  if(0 > index || _line_count <= index)
+  {
+    return NULL;
+  }
+
+  *line           = _lines[index].line;
+  *is_listed_only = _lines[index].is_listed_only;
+  return _lines[index].text;
+}
+
+int macro_get_line_count(void)
+{
+  return _line_count;
+}
+
+void macro_initialize(void)
+{
+  _lines         = NULL;
+  _line_count    = 0;
+  _line_capacity = 0;
+  _macro_count   = 0;
+  _unique_count  = 0;
+  _included_hashes = NULL;
+  _included_count  = 0;
+  memset(_macros, 0, sizeof(_macros));
+  memset(_expansions, 0, sizeof(_expansions));
+}
+
+bool macro_process(FILE *asm_file)
+{
+  macro_terminate();
+
+  char buffer[BUFFER_LEN];
+  int  line_count = 0;
+  while(fgets(buffer, BUFFER_LEN, asm_file))
+  {
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    int line = ++line_count * LINE_INCREMENT;
+
+    char       first[BUFFER_LEN];
+    char       second[BUFFER_LEN];
+    const char *after_first  = macro_tokenize(buffer, first);
+    const char *after_second = macro_tokenize(after_first, second);
+    if('.' != buffer[0] && !strcmp("MACRO", first))
+    {
+      symbol_set_error(REQUIRED_ONE_OPERAND, line, "MACRO");
+      return false;
+    }
+    else if('.' != buffer[0] && !strcmp("MACRO", second))
+    {
+      macro_append_line(buffer, line, true);
+      if(!macro_define(asm_file,
+                       first,
+                       after_second,
+                       line,
+                       &line_count,
+                       true))
+      {
+        return false;
+      }
+    }
+    else if('.' != buffer[0] && !strcmp("INCLUDE", first))
+    {
+      macro_append_line(buffer, line, true);
+      if(!macro_include(after_first, line))
+      {
+        return false;
+      }
+    }
+    else if(!macro_process_line(buffer, line, 0))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void macro_terminate(void)
+{
+  macro_release();
+  macro_initialize();
+}
+
+static void macro_append_line(const char *text,
+                              const int  line,
+                              const bool is_listed_only)
+{
+  if(_line_count == _line_capacity)
+  {
+    _line_capacity = _line_capacity ? 2 * _line_capacity :
+                                      LINES_INITIAL_CAPACITY;
+    _lines = realloc(_lines, _line_capacity * sizeof(*_lines));
+  }
+
+  _lines[_line_count].text           = strdup(text);
+  _lines[_line_count].line           = line;
+  _lines[_line_count].is_listed_only = is_listed_only;
+  ++_line_count;
+}
+
+static bool macro_define(FILE       *asm_file,
+                         const char *name,
+                         const char *operand,
+                         const int  line,
+                         int        *line_count,
+                         const bool is_listed)
+{
+  if(macro_find(name))
+  {
+    symbol_set_error(DUPLICATE_SYMBOL, line, name);
+    return false;
+  }
+
+  struct macro *macro = malloc(sizeof(*macro) +
+                               sizeof(char) * (strlen(name) + 1));
+  strcpy(macro->name, name);
+  macro->params      = NULL;
+  macro->defaults    = NULL;
+  macro->param_count = 0;
+  macro->body        = NULL;
+  macro->body_count  = 0;
+
+  int key = macro_hash(name) % MACRO_TABLE_LEN;
+  macro->next  = _macros[key];
+  _macros[key] = macro;
+  ++_macro_count;
+
+  // Parameters are &NAME or &NAME=DEFAULT, separated by comma.
+  const char *walk = operand;
+  while(*walk)
+  {
+    int  len   = strcspn(walk, ",");
+    char *param = macro_trim(walk, len);
+    walk += len;
+    if(',' == *walk)
+    {
+      ++walk;
+    }
+
+    char *equal = strchr(param, '=');
+    if(equal)
+    {
+      *equal = '\0';
+    }
+    if('&' != param[0] || '\0' == param[1])
+    {
+      symbol_set_error(INVALID_OPERAND, line, param);
+      free(param);
+      return false;
+    }
+
+    macro->params   = realloc(macro->params,
+                              (macro->param_count + 1) * sizeof(char *));
+    macro->defaults = realloc(macro->defaults,
+                              (macro->param_count + 1) * sizeof(char *));
+    macro->params[macro->param_count]   = strdup(&param[1]);
+    macro->defaults[macro->param_count] = strdup(equal ? equal + 1 : "");
+    ++macro->param_count;
+    free(param);
+  }
+
+  char buffer[BUFFER_LEN];
+  while(fgets(buffer, BUFFER_LEN, asm_file))
+  {
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    int body_line = ++*line_count * LINE_INCREMENT;
+    if(is_listed)
+    {
+      macro_append_line(buffer, body_line, true);
+    }
+
+    char first[BUFFER_LEN];
+    char second[BUFFER_LEN];
+    macro_tokenize(macro_tokenize(buffer, first), second);
+    if(!strcmp("MEND", first) || !strcmp("MEND", second))
+    {
+      return true;
+    }
+    if(!strcmp("MACRO", first) || !strcmp("MACRO", second))
+    {
+      // Nested definitions are not supported.
+      symbol_set_error(INVALID_OPCODE, body_line, "MACRO");
+      return false;
+    }
+
+    macro->body = realloc(macro->body,
+                          (macro->body_count + 1) * sizeof(char *));
+    macro->body[macro->body_count++] = strdup(buffer);
+  }
+
+  symbol_set_error(INVALID_OPCODE, line, "MACRO");
+  return false;
+}
+
+static bool macro_evaluate_condition(const char         *condition,
+                                     const struct macro *macro,
+                                     char               **values,
+                                     bool               *result)
+{
+  const char *open  = strchr(condition, '(');
+  const char *close = strrchr(condition, ')');
+  if(!open || !close || close < open)
+  {
+    return false;
+  }
+
+  // Tokens are substituted one by one, so empty values are still tokens.
+  char *inner = macro_trim(open + 1, close - open - 1);
+  char tokens[3][BUFFER_LEN];
+  const char *walk = inner;
+  for(int i = 0; i < 3; ++i)
+  {
+    walk = macro_tokenize(walk, tokens[i]);
+  }
+  char extra[BUFFER_LEN];
+  macro_tokenize(walk, extra);
+  free(inner);
+  if(!strlen(tokens[2]) || strlen(extra))
+  {
+    return false;
+  }
+
+  char *operands[2];
+  for(int i = 0; i < 2; ++i)
+  {
+    operands[i] = macro_substitute(tokens[2 * i], macro, values);
+
+    // Quotes are removed, so '' is an empty string.
+    int len = strlen(operands[i]);
+    if(2 <= len && '\'' == operands[i][0] && '\'' == operands[i][len - 1])
+    {
+      memmove(operands[i], &operands[i][1], len - 2);
+      operands[i][len - 2] = '\0';
+    }
+  }
+
+  // Compare as numbers if both are numbers, or as strings otherwise.
+  char *endptr1 = NULL;
+  char *endptr2 = NULL;
+  long number1  = strtol(operands[0], &endptr1, DECIMAL);
+  long number2  = strtol(operands[1], &endptr2, DECIMAL);
+  long diff     = 0;
+  if(strlen(operands[0]) && '\0' == *endptr1 &&
+     strlen(operands[1]) && '\0' == *endptr2)
+  {
+    diff = (number1 > number2) - (number1 < number2);
+  }
+  else
+  {
+    diff = strcmp(operands[0], operands[1]);
+  }
+  free(operands[0]);
+  free(operands[1]);
+
+  const char *op = tokens[1];
+  if(!strcmp("EQ", op))
+  {
+    *result = 0 == diff;
+  }
+  else if(!strcmp("NE", op))
+  {
+    *result = 0 != diff;
+  }
+  else if(!strcmp("LT", op))
+  {
+    *result = 0 > diff;
+  }
+  else if(!strcmp("LE", op))
+  {
+    *result = 0 >= diff;
+  }
+  else if(!strcmp("GT", op))
+  {
+    *result = 0 < diff;
+  }
+  else if(!strcmp("GE", op))
+  {
+    *result = 0 <= diff;
+  }
+  else
+  {
+    return false;
+  }
+
+  return true;
+}
+
+static bool macro_expand(const struct macro *macro,
+                         const char         *label,
+                         const char         *arguments,
+                         const int          line,
+                         const int          depth)
+{
+  if(DEPTH_MAX <= depth)
+  {
+    symbol_set_error(INVALID_OPCODE, line, macro->name);
+    return false;
+  }
+
+  // Start with default values, and overwrite them by arguments.
+  char **values = malloc((macro->param_count + 1) * sizeof(*values));
+  for(int i = 0; i < macro->param_count; ++i)
+  {
+    values[i] = strdup(macro->defaults[i]);
+  }
+
+  bool       is_success = true;
+  int        position   = 0;
+  const char *walk      = arguments;
+  while(is_success && *walk)
+  {
+    int  len       = strcspn(walk, ",");
+    char *argument = macro_trim(walk, len);
+    walk += len;
+    if(',' == *walk)
+    {
+      ++walk;
+    }
+
+    // A keyword argument is NAME=VALUE or &NAME=VALUE.
+    int  index = -1;
+    char *value = argument;
+    char *equal = strchr(argument, '=');
+    if(equal && equal != argument)
+    {
+      *equal = '\0';
+      const char *name = '&' == argument[0] ? &argument[1] : argument;
+      for(int i = 0; i < macro->param_count; ++i)
+      {
+        if(!strcmp(name, macro->params[i]))
+        {
+          index = i;
+          value = equal + 1;
+          break;
+        }
+      }
+      if(0 > index)
+      {
+        // Not a keyword, such as a literal operand.
+        *equal = '=';
+      }
+    }
+    if(0 > index)
+    {
+      index = position++;
+    }
+
+    if(macro->param_count <= index)
+    {
+      symbol_set_error(INVALID_OPERAND, line, value);
+      is_success = false;
+    }
+    else
+    {
+      free(values[index]);
+      values[index] = strdup(value);
+    }
+    free(argument);
+  }
+
+  struct macro_expansion *expansion = NULL;
+  if(is_success)
+  {
+    // Identical invocations reuse the memoized expansion.
+    int key_len = strlen(macro->name) + 1;
+    for(int i = 0; i < macro->param_count; ++i)
+    {
+      key_len += strlen(values[i]) + 1;
+    }
+    char *key = malloc(key_len);
+    strcpy(key, macro->name);
+    for(int i = 0; i < macro->param_count; ++i)
+    {
+      int len = strlen(key);
+      key[len]     = KEY_SEPARATOR;
+      key[len + 1] = '\0';
+      strcat(key, values[i]);
+    }
+
+    expansion = _expansions[macro_hash(key) % EXPANSION_TABLE_LEN];
+    while(expansion && strcmp(key, expansion->key))
+    {
+      expansion = expansion->next;
+    }
+    if(!expansion)
+    {
+      expansion = macro_instantiate(macro, values, key, line);
+    }
+    free(key);
+  }
+
+  for(int i = 0; i < macro->param_count; ++i)
+  {
+    free(values[i]);
+  }
+  free(values);
+
+  if(!expansion)
+  {
+    return false;
+  }
+
+  // Each invocation has its own unique labels.
+  bool is_unique_counted = false;
+  for(int i = 0; i < expansion->line_count; ++i)
+  {
+    const char *text = expansion->lines[i];
+    char       *copy = NULL;
+    if(strchr(text, '$'))
+    {
+      if(!is_unique_counted)
+      {
+        ++_unique_count;
+        is_unique_counted = true;
+      }
+      copy = macro_make_unique(text);
+      text = copy;
+    }
+
+    if(label && 0 == i && ' ' != text[0] && '\t' != text[0])
+    {
+      // The first line has its own label, so the label of the invocation is
+      // defined on a line of its own, at the same locctr.
+      char *defined = malloc(strlen(label) + strlen(LABEL_DEFINITION) + 1);
+      strcpy(defined, label);
+      strcat(defined, LABEL_DEFINITION);
+      is_success = macro_process_line(defined, line, depth + 1);
+      free(defined);
+      if(!is_success)
+      {
+        free(copy);
+        return false;
+      }
+    }
+    else if(label && 0 == i)
+    {
+      // The label of the invocation is moved to the first line.
+      char *labeled = malloc(strlen(label) + strlen(text) + 1);
+      strcpy(labeled, label);
+      strcat(labeled, text);
+      free(copy);
+      copy = labeled;
+      text = copy;
+    }
+
+    is_success = macro_process_line(text, line, depth + 1);
+    free(copy);
+    if(!is_success)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void macro_free(struct macro *macro)
+{
+  for(int i = 0; i < macro->param_count; ++i)
+  {
+    free(macro->params[i]);
+    free(macro->defaults[i]);
+  }
+  for(int i = 0; i < macro->body_count; ++i)
+  {
+    free(macro->body[i]);
+  }
+  free(macro->params);
+  free(macro->defaults);
+  free(macro->body);
+  free(macro);
+}
+
+static struct macro *macro_find(const char *name)
+{
+  if(0 == _macro_count)
+  {
+    return NULL;
+  }
+
+  struct macro *walk = _macros[macro_hash(name) % MACRO_TABLE_LEN];
+  while(walk && strcmp(name, walk->name))
+  {
+    walk = walk->next;
+  }
+
+  return walk;
+}
+
+static unsigned int macro_hash(const char *str)
+{
+  unsigned int hash = 2166136261u;
+  for(int i = 0; str[i]; ++i)
+  {
+    hash ^= (unsigned char)str[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+static uint64_t macro_hash_content(const char *data, const size_t len)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for(size_t i = 0; i < len; ++i)
+  {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static bool macro_include(const char *operand, const int line)
+{
+  // The operand is a file name in double quotes.
+  char *filename = macro_trim(operand, strlen(operand));
+  int  len       = strlen(filename);
+  if(2 >= len || '"' != filename[0] || '"' != filename[len - 1])
+  {
+    symbol_set_error(INVALID_OPERAND, line, filename);
+    free(filename);
+    return false;
+  }
+  memmove(filename, &filename[1], len - 2);
+  filename[len - 2] = '\0';
+
+  FILE *file = fopen(filename, "rb");
+  if(!file)
+  {
+    symbol_set_error(INVALID_OPERAND, line, filename);
+    free(filename);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  char *data = malloc(size + 1);
+  size = fread(data, 1, size, file);
+  fclose(file);
+
+  // The same content is included once, like an include guard.
+  uint64_t hash = macro_hash_content(data, size);
+  for(int i = 0; i < _included_count; ++i)
+  {
+    if(hash == _included_hashes[i])
+    {
+      free(data);
+      free(filename);
+      return true;
+    }
+  }
+  _included_hashes = realloc(_included_hashes,
+                             (_included_count + 1) * sizeof(*_included_hashes));
+  _included_hashes[_included_count++] = hash;
+
+  char *cache_filename = malloc(strlen(filename) +
+                                strlen(CACHE_EXTENSION) + 1);
+  strcpy(cache_filename, filename);
+  strcat(cache_filename, CACHE_EXTENSION);
+
+  bool         is_success  = true;
+  char         **lines     = NULL;
+  int          line_count  = 0;
+  struct macro **macros    = NULL;
+  int          macro_count = 0;
+  if(macro_load_cache(cache_filename,
+                      hash,
+                      &lines,
+                      &line_count,
+                      &macros,
+                      &macro_count))
+  {
+    // Cached macros are inserted as if they were defined here.
+    for(int i = 0; i < macro_count; ++i)
+    {
+      if(!is_success || macro_find(macros[i]->name))
+      {
+        if(is_success)
+        {
+          symbol_set_error(DUPLICATE_SYMBOL, line, macros[i]->name);
+          is_success = false;
+        }
+        macro_free(macros[i]);
+        continue;
+      }
+
+      int key = macro_hash(macros[i]->name) % MACRO_TABLE_LEN;
+      macros[i]->next = _macros[key];
+      _macros[key]    = macros[i];
+      ++_macro_count;
+    }
+    free(macros);
+  }
+  else
+  {
+    char **names    = NULL;
+    int  name_count = 0;
+    FILE *stream    = 0 < size ? fmemopen(data, size, "r") : NULL;
+    if(stream)
+    {
+      is_success = macro_parse_include(stream,
+                                       line,
+                                       &lines,
+                                       &line_count,
+                                       &names,
+                                       &name_count);
+      fclose(stream);
+    }
+    if(is_success)
+    {
+      macro_save_cache(cache_filename,
+                       hash,
+                       lines,
+                       line_count,
+                       names,
+                       name_count);
+    }
+
+    for(int i = 0; i < name_count; ++i)
+    {
+      free(names[i]);
+    }
+    free(names);
+  }
+  free(cache_filename);
+  free(data);
+  free(filename);
+
+  // Definitions other than macros are assembled at the INCLUDE line.
+  for(int i = 0; i < line_count; ++i)
+  {
+    if(is_success)
+    {
+      macro_append_line(lines[i], line, false);
+    }
+    free(lines[i]);
+  }
+  free(lines);
+
+  return is_success;
+}
+
+static struct macro_expansion *macro_instantiate(const struct macro *macro,
+                                                 char               **values,
+                                                 const char         *key,
+                                                 const int          line)
+{
+  struct macro_expansion *expansion = malloc(sizeof(*expansion) +
+                                             sizeof(char) * (strlen(key) + 1));
+  strcpy(expansion->key, key);
+  expansion->lines      = NULL;
+  expansion->line_count = 0;
+
+  struct macro_if ifs[IF_DEPTH_MAX];
+  int             if_depth   = 0;
+  bool            is_active  = true;
+  bool            is_success = true;
+  for(int i = 0; is_success && i < macro->body_count; ++i)
+  {
+    char       mnemonic[BUFFER_LEN];
+    const char *condition = macro_tokenize(macro->body[i], mnemonic);
+    if(!strcmp("IF", mnemonic))
+    {
+      bool is_true = false;
+      if(IF_DEPTH_MAX == if_depth ||
+         !macro_evaluate_condition(condition, macro, values, &is_true))
+      {
+        symbol_set_error(INVALID_OPERAND, line, "IF");
+        is_success = false;
+        break;
+      }
+
+      ifs[if_depth].is_parent_active = is_active;
+      ifs[if_depth].is_true          = is_true;
+      ++if_depth;
+      is_active = is_active && is_true;
+    }
+    else if(!strcmp("ELSE", mnemonic))
+    {
+      if(0 == if_depth)
+      {
+        symbol_set_error(INVALID_OPCODE, line, "ELSE");
+        is_success = false;
+        break;
+      }
+
+      is_active = ifs[if_depth - 1].is_parent_active &&
+                  !ifs[if_depth - 1].is_true;
+    }
+    else if(!strcmp("ENDIF", mnemonic))
+    {
+      if(0 == if_depth)
+      {
+        symbol_set_error(INVALID_OPCODE, line, "ENDIF");
+        is_success = false;
+        break;
+      }
+
+      --if_depth;
+      is_active = ifs[if_depth].is_parent_active;
+    }
+    else if(is_active)
+    {
+      expansion->lines = realloc(expansion->lines,
+                                 (expansion->line_count + 1) * sizeof(char *));
+      expansion->lines[expansion->line_count++] =
+        macro_substitute(macro->body[i], macro, values);
+    }
+  }
+  if(is_success && 0 != if_depth)
+  {
+    symbol_set_error(INVALID_OPCODE, line, "IF");
+    is_success = false;
+  }
+
+  if(!is_success)
+  {
+    for(int i = 0; i < expansion->line_count; ++i)
+    {
+      free(expansion->lines[i]);
+    }
+    free(expansion->lines);
+    free(expansion);
+    return NULL;
+  }
+
+  int index = macro_hash(key) % EXPANSION_TABLE_LEN;
+  expansion->next    = _expansions[index];
+  _expansions[index] = expansion;
+
+  return expansion;
+}
+
+static bool macro_load_cache(const char     *filename,
+                             const uint64_t hash,
+                             char           ***lines,
+                             int            *line_count,
+                             struct macro   ***macros,
+                             int            *macro_count)
+{
+  FILE *file = fopen(filename, "rb");
+  if(!file)
+  {
+    return false;
+  }
+
+  char     magic[sizeof(CACHE_MAGIC)];
+  uint64_t cached_hash = 0;
+  uint32_t count       = 0;
+  bool     is_valid    = 1 == fread(magic, sizeof(magic), 1, file) &&
+                         !memcmp(CACHE_MAGIC, magic, sizeof(magic)) &&
+                         1 == fread(&cached_hash, sizeof(cached_hash), 1, file) &&
+                         hash == cached_hash &&
+                         1 == fread(&count, sizeof(count), 1, file);
+
+  for(uint32_t i = 0; is_valid && i < count; ++i)
+  {
+    char *text = NULL;
+    is_valid = macro_read_string(file, &text);
+    if(is_valid)
+    {
+      *lines = realloc(*lines, (*line_count + 1) * sizeof(char *));
+      (*lines)[(*line_count)++] = text;
+    }
+  }
+
+  is_valid = is_valid && 1 == fread(&count, sizeof(count), 1, file);
+  for(uint32_t i = 0; is_valid && i < count; ++i)
+  {
+    char     *name       = NULL;
+    uint32_t param_count = 0;
+    uint32_t body_count  = 0;
+    if(!macro_read_string(file, &name))
+    {
+      is_valid = false;
+      break;
+    }
+
+    struct macro *macro = malloc(sizeof(*macro) +
+                                 sizeof(char) * (strlen(name) + 1));
+    strcpy(macro->name, name);
+    free(name);
+    macro->next        = NULL;
+    macro->params      = NULL;
+    macro->defaults    = NULL;
+    macro->param_count = 0;
+    macro->body        = NULL;
+    macro->body_count  = 0;
+    *macros = realloc(*macros, (*macro_count + 1) * sizeof(*macros));
+    (*macros)[(*macro_count)++] = macro;
+
+    is_valid = 1 == fread(&param_count, sizeof(param_count), 1, file);
+    for(uint32_t j = 0; is_valid && j < param_count; ++j)
+    {
+      char *param = NULL;
+      char *value = NULL;
+      is_valid = macro_read_string(file, &param) &&
+                 macro_read_string(file, &value);
+      if(!is_valid)
+      {
+        free(param);
+        free(value);
+        break;
+      }
+      macro->params   = realloc(macro->params,
+                                (macro->param_count + 1) * sizeof(char *));
+      macro->defaults = realloc(macro->defaults,
+                                (macro->param_count + 1) * sizeof(char *));
+      macro->params[macro->param_count]   = param;
+      macro->defaults[macro->param_count] = value;
+      ++macro->param_count;
+    }
+
+    is_valid = is_valid && 1 == fread(&body_count, sizeof(body_count), 1, file);
+    for(uint32_t j = 0; is_valid && j < body_count; ++j)
+    {
+      char *text = NULL;
+      is_valid = macro_read_string(file, &text);
+      if(is_valid)
+      {
+        macro->body = realloc(macro->body,
+                              (macro->body_count + 1) * sizeof(char *));
+        macro->body[macro->body_count++] = text;
+      }
+    }
+  }
+  fclose(file);
+
+  if(!is_valid)
+  {
+    // The cache is stale or broken, so the file is parsed again.
+    for(int i = 0; i < *line_count; ++i)
+    {
+      free((*lines)[i]);
+    }
+    for(int i = 0; i < *macro_count; ++i)
+    {
+      macro_free((*macros)[i]);
+    }
+    free(*lines);
+    free(*macros);
+    *lines       = NULL;
+    *line_count  = 0;
+    *macros      = NULL;
+    *macro_count = 0;
+  }
+
+  return is_valid;
+}
+
+static char *macro_make_unique(const char *text)
+{
+  // '$' becomes 'Z' followed by letters counting expansions, such as ZAA,
+  // since symbols should start with an alphabet.
+  char prefix[BUFFER_LEN];
+  int  count = _unique_count - 1;
+  int  len   = 0;
+  prefix[len++] = 'Z';
+  prefix[len++] = 'A' + (count / 26) % 26;
+  prefix[len++] = 'A' + count % 26;
+  for(count /= 26 * 26; count; count /= 26)
+  {
+    prefix[len++] = 'A' + count % 26;
+  }
+  prefix[len] = '\0';
+
+  int dollar_count = 0;
+  for(int i = 0; text[i]; ++i)
+  {
+    dollar_count += '$' == text[i];
+  }
+
+  char *unique = malloc(strlen(text) + dollar_count * len + 1);
+  char *walk   = unique;
+  for(int i = 0; text[i]; ++i)
+  {
+    if('$' == text[i])
+    {
+      strcpy(walk, prefix);
+      walk += len;
+    }
+    else
+    {
+      *walk++ = text[i];
+    }
+  }
+  *walk = '\0';
+
+  return unique;
+}
+
+static bool macro_parse_include(FILE      *file,
+                                const int line,
+                                char      ***lines,
+                                int       *line_count,
+                                char      ***names,
+                                int       *name_count)
+{
+  char buffer[BUFFER_LEN];
+  int  included_line_count = 0;
+  while(fgets(buffer, BUFFER_LEN, file))
+  {
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    ++included_line_count;
+
+    char       first[BUFFER_LEN];
+    char       second[BUFFER_LEN];
+    const char *after_first  = macro_tokenize(buffer, first);
+    const char *after_second = macro_tokenize(after_first, second);
+    if('.' == buffer[0] || !strlen(first))
+    {
+      // Comments are not included.
+      continue;
+    }
+
+    if(!strcmp("MACRO", second))
+    {
+      if(!macro_define(file,
+                       first,
+                       after_second,
+                       line,
+                       &included_line_count,
+                       false))
+      {
+        return false;
+      }
+
+      *names = realloc(*names, (*name_count + 1) * sizeof(char *));
+      (*names)[(*name_count)++] = strdup(first);
+    }
+    else if(!strcmp("EQU", second))
+    {
+      *lines = realloc(*lines, (*line_count + 1) * sizeof(char *));
+      (*lines)[(*line_count)++] = strdup(buffer);
+    }
+    else
+    {
+      // Included files only have definitions, and cannot include others.
+      symbol_set_error(INVALID_OPCODE, line, strlen(second) ? second : first);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool macro_process_line(const char *text,
+                               const int  line,
+                               const int  depth)
+{
+  if('.' != text[0] && _macro_count)
+  {
+    char       first[BUFFER_LEN];
+    char       second[BUFFER_LEN];
+    const char *after_first  = macro_tokenize(text, first);
+    const char *after_second = macro_tokenize(after_first, second);
+
+    const char   *label     = NULL;
+    const char   *arguments = NULL;
+    struct macro *macro     = macro_find(first);
+    if(macro)
+    {
+      arguments = after_first;
+    }
+    else if(strlen(second) &&
+            !opcode_is_opcode(first) &&
+            (macro = macro_find(second)))
+    {
+      label     = first;
+      arguments = after_second;
+    }
+
+    if(macro)
+    {
+      if(0 == depth)
+      {
+        // Only invocations in the source are listed.
+        macro_append_line(text, line, true);
+      }
+
+      return macro_expand(macro, label, arguments, line, depth);
+    }
+  }
+
+  macro_append_line(text, line, false);
+
+  return true;
+}
+
+static bool macro_read_string(FILE *file, char **str)
+{
+  uint32_t len = 0;
+  if(1 != fread(&len, sizeof(len), 1, file) || CACHE_STRING_MAX_LEN < len)
+  {
+    return false;
+  }
+
+  *str = malloc(len + 1);
+  if(len != fread(*str, 1, len, file))
+  {
+    free(*str);
+    *str = NULL;
+    return false;
+  }
+  (*str)[len] = '\0';
+
+  return true;
+}
+
+static void macro_release(void)
+{
+  for(int i = 0; i < _line_count; ++i)
+  {
+    free(_lines[i].text);
+  }
+  free(_lines);
+  free(_included_hashes);
+
+  for(int i = 0; i < MACRO_TABLE_LEN; ++i)
+  {
+    struct macro *walk = _macros[i];
+    while(walk)
+    {
+      struct macro *del = walk;
+      walk = walk->next;
+      macro_free(del);
+    }
+  }
+
+  for(int i = 0; i < EXPANSION_TABLE_LEN; ++i)
+  {
+    struct macro_expansion *walk = _expansions[i];
+    while(walk)
+    {
+      struct macro_expansion *del = walk;
+      walk = walk->next;
+
+      for(int j = 0; j < del->line_count; ++j)
+      {
+        free(del->lines[j]);
+      }
+      free(del->lines);
+      free(del);
+    }
+  }
+}
+
+static void macro_save_cache(const char     *filename,
+                             const uint64_t hash,
+                             char           **lines,
+                             const int      line_count,
+                             char           **names,
+                             const int      name_count)
+{
+  // Written to a temporary file and renamed, so readers never see a half
+  // written cache.
+  char *temp_filename = malloc(strlen(filename) + 2);
+  sprintf(temp_filename, "%s~", filename);
+  FILE *file = fopen(temp_filename, "wb");
+  if(!file)
+  {
+    free(temp_filename);
+    return;
+  }
+
+  uint32_t count = line_count;
+  fwrite(CACHE_MAGIC, sizeof(CACHE_MAGIC), 1, file);
+  fwrite(&hash, sizeof(hash), 1, file);
+  fwrite(&count, sizeof(count), 1, file);
+  for(int i = 0; i < line_count; ++i)
+  {
+    macro_write_string(file, lines[i]);
+  }
+
+  count = name_count;
+  fwrite(&count, sizeof(count), 1, file);
+  for(int i = 0; i < name_count; ++i)
+  {
+    const struct macro *macro = macro_find(names[i]);
+    macro_write_string(file, macro->name);
+
+    count = macro->param_count;
+    fwrite(&count, sizeof(count), 1, file);
+    for(int j = 0; j < macro->param_count; ++j)
+    {
+      macro_write_string(file, macro->params[j]);
+      macro_write_string(file, macro->defaults[j]);
+    }
+
+    count = macro->body_count;
+    fwrite(&count, sizeof(count), 1, file);
+    for(int j = 0; j < macro->body_count; ++j)
+    {
+      macro_write_string(file, macro->body[j]);
+    }
+  }
+
+  if(fclose(file) || rename(temp_filename, filename))
+  {
+    remove(temp_filename);
+  }
+  free(temp_filename);
+}
+
+static char *macro_substitute(const char         *text,
+                              const struct macro *macro,
+                              char               **values)
+{
+  // Compute the length first to allocate once.
+  int len = 0;
+  for(int pass = 0; pass < 2; ++pass)
+  {
+    char *result = 1 == pass ? malloc(len + 1) : NULL;
+    int  written = 0;
+
+    const char *walk = text;
+    while(*walk)
+    {
+      int index = -1;
+      int name_len = 0;
+      if('&' == *walk)
+      {
+        name_len = strspn(walk + 1,
+                          "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                          "abcdefghijklmnopqrstuvwxyz0123456789");
+        for(int i = 0; i < macro->param_count; ++i)
+        {
+          if(name_len == strlen(macro->params[i]) &&
+             !strncmp(walk + 1, macro->params[i], name_len))
+          {
+            index = i;
+            break;
+          }
+        }
+      }
+
+      if(0 <= index)
+      {
+        int value_len = strlen(values[index]);
+        if(result)
+        {
+          memcpy(&result[written], values[index], value_len);
+        }
+        written += value_len;
+        walk    += 1 + name_len;
+      }
+      else
+      {
+        if(result)
+        {
+          result[written] = *walk;
+        }
+        ++written;
+        ++walk;
+      }
+    }
+
+    if(result)
+    {
+      result[written] = '\0';
+      return result;
+    }
+    len = written;
+  }
+
+  return NULL;
+}
+
+static const char *macro_tokenize(const char *text, char *token)
+{
+  text += strspn(text, " \t");
+
+  int len = strcspn(text, " \t");
+  if(BUFFER_LEN <= len)
+  {
+    len = BUFFER_LEN - 1;
+  }
+  memcpy(token, text, len);
+  token[len] = '\0';
+
+  return text + strcspn(text, " \t");
+}
+
+static char *macro_trim(const char *text, const int len)
+{
+  int begin = 0;
+  int end   = len;
+  while(begin < end && (' ' == text[begin] || '\t' == text[begin]))
+  {
+    ++begin;
+  }
+  while(end > begin && (' ' == text[end - 1] || '\t' == text[end - 1]))
+  {
+    --end;
+  }
+
+  char *trimmed = malloc(end - begin + 1);
+  memcpy(trimmed, &text[begin], end - begin);
+  trimmed[end - begin] = '\0';
+
+  return trimmed;
+}
+
+static void macro_write_string(FILE *file, const char *str)
+{
+  uint32_t len = strlen(str);
+  fwrite(&len, sizeof(len), 1, file);
+  fwrite(str, 1, len, file);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file  macro.h
+ * @brief A macro processor that runs in front of the assembler. It expands
+ *        macro invocations of .asm file into lines that the assembler reads.
+ */
+
+#ifndef __MACRO_H__
+#define __MACRO_H__
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief                     Return a line of the expanded source.
+ * @param[in]  index          An index of the line.
+ * @param[out] line           A line number in .lst file. Expanded lines
+ *                            have the line number of their invocation.
+ * @param[out] is_listed_only True if the line is only written to .lst file
+ *                            as a comment, such as macro definitions and
+ *                            invocations.
+ * @return                    A line if exists, NULL otherwise.
+ */
+const char *macro_get_line(const int index, int *line, bool *is_listed_only);
+
+/**
+ * @brief  Return the number of expanded lines.
+ * @return The number of lines.
+ */
+int macro_get_line_count(void);
+
+/**
+ * @brief Initialize macro processor.
+ */
+void macro_initialize(void);
+
+/**
+ * @brief              Read .asm file, define macros, and expand invocations.
+ *                     Errors are set by symbol_set_error().
+ * @param[in] asm_file A file pointer to an .asm file to be read.
+ * @return             True on success, false otherwise.
+ */
+bool macro_process(FILE *asm_file);
+
+/**
+ * @brief Release all allocated memories.
+ */
+void macro_terminate(void);
+
+#endif
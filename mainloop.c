@@ -9,15 +9,33 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "analyze.h"
 #include "assembler.h"
+#include "block.h"
+#include "cache.h"
+#include "coverage.h"
 #include "debugger.h"
+#include "device.h"
 #include "external_symbol.h"
+#include "heatmap.h"
+#include "hexfile.h"
+#include "json.h"
+#include "line_table.h"
+#include "literal.h"
 #include "loader.h"
 #include "logger.h"
+#include "macro.h"
 #include "memspace.h"
 #include "opcode.h"
+#include "peephole.h"
+#include "perf.h"
+#include "replay.h"
+#include "sample.h"
 #include "shell.h"
 #include "symbol.h"
+#include "timeline.h"
+#include "watch.h"
+#include "writer.h"
 
 #include "mainloop.h"
 
@@ -75,13 +93,51 @@ static bool mainloop_assign_handler(void);
  */
 static void mainloop_tokenize_input(char *input);
 
+void mainloop_execute_command(const char *cmd,
+                              const int  argc,
+                              const char *argv[])
+{
+  // The current command is being executed, so keep it aside.
+  struct command saved_command = _command;
+
+  _command.cmd = (char *)cmd;
+  if(mainloop_assign_handler() && _command.handler)
+  {
+    _command.handler(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  _command = saved_command;
+}
+
 void mainloop_initialize(void)
 {
+  block_initialize();
+  cache_initialize();
+  coverage_initialize();
   debugger_initialize();
+  device_initialize();
   external_symbol_initialize();
+  heatmap_initialize();
+  hexfile_initialize();
+  json_initialize();
+  line_table_initialize();
+  literal_initialize();
+  loader_initialize();
   logger_initialize(INPUT_LEN);
+  macro_initialize();
+  memspace_initialize();
   opcode_initialize();
+  peephole_initialize();
+  perf_initialize();
+  replay_initialize();
+  sample_initialize();
   symbol_initialize();
+  timeline_initialize();
+  writer_initialize();
 }
 
 void mainloop_launch(void)
@@ -90,27 +146,46 @@ void mainloop_launch(void)
 
   while(!_quit_mainloop)
   {
-    printf("sicsim> ");
+    if(!json_is_enabled())
+    {
+      // A prompt would break one JSON object per line.
+      json_printf("sicsim> ");
+    }
     if(fgets(input, INPUT_LEN, stdin))
     {
+      bool is_handled = false;
+
       mainloop_tokenize_input(input);
+      json_begin_command();
       if(mainloop_assign_handler())
       {
         if(_command.handler)
         {
+          perf_begin_command();
           _command.handler((const char *)_command.cmd,
                            (const int)_command.argc,
                            (const char **)_command.argv);
+          perf_end_command(_command.cmd);
+          is_handled = true;
         }
         else
         {
-          printf("%s: command cannot be handled\n", _command.cmd);
+          json_printf("%s: command cannot be handled\n", _command.cmd);
         }
       }
       else
       {
-        printf("%s: command not found\n", _command.cmd);
+        json_printf("%s: command not found\n", _command.cmd);
       }
+      json_end_command((const char *)_command.cmd,
+                       (const int)_command.argc,
+                       (const char **)_command.argv,
+                       is_handled);
+    }
+    else
+    {
+      // Quit at the end of input instead of prompting forever.
+      _quit_mainloop = true;
     }
   }
 }
@@ -122,11 +197,24 @@ void mainloop_quit(void)
 
 void mainloop_terminate(void)
 {
+  block_terminate();
   debugger_terminate();
+  device_terminate();
   external_symbol_terminate();
+  heatmap_terminate();
+  json_terminate();
+  line_table_terminate();
+  literal_terminate();
+  loader_terminate();
   logger_terminate();
+  macro_terminate();
   opcode_terminate();
+  peephole_terminate();
+  perf_terminate();
+  replay_terminate();
   symbol_terminate();
+  timeline_terminate();
+  writer_terminate();
 }
 
 static bool mainloop_assign_handler(void)
@@ -138,11 +226,22 @@ static bool mainloop_assign_handler(void)
     return false;
   }
 
+  const char * const ANALYZE_CMDS[]   = {"analyze"};
   const char * const ASSEMBLER_CMDS[] = {"assemble",
                                          "symbol"};
+  const char * const CACHE_CMDS[]     = {"cache"};
+  const char * const COVERAGE_CMDS[]  = {"coverage"};
   const char * const DEBUGGER_CMDS[]  = {"bp",
-                                         "run"};
-  const char * const LOADER_CMDS[]    = {"loader"};
+                                         "run",
+                                         "step",
+                                         "list"};
+  const char * const FORMAT_CMDS[]    = {"format"};
+  const char * const HEATMAP_CMDS[]   = {"heatmap"};
+  const char * const HEXFILE_CMDS[]   = {"memexport",
+                                         "memimport"};
+  const char * const LOADER_CMDS[]    = {"loadstats",
+                                         "loader",
+                                         "relocate"};
   const char * const MEMSPACE_CMDS[]  = {"du",
                                          "dump",
                                          "e",
@@ -150,9 +249,15 @@ static bool mainloop_assign_handler(void)
                                          "f",
                                          "fill",
                                          "reset",
-                                         "progaddr"};
+                                         "progaddr",
+                                         "protect"};
   const char * const OPCODE_CMDS[]    = {"opcode",
                                          "opcodelist"};
+  const char * const PERF_CMDS[]      = {"perf",
+                                         "time"};
+  const char * const REPLAY_CMDS[]    = {"record",
+                                         "replay"};
+  const char * const SAMPLE_CMDS[]    = {"sample"};
   const char * const SHELL_CMDS[]     = {"h",
                                          "help",
                                          "d",
@@ -162,19 +267,51 @@ static bool mainloop_assign_handler(void)
                                          "hi",
                                          "history",
                                          "type"};
+  const char * const TIMELINE_CMDS[]  = {"trace-timeline"};
+  const char * const WATCH_CMDS[]     = {"watch-build"};
+  const int ANALYZE_CMDS_COUNT   = (int)(sizeof(ANALYZE_CMDS) /
+                                         sizeof(ANALYZE_CMDS[0]));
   const int ASSEMBLER_CMDS_COUNT = (int)(sizeof(ASSEMBLER_CMDS) /
                                          sizeof(ASSEMBLER_CMDS[0]));
+  const int CACHE_CMDS_COUNT     = (int)(sizeof(CACHE_CMDS) /
+                                         sizeof(CACHE_CMDS[0]));
+  const int COVERAGE_CMDS_COUNT  = (int)(sizeof(COVERAGE_CMDS) /
+                                         sizeof(COVERAGE_CMDS[0]));
   const int DEBUGGER_CMDS_COUNT  = (int)(sizeof(DEBUGGER_CMDS) /
                                          sizeof(DEBUGGER_CMDS[0]));
+  const int FORMAT_CMDS_COUNT    = (int)(sizeof(FORMAT_CMDS) /
+                                         sizeof(FORMAT_CMDS[0]));
+  const int HEATMAP_CMDS_COUNT   = (int)(sizeof(HEATMAP_CMDS) /
+                                         sizeof(HEATMAP_CMDS[0]));
+  const int HEXFILE_CMDS_COUNT   = (int)(sizeof(HEXFILE_CMDS) /
+                                         sizeof(HEXFILE_CMDS[0]));
   const int LOADER_CMDS_COUNT    = (int)(sizeof(LOADER_CMDS) /
                                          sizeof(LOADER_CMDS[0]));
   const int MEMSPACE_CMDS_COUNT  = (int)(sizeof(MEMSPACE_CMDS) /
                                          sizeof(MEMSPACE_CMDS[0]));
   const int OPCODE_CMDS_COUNT    = (int)(sizeof(OPCODE_CMDS) /
                                          sizeof(OPCODE_CMDS[0]));
+  const int PERF_CMDS_COUNT      = (int)(sizeof(PERF_CMDS) /
+                                         sizeof(PERF_CMDS[0]));
+  const int REPLAY_CMDS_COUNT    = (int)(sizeof(REPLAY_CMDS) /
+                                         sizeof(REPLAY_CMDS[0]));
+  const int SAMPLE_CMDS_COUNT    = (int)(sizeof(SAMPLE_CMDS) /
+                                         sizeof(SAMPLE_CMDS[0]));
   const int SHELL_CMDS_COUNT     = (int)(sizeof(SHELL_CMDS) /
                                          sizeof(SHELL_CMDS[0]));
+  const int TIMELINE_CMDS_COUNT  = (int)(sizeof(TIMELINE_CMDS) /
+                                         sizeof(TIMELINE_CMDS[0]));
+  const int WATCH_CMDS_COUNT     = (int)(sizeof(WATCH_CMDS) /
+                                         sizeof(WATCH_CMDS[0]));
 
+  for(int i = 0; i < ANALYZE_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(ANALYZE_CMDS[i], _command.cmd))
+    {
+      _command.handler = analyze_execute;
+      return true;
+    }
+  }
   for(int i = 0; i < ASSEMBLER_CMDS_COUNT; ++i)
   {
     if(!strcmp(ASSEMBLER_CMDS[i], _command.cmd))
@@ -183,6 +320,22 @@ static bool mainloop_assign_handler(void)
       return true;
     }
   }
+  for(int i = 0; i < CACHE_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(CACHE_CMDS[i], _command.cmd))
+    {
+      _command.handler = cache_execute;
+      return true;
+    }
+  }
+  for(int i = 0; i < COVERAGE_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(COVERAGE_CMDS[i], _command.cmd))
+    {
+      _command.handler = coverage_execute;
+      return true;
+    }
+  }
   for(int i = 0; i < DEBUGGER_CMDS_COUNT; ++i)
   {
     if(!strcmp(DEBUGGER_CMDS[i], _command.cmd))
@@ -191,6 +344,30 @@ static bool mainloop_assign_handler(void)
       return true;
     }
   }
+  for(int i = 0; i < FORMAT_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(FORMAT_CMDS[i], _command.cmd))
+    {
+      _command.handler = json_execute;
+      return true;
+    }
+  }
+  for(int i = 0; i < HEATMAP_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(HEATMAP_CMDS[i], _command.cmd))
+    {
+      _command.handler = heatmap_execute;
+      return true;
+    }
+  }
+  for(int i = 0; i < HEXFILE_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(HEXFILE_CMDS[i], _command.cmd))
+    {
+      _command.handler = hexfile_execute;
+      return true;
+    }
+  }
   for(int i = 0; i < LOADER_CMDS_COUNT; ++i)
   {
     if(!strcmp(LOADER_CMDS[i], _command.cmd))
@@ -215,6 +392,30 @@ static bool mainloop_assign_handler(void)
       return true;
     }
   }
+  for(int i = 0; i < PERF_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(PERF_CMDS[i], _command.cmd))
+    {
+      _command.handler = perf_execute;
+      return true;
+    }
+  }
+  for(int i = 0; i < REPLAY_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(REPLAY_CMDS[i], _command.cmd))
+    {
+      _command.handler = replay_execute;
+      return true;
+    }
+  }
+  for(int i = 0; i < SAMPLE_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(SAMPLE_CMDS[i], _command.cmd))
+    {
+      _command.handler = sample_execute;
+      return true;
+    }
+  }
   for(int i = 0; i < SHELL_CMDS_COUNT; ++i)
   {
     if(!strcmp(SHELL_CMDS[i], _command.cmd))
@@ -223,6 +424,22 @@ static bool mainloop_assign_handler(void)
       return true;
     }
   }
+  for(int i = 0; i < TIMELINE_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(TIMELINE_CMDS[i], _command.cmd))
+    {
+      _command.handler = timeline_execute;
+      return true;
+    }
+  }
+  for(int i = 0; i < WATCH_CMDS_COUNT; ++i)
+  {
+    if(!strcmp(WATCH_CMDS[i], _command.cmd))
+    {
+      _command.handler = watch_execute;
+      return true;
+    }
+  }
 
   _command.handler = NULL;
   return false;
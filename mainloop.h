@@ -7,6 +7,17 @@
 #ifndef __MAINLOOP_H__
 #define __MAINLOOP_H__
 
+/**
+ * @brief          Execute the given command as if it was entered. Used by
+ *                 commands that run other commands.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void mainloop_execute_command(const char *cmd,
+                              const int  argc,
+                              const char *argv[]);
+
 /**
  * @brief Initialize all interal states.
  */
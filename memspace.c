@@ -8,6 +8,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "memspace.h"
+
+#include "json.h"
 #include "logger.h"
 
 /**
@@ -16,7 +19,6 @@
  * @see   memory
  */
 #define MEMORY_SIZE 0xFFFFF + 1
-
 /**
  * @brief Equals to 0x00000.
  */
@@ -61,6 +63,11 @@ static const int VALUE_MIN = 0x00;
  */
 static const int VALUE_MAX = 0xFF;
 
+/**
+ * @brief A handler called on the first access to a pending page.
+ */
+static void (*_fault_handler)(const int page) = NULL;
+
 /**
  * @brief A flag indicating the last dumped address.
  */
@@ -77,11 +84,26 @@ static bool _is_command_executed = false;
  */
 static unsigned char _memory[MEMORY_SIZE] = {0,};
 
+/**
+ * @brief The number of pending pages. Accesses check pages only if any.
+ */
+static int _pending_count = 0;
+
+/**
+ * @brief Flags indicating whether each page is pending or not.
+ */
+static bool _pending_pages[MEMSPACE_PAGE_COUNT] = {false,};
+
 /**
  * @brief An starting address in memory where a program is to be loaded.
  */
 static int _progaddr = 0;
 
+/**
+ * @brief Protection flags of each page.
+ */
+static unsigned char _protections[MEMSPACE_PAGE_COUNT];
+
 /**
  * @brief          Print memory in the given range.
  * @param[in] cmd  A type of the command.
@@ -122,6 +144,16 @@ static bool memspace_execute_progaddr(const char *cmd,
                                       const int  argc,
                                       const char *argv[]);
 
+/**
+ * @brief          Set protection flags of pages, or show flags of all pages.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool memspace_execute_protect(const char *cmd,
+                                     const int  argc,
+                                     const char *argv[]);
+
 /**
  * @brief          Clear all memory.
  * @param[in] cmd  A type of the command.
@@ -132,6 +164,40 @@ static bool memspace_execute_reset(const char *cmd,
                                    const int  argc,
                                    const char *argv[]);
 
+/**
+ * @brief                Load pending pages in the given range before they
+ *                       are accessed.
+ * @param[in] address    The starting address of the range.
+ * @param[in] byte_count The number of bytes of the range.
+ */
+static void memspace_fault(const int address, const int byte_count);
+
+/**
+ * @brief                Check if memory of the given number of bytes at the
+ *                       given address is in range.
+ * @param[in] address    The starting address of the range.
+ * @param[in] byte_count The number of bytes of the range.
+ * @return               True if in range, false otherwise.
+ */
+static bool memspace_is_valid_range(const int address, const int byte_count);
+
+bool memspace_compare_memory(const int address1,
+                             const int address2,
+                             const int byte_count,
+                             int       *result)
+{
+  if(!memspace_is_valid_range(address1, byte_count) ||
+     !memspace_is_valid_range(address2, byte_count))
+  {
+    return false;
+  }
+
+  memspace_fault(address1, byte_count);
+  memspace_fault(address2, byte_count);
+  *result = memcmp(&_memory[address1], &_memory[address2], byte_count);
+  return true;
+}
+
 void memspace_execute(const char *cmd, const int argc, const char *argv[])
 {
   if(!strcmp("du", cmd) || !strcmp("dump", cmd))
@@ -154,9 +220,13 @@ void memspace_execute(const char *cmd, const int argc, const char *argv[])
   {
     _is_command_executed = memspace_execute_progaddr(cmd, argc, argv);
   }
+  else if(!strcmp("protect", cmd))
+  {
+    _is_command_executed = memspace_execute_protect(cmd, argc, argv);
+  }
   else
   {
-    printf("%s: command not found\n", cmd);
+    json_printf("%s: command not found\n", cmd);
   }
 
   if(_is_command_executed)
@@ -165,11 +235,43 @@ void memspace_execute(const char *cmd, const int argc, const char *argv[])
   }
 }
 
+bool memspace_fill_memory(const int           address,
+                          const unsigned char value,
+                          const int           byte_count)
+{
+  if(!memspace_is_valid_range(address, byte_count))
+  {
+    return false;
+  }
+
+  memspace_fault(address, byte_count);
+  memset(&_memory[address], value, byte_count);
+  return true;
+}
+
+int memspace_get_protection(const int address)
+{
+  if(ADDRESS_MIN > address ||
+     ADDRESS_MAX < address)
+  {
+    return 0;
+  }
+
+  return _protections[address / MEMSPACE_PAGE_LEN];
+}
+
 int memspace_get_progaddr(void)
 {
   return _progaddr;
 }
 
+void memspace_initialize(void)
+{
+  memset(_protections,
+         MEMSPACE_READ | MEMSPACE_WRITE | MEMSPACE_EXECUTE,
+         sizeof(_protections));
+}
+
 unsigned char *memspace_get_memory(unsigned char *memory,
                                    const int     address,
                                    const int     byte_count)
@@ -177,22 +279,23 @@ unsigned char *memspace_get_memory(unsigned char *memory,
   if(ADDRESS_MIN > address ||
      ADDRESS_MAX < address)
   {
-    printf("memspace: address '%X' is out of range\n", address);
+    json_printf("memspace: address '%X' is out of range\n", address);
     return NULL;
   }
   if(ADDRESS_MAX < address + byte_count)
   {
-    printf("memspace: '%d' bytes from the address '%X' is out of range\n",
-        byte_count,
-        address);
+    json_printf("memspace: '%d' bytes from the address '%X' is out of range\n",
+             byte_count,
+             address);
     return NULL;
   }
   if(!memory)
   {
-    printf("memspace: the address of memory to obtain is NULL\n");
+    json_printf("memspace: the address of memory to obtain is NULL\n");
     return NULL;
   }
 
+  memspace_fault(address, byte_count);
   memcpy(memory, &_memory[address], byte_count);
   return memory;
 }
@@ -205,14 +308,14 @@ bool memspace_modify_memory(const int  address,
   if(ADDRESS_MIN > address ||
      ADDRESS_MAX < address)
   {
-    printf("memspace: address '%X' is out of range\n", address);
+    json_printf("memspace: address '%X' is out of range\n", address);
     return false;
   }
   if(ADDRESS_MAX < address + 2)
   {
-    printf("memspace: '%d' half-bytes from the address '%X' is out of range\n",
-        length,
-        address);
+    json_printf("memspace: '%d' half-bytes from the address '%X' is out of range\n",
+             length,
+             address);
     return false;
   }
 
@@ -221,6 +324,7 @@ bool memspace_modify_memory(const int  address,
   unsigned char leftmost_nibble            = 0;
   unsigned int  new_address                = 0;
 
+  memspace_fault(address, byte_count);
   memcpy(new_memory, &_memory[address], byte_count);
   new_memory[byte_count] = '\0';
   if(0 != length % 2)
@@ -244,7 +348,7 @@ bool memspace_modify_memory(const int  address,
   }
   else
   {
-    printf("memspace: unknown modification flag '%c'\n", flag);
+    json_printf("memspace: unknown modification flag '%c'\n", flag);
     return false;
   }
 
@@ -259,6 +363,38 @@ bool memspace_modify_memory(const int  address,
   return true;
 }
 
+bool memspace_move_memory(const int destination,
+                          const int source,
+                          const int byte_count)
+{
+  if(!memspace_is_valid_range(destination, byte_count) ||
+     !memspace_is_valid_range(source, byte_count))
+  {
+    return false;
+  }
+
+  memspace_fault(destination, byte_count);
+  memspace_fault(source, byte_count);
+  memmove(&_memory[destination], &_memory[source], byte_count);
+  return true;
+}
+
+bool memspace_search_memory(const int           address,
+                            const unsigned char value,
+                            const int           byte_count,
+                            int                 *found)
+{
+  if(!memspace_is_valid_range(address, byte_count))
+  {
+    return false;
+  }
+
+  memspace_fault(address, byte_count);
+  const unsigned char *byte = memchr(&_memory[address], value, byte_count);
+  *found = byte ? byte - _memory : -1;
+  return true;
+}
+
 bool memspace_set_memory(const int     address,
                          unsigned char *memory,
                          const int     byte_count)
@@ -266,33 +402,113 @@ bool memspace_set_memory(const int     address,
   if(ADDRESS_MIN > address ||
      ADDRESS_MAX < address)
   {
-    printf("memspace: address '%X' is out of range\n", address);
+    json_printf("memspace: address '%X' is out of range\n", address);
     return false;
   }
   if(ADDRESS_MAX < address + byte_count)
   {
-    printf("memspace: '%d' bytes from the address '%X' is out of range\n",
-        byte_count,
-        address);
+    json_printf("memspace: '%d' bytes from the address '%X' is out of range\n",
+             byte_count,
+             address);
     return false;
   }
   if(!memory)
   {
-    printf("memspace: the address of memory to set is NULL\n");
+    json_printf("memspace: the address of memory to set is NULL\n");
     return false;
   }
 
+  memspace_fault(address, byte_count);
   memcpy(&_memory[address], memory, byte_count);
   return true;
 }
 
+void memspace_set_fault_handler(void (*handler)(const int page))
+{
+  _fault_handler = handler;
+}
+
+bool memspace_set_pending(const int  address,
+                          const int  byte_count,
+                          const bool is_pending)
+{
+  if(ADDRESS_MIN > address ||
+     ADDRESS_MAX < address)
+  {
+    json_printf("memspace: address '%X' is out of range\n", address);
+    return false;
+  }
+  if(ADDRESS_MAX < address + byte_count - 1)
+  {
+    json_printf("memspace: '%d' bytes from the address '%X' is out of range\n",
+             byte_count,
+             address);
+    return false;
+  }
+
+  for(int page = address / MEMSPACE_PAGE_LEN;
+      page <= (address + byte_count - 1) / MEMSPACE_PAGE_LEN;
+      ++page)
+  {
+    if(is_pending != _pending_pages[page])
+    {
+      _pending_pages[page] = is_pending;
+      _pending_count       += is_pending ? 1 : -1;
+    }
+  }
+
+  return true;
+}
+
+bool memspace_set_protection(const int address,
+                             const int byte_count,
+                             const int protection)
+{
+  if(ADDRESS_MIN > address ||
+     ADDRESS_MAX < address)
+  {
+    json_printf("memspace: address '%X' is out of range\n", address);
+    return false;
+  }
+  if(ADDRESS_MAX < address + byte_count - 1)
+  {
+    json_printf("memspace: '%d' bytes from the address '%X' is out of range\n",
+             byte_count,
+             address);
+    return false;
+  }
+
+  for(int page = address / MEMSPACE_PAGE_LEN;
+      page <= (address + byte_count - 1) / MEMSPACE_PAGE_LEN;
+      ++page)
+  {
+    _protections[page] = protection;
+  }
+
+  return true;
+}
+
+bool memspace_set_progaddr(const int progaddr)
+{
+  if(ADDRESS_MIN > progaddr ||
+     ADDRESS_MAX < progaddr)
+  {
+    json_printf("progaddr: value '%X' is out of range\n", progaddr);
+    return false;
+  }
+
+  _progaddr = progaddr;
+
+  return true;
+}
+
 static bool memspace_execute_dump(const char *cmd,
                                   const int  argc,
                                   const char *argv[])
 {
   if(2 < argc)
   {
-    printf("dump: too many arguments\n");
+    json_printf("dump: too many arguments\n");
     return false;
   }
 
@@ -313,13 +529,13 @@ static bool memspace_execute_dump(const char *cmd,
     dump_start = strtol(argv[0], &endptr, HEX);
     if('\0' != *endptr)
     {
-      printf("dump: argument '%s' is invalid\n", argv[0]);
+      json_printf("dump: argument '%s' is invalid\n", argv[0]);
       return false;
     }
     if(ADDRESS_MIN > dump_start ||
        ADDRESS_MAX < dump_start)
     {
-      printf("dump: start '%X' is out of range\n", dump_start);
+      json_printf("dump: start '%X' is out of range\n", dump_start);
       return false;
     }
   }
@@ -337,58 +553,77 @@ static bool memspace_execute_dump(const char *cmd,
     dump_end = strtol(argv[1], &endptr, HEX);
     if('\0' != *endptr)
     {
-      printf("dump: argument '%s' is invalid\n", argv[1]);
+      json_printf("dump: argument '%s' is invalid\n", argv[1]);
       return false;
     }
     if(ADDRESS_MIN > dump_end ||
        ADDRESS_MAX < dump_end)
     {
-      printf("dump: end '%X' is out of range\n", dump_end);
+      json_printf("dump: end '%X' is out of range\n", dump_end);
       return false;
     }
 
     if(dump_start > dump_end)
     {
-      printf("dump: start '%X' is larger than end value '%X'\n",
-          dump_start, dump_end);
+      json_printf("dump: start '%X' is larger than end value '%X'\n",
+               dump_start, dump_end);
       return false;
     }
   }
 
+  memspace_fault(dump_start, dump_end - dump_start + 1);
+
+  if(json_is_enabled())
+  {
+    json_begin_object("memory");
+    json_write_integer("start", dump_start);
+    json_write_integer("end", dump_end);
+    json_begin_array("bytes");
+    for(int address = dump_start; address <= dump_end; ++address)
+    {
+      json_write_integer(NULL, _memory[address]);
+    }
+    json_end_array();
+    json_end_object();
+
+    _last_dumped = dump_end;
+    return true;
+  }
+
   for(int line = dump_start / DUMP_LINE_LEN;
       line <= dump_end / DUMP_LINE_LEN;
       ++line)
   {
     int base = line * DUMP_LINE_LEN;
 
-    printf("%05X ", base);
+    json_printf("%05X ", base);
     for(int offset = 0; offset < DUMP_LINE_LEN; ++offset)
     {
       int address = base + offset;
       if(address < dump_start || address > dump_end)
       {
-        printf("%2c ", ' ');
+        json_printf("%2c ", ' ');
       }
       else
       {
-        printf("%02X ", _memory[address]);
+        json_printf("%02X ", _memory[address]);
       }
     }
-    printf("; ");
+    json_printf("; ");
     for(int offset = 0; offset < DUMP_LINE_LEN; ++offset)
     {
       int address = base + offset;
       if(address < dump_start || address > dump_end ||
          _memory[address] < 0x20 || _memory[address] > 0x7E)
       {
-        printf(".");
+        json_printf(".");
       }
       else
       {
-        printf("%c", _memory[address]);
+        json_printf("%c", _memory[address]);
       }
     }
-    printf("\n");
+    json_printf("\n");
   }
 
   _last_dumped = dump_end;
@@ -402,7 +637,7 @@ static bool memspace_execute_edit(const char *cmd,
 {
   if(2 != argc)
   {
-    printf("edit: two arguments are required\n");
+    json_printf("edit: two arguments are required\n");
     return false;
   }
 
@@ -413,29 +648,30 @@ static bool memspace_execute_edit(const char *cmd,
   address = strtol(argv[0], &endptr, HEX);
   if('\0' != *endptr)
   {
-    printf("edit: argument '%s' is invalid\n", argv[0]);
+    json_printf("edit: argument '%s' is invalid\n", argv[0]);
     return false;
   }
   if(ADDRESS_MIN > address ||
      ADDRESS_MAX < address)
   {
-    printf("dump: address '%X' is out of range\n", address);
+    json_printf("dump: address '%X' is out of range\n", address);
     return false;
   }
 
   value = strtol(argv[1], &endptr, HEX);
   if('\0' != *endptr)
   {
-    printf("edit: argument '%s' is invalid\n", argv[1]);
+    json_printf("edit: argument '%s' is invalid\n", argv[1]);
     return false;
   }
   if(VALUE_MIN > value ||
      VALUE_MAX < value)
   {
-    printf("dump: value '%X' is out of range\n", value);
+    json_printf("dump: value '%X' is out of range\n", value);
     return false;
   }
 
+  memspace_fault(address, 1);
   _memory[address] = value;
 
   return true;
@@ -447,7 +683,7 @@ static bool memspace_execute_fill(const char *cmd,
 {
   if(3 != argc)
   {
-    printf("fill: three arguments are required\n");
+    json_printf("fill: three arguments are required\n");
     return false;
   }
 
@@ -459,48 +695,49 @@ static bool memspace_execute_fill(const char *cmd,
   start = strtol(argv[0], &endptr, HEX);
   if('\0' != *endptr)
   {
-    printf("fill: argument '%s' is invalid\n", argv[0]);
+    json_printf("fill: argument '%s' is invalid\n", argv[0]);
     return false;
   }
   if(ADDRESS_MIN > start ||
      ADDRESS_MAX < start)
   {
-    printf("fill: start '%X' is out of range\n", start);
+    json_printf("fill: start '%X' is out of range\n", start);
     return false;
   }
 
   end = strtol(argv[1], &endptr, HEX);
   if('\0' != *endptr)
   {
-    printf("fill: argument '%s' is invalid\n", argv[1]);
+    json_printf("fill: argument '%s' is invalid\n", argv[1]);
     return false;
   }
   if(ADDRESS_MIN > end ||
      ADDRESS_MAX < end)
   {
-    printf("fill: end '%X' is out of range\n", end);
+    json_printf("fill: end '%X' is out of range\n", end);
     return false;
   }
 
   if(start > end)
   {
-    printf("fill: end '%X' is smaller than start '%X'\n", start, end);
+    json_printf("fill: end '%X' is smaller than start '%X'\n", start, end);
     return false;
   }
 
   value = strtol(argv[2], &endptr, HEX);
   if('\0' != *endptr)
   {
-    printf("fill: argument '%s' is invalid\n", argv[2]);
+    json_printf("fill: argument '%s' is invalid\n", argv[2]);
     return false;
   }
   if(VALUE_MIN > value ||
      VALUE_MAX < value)
   {
-    printf("fill: value '%X' is out of range\n", value);
+    json_printf("fill: value '%X' is out of range\n", value);
     return false;
   }
 
+  memspace_fault(start, end - start + 1);
   memset(&_memory[start], value, end - start + 1);
 
   return true;
@@ -512,7 +749,7 @@ static bool memspace_execute_progaddr(const char *cmd,
 {
   if(1 != argc)
   {
-    printf("progaddr: one argument is required\n");
+    json_printf("progaddr: one argument is required\n");
     return false;
   }
 
@@ -522,19 +759,118 @@ static bool memspace_execute_progaddr(const char *cmd,
   value = strtol(argv[0], &endptr, HEX);
   if('\0' != *endptr)
   {
-    printf("progaddr: argument '%s' is invalid\n", argv[0]);
+    json_printf("progaddr: argument '%s' is invalid\n", argv[0]);
     return false;
   }
-  if(ADDRESS_MIN > value ||
-     ADDRESS_MAX < value)
+
+  return memspace_set_progaddr(value);
+}
+
+static bool memspace_execute_protect(const char *cmd,
+                                     const int  argc,
+                                     const char *argv[])
+{
+  if(0 == argc)
+  {
+    // Show pages of the same flags as a range.
+    if(json_is_enabled())
+    {
+      json_begin_array("protection");
+    }
+    else
+    {
+      json_printf("Start\tEnd\tFlags\n");
+      json_printf("---------------------\n");
+    }
+    int first = 0;
+    for(int page = 1; page <= MEMSPACE_PAGE_COUNT; ++page)
+    {
+      if(MEMSPACE_PAGE_COUNT > page && _protections[first] == _protections[page])
+      {
+        continue;
+      }
+
+      const int protection = _protections[first];
+      const char flags[4]  = {protection & MEMSPACE_READ    ? 'r' : '-',
+                              protection & MEMSPACE_WRITE   ? 'w' : '-',
+                              protection & MEMSPACE_EXECUTE ? 'x' : '-',
+                              '\0'};
+      const int  start     = first * MEMSPACE_PAGE_LEN;
+      const int  end       = page * MEMSPACE_PAGE_LEN - 1;
+      if(json_is_enabled())
+      {
+        json_begin_object(NULL);
+        json_write_integer("start", start);
+        json_write_integer("end", end);
+        json_write_string("flags", flags);
+        json_end_object();
+      }
+      else
+      {
+        json_printf("%05X\t%05X\t%s\n", start, end, flags);
+      }
+      first = page;
+    }
+    if(json_is_enabled())
+    {
+      json_end_array();
+    }
+
+    return true;
+  }
+  if(3 != argc)
   {
-    printf("progaddr: value '%X' is out of range\n", value);
+    json_printf("protect: three arguments are required\n");
     return false;
   }
 
-  _progaddr = value;
+  int  start   = 0;
+  int  end     = 0;
+  char *endptr = NULL;
 
-  return true;
+  start = strtol(argv[0], &endptr, HEX);
+  if('\0' != *endptr)
+  {
+    json_printf("protect: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+  end = strtol(argv[1], &endptr, HEX);
+  if('\0' != *endptr)
+  {
+    json_printf("protect: argument '%s' is invalid\n", argv[1]);
+    return false;
+  }
+  if(start > end)
+  {
+    json_printf("protect: start '%X' is larger than end value '%X'\n",
+                start, end);
+    return false;
+  }
+
+  // Flags are any of r, w, and x, or - for none.
+  int protection = 0;
+  for(const char *flag = argv[2]; '\0' != *flag; ++flag)
+  {
+    if('r' == *flag)
+    {
+      protection |= MEMSPACE_READ;
+    }
+    else if('w' == *flag)
+    {
+      protection |= MEMSPACE_WRITE;
+    }
+    else if('x' == *flag)
+    {
+      protection |= MEMSPACE_EXECUTE;
+    }
+    else if('-' != *flag)
+    {
+      json_printf("protect: flags '%s' are invalid\n", argv[2]);
+      return false;
+    }
+  }
+
+  return memspace_set_protection(start, end - start + 1, protection);
 }
 
 static bool memspace_execute_reset(const char *cmd,
@@ -543,11 +879,57 @@ static bool memspace_execute_reset(const char *cmd,
 {
   if(0 < argc)
   {
-    printf("reset: too many arguments\n");
+    json_printf("reset: too many arguments\n");
     return false;
   }
 
   memset(_memory, 0, MEMORY_SIZE);
 
+  // Pages not loaded yet are cleared as well.
+  memset(_pending_pages, 0, sizeof(_pending_pages));
+  _pending_count = 0;
+
+  return true;
+}
+
+static void memspace_fault(const int address, const int byte_count)
+{
+  if(0 == _pending_count)
+  {
+    return;
+  }
+
+  for(int page = address / MEMSPACE_PAGE_LEN;
+      page <= (address + byte_count - 1) / MEMSPACE_PAGE_LEN;
+      ++page)
+  {
+    if(_pending_pages[page])
+    {
+      _pending_pages[page] = false;
+      --_pending_count;
+      if(_fault_handler)
+      {
+        _fault_handler(page);
+      }
+    }
+  }
+}
+
+static bool memspace_is_valid_range(const int address, const int byte_count)
+{
+  if(ADDRESS_MIN > address ||
+     ADDRESS_MAX < address)
+  {
+    json_printf("memspace: address '%X' is out of range\n", address);
+    return false;
+  }
+  if(0 > byte_count || ADDRESS_MAX < address + byte_count - 1)
+  {
+    json_printf("memspace: '%d' bytes from the address '%X' is out of range\n",
+             byte_count,
+             address);
+    return false;
+  }
+
   return true;
 }
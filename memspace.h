@@ -6,6 +6,51 @@
 #ifndef __MEMSPACE_H__
 #define __MEMSPACE_H__
 
+/**
+ * @def   MEMSPACE_PAGE_LEN
+ * @brief The number of bytes of a page. Memory is loaded lazily by pages.
+ */
+#define MEMSPACE_PAGE_LEN 0x1000
+
+/**
+ * @def   MEMSPACE_PAGE_COUNT
+ * @brief The number of pages of memory.
+ */
+#define MEMSPACE_PAGE_COUNT 0x100
+
+/**
+ * @def   MEMSPACE_READ
+ * @brief A protection flag permitting to read a page.
+ */
+#define MEMSPACE_READ 0x4
+
+/**
+ * @def   MEMSPACE_WRITE
+ * @brief A protection flag permitting to write a page.
+ */
+#define MEMSPACE_WRITE 0x2
+
+/**
+ * @def   MEMSPACE_EXECUTE
+ * @brief A protection flag permitting to execute a page.
+ */
+#define MEMSPACE_EXECUTE 0x1
+
+/**
+ * @brief                 Compare memory of the given number of bytes at the
+ *                        given addresses, as memcmp().
+ * @param[in]  address1   The address of memory to be compared.
+ * @param[in]  address2   The address of memory to compare with.
+ * @param[in]  byte_count The number of bytes to compare.
+ * @param[out] result     Negative, zero, or positive as memory at address1
+ *                        is less than, equal to, or greater than the other.
+ * @return                True if both ranges are valid, false otherwise.
+ */
+bool memspace_compare_memory(const int address1,
+                             const int address2,
+                             const int byte_count,
+                             int       *result);
+
 /**
  * @brief          Receives command and executes the command.
  * @param[in] cmd  A type of the command.
@@ -14,12 +59,39 @@
  */
 void memspace_execute(const char *cmd, const int argc, const char *argv[]);
 
+/**
+ * @brief                Fill memory of the given number of bytes at the given
+ *                       address with the given value.
+ * @param[in] address    The address of memory to be filled.
+ * @param[in] value      A value of a byte.
+ * @param[in] byte_count The number of bytes to fill.
+ * @return               True if the range is valid, false otherwise.
+ */
+bool memspace_fill_memory(const int           address,
+                          const unsigned char value,
+                          const int           byte_count);
+
+/**
+ * @brief             Return protection flags of the page of the given
+ *                    address. Flags are checked by the debugger, and not by
+ *                    commands or the loader.
+ * @param[in] address An address in the page.
+ * @return            Protection flags, or 0 if the address is out of range.
+ */
+int memspace_get_protection(const int address);
+
 /**
  * @brief  Return the starting address that the linked program will be loaded.
  * @return A prograddr.
  */
 int memspace_get_progaddr(void);
 
+/**
+ * @brief Initialize memspace. All pages are permitted to read, write, and
+ *        execute.
+ */
+void memspace_initialize(void);
+
 /**
  * @brief      Return memory of the given number of bytes at the given address.
  * @param[out] A memory of the given number of bytes at the given address.
@@ -45,6 +117,33 @@ bool memspace_modify_memory(const int  address,
                             const char flag,
                             const int  amount);
 
+/**
+ * @brief                 Move memory of the given number of bytes, as
+ *                        memmove(). The ranges may overlap.
+ * @param[in] destination The address of memory to be set.
+ * @param[in] source      The address of memory to move.
+ * @param[in] byte_count  The number of bytes to move.
+ * @return                True if both ranges are valid, false otherwise.
+ */
+bool memspace_move_memory(const int destination,
+                          const int source,
+                          const int byte_count);
+
+/**
+ * @brief                 Search memory of the given number of bytes at the
+ *                        given address for the given value, as memchr().
+ * @param[in]  address    The address of memory to be searched.
+ * @param[in]  value      A value of a byte.
+ * @param[in]  byte_count The number of bytes to search.
+ * @param[out] found      The address of the first byte of the value, or -1
+ *                        if there is none.
+ * @return                True if the range is valid, false otherwise.
+ */
+bool memspace_search_memory(const int           address,
+                            const unsigned char value,
+                            const int           byte_count,
+                            int                 *found);
+
 /**
  * @brief     Set memory of the given number of bytes at the given address.
  * @param[in] The address of memory to be set.
@@ -56,4 +155,43 @@ bool memspace_set_memory(const int     address,
                          unsigned char *memory,
                          const int     byte_count);
 
+/**
+ * @brief             Set handler which is called on the first access to a
+ *                    pending page. The page is no longer pending when the
+ *                    handler is called, so it can set the page.
+ * @param[in] handler A handler receiving the index of the page.
+ */
+void memspace_set_fault_handler(void (*handler)(const int page));
+
+/**
+ * @brief                Mark or unmark pages in the given range as pending,
+ *                       i.e. not loaded yet.
+ * @param[in] address    The starting address of the range.
+ * @param[in] byte_count The number of bytes of the range.
+ * @param[in] is_pending True to mark, false to unmark.
+ * @return               True if the range is valid, false otherwise.
+ */
+bool memspace_set_pending(const int  address,
+                          const int  byte_count,
+                          const bool is_pending);
+
+/**
+ * @brief                Set protection flags of pages in the given range.
+ * @param[in] address    The starting address of the range.
+ * @param[in] byte_count The number of bytes of the range.
+ * @param[in] protection Protection flags.
+ * @return               True if the range is valid, false otherwise.
+ */
+bool memspace_set_protection(const int address,
+                             const int byte_count,
+                             const int protection);
+
+/**
+ * @brief              Set the starting address that the linked program will
+ *                     be loaded.
+ * @param[in] progaddr A progaddr.
+ * @return             True if progaddr is in range, false otherwise.
+ */
+bool memspace_set_progaddr(const int progaddr);
+
 #endif
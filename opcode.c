@@ -9,6 +9,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "json.h"
 #include "logger.h"
 
 /**
@@ -44,6 +45,8 @@ struct opcode
   unsigned int  format2 : 1;
   unsigned int  format3 : 1;
   unsigned int  format4 : 1;
+  /** A flag indicating whether the opcode is an extension to SIC/XE. */
+  unsigned int  is_extension : 1;
   /** A mnemonic equivalent to the opcode. */
   char          mnemonic[];
 };
@@ -68,6 +71,11 @@ static struct lcg _lcg = {0,};
  */
 static bool _is_command_executed = false;
 
+/**
+ * @brief A flag indicating whether extension opcodes are enabled or not.
+ */
+static bool _is_extension_enabled = false;
+
 /**
  * @brief A hash table of opcodes.
  */
@@ -84,11 +92,13 @@ static const int opcode_compute_key(const char *mnemonic);
  * @param[in] opcode   Opcode.
  * @param[in] mnemonic Mnemonic.
  * @param[in] format   Format type.
+ * @param[in] set      'EXT' if the opcode is an extension, NULL otherwise.
  * @return             Created opcode object.
  */
 static struct opcode *opcode_create_opcode(const char *opcode,
                                            const char *mnemonic,
-                                           const char *format);
+                                           const char *format,
+                                           const char *set);
 
 /**
  * @brief Create opcode hash table using universal hasing.
@@ -144,7 +154,7 @@ void opcode_execute(const char *cmd, const int argc, const char *argv[])
   }
   else
   {
-    printf("%s: command not found\n", cmd);
+    json_printf("%s: command not found\n", cmd);
   }
 
   if(_is_command_executed)
@@ -179,7 +189,7 @@ int opcode_get_format(const char *mnemonic)
   }
   else
   {
-    printf("opcode: cannot find mnemonic '%s'\n", mnemonic);
+    json_printf("opcode: cannot find mnemonic '%s'\n", mnemonic);
     return 0;
   }
 }
@@ -215,11 +225,21 @@ void opcode_initialize(void)
   opcode_create_table();
 }
 
+bool opcode_is_extension_enabled(void)
+{
+  return _is_extension_enabled;
+}
+
 bool opcode_is_opcode(const char *mnemonic)
 {
   return opcode_search_opcode(mnemonic) ? true : false;
 }
 
+void opcode_set_extension_enabled(const bool is_enabled)
+{
+  _is_extension_enabled = is_enabled;
+}
+
 void opcode_terminate(void)
 {
   for(int i = 0; i < OPCODE_TABLE_LEN; ++i)
@@ -249,7 +269,8 @@ static const int opcode_compute_key(const char *mnemonic)
 
 static struct opcode *opcode_create_opcode(const char *opcode,
                                            const char *mnemonic,
-                                           const char *format)
+                                           const char *format,
+                                           const char *set)
 {
   struct opcode *new_opcode = malloc(sizeof(*new_opcode) +
                                      sizeof(char) * (strlen(mnemonic) + 1));
@@ -280,6 +301,7 @@ static struct opcode *opcode_create_opcode(const char *opcode,
         break;
     }
   }
+  new_opcode->is_extension = set && !strcmp("EXT", set);
   strcpy(new_opcode->mnemonic, mnemonic);
 
   return new_opcode;
@@ -292,11 +314,12 @@ static void opcode_create_table(void)
   char *opcode                 = NULL;
   char *mnemonic               = NULL;
   char *format                 = NULL;
+  char *set                    = NULL;
 
   fp = fopen("opcode.txt", "r");
   if(!fp)
   {
-    printf("opcode: cannot find 'opcode.txt' file.\n");
+    json_printf("opcode: cannot find 'opcode.txt' file.\n");
     return;
   }
 
@@ -305,8 +328,12 @@ static void opcode_create_table(void)
     opcode = strtok(instruction, " \t\n");
     mnemonic = strtok(NULL, " \t\n");
     format = strtok(NULL, " \t\n");
+    set = strtok(NULL, " \t\r\n");
 
-    struct opcode *new_opcode = opcode_create_opcode(opcode, mnemonic, format);
+    struct opcode *new_opcode = opcode_create_opcode(opcode,
+                                                     mnemonic,
+                                                     format,
+                                                     set);
     opcode_insert_opcode(new_opcode);
   }
 
@@ -319,24 +346,24 @@ static bool opcode_execute_opcode(const char *cmd,
 {
   if(0 == argc)
   {
-    printf("opcode: one argument is required\n");
+    json_printf("opcode: one argument is required\n");
     return false;
   }
   if(1 < argc)
   {
-    printf("opcode: too many arguments\n");
+    json_printf("opcode: too many arguments\n");
     return false;
   }
 
   struct opcode *opcode = opcode_search_opcode(argv[0]);
   if(opcode)
   {
-    printf("opcode is %X\n", opcode->opcode);
+    json_printf("opcode is %X\n", opcode->opcode);
     return true;
   }
   else
   {
-    printf("opcode: cannot find mnemonic %s\n", argv[0]);
+    json_printf("opcode: cannot find mnemonic %s\n", argv[0]);
     return false;
   }
 }
@@ -347,22 +374,26 @@ static bool opcode_execute_opcodelist(const char *cmd,
 {
   if(0 < argc)
   {
-    printf("opcodelist: too many arguments\n");
+    json_printf("opcodelist: too many arguments\n");
     return false;
   }
 
   for(int i = 0; i < OPCODE_TABLE_LEN; ++i)
   {
-    printf("%d :", i);
+    json_printf("%d :", i);
+    bool is_first = true;
     for(struct opcode *walk = _opcode_table[i]; walk; walk = walk->next)
     {
-      printf(" [%s,%X] ", walk->mnemonic, walk->opcode);
-      if(walk->next)
+      if(walk->is_extension && !_is_extension_enabled)
       {
-        printf("->");
+        continue;
       }
+
+      json_printf("%s [%s,%X] ",
+                  is_first ? "" : "->", walk->mnemonic, walk->opcode);
+      is_first = false;
     }
-    printf("\n");
+    json_printf("\n");
   }
 
   return true;
@@ -418,7 +449,10 @@ static struct opcode *opcode_search_opcode(const char *opcode)
 
   const int     key   = opcode_compute_key(opcode);
   struct opcode *walk = _opcode_table[key];
-  while(walk && strcmp(opcode, walk->mnemonic))
+  // Extension opcodes are not found unless enabled, as if they were not in
+  // the table.
+  while(walk && (strcmp(opcode, walk->mnemonic) ||
+                 (walk->is_extension && !_is_extension_enabled)))
   {
     walk = walk->next;
   }
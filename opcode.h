@@ -34,6 +34,13 @@ int opcode_get_opcode(const char *mnemonic);
  */
 void opcode_initialize(void);
 
+/**
+ * @brief  Check if extension opcodes are enabled. Extension opcodes are
+ *         marked 'EXT' in opcode.txt, and are not standard SIC/XE.
+ * @return True if enabled, false otherwise.
+ */
+bool opcode_is_extension_enabled(void);
+
 /**
  * @brief              Check if the mnemonic is opcode.
  * @param[in] mnemonic A mnemonic to be validated.
@@ -41,6 +48,14 @@ void opcode_initialize(void);
  */
 bool opcode_is_opcode(const char *mnemonic);
 
+/**
+ * @brief                Enable or disable extension opcodes. Disabled
+ *                       extension opcodes are not found by mnemonic, and are
+ *                       invalid to the debugger.
+ * @param[in] is_enabled True to enable, false to disable.
+ */
+void opcode_set_extension_enabled(const bool is_enabled);
+
 /**
  * @brief Release hash table.
  */
@@ -0,0 +1,486 @@
+/**
+ * @file  peephole.c
+ * @brief A peephole optimizer of assembly. Pass 1 decides rewrites of
+ *        instructions to cheaper equivalents, and pass 2 applies the same
+ *        rewrites by the index of the line.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "peephole.h"
+
+#include "block.h"
+#include "expression.h"
+#include "json.h"
+#include "opcode.h"
+
+/**
+ * @def   PEEPHOLE_OPERAND_LEN
+ * @brief The maximum length of a remembered operand.
+ */
+#define PEEPHOLE_OPERAND_LEN 64
+
+/**
+ * @brief Structure of rewrite elements.
+ */
+struct peephole_rewrite
+{
+  /** A pointer to the next rewrite element, in order of lines. */
+  struct peephole_rewrite *next;
+  /** An index of the line in the expanded source. */
+  int                     index;
+  /** A flag indicating whether the line is removed or not. */
+  bool                    is_removed;
+  /** A mnemonic that replaces the original. */
+  char                    mnemonic[8];
+  /** The first operand that replaces the original. */
+  char                    operand1[4];
+  /** The second operand that replaces the original. Empty if none. */
+  char                    operand2[4];
+  /** A note written to .lst file. */
+  char                    note[];
+};
+
+/**
+ * @brief Structure of registers that are loaded and stored.
+ */
+struct peephole_register
+{
+  /** A load instruction. */
+  const char *load;
+  /** A store instruction. */
+  const char *store;
+  /** A register. */
+  const char *reg;
+};
+
+/**
+ * @brief A const variable that holds registers with their loads and stores.
+ *        F and LDCH are not included, since they are not one word.
+ */
+static const struct peephole_register REGISTERS[] = {{"LDA", "STA", "A"},
+                                                     {"LDX", "STX", "X"},
+                                                     {"LDL", "STL", "L"},
+                                                     {"LDB", "STB", "B"},
+                                                     {"LDS", "STS", "S"},
+                                                     {"LDT", "STT", "T"}};
+
+/**
+ * @brief A const variable that holds the number of registers.
+ */
+static const int REGISTERS_COUNT = (int)(sizeof(REGISTERS) /
+                                         sizeof(REGISTERS[0]));
+
+/**
+ * @brief A const variable that holds the length of a word in bytes.
+ */
+static const int WORD_LEN = 3;
+
+/**
+ * @brief The immediate operand last loaded to register B by LDB on the
+ *        current straight-line path. Empty if register B is unknown. BASE
+ *        only declares what register B should hold, so it is not trusted.
+ */
+static char _base_operand[PEEPHOLE_OPERAND_LEN];
+
+/**
+ * @brief The total cycles saved by rewrites. A cycle is estimated per byte
+ *        fetched or accessed in memory.
+ */
+static int _cycles_saved = 0;
+
+/**
+ * @brief The total bytes saved by rewrites.
+ */
+static int _bytes_saved = 0;
+
+/**
+ * @brief The rewrite applied last in pass 2, from which lookups start.
+ */
+static struct peephole_rewrite *_cursor = NULL;
+
+/**
+ * @brief The first rewrite.
+ */
+static struct peephole_rewrite *_head = NULL;
+
+/**
+ * @brief A flag indicating whether rewrites are decided or not.
+ */
+static bool _is_enabled = false;
+
+/**
+ * @brief The number of rewrites.
+ */
+static int _rewrites_count = 0;
+
+/**
+ * @brief The register stored by the previous line. NULL if the previous line
+ *        is not a store.
+ */
+static const struct peephole_register *_stored_register = NULL;
+
+/**
+ * @brief The operand of the store of the previous line.
+ */
+static char _stored_operand[PEEPHOLE_OPERAND_LEN];
+
+/**
+ * @brief The last rewrite.
+ */
+static struct peephole_rewrite *_tail = NULL;
+
+/**
+ * @brief               Append a rewrite of the line.
+ * @param[in] index     An index of the line.
+ * @param[in] mnemonic  A new mnemonic. NULL if the line is removed.
+ * @param[in] operand1  A new first operand.
+ * @param[in] operand2  A new second operand. NULL if none.
+ * @param[in] bytes     The bytes saved.
+ * @param[in] cycles    The cycles saved.
+ * @param[in] note      A note written to .lst file.
+ */
+static void peephole_append(const int  index,
+                            const char *mnemonic,
+                            const char *operand1,
+                            const char *operand2,
+                            const int  bytes,
+                            const int  cycles,
+                            const char *note);
+
+/**
+ * @brief               Find the register loaded or stored by the mnemonic.
+ * @param[in] mnemonic  A mnemonic without '+'.
+ * @param[in] is_load   True to find loads, false to find stores.
+ * @return              A register if found, NULL otherwise.
+ */
+static const struct peephole_register *peephole_find_register(
+    const char *mnemonic,
+    const bool is_load);
+
+/**
+ * @brief               Check if the operand is a plain memory operand, which
+ *                      is neither immediate, indirect, nor literal.
+ * @param[in] operands  Operands of the line.
+ * @return              True if plain, false otherwise.
+ */
+static bool peephole_is_plain_memory(char *const (*operands)[]);
+
+/**
+ * @brief               Forget the register B if the line may change it, or
+ *                      if the next line does not follow it in memory.
+ * @param[in] mnemonic  A mnemonic without '+'.
+ * @param[in] operands  Operands of the line.
+ */
+static void peephole_update_base(const char *mnemonic,
+                                 char *const (*operands)[]);
+
+bool peephole_apply(const int index, char **mnemonic, char *(*operands)[])
+{
+  if(!_cursor || _cursor->index > index)
+  {
+    // Lines are given in order, so lookups restart only at a new pass.
+    _cursor = _head;
+  }
+  while(_cursor && _cursor->index < index)
+  {
+    _cursor = _cursor->next;
+  }
+
+  if(!_cursor || _cursor->index != index)
+  {
+    return true;
+  }
+  if(_cursor->is_removed)
+  {
+    return false;
+  }
+
+  *mnemonic      = _cursor->mnemonic;
+  (*operands)[0] = _cursor->operand1;
+  (*operands)[1] = strlen(_cursor->operand2) ? _cursor->operand2 : NULL;
+
+  return true;
+}
+
+const char *peephole_get_note(const int index)
+{
+  struct peephole_rewrite *walk = _cursor && _cursor->index <= index ?
+                                  _cursor :
+                                  _head;
+  while(walk && walk->index < index)
+  {
+    walk = walk->next;
+  }
+
+  return walk && walk->index == index ? walk->note : NULL;
+}
+
+void peephole_initialize(void)
+{
+  _head            = NULL;
+  _tail            = NULL;
+  _cursor          = NULL;
+  _is_enabled      = false;
+  _rewrites_count  = 0;
+  _bytes_saved     = 0;
+  _cycles_saved    = 0;
+  _stored_register = NULL;
+  memset(_stored_operand, 0, sizeof(_stored_operand));
+  memset(_base_operand, 0, sizeof(_base_operand));
+}
+
+void peephole_new_table(const bool is_enabled)
+{
+  peephole_terminate();
+
+  _is_enabled = is_enabled;
+}
+
+bool peephole_optimize(const int  index,
+                       const char *label,
+                       char       **mnemonic,
+                       char       *(*operands)[],
+                       const int  locctr)
+{
+  if(!_is_enabled)
+  {
+    return true;
+  }
+
+  if(label)
+  {
+    // The line can be jumped to, so nothing is known about registers.
+    _stored_register = NULL;
+    _base_operand[0] = '\0';
+  }
+
+  bool       is_extended = '+' == (*mnemonic)[0];
+  const char *name       = is_extended ? &(*mnemonic)[1] : *mnemonic;
+  int        len         = is_extended ? 4 : 3;
+
+  const struct peephole_register *stored_register = _stored_register;
+  _stored_register = NULL;
+
+  if(!opcode_is_opcode(name) || 3 != opcode_get_format(name))
+  {
+    peephole_update_base(name, operands);
+    return true;
+  }
+
+  const struct peephole_register *load = peephole_find_register(name, true);
+  if(load && (*operands)[0] && !(*operands)[1])
+  {
+    // Redundant LDB, which loads what register B already holds.
+    if(!strcmp("B", load->reg) &&
+       _base_operand[0] &&
+       !strcmp(_base_operand, (*operands)[0]))
+    {
+      char note[PEEPHOLE_OPERAND_LEN + 32];
+      snprintf(note, sizeof(note), "removed %s %s", *mnemonic,
+                                                    (*operands)[0]);
+      peephole_append(index, NULL, NULL, NULL, len, len, note);
+      return false;
+    }
+
+    // Loading zero, which CLEAR does without memory access.
+    int                  value = 0;
+    enum expression_type type  = EXPRESSION_NONE;
+    int                  block = 0;
+    if('#' == (*operands)[0][0] &&
+       expression_evaluate(&(*operands)[0][1],
+                           locctr,
+                           block_get_current(),
+                           &value,
+                           &type,
+                           &block) &&
+       EXPRESSION_ABSOLUTE == type &&
+       0 == value)
+    {
+      char note[PEEPHOLE_OPERAND_LEN + 32];
+      snprintf(note, sizeof(note), "was %s %s", *mnemonic, (*operands)[0]);
+      peephole_append(index, "CLEAR", load->reg, NULL, len - 2, len - 2, note);
+      if(!strcmp("B", load->reg))
+      {
+        _base_operand[0] = '\0';
+      }
+      return peephole_apply(index, mnemonic, operands);
+    }
+
+    // Loading what the previous line stored, which is still in a register.
+    if(stored_register &&
+       !label &&
+       peephole_is_plain_memory(operands) &&
+       !strcmp(_stored_operand, (*operands)[0]))
+    {
+      char note[PEEPHOLE_OPERAND_LEN + 32];
+      if(!strcmp("B", load->reg))
+      {
+        _base_operand[0] = '\0';
+      }
+
+      if(stored_register == load)
+      {
+        snprintf(note, sizeof(note), "removed %s %s", *mnemonic,
+                                                      (*operands)[0]);
+        peephole_append(index, NULL, NULL, NULL, len, len + WORD_LEN, note);
+
+        // The stored register still holds the memory for the next line.
+        _stored_register = stored_register;
+        return false;
+      }
+
+      snprintf(note, sizeof(note), "was %s %s", *mnemonic, (*operands)[0]);
+      peephole_append(index,
+                      "RMO",
+                      stored_register->reg,
+                      load->reg,
+                      len - 2,
+                      len - 2 + WORD_LEN,
+                      note);
+      return peephole_apply(index, mnemonic, operands);
+    }
+
+    if(!strcmp("B", load->reg))
+    {
+      // Only immediate values are known, since memory can be changed.
+      snprintf(_base_operand, sizeof(_base_operand), "%s",
+               '#' == (*operands)[0][0] ? (*operands)[0] : "");
+    }
+    return true;
+  }
+
+  const struct peephole_register *store = peephole_find_register(name, false);
+  if(store && peephole_is_plain_memory(operands))
+  {
+    _stored_register = store;
+    snprintf(_stored_operand, sizeof(_stored_operand), "%s", (*operands)[0]);
+    return true;
+  }
+
+  peephole_update_base(name, operands);
+  return true;
+}
+
+void peephole_show_summary(void)
+{
+  if(!_is_enabled)
+  {
+    return;
+  }
+
+  json_printf("assemble: %d instructions rewritten, %d bytes and about %d cycles "
+              "saved\n", _rewrites_count, _bytes_saved, _cycles_saved);
+}
+
+void peephole_terminate(void)
+{
+  struct peephole_rewrite *walk = _head;
+  while(walk)
+  {
+    struct peephole_rewrite *del = walk;
+    walk = walk->next;
+    free(del);
+  }
+
+  peephole_initialize();
+}
+
+static void peephole_append(const int  index,
+                            const char *mnemonic,
+                            const char *operand1,
+                            const char *operand2,
+                            const int  bytes,
+                            const int  cycles,
+                            const char *note)
+{
+  struct peephole_rewrite *new_rewrite = malloc(sizeof(*new_rewrite) +
+                                                sizeof(char) *
+                                                (strlen(note) + 1));
+  memset(new_rewrite, 0, sizeof(*new_rewrite));
+  new_rewrite->index      = index;
+  new_rewrite->is_removed = !mnemonic;
+  if(mnemonic)
+  {
+    snprintf(new_rewrite->mnemonic, sizeof(new_rewrite->mnemonic), "%s",
+                                                                    mnemonic);
+    snprintf(new_rewrite->operand1, sizeof(new_rewrite->operand1), "%s",
+                                                                    operand1);
+    snprintf(new_rewrite->operand2, sizeof(new_rewrite->operand2), "%s",
+                                                                    operand2 ?
+                                                                    operand2 :
+                                                                    "");
+  }
+  strcpy(new_rewrite->note, note);
+
+  if(!_head)
+  {
+    _head = new_rewrite;
+  }
+  else
+  {
+    _tail->next = new_rewrite;
+  }
+  _tail = new_rewrite;
+
+  ++_rewrites_count;
+  _bytes_saved  += bytes;
+  _cycles_saved += cycles;
+}
+
+static const struct peephole_register *peephole_find_register(
+    const char *mnemonic,
+    const bool is_load)
+{
+  for(int i = 0; i < REGISTERS_COUNT; ++i)
+  {
+    if(!strcmp(is_load ? REGISTERS[i].load : REGISTERS[i].store, mnemonic))
+    {
+      return &REGISTERS[i];
+    }
+  }
+
+  return NULL;
+}
+
+static bool peephole_is_plain_memory(char *const (*operands)[])
+{
+  const char *operand = (*operands)[0];
+
+  return operand &&
+         !(*operands)[1] &&
+         '#' != operand[0] &&
+         '@' != operand[0] &&
+         '=' != operand[0] &&
+         PEEPHOLE_OPERAND_LEN > strlen(operand);
+}
+
+static void peephole_update_base(const char *mnemonic,
+                                 char *const (*operands)[])
+{
+  if(!strcmp("JSUB", mnemonic))
+  {
+    // The subroutine may change register B.
+    _base_operand[0] = '\0';
+    return;
+  }
+
+  if(!strcmp("USE", mnemonic) || !strcmp("ORG", mnemonic))
+  {
+    // The next line does not follow this one in memory.
+    _base_operand[0] = '\0';
+    return;
+  }
+
+  for(int i = 0; i < 2; ++i)
+  {
+    if((*operands)[i] && !strcmp("B", (*operands)[i]))
+    {
+      // Format 2 instructions with register B may change it.
+      _base_operand[0] = '\0';
+    }
+  }
+}
@@ -0,0 +1,70 @@
+/**
+ * @file  peephole.h
+ * @brief A peephole optimizer of assembly. Pass 1 decides rewrites of
+ *        instructions to cheaper equivalents, and pass 2 applies the same
+ *        rewrites by the index of the line.
+ */
+
+#ifndef __PEEPHOLE_H__
+#define __PEEPHOLE_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief               Apply the rewrite decided for the line in pass 1.
+ * @param[in]  index    An index of the line in the expanded source.
+ * @param[out] mnemonic A mnemonic, replaced if rewritten.
+ * @param[out] operands Operands, replaced if rewritten.
+ * @return              False if the line is removed, true otherwise.
+ */
+bool peephole_apply(const int index, char **mnemonic, char *(*operands)[]);
+
+/**
+ * @brief            Return the note of the rewrite of the line, which is
+ *                   written to .lst file.
+ * @param[in] index  An index of the line in the expanded source.
+ * @return           A note if the line is rewritten, NULL otherwise.
+ */
+const char *peephole_get_note(const int index);
+
+/**
+ * @brief Initialize peephole optimizer.
+ */
+void peephole_initialize(void);
+
+/**
+ * @brief                Release the rewrites of the last assembly and start
+ *                       a new one.
+ * @param[in] is_enabled True if rewrites are decided, false otherwise.
+ */
+void peephole_new_table(const bool is_enabled);
+
+/**
+ * @brief                  Decide the rewrite of the line, and apply it.
+ *                         Decisions depend on the lines before, so lines
+ *                         are given in order. Does nothing unless enabled.
+ * @param[in]     index    An index of the line in the expanded source.
+ * @param[in]     label    A label of the line.
+ * @param[in,out] mnemonic A mnemonic, replaced if rewritten.
+ * @param[in,out] operands Operands, replaced if rewritten.
+ * @param[in]     locctr   A locctr of the line.
+ * @return                 False if the line is removed, true otherwise.
+ */
+bool peephole_optimize(const int  index,
+                       const char *label,
+                       char       **mnemonic,
+                       char       *(*operands)[],
+                       const int  locctr);
+
+/**
+ * @brief Print the number of rewrites, and bytes and cycles saved by them.
+ *        Does nothing unless enabled.
+ */
+void peephole_show_summary(void);
+
+/**
+ * @brief Release all allocated memories.
+ */
+void peephole_terminate(void);
+
+#endif
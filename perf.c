@@ -0,0 +1,345 @@
+/**
+ * @file  perf.c
+ * @brief A handler of host performance counter related commands. Measures
+ *        host cycles, instructions, branch misses, and cache misses spent
+ *        on commands.
+ */
+
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perf.h"
+
+#include "debugger.h"
+#include "json.h"
+#include "logger.h"
+#include "mainloop.h"
+
+/**
+ * @def   PERF_COUNTERS_COUNT
+ * @brief The number of host performance counters.
+ */
+#define PERF_COUNTERS_COUNT 4
+
+/**
+ * @brief Structure of a measurement of a command.
+ */
+struct perf_sample
+{
+  /** Values of counters. */
+  uint64_t           counters[PERF_COUNTERS_COUNT];
+  /** The number of guest instructions executed so far. */
+  unsigned long long guest_instructions;
+  /** A wall clock time. */
+  struct timespec    time;
+};
+
+/**
+ * @brief Hardware events of host performance counters.
+ */
+static const uint64_t PERF_EVENTS[PERF_COUNTERS_COUNT] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_BRANCH_MISSES,
+  PERF_COUNT_HW_CACHE_MISSES
+};
+
+/**
+ * @brief Names of host performance counters.
+ */
+static const char *PERF_NAMES[PERF_COUNTERS_COUNT] = {"cycles",
+                                                      "instructions",
+                                                      "branch-misses",
+                                                      "cache-misses"};
+
+/**
+ * @brief File descriptors of host performance counters. -1 if the counter
+ *        could not be opened.
+ */
+static int _counter_fds[PERF_COUNTERS_COUNT] = {-1, -1, -1, -1};
+
+/**
+ * @brief A flag indicating whether counters were tried to be opened or not.
+ */
+static bool _is_counters_opened = false;
+
+/**
+ * @brief A flag indicating whether each command is reported or not.
+ */
+static bool _is_perf_enabled = false;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief A measurement taken at the beginning of the current command.
+ */
+static struct perf_sample _begin_sample;
+
+/**
+ * @brief          Turn per-command reporting on or off.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool perf_execute_perf(const char *cmd,
+                              const int  argc,
+                              const char *argv[]);
+
+/**
+ * @brief          Execute the given command and report its cost.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool perf_execute_time(const char *cmd,
+                              const int  argc,
+                              const char *argv[]);
+
+/**
+ * @brief Open host performance counters. Counters that are not permitted
+ *        are left closed and reported as unavailable.
+ */
+static void perf_open_counters(void);
+
+/**
+ * @brief             Print the difference between two measurements.
+ * @param[in] cmd     A type of the measured command.
+ * @param[in] begin   A measurement taken before the command.
+ * @param[in] end     A measurement taken after the command.
+ */
+static void perf_report(const char               *cmd,
+                        const struct perf_sample *begin,
+                        const struct perf_sample *end);
+
+/**
+ * @brief             Read values of all counters.
+ * @param[out] sample A measurement to be filled.
+ */
+static void perf_take_sample(struct perf_sample *sample);
+
+void perf_execute(const char *cmd,
+                  const int  argc,
+                  const char *argv[])
+{
+  if(!strcmp("perf", cmd))
+  {
+    _is_command_executed = perf_execute_perf(cmd, argc, argv);
+  }
+  else if(!strcmp("time", cmd))
+  {
+    // The timed command writes its own log.
+    perf_execute_time(cmd, argc, argv);
+    _is_command_executed = false;
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void perf_begin_command(void)
+{
+  if(_is_perf_enabled)
+  {
+    perf_take_sample(&_begin_sample);
+  }
+}
+
+void perf_end_command(const char *cmd)
+{
+  if(_is_perf_enabled && cmd && strcmp("perf", cmd))
+  {
+    struct perf_sample end_sample;
+    perf_take_sample(&end_sample);
+    perf_report(cmd, &_begin_sample, &end_sample);
+  }
+}
+
+void perf_initialize(void)
+{
+  perf_terminate();
+
+  _is_perf_enabled = false;
+}
+
+void perf_terminate(void)
+{
+  for(int i = 0; i < PERF_COUNTERS_COUNT; ++i)
+  {
+    if(0 <= _counter_fds[i])
+    {
+      close(_counter_fds[i]);
+    }
+    _counter_fds[i] = -1;
+  }
+  _is_counters_opened = false;
+}
+
+static bool perf_execute_perf(const char *cmd,
+                              const int  argc,
+                              const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("perf: %s\n", _is_perf_enabled ? "on" : "off");
+    return true;
+  }
+  if(1 < argc)
+  {
+    json_printf("perf: too many arguments\n");
+    return false;
+  }
+
+  if(!strcmp("on", argv[0]))
+  {
+    perf_open_counters();
+    _is_perf_enabled = true;
+  }
+  else if(!strcmp("off", argv[0]))
+  {
+    _is_perf_enabled = false;
+  }
+  else
+  {
+    json_printf("perf: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+
+  return true;
+}
+
+static bool perf_execute_time(const char *cmd,
+                              const int  argc,
+                              const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("time: a command is required\n");
+    return false;
+  }
+  if(!strcmp("time", argv[0]))
+  {
+    json_printf("time: cannot time itself\n");
+    return false;
+  }
+
+  perf_open_counters();
+
+  struct perf_sample begin;
+  struct perf_sample end;
+  perf_take_sample(&begin);
+  mainloop_execute_command(argv[0], argc - 1, &argv[1]);
+  perf_take_sample(&end);
+
+  perf_report(argv[0], &begin, &end);
+
+  return true;
+}
+
+static void perf_open_counters(void)
+{
+  if(_is_counters_opened)
+  {
+    return;
+  }
+  _is_counters_opened = true;
+
+  bool is_any_failed = false;
+  for(int i = 0; i < PERF_COUNTERS_COUNT; ++i)
+  {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_EVENTS[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.inherit        = 1;
+
+    // Count this process on any CPU. Threads created later, such as pass 2
+    // encoders and the writer, are inherited, and their counts are added
+    // when they are joined.
+    _counter_fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if(0 > _counter_fds[i])
+    {
+      is_any_failed = true;
+    }
+  }
+
+  if(is_any_failed)
+  {
+    json_printf("perf: some hardware counters are not permitted; "
+                "they are reported as n/a\n");
+  }
+}
+
+static void perf_report(const char               *cmd,
+                        const struct perf_sample *begin,
+                        const struct perf_sample *end)
+{
+  double seconds = (end->time.tv_sec - begin->time.tv_sec) +
+                   (end->time.tv_nsec - begin->time.tv_nsec) / 1e9;
+  unsigned long long guest_instructions = end->guest_instructions -
+                                          begin->guest_instructions;
+
+  json_printf("perf: %s\n", cmd);
+  json_printf("%-14s%.6f s\n", "time", seconds);
+  for(int i = 0; i < PERF_COUNTERS_COUNT; ++i)
+  {
+    if(0 > _counter_fds[i])
+    {
+      json_printf("%-14s%s\n", PERF_NAMES[i], "n/a");
+      continue;
+    }
+
+    uint64_t count = end->counters[i] - begin->counters[i];
+    json_printf("%-14s%llu", PERF_NAMES[i], (unsigned long long)count);
+    if(guest_instructions)
+    {
+      json_printf("\t(%.2f per guest instruction)",
+               (double)count / guest_instructions);
+    }
+    json_printf("\n");
+  }
+
+  if(guest_instructions)
+  {
+    json_printf("%-14s%llu\t(%.2f ns per guest instruction)\n",
+             "guest",
+             guest_instructions,
+             seconds * 1e9 / guest_instructions);
+  }
+}
+
+static void perf_take_sample(struct perf_sample *sample)
+{
+  for(int i = 0; i < PERF_COUNTERS_COUNT; ++i)
+  {
+    sample->counters[i] = 0;
+    if(0 <= _counter_fds[i] &&
+       sizeof(sample->counters[i]) != read(_counter_fds[i],
+                                           &sample->counters[i],
+                                           sizeof(sample->counters[i])))
+    {
+      sample->counters[i] = 0;
+    }
+  }
+  sample->guest_instructions = debugger_get_executed_count();
+
+  clock_gettime(CLOCK_MONOTONIC, &sample->time);
+}
@@ -0,0 +1,43 @@
+/**
+ * @file  perf.h
+ * @brief A handler of host performance counter related commands. Measures
+ *        host cycles, instructions, branch misses, and cache misses spent
+ *        on commands.
+ */
+
+#ifndef __PERF_H__
+#define __PERF_H__
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void perf_execute(const char *cmd,
+                  const int  argc,
+                  const char *argv[]);
+
+/**
+ * @brief Start measuring a command if per-command reporting is on.
+ */
+void perf_begin_command(void);
+
+/**
+ * @brief         Finish measuring a command and report its cost if
+ *                per-command reporting is on.
+ * @param[in] cmd A type of the measured command.
+ */
+void perf_end_command(const char *cmd);
+
+/**
+ * @brief Initialize performance counters.
+ */
+void perf_initialize(void);
+
+/**
+ * @brief Close performance counters.
+ */
+void perf_terminate(void);
+
+#endif
@@ -0,0 +1,436 @@
+/**
+ * @file  replay.c
+ * @brief A handler of record and replay related commands. Records results
+ *        of devices with the instruction count in a binary log, and feeds
+ *        them back in a later run, so that the run is reproduced.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "replay.h"
+
+#include "debugger.h"
+#include "json.h"
+#include "logger.h"
+
+/**
+ * @def   REPLAY_BUFFER_LEN
+ * @brief The length of buffer of the log file.
+ */
+#define REPLAY_BUFFER_LEN 0x10000
+
+/**
+ * @brief Structure of an event of the log.
+ */
+struct replay_record
+{
+  /** The number of instructions executed before the event, since record
+   *  was turned on. */
+  unsigned long long count;
+  /** A kind of the event. */
+  int                event;
+  /** A device number. */
+  int                device;
+  /** A result of the event. */
+  unsigned char      value;
+};
+
+/**
+ * @brief A magic number at the start of a log.
+ */
+static const char LOG_MAGIC[] = "SICREC1";
+
+/**
+ * @brief A const variable that holds the length of a path of an open file.
+ */
+static const int PATH_LEN = 0x20;
+
+/**
+ * @brief The number of instructions executed before record or replay was
+ *        turned on. Counts of events are relative to it.
+ */
+static unsigned long long _base_count = 0;
+
+/**
+ * @brief A buffer of the log file.
+ */
+static char _buffer[REPLAY_BUFFER_LEN];
+
+/**
+ * @brief The number of events written or replayed.
+ */
+static unsigned long long _event_count = 0;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief A flag indicating whether the log is being written or not.
+ */
+static bool _is_recording = false;
+
+/**
+ * @brief A flag indicating whether the log is being replayed or not.
+ */
+static bool _is_replaying = false;
+
+/**
+ * @brief The count of the last event. Counts are written as the difference
+ *        from the last one.
+ */
+static unsigned long long _last_count = 0;
+
+/**
+ * @brief A log file. NULL if record and replay are off.
+ */
+static FILE *_log_file = NULL;
+
+/**
+ * @brief The next event of the log to be replayed.
+ */
+static struct replay_record _next;
+
+/**
+ * @brief          Turn record on or off.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool replay_execute_record(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[]);
+
+/**
+ * @brief          Turn replay on or off.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool replay_execute_replay(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[]);
+
+/**
+ * @brief  Return the number of instructions executed since record or replay
+ *         was turned on.
+ * @return An instruction count.
+ */
+static unsigned long long replay_get_count(void);
+
+/**
+ * @brief           Read a variable-length count of the log. Each byte has
+ *                  7 bits of the count from the lowest, and its highest bit
+ *                  is set if more bytes follow.
+ * @param[out] count A count read.
+ * @return           True on success, false at the end of the log.
+ */
+static bool replay_read_count(unsigned long long *count);
+
+/**
+ * @brief  Read the next event of the log.
+ * @return True on success, false at the end of the log.
+ */
+static bool replay_read_next(void);
+
+/**
+ * @brief           Write a variable-length count to the log.
+ * @param[in] count A count to be written.
+ */
+static void replay_write_count(unsigned long long count);
+
+void replay_detach(void)
+{
+  // The log is left open but not used, since closing it would flush or seek
+  // the file shared with the parent.
+  if(_is_replaying)
+  {
+    // Open the file again by its descriptor, which gives it its own offset.
+    const long offset = ftell(_log_file);
+    char       path[PATH_LEN];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fileno(_log_file));
+    _log_file = fopen(path, "rb");
+    if(_log_file && 0 == fseek(_log_file, offset, SEEK_SET))
+    {
+      return;
+    }
+    if(_log_file)
+    {
+      fclose(_log_file);
+    }
+  }
+
+  _log_file     = NULL;
+  _is_recording = false;
+  _is_replaying = false;
+}
+
+void replay_execute(const char *cmd,
+                    const int  argc,
+                    const char *argv[])
+{
+  if(!strcmp("record", cmd))
+  {
+    _is_command_executed = replay_execute_record(cmd, argc, argv);
+  }
+  else if(!strcmp("replay", cmd))
+  {
+    _is_command_executed = replay_execute_replay(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void replay_initialize(void)
+{
+  _log_file     = NULL;
+  _is_recording = false;
+  _is_replaying = false;
+}
+
+void replay_log(const enum replay_event event,
+                const int               device,
+                const unsigned char     value)
+{
+  if(!_is_recording)
+  {
+    return;
+  }
+
+  // An event takes 4 bytes mostly, since events are a few instructions
+  // apart.
+  const unsigned long long count = replay_get_count();
+  replay_write_count(count - _last_count);
+  fputc(event, _log_file);
+  fputc(device, _log_file);
+  fputc(value, _log_file);
+  _last_count = count;
+  ++_event_count;
+}
+
+bool replay_take(const enum replay_event event,
+                 const int               device,
+                 unsigned char           *value)
+{
+  if(!_is_replaying)
+  {
+    return false;
+  }
+
+  const unsigned long long count = replay_get_count();
+  if(count != _next.count || event != _next.event || device != _next.device)
+  {
+    json_printf("replay: diverged from the log at instruction %llu\n", count);
+    replay_terminate();
+    return false;
+  }
+
+  *value = _next.value;
+  ++_event_count;
+  if(!replay_read_next())
+  {
+    json_printf("replay: all %llu events are replayed\n", _event_count);
+    replay_terminate();
+  }
+
+  return true;
+}
+
+void replay_terminate(void)
+{
+  if(_log_file)
+  {
+    fclose(_log_file);
+  }
+
+  _log_file     = NULL;
+  _is_recording = false;
+  _is_replaying = false;
+}
+
+static bool replay_execute_record(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("record: %s\n", _is_recording ? "on" : "off");
+    return true;
+  }
+  if(1 < argc)
+  {
+    json_printf("record: too many arguments\n");
+    return false;
+  }
+
+  if(!strcmp("off", argv[0]))
+  {
+    if(!_is_recording)
+    {
+      json_printf("record: record is not on\n");
+      return false;
+    }
+
+    json_printf("record: %llu events in %ld bytes\n",
+                _event_count,
+                ftell(_log_file));
+    replay_terminate();
+    return true;
+  }
+  if(_is_replaying)
+  {
+    json_printf("record: replay is on\n");
+    return false;
+  }
+
+  replay_terminate();
+  _log_file = fopen(argv[0], "wb");
+  if(!_log_file)
+  {
+    json_printf("record: cannot create '%s' file\n", argv[0]);
+    return false;
+  }
+  setvbuf(_log_file, _buffer, _IOFBF, sizeof(_buffer));
+  fwrite(LOG_MAGIC, 1, sizeof(LOG_MAGIC), _log_file);
+
+  _base_count   = debugger_get_executed_count();
+  _last_count   = 0;
+  _event_count  = 0;
+  _is_recording = true;
+
+  return true;
+}
+
+static bool replay_execute_replay(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("replay: %s\n", _is_replaying ? "on" : "off");
+    return true;
+  }
+  if(1 < argc)
+  {
+    json_printf("replay: too many arguments\n");
+    return false;
+  }
+
+  if(!strcmp("off", argv[0]))
+  {
+    if(!_is_replaying)
+    {
+      json_printf("replay: replay is not on\n");
+      return false;
+    }
+
+    json_printf("replay: %llu events are replayed\n", _event_count);
+    replay_terminate();
+    return true;
+  }
+  if(_is_recording)
+  {
+    json_printf("replay: record is on\n");
+    return false;
+  }
+
+  replay_terminate();
+  _log_file = fopen(argv[0], "rb");
+  if(!_log_file)
+  {
+    json_printf("replay: there is no such file '%s'\n", argv[0]);
+    return false;
+  }
+  setvbuf(_log_file, _buffer, _IOFBF, sizeof(_buffer));
+
+  char magic[sizeof(LOG_MAGIC)];
+  if(sizeof(magic) != fread(magic, 1, sizeof(magic), _log_file) ||
+     memcmp(LOG_MAGIC, magic, sizeof(magic)))
+  {
+    json_printf("replay: '%s' is not a log\n", argv[0]);
+    replay_terminate();
+    return false;
+  }
+
+  _base_count   = debugger_get_executed_count();
+  _last_count   = 0;
+  _event_count  = 0;
+  if(!replay_read_next())
+  {
+    json_printf("replay: '%s' has no events\n", argv[0]);
+    replay_terminate();
+    return false;
+  }
+  _is_replaying = true;
+
+  return true;
+}
+
+static unsigned long long replay_get_count(void)
+{
+  return debugger_get_executed_count() - _base_count;
+}
+
+static bool replay_read_count(unsigned long long *count)
+{
+  *count = 0;
+  for(int shift = 0; ; shift += 7)
+  {
+    const int byte = fgetc(_log_file);
+    if(EOF == byte)
+    {
+      return false;
+    }
+
+    *count |= (unsigned long long)(byte & 0x7F) << shift;
+    if(!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+}
+
+static bool replay_read_next(void)
+{
+  unsigned long long delta = 0;
+  if(!replay_read_count(&delta))
+  {
+    return false;
+  }
+
+  const int event  = fgetc(_log_file);
+  const int device = fgetc(_log_file);
+  const int value  = fgetc(_log_file);
+  if(EOF == event || EOF == device || EOF == value)
+  {
+    return false;
+  }
+
+  _last_count  += delta;
+  _next.count  = _last_count;
+  _next.event  = event;
+  _next.device = device;
+  _next.value  = value;
+
+  return true;
+}
+
+static void replay_write_count(unsigned long long count)
+{
+  while(0x80 <= count)
+  {
+    fputc((count & 0x7F) | 0x80, _log_file);
+    count >>= 7;
+  }
+  fputc(count, _log_file);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file  replay.h
+ * @brief A handler of record and replay related commands. Records results
+ *        of devices with the instruction count in a binary log, and feeds
+ *        them back in a later run, so that the run is reproduced.
+ */
+
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+/**
+ * @brief An enum of kinds of recorded events.
+ */
+enum replay_event
+{
+  REPLAY_READ,
+  REPLAY_TEST,
+};
+
+/**
+ * @brief Give replay its own log file after fork(), at the same position,
+ *        so that a child process does not move the log of its parent. Record
+ *        is turned off in the child.
+ */
+void replay_detach(void);
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void replay_execute(const char *cmd,
+                    const int  argc,
+                    const char *argv[]);
+
+/**
+ * @brief Initialize record and replay.
+ */
+void replay_initialize(void);
+
+/**
+ * @brief            Write an event to the log. Does nothing if record is
+ *                   off.
+ * @param[in] event  A kind of the event.
+ * @param[in] device A device number.
+ * @param[in] value  A result of the event.
+ */
+void replay_log(const enum replay_event event,
+                const int               device,
+                const unsigned char     value);
+
+/**
+ * @brief             Take the next event of the log, if replay is on.
+ *                    Replay is turned off if the event is not the next one
+ *                    of the log.
+ * @param[in]  event  A kind of the event.
+ * @param[in]  device A device number.
+ * @param[out] value  A recorded result of the event.
+ * @return            True if the event is replayed, false otherwise.
+ */
+bool replay_take(const enum replay_event event,
+                 const int               device,
+                 unsigned char           *value);
+
+/**
+ * @brief Close the log, and turn record and replay off.
+ */
+void replay_terminate(void);
+
+#endif
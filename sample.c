@@ -0,0 +1,344 @@
+/**
+ * @file  sample.c
+ * @brief A handler of sample related commands. Runs a program fast, with
+ *        short windows run in detail by the cache model, and estimates
+ *        statistics of the whole run from the windows.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample.h"
+
+#include "cache.h"
+#include "debugger.h"
+#include "json.h"
+#include "logger.h"
+
+/**
+ * @brief Structure of sums of a statistic over windows, to estimate its mean
+ *        and variance.
+ */
+struct sample_sum
+{
+  /** A sum of the statistic. */
+  double sum;
+  /** A sum of squares of the statistic. */
+  double square_sum;
+};
+
+/**
+ * @brief Equals to 10.
+ */
+static const int DECIMAL = 10;
+
+/**
+ * @brief The quantile of the normal distribution for a 95% confidence
+ *        interval.
+ */
+static const double Z_95 = 1.96;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief The number of instructions of a period. 0 if sampling is off.
+ */
+static int _period = 0;
+
+/**
+ * @brief The number of instructions run in detail before a window, whose
+ *        counts are discarded.
+ */
+static int _warmup = 0;
+
+/**
+ * @brief The number of instructions of a window.
+ */
+static int _window = 0;
+
+/**
+ * @brief               Add a statistic of a window to the sums.
+ * @param[in,out] sum   Sums of the statistic.
+ * @param[in]     value A statistic of a window.
+ */
+static void sample_add(struct sample_sum *sum, const double value);
+
+/**
+ * @brief                  Estimate the total of a statistic over the run,
+ *                         from its means per instruction of the windows.
+ * @param[in]  sum          Sums of the statistic per instruction.
+ * @param[in]  window_count The number of windows.
+ * @param[in]  count        The number of instructions of the run.
+ * @param[out] margin       A margin of the 95% confidence interval, or -1 if
+ *                          there are too few windows.
+ * @return                  An estimated total.
+ */
+static double sample_estimate(const struct sample_sum *sum,
+                              const int               window_count,
+                              const unsigned long long count,
+                              double                  *margin);
+
+/**
+ * @brief          Turn sampling on or off, or show its settings.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool sample_execute_sample(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[]);
+
+/**
+ * @brief           Parse a count of instructions.
+ * @param[in]  arg   An argument to be parsed.
+ * @param[out] count A parsed count.
+ * @return           True on success, false otherwise.
+ */
+static bool sample_parse_count(const char *arg, int *count);
+
+void sample_execute(const char *cmd,
+                    const int  argc,
+                    const char *argv[])
+{
+  if(!strcmp("sample", cmd))
+  {
+    _is_command_executed = sample_execute_sample(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void sample_initialize(void)
+{
+  _period = 0;
+  _window = 0;
+  _warmup = 0;
+}
+
+bool sample_is_enabled(void)
+{
+  return 0 != _period;
+}
+
+bool sample_run(void)
+{
+  const unsigned long long start_count = debugger_get_executed_count();
+  const int                fast_count  = _period - _warmup - _window;
+
+  // The model is on again after the run, if it is on for whole runs.
+  const bool was_enabled = cache_set_enabled(false);
+
+  struct sample_sum cycles       = {0,};
+  struct sample_sum misses       = {0,};
+  int               window_count = 0;
+  bool              is_success   = true;
+  bool              is_stopped   = false;
+  while(is_success && !is_stopped)
+  {
+    // Lines are stale after a fast-forward, so the cache is warmed up first.
+    cache_set_enabled(false);
+    is_success = debugger_run_slice(fast_count, &is_stopped);
+    if(!is_success || is_stopped)
+    {
+      break;
+    }
+    cache_set_enabled(true);
+    is_success = debugger_run_slice(_warmup, &is_stopped);
+    if(!is_success || is_stopped)
+    {
+      break;
+    }
+
+    cache_reset_counters();
+    const unsigned long long window_start = debugger_get_executed_count();
+    is_success = debugger_run_slice(_window, &is_stopped);
+
+    const unsigned long long count = debugger_get_executed_count() -
+                                     window_start;
+    if(0 < count)
+    {
+      sample_add(&cycles, (double)cache_get_cycles() / count);
+      sample_add(&misses, (double)cache_get_misses() / count);
+      ++window_count;
+    }
+  }
+  cache_set_enabled(was_enabled);
+
+  const unsigned long long count = debugger_get_executed_count() - start_count;
+  double       cycles_margin = 0;
+  double       misses_margin = 0;
+  const double cycles_total  = sample_estimate(&cycles, window_count, count,
+                                               &cycles_margin);
+  const double misses_total  = sample_estimate(&misses, window_count, count,
+                                               &misses_margin);
+
+  if(json_is_enabled())
+  {
+    json_begin_object("sample");
+    json_write_integer("instructions", count);
+    json_write_integer("windows", window_count);
+    json_write_integer("cycles", llround(cycles_total));
+    json_write_integer("cycles_margin", llround(cycles_margin));
+    json_write_integer("misses", llround(misses_total));
+    json_write_integer("misses_margin", llround(misses_margin));
+    json_end_object();
+    return is_success;
+  }
+
+  json_printf("Instructions\t%llu\n", count);
+  json_printf("Windows\t\t%d of %d instructions, %.1f%% in detail\n",
+              window_count,
+              _window,
+              count ? 100.0 * window_count * (_warmup + _window) / count : 0.0);
+  if(0 == window_count)
+  {
+    json_printf("sample: the run is shorter than a period\n");
+    return is_success;
+  }
+  if(0 > cycles_margin)
+  {
+    json_printf("Cycles\t\t%.0f\n", cycles_total);
+    json_printf("Cache misses\t%.0f\n", misses_total);
+    json_printf("sample: at least two windows are needed for confidence\n");
+    return is_success;
+  }
+  json_printf("Cycles\t\t%.0f +- %.0f (95%% confidence)\n",
+              cycles_total,
+              cycles_margin);
+  json_printf("Cache misses\t%.0f +- %.0f (95%% confidence)\n",
+              misses_total,
+              misses_margin);
+
+  return is_success;
+}
+
+static void sample_add(struct sample_sum *sum, const double value)
+{
+  sum->sum        += value;
+  sum->square_sum += value * value;
+}
+
+static double sample_estimate(const struct sample_sum *sum,
+                              const int               window_count,
+                              const unsigned long long count,
+                              double                  *margin)
+{
+  *margin = -1;
+  if(0 == window_count)
+  {
+    return 0;
+  }
+
+  const double mean = sum->sum / window_count;
+  if(1 < window_count)
+  {
+    // A sample variance, which is not negative but for rounding.
+    double variance = (sum->square_sum - window_count * mean * mean) /
+                      (window_count - 1);
+    if(0 > variance)
+    {
+      variance = 0;
+    }
+    *margin = Z_95 * sqrt(variance / window_count) * count;
+  }
+
+  return mean * count;
+}
+
+static bool sample_execute_sample(const char *cmd,
+                                  const int  argc,
+                                  const char *argv[])
+{
+  if(0 == argc)
+  {
+    if(!sample_is_enabled())
+    {
+      json_printf("sample: off\n");
+    }
+    else
+    {
+      json_printf("sample: a window of %d instructions every %d, warmed up by %d\n",
+                  _window,
+                  _period,
+                  _warmup);
+    }
+    return true;
+  }
+
+  if(!strcmp("off", argv[0]))
+  {
+    if(1 < argc)
+    {
+      json_printf("sample: too many arguments\n");
+      return false;
+    }
+
+    sample_initialize();
+    return true;
+  }
+
+  if(2 > argc)
+  {
+    json_printf("sample: a period and a window are required\n");
+    return false;
+  }
+  if(3 < argc)
+  {
+    json_printf("sample: too many arguments\n");
+    return false;
+  }
+
+  int period = 0;
+  int window = 0;
+  int warmup = 0;
+  if(!sample_parse_count(argv[0], &period) ||
+     !sample_parse_count(argv[1], &window) ||
+     (3 == argc && !sample_parse_count(argv[2], &warmup)))
+  {
+    return false;
+  }
+  if(0 == period || 0 == window)
+  {
+    json_printf("sample: a period and a window must not be 0\n");
+    return false;
+  }
+  if(period < (long)window + warmup)
+  {
+    json_printf("sample: a window and a warmup are longer than a period\n");
+    return false;
+  }
+
+  _period = period;
+  _window = window;
+  _warmup = warmup;
+
+  return true;
+}
+
+static bool sample_parse_count(const char *arg, int *count)
+{
+  char       *endptr = NULL;
+  const long value   = strtol(arg, &endptr, DECIMAL);
+  if('\0' != *endptr || 0 > value || INT_MAX < value)
+  {
+    json_printf("sample: count '%s' is invalid\n", arg);
+    return false;
+  }
+  *count = value;
+
+  return true;
+}
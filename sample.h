@@ -0,0 +1,40 @@
+/**
+ * @file  sample.h
+ * @brief A handler of sample related commands. Runs a program fast, with
+ *        short windows run in detail by the cache model, and estimates
+ *        statistics of the whole run from the windows.
+ */
+
+#ifndef __SAMPLE_H__
+#define __SAMPLE_H__
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void sample_execute(const char *cmd,
+                    const int  argc,
+                    const char *argv[]);
+
+/**
+ * @brief Initialize sample. Sampling is off.
+ */
+void sample_initialize(void);
+
+/**
+ * @brief  Check if sampling is on.
+ * @return True if on, false otherwise.
+ */
+bool sample_is_enabled(void);
+
+/**
+ * @brief  Run the loaded program as `run`, but in periods of a fast-forward,
+ *         a warmup, and a detailed window, and show estimates of cycles and
+ *         cache misses of the run.
+ * @return True on success, false otherwise.
+ */
+bool sample_run(void);
+
+#endif
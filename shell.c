@@ -12,6 +12,7 @@
 
 #include "logger.h"
 
+#include "json.h"
 #include "mainloop.h"
 
 /**
@@ -89,7 +90,7 @@ void shell_execute(const char *cmd, const int argc, const char *argv[])
   }
   else
   {
-    printf("%s: command not found\n", cmd);
+    json_printf("%s: command not found\n", cmd);
   }
 
   if(_is_command_executed)
@@ -102,7 +103,7 @@ static bool shell_execute_dir(const char *cmd, const int argc, const char *argv[
 {
   if(0 < argc)
   {
-    printf("dir: too many arguments\n");
+    json_printf("dir: too many arguments\n");
     return false;
   }
 
@@ -118,23 +119,23 @@ static bool shell_execute_dir(const char *cmd, const int argc, const char *argv[
         continue;
       }
 
-      printf("%s", ent->d_name);
+      json_printf("%s", ent->d_name);
       if(DT_DIR == ent->d_type)
       {
         // This entry is a directory.
-        printf("/");
+        json_printf("/");
       }
       if(DT_REG == ent->d_type && (0 == access(ent->d_name, X_OK)))
       {
         // This entry is executable file.
-        printf("*");
+        json_printf("*");
       }
-      printf("\n");
+      json_printf("\n");
     }
   }
   else
   {
-    printf("dir: cannot open directory\n");
+    json_printf("dir: cannot open directory\n");
     return false;
   }
   closedir(dir);
@@ -146,29 +147,52 @@ static bool shell_execute_help(const char *cmd, const int argc, const char *argv
 {
   if(0 < argc)
   {
-    printf("help: too many arguments\n");
+    json_printf("help: too many arguments\n");
     return false;
   }
 
-  printf("h[elp]\n");
-  printf("d[ir]\n");
-  printf("q[uit]\n");
-  printf("hi[story]\n");
-  printf("du[mp] [start, end]\n");
-  printf("e[dit] address, value\n");
-  printf("f[ill] start, end, value\n");
-  printf("reset\n");
-  printf("opcode mnemonic\n");
-  printf("opcodelist\n");
-  printf("assemble filename\n");
-  printf("type filename\n");
-  printf("symbol\n");
-  printf("progaddr address\n");
-  printf("loader object filename1 object filename2 ...\n");
-  printf("bp address\n");
-  printf("bp clear\n");
-  printf("bp\n");
-  printf("run\n");
+  json_printf("h[elp]\n");
+  json_printf("d[ir]\n");
+  json_printf("q[uit]\n");
+  json_printf("hi[story]\n");
+  json_printf("du[mp] [start, end]\n");
+  json_printf("e[dit] address, value\n");
+  json_printf("f[ill] start, end, value\n");
+  json_printf("reset\n");
+  json_printf("opcode mnemonic\n");
+  json_printf("opcodelist\n");
+  json_printf("assemble [-O] [-nolst] filename\n");
+  json_printf("type filename\n");
+  json_printf("symbol\n");
+  json_printf("progaddr address\n");
+  json_printf("protect [start, end flags]\n");
+  json_printf("loader [-lazy] object filename1 object filename2 ...\n");
+  json_printf("loadstats\n");
+  json_printf("relocate address\n");
+  json_printf("bp address\n");
+  json_printf("bp filename:line\n");
+  json_printf("bp clear\n");
+  json_printf("bp\n");
+  json_printf("run\n");
+  json_printf("step\n");
+  json_printf("list [filename:line]\n");
+  json_printf("coverage [on|off|clear]\n");
+  json_printf("coverage save|merge filename\n");
+  json_printf("coverage report filename [address]\n");
+  json_printf("time command [arguments]\n");
+  json_printf("perf [on|off]\n");
+  json_printf("trace-timeline on filename [guest]\n");
+  json_printf("trace-timeline off\n");
+  json_printf("format [json|text]\n");
+  json_printf("watch-build filename [address]\n");
+  json_printf("record filename|off\n");
+  json_printf("replay filename|off\n");
+  json_printf("analyze interval\n");
+  json_printf("sample period, window [, warmup]|off\n");
+  json_printf("cache [on|off]\n");
+  json_printf("heatmap [on interval|off|save filename]\n");
+  json_printf("memexport filename start, end [ihex|srec]\n");
+  json_printf("memimport filename\n");
 
   return true;
 }
@@ -177,13 +201,13 @@ static bool shell_execute_history(const char *cmd, const int argc, const char *a
 {
   if(0 < argc)
   {
-    printf("history: too many arguments\n");
+    json_printf("history: too many arguments\n");
     return false;
   }
 
   const int log_count = logger_view_log();
-  printf("%d\t", log_count + 1);
-  printf("%s\n", cmd); // Current execution is considered successful.
+  json_printf("%d\t", log_count + 1);
+  json_printf("%s\n", cmd); // Current execution is considered successful.
 
   return true;
 }
@@ -192,21 +216,21 @@ static bool shell_execute_type(const char *cmd, const int argc, const char *argv
 {
   if(1 != argc)
   {
-    printf("type: one argument is required\n");
+    json_printf("type: one argument is required\n");
     return false;
   }
 
   FILE *fp = fopen(argv[0], "r");
   if(!fp)
   {
-    printf("type: there is no such file '%s'\n", argv[0]);
+    json_printf("type: there is no such file '%s'\n", argv[0]);
     return false;
   }
 
   char buffer[BUFFER_LEN];
   while(fgets(buffer, BUFFER_LEN, fp))
   {
-    printf("%s", buffer);
+    json_printf("%s", buffer);
   }
 
   fclose(fp);
@@ -218,7 +242,7 @@ static bool shell_execute_quit(const char *cmd, const int argc, const char *argv
 {
   if(0 < argc)
   {
-    printf("quit: too many arguments\n");
+    json_printf("quit: too many arguments\n");
     return false;
   }
 
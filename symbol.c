@@ -10,6 +10,8 @@
 
 #include "symbol.h"
 
+#include "json.h"
+
 /**
  * @brief Structure of symbol elements.
  */
@@ -19,6 +21,8 @@ struct symbol
   struct symbol *next;
   /** A locctr value. */
   int           locctr;
+  /** A program block. SYMBOL_ABSOLUTE_BLOCK if the symbol is absolute. */
+  int           block;
   /** A symbol string. */
   char          symbol[];
 };
@@ -103,6 +107,31 @@ static void symbol_release_saved_table(void);
  */
 static void symbol_release_working_table(void);
 
+int symbol_get_block(const char *symbol)
+{
+  if(!_working_symbol_table || !symbol)
+  {
+    return SYMBOL_ABSOLUTE_BLOCK;
+  }
+
+  for(int i = 0; i < SYMBOL_TABLE_LEN; ++i)
+  {
+    struct symbol *walk = _working_symbol_table[i];
+    while(walk)
+    {
+      if(!strcmp(symbol, walk->symbol))
+      {
+        return walk->block;
+      }
+
+      walk = walk->next;
+    }
+  }
+
+  // Registers are absolute.
+  return SYMBOL_ABSOLUTE_BLOCK;
+}
+
 int symbol_get_locctr(const char *symbol)
 {
   if(!symbol)
@@ -144,17 +173,19 @@ void symbol_initialize(void)
   _working_symbol_table = NULL;
 }
 
-bool symbol_insert_symbol(const char *symbol, const int locctr)
+bool symbol_insert_symbol(const char *symbol,
+                          const int  locctr,
+                          const int  block)
 {
   if(!_working_symbol_table)
   {
-    printf("symbol: symbol table does not exist\n");
+    json_printf("symbol: symbol table does not exist\n");
     return false;
   }
 
   if(symbol_is_exist(symbol))
   {
-    printf("symbol: symbol '%s' already exists\n", symbol);
+    json_printf("symbol: symbol '%s' already exists\n", symbol);
     return false;
   }
 
@@ -162,6 +193,7 @@ bool symbol_insert_symbol(const char *symbol, const int locctr)
                                      sizeof(char) * (strlen(symbol) + 1));
   new_symbol->next = NULL;
   new_symbol->locctr = locctr;
+  new_symbol->block = block;
   strcpy(new_symbol->symbol, symbol);
 
   int key = symbol[0] - 'A';
@@ -190,7 +222,7 @@ bool symbol_insert_symbol(const char *symbol, const int locctr)
       }
 
       prev->next = new_symbol;
-      new_symbol = walk;
+      new_symbol->next = walk;
     }
   }
 
@@ -201,7 +233,7 @@ bool symbol_is_exist(const char *symbol)
 {
   if(!_working_symbol_table)
   {
-    printf("symbol: symbol table does not exist\n");
+    json_printf("symbol: symbol table does not exist\n");
     return false;
   }
 
@@ -230,6 +262,30 @@ bool symbol_is_exist(const char *symbol)
   return false;
 }
 
+bool symbol_is_absolute(const char *symbol)
+{
+  if(!_working_symbol_table || !symbol)
+  {
+    return false;
+  }
+
+  for(int i = 0; i < SYMBOL_TABLE_LEN; ++i)
+  {
+    struct symbol *walk = _working_symbol_table[i];
+    while(walk)
+    {
+      if(!strcmp(symbol, walk->symbol))
+      {
+        return SYMBOL_ABSOLUTE_BLOCK == walk->block;
+      }
+
+      walk = walk->next;
+    }
+  }
+
+  return false;
+}
+
 bool symbol_is_register(const char *symbol)
 {
   if(!symbol)
@@ -259,6 +315,28 @@ void symbol_new_table(void)
          SYMBOL_TABLE_LEN * sizeof(*_working_symbol_table));
 }
 
+void symbol_relocate_block(const int block, const int address)
+{
+  if(!_working_symbol_table)
+  {
+    return;
+  }
+
+  for(int i = 0; i < SYMBOL_TABLE_LEN; ++i)
+  {
+    struct symbol *walk = _working_symbol_table[i];
+    while(walk)
+    {
+      if(block == walk->block)
+      {
+        walk->locctr += address;
+      }
+
+      walk = walk->next;
+    }
+  }
+}
+
 void symbol_save_table(void)
 {
   symbol_release_saved_table();
@@ -291,29 +369,29 @@ void symbol_show_error_msg(void)
   switch(_error->type)
   {
     case DUPLICATE_SYMBOL:
-      printf("symbol: (line %d) symbol '%s' duplicate\n",
-          _error->line,
-          _error->keyword);
+      json_printf("symbol: (line %d) symbol '%s' duplicate\n",
+               _error->line,
+               _error->keyword);
       break;
     case INVALID_OPCODE:
-      printf("symbol: (line %d) opcode '%s' is invalid\n",
-          _error->line,
-          _error->keyword);
+      json_printf("symbol: (line %d) opcode '%s' is invalid\n",
+               _error->line,
+               _error->keyword);
       break;
     case INVALID_OPERAND:
-      printf("symbol: (line %d) operand '%s' is invalid\n",
-          _error->line,
-          _error->keyword);
+      json_printf("symbol: (line %d) operand '%s' is invalid\n",
+               _error->line,
+               _error->keyword);
       break;
     case REQUIRED_ONE_OPERAND:
-      printf("symbol: (line %d) mnemonic '%s' requires one operand\n",
-          _error->line,
-          _error->keyword);
+      json_printf("symbol: (line %d) mnemonic '%s' requires one operand\n",
+               _error->line,
+               _error->keyword);
       break;
     case REQUIRED_TWO_OPERANDS:
-      printf("symbol: (line %d) mnemonic '%s' requires two operands\n",
-          _error->line,
-          _error->keyword);
+      json_printf("symbol: (line %d) mnemonic '%s' requires two operands\n",
+               _error->line,
+               _error->keyword);
       break;
     default:
       // Do nothing.
@@ -328,13 +406,30 @@ void symbol_show_table(void)
     return;
   }
 
+  if(json_is_enabled())
+  {
+    json_begin_array("symbols");
+    for(int i = 0; i < SYMBOL_TABLE_LEN; ++i)
+    {
+      for(struct symbol *walk = _saved_symbol_table[i]; walk; walk = walk->next)
+      {
+        json_begin_object(NULL);
+        json_write_string("name", walk->symbol);
+        json_write_integer("address", walk->locctr);
+        json_end_object();
+      }
+    }
+    json_end_array();
+    return;
+  }
+
   for(int i = 0; i < SYMBOL_TABLE_LEN; ++i)
   {
     struct symbol *walk = _saved_symbol_table[i];
     while(walk)
     {
-      printf("%s\t", walk->symbol);
-      printf("%04X\n", walk->locctr);
+      json_printf("%s\t", walk->symbol);
+      json_printf("%04X\n", walk->locctr);
 
       walk = walk->next;
     }
@@ -6,6 +6,12 @@
 #ifndef __SYMBOL_H__
 #define __SYMBOL_H__
 
+/**
+ * @def   SYMBOL_ABSOLUTE_BLOCK
+ * @brief The program block of absolute symbols, which are not relocated.
+ */
+#define SYMBOL_ABSOLUTE_BLOCK -1
+
 /**
  * @brief An enum of errors that can occur during assembly.
  */
@@ -19,6 +25,14 @@ enum symbol_error
   REQUIRED_TWO_OPERANDS,
 };
 
+/**
+ * @brief            Return the program block of the symbol.
+ * @param[in] symbol A symbol to be searched.
+ * @return           A program block if exists and relative,
+ *                   SYMBOL_ABSOLUTE_BLOCK otherwise.
+ */
+int symbol_get_block(const char *symbol);
+
 /**
  * @brief            Return locctr of the symbol if exists in symbol table.
  * @param[in] symbol A symbol to be searched.
@@ -34,10 +48,22 @@ void symbol_initialize(void);
 /**
  * @brief            Insert the symbol if it is not duplicate.
  * @param[in] symbol A symbol to be inserted.
- * @param[in] locctr A locctr of the symbol.
+ * @param[in] locctr A locctr of the symbol in its block, or its value if
+ *                   absolute.
+ * @param[in] block  A program block of the symbol. SYMBOL_ABSOLUTE_BLOCK if
+ *                   the symbol is an absolute value defined by EQU.
  * @return           True on success, false otherwise.
  */
-bool symbol_insert_symbol(const char *symbol, const int locctr);
+bool symbol_insert_symbol(const char *symbol,
+                          const int  locctr,
+                          const int  block);
+
+/**
+ * @brief            Check if the symbol is an absolute value.
+ * @param[in] symbol A symbol to be validated.
+ * @return           True if absolute, false if relative or not exists.
+ */
+bool symbol_is_absolute(const char *symbol);
 
 /**
  * @brief            Check if the symbol exists in symbol table or is register.
@@ -59,6 +85,14 @@ bool symbol_is_register(const char *symbol);
  */
 void symbol_new_table(void);
 
+/**
+ * @brief             Add the start address of the program block to locctrs
+ *                    of its symbols. Called once blocks are assigned.
+ * @param[in] block   A program block.
+ * @param[in] address A start address of the block.
+ */
+void symbol_relocate_block(const int block, const int address);
+
 /**
  * @brief Save current symbol table. This function should be called
  *        when assembly is successfully done.
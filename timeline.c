@@ -0,0 +1,318 @@
+/**
+ * @file  timeline.c
+ * @brief A handler of timeline related commands. Writes spans of assembler,
+ *        loader, and run phases to a Chrome trace-event JSON file.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "timeline.h"
+
+#include "json.h"
+#include "line_table.h"
+#include "logger.h"
+
+/**
+ * @def   TIMELINE_BUFFER_LEN
+ * @brief The length of buffer that events are written to before they are
+ *        written to the trace file.
+ */
+#define TIMELINE_BUFFER_LEN 0x10000
+
+/**
+ * @brief A const variable that holds the maximum length of an event.
+ */
+static const int EVENT_LEN = 0x200;
+
+/**
+ * @brief A thread id of host spans in the trace.
+ */
+static const int HOST_TID = 1;
+
+/**
+ * @brief A thread id of guest spans in the trace.
+ */
+static const int GUEST_TID = 2;
+
+/**
+ * @brief A buffer of events that are not written to the trace file yet.
+ */
+static char _buffer[TIMELINE_BUFFER_LEN];
+
+/**
+ * @brief The length of events in the buffer.
+ */
+static int _buffer_len = 0;
+
+/**
+ * @brief The number of guest spans that are not ended yet.
+ */
+static int _guest_depth = 0;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief A flag indicating whether any event is written or not. Used to
+ *        separate events by comma.
+ */
+static bool _is_event_written = false;
+
+/**
+ * @brief A flag indicating whether guest spans are traced or not.
+ */
+static bool _is_guest_enabled = false;
+
+/**
+ * @brief A time when tracing is turned on. Timestamps are relative to it.
+ */
+static struct timespec _start_time;
+
+/**
+ * @brief A trace file. NULL if tracing is off.
+ */
+static FILE *_trace_file = NULL;
+
+/**
+ * @brief          Turn tracing on or off.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool timeline_execute_trace_timeline(const char *cmd,
+                                            const int  argc,
+                                            const char *argv[]);
+
+/**
+ * @brief Write buffered events to the trace file.
+ */
+static void timeline_flush(void);
+
+/**
+ * @brief  Return microseconds elapsed since tracing was turned on.
+ * @return Elapsed microseconds.
+ */
+static double timeline_get_timestamp(void);
+
+/**
+ * @brief          Write an event to the buffer.
+ * @param[in] name A name of the span.
+ * @param[in] ph   A phase of the event. 'B' for begin and 'E' for end.
+ * @param[in] tid  A thread id of the event.
+ */
+static void timeline_write_event(const char *name,
+                                 const char ph,
+                                 const int  tid);
+
+void timeline_detach(void)
+{
+  // The file is left open, since closing it would write buffered events.
+  _trace_file       = NULL;
+  _is_event_written = false;
+  _is_guest_enabled = false;
+  _guest_depth      = 0;
+  _buffer_len       = 0;
+}
+
+void timeline_execute(const char *cmd,
+                      const int  argc,
+                      const char *argv[])
+{
+  if(!strcmp("trace-timeline", cmd))
+  {
+    _is_command_executed = timeline_execute_trace_timeline(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+void timeline_begin(const char *name)
+{
+  if(_trace_file)
+  {
+    timeline_write_event(name, 'B', HOST_TID);
+  }
+}
+
+void timeline_end(const char *name)
+{
+  if(_trace_file)
+  {
+    timeline_write_event(name, 'E', HOST_TID);
+  }
+}
+
+void timeline_enter_subroutine(const int address)
+{
+  if(!_trace_file || !_is_guest_enabled)
+  {
+    return;
+  }
+
+  char       name[EVENT_LEN];
+  const char *filename = NULL;
+  int        line      = 0;
+  if(address == line_table_find_line(address, &filename, &line))
+  {
+    snprintf(name, sizeof(name), "%X %s:%d", address, filename, line);
+  }
+  else
+  {
+    snprintf(name, sizeof(name), "%X", address);
+  }
+
+  timeline_write_event(name, 'B', GUEST_TID);
+  ++_guest_depth;
+}
+
+void timeline_initialize(void)
+{
+  timeline_terminate();
+}
+
+void timeline_leave_subroutine(void)
+{
+  if(!_trace_file || !_is_guest_enabled || 0 == _guest_depth)
+  {
+    // A return without matching call, such as the return of the program.
+    return;
+  }
+
+  timeline_write_event("", 'E', GUEST_TID);
+  --_guest_depth;
+}
+
+void timeline_terminate(void)
+{
+  if(!_trace_file)
+  {
+    return;
+  }
+
+  timeline_flush();
+  fputs("\n]\n", _trace_file);
+  fclose(_trace_file);
+
+  _trace_file       = NULL;
+  _is_event_written = false;
+  _is_guest_enabled = false;
+  _guest_depth      = 0;
+}
+
+static bool timeline_execute_trace_timeline(const char *cmd,
+                                            const int  argc,
+                                            const char *argv[])
+{
+  if(0 == argc)
+  {
+    json_printf("trace-timeline: %s\n", _trace_file ? "on" : "off");
+    return true;
+  }
+
+  if(!strcmp("off", argv[0]))
+  {
+    if(1 < argc)
+    {
+      json_printf("trace-timeline: too many arguments\n");
+      return false;
+    }
+
+    timeline_terminate();
+    return true;
+  }
+  else if(!strcmp("on", argv[0]))
+  {
+    if(2 > argc)
+    {
+      json_printf("trace-timeline: a file name is required\n");
+      return false;
+    }
+    if(3 < argc || (3 == argc && strcmp("guest", argv[2])))
+    {
+      json_printf("trace-timeline: usage: trace-timeline on file [guest]\n");
+      return false;
+    }
+
+    timeline_terminate();
+
+    _trace_file = fopen(argv[1], "w");
+    if(!_trace_file)
+    {
+      json_printf("trace-timeline: cannot create '%s' file\n", argv[1]);
+      return false;
+    }
+    fputs("[\n", _trace_file);
+
+    clock_gettime(CLOCK_MONOTONIC, &_start_time);
+    _buffer_len       = 0;
+    _is_guest_enabled = 3 == argc;
+
+    return true;
+  }
+  else
+  {
+    json_printf("trace-timeline: argument '%s' is invalid\n", argv[0]);
+    return false;
+  }
+}
+
+static void timeline_flush(void)
+{
+  fwrite(_buffer, 1, _buffer_len, _trace_file);
+  _buffer_len = 0;
+}
+
+static double timeline_get_timestamp(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (now.tv_sec - _start_time.tv_sec) * 1e6 +
+         (now.tv_nsec - _start_time.tv_nsec) / 1e3;
+}
+
+static void timeline_write_event(const char *name,
+                                 const char ph,
+                                 const int  tid)
+{
+  if(TIMELINE_BUFFER_LEN - EVENT_LEN < _buffer_len)
+  {
+    timeline_flush();
+  }
+
+  // Names are escaped since they can contain file names.
+  char escaped_name[EVENT_LEN / 2];
+  int  len = 0;
+  for(int i = 0; name[i] && len < (int)sizeof(escaped_name) - 2; ++i)
+  {
+    if('"' == name[i] || '\\' == name[i])
+    {
+      escaped_name[len++] = '\\';
+    }
+    escaped_name[len++] = name[i];
+  }
+  escaped_name[len] = '\0';
+
+  _buffer_len += snprintf(&_buffer[_buffer_len],
+                          EVENT_LEN,
+                          "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+                          "\"pid\":1,\"tid\":%d}",
+                          _is_event_written ? ",\n" : "",
+                          escaped_name,
+                          ph,
+                          timeline_get_timestamp(),
+                          tid);
+  _is_event_written = true;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file  timeline.h
+ * @brief A handler of timeline related commands. Writes spans of assembler,
+ *        loader, and run phases to a Chrome trace-event JSON file.
+ */
+
+#ifndef __TIMELINE_H__
+#define __TIMELINE_H__
+
+/**
+ * @brief Stop tracing after fork() without writing, so that a child process
+ *        does not write to the trace of its parent.
+ */
+void timeline_detach(void);
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void timeline_execute(const char *cmd,
+                      const int  argc,
+                      const char *argv[]);
+
+/**
+ * @brief          Begin a span. Does nothing if tracing is off.
+ * @param[in] name A name of the span.
+ */
+void timeline_begin(const char *name);
+
+/**
+ * @brief          End the span that was begun last. Does nothing if
+ *                 tracing is off.
+ * @param[in] name A name of the span.
+ */
+void timeline_end(const char *name);
+
+/**
+ * @brief             Begin a guest span for a subroutine call. Does nothing
+ *                    if guest tracing is off.
+ * @param[in] address A target address of the subroutine call.
+ */
+void timeline_enter_subroutine(const int address);
+
+/**
+ * @brief Initialize timeline.
+ */
+void timeline_initialize(void);
+
+/**
+ * @brief End the guest span that was begun last. Does nothing if guest
+ *        tracing is off.
+ */
+void timeline_leave_subroutine(void);
+
+/**
+ * @brief Flush and close the trace file, if open.
+ */
+void timeline_terminate(void);
+
+#endif
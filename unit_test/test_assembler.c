@@ -0,0 +1,205 @@
+/**
+ * @file  test_assembler.c
+ * @brief Test functions for assembler.c.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../assembler.c"
+
+#include "test_assembler.h"
+
+#define SECTION_COUNT 12
+
+#define SECTION_LINE_COUNT 100
+
+#define SERIAL_CHUNK_LEN 0x100000
+
+static const char *ASM_FILENAME = "test_assembler.asm";
+
+static const char *LST_FILENAME = "test_assembler.lst";
+
+static const char *OBJ_FILENAME = "test_assembler.obj";
+
+static int _fail_count = 0;
+
+static int _pass_count = 0;
+
+static bool test_assembler_assemble(char **lst, char **obj);
+
+static void test_assembler_pass2_encode_lines(void);
+
+static char *test_assembler_read_file(const char *filename);
+
+static void test_assembler_write_program(void);
+
+void test_assembler(void)
+{
+  printf("\nStart test assembler.\n");
+
+  // opcode.txt is read from the working directory, which is the parent.
+  if(chdir(".."))
+  {
+    printf("cannot change directory to '..'\n");
+    return;
+  }
+
+  block_initialize();
+  literal_initialize();
+  macro_initialize();
+  opcode_initialize();
+  peephole_initialize();
+  symbol_initialize();
+  timeline_initialize();
+  writer_initialize();
+
+  test_assembler_pass2_encode_lines();
+
+  remove(ASM_FILENAME);
+  remove(LST_FILENAME);
+  remove(OBJ_FILENAME);
+  if(chdir("unit_test"))
+  {
+    printf("cannot change directory to 'unit_test'\n");
+  }
+
+  printf("\n");
+  printf("Pass: %d\n", _pass_count);
+  printf("Fail: %d\n", _fail_count);
+  printf("End test assembler.\n");
+}
+
+static bool test_assembler_assemble(char **lst, char **obj)
+{
+  *lst = NULL;
+  *obj = NULL;
+  if(!assembler_assemble(ASM_FILENAME, false, true))
+  {
+    return false;
+  }
+
+  *lst = test_assembler_read_file(LST_FILENAME);
+  *obj = test_assembler_read_file(OBJ_FILENAME);
+
+  return *lst && *obj;
+}
+
+static void test_assembler_pass2_encode_lines(void)
+{
+  printf("Test assembler_pass2_encode_lines() with %d lines: ",
+         SECTION_COUNT * SECTION_LINE_COUNT);
+
+  test_assembler_write_program();
+
+  char *parallel_lst = NULL;
+  char *parallel_obj = NULL;
+  char *serial_lst   = NULL;
+  char *serial_obj   = NULL;
+
+  const int chunk_len = _pass2_chunk_len;
+  bool      is_pass   = test_assembler_assemble(&parallel_lst, &parallel_obj);
+  _pass2_chunk_len = SERIAL_CHUNK_LEN;
+  is_pass = test_assembler_assemble(&serial_lst, &serial_obj) && is_pass;
+  _pass2_chunk_len = chunk_len;
+
+  if(!is_pass)
+  {
+    ++_fail_count;
+    printf("fail. it should be assembled.\n");
+  }
+  else if(strcmp(parallel_lst, serial_lst) || strcmp(parallel_obj, serial_obj))
+  {
+    ++_fail_count;
+    printf("fail. it should be the same as serial assembly.\n");
+  }
+  else
+  {
+    ++_pass_count;
+    printf("pass.\n");
+  }
+
+  free(parallel_lst);
+  free(parallel_obj);
+  free(serial_lst);
+  free(serial_obj);
+}
+
+static char *test_assembler_read_file(const char *filename)
+{
+  FILE *file = fopen(filename, "r");
+  if(!file)
+  {
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  const long len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *text = calloc(len + 1, sizeof(*text));
+  if(len != (long)fread(text, 1, len, file))
+  {
+    free(text);
+    text = NULL;
+  }
+  fclose(file);
+
+  return text;
+}
+
+static void test_assembler_write_program(void)
+{
+  FILE *file = fopen(ASM_FILENAME, "w");
+  if(!file)
+  {
+    return;
+  }
+
+  // Sections switch between two bases and none, so chunks start in each
+  // state, and a wrong base at a chunk changes displacements.
+  fprintf(file, "PAR     START   0\n");
+  fprintf(file, "FIRST  +LDB     #BUF1\n");
+  for(int i = 0; i < SECTION_COUNT; ++i)
+  {
+    const int section = i % 3;
+    if(0 == section)
+    {
+      fprintf(file, "        BASE    BUF1\n");
+    }
+    else if(1 == section)
+    {
+      fprintf(file, "        BASE    BUF2\n");
+    }
+    else
+    {
+      fprintf(file, "        NOBASE\n");
+    }
+
+    for(int j = 0; j < SECTION_LINE_COUNT; ++j)
+    {
+      if(0 == section)
+      {
+        fprintf(file, "        LDA     BUF1+%d\n", j * 3);
+      }
+      else if(1 == section)
+      {
+        fprintf(file, "        STA     BUF2+%d\n", j * 3);
+      }
+      else
+      {
+        fprintf(file, "       +LDA     BUF1+%d\n", j * 3);
+      }
+    }
+  }
+  fprintf(file, "        RSUB\n");
+  fprintf(file, "GAP     RESB    4096\n");
+  fprintf(file, "BUF1    RESB    4200\n");
+  fprintf(file, "BUF2    RESB    4200\n");
+  fprintf(file, "        END     FIRST\n");
+
+  fclose(file);
+}
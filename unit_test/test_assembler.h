@@ -0,0 +1,14 @@
+/**
+ * @file  test_assembler.h
+ * @brief Test functions for assembler.c.
+ */
+
+#ifndef __TEST_ASSEMBLER_H__
+#define __TEST_ASSEMBLER_H__
+
+/**
+ * @brief Test all functions in assembler.c
+ */
+void test_assembler(void);
+
+#endif
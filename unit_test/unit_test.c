@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 
+#include "test_assembler.h"
 #include "test_logger.h"
 #include "test_mainloop.h"
 #include "test_memspace.h"
@@ -13,6 +14,7 @@
 
 int main(void)
 {
+  test_assembler();
   test_logger();
   test_mainloop();
   test_memspace();
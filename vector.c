@@ -0,0 +1,258 @@
+/**
+ * @file  vector.c
+ * @brief Lanes of the vector extension, computed by host SIMD. Registers
+ *        are packed with 3 bytes as unsigned lanes, and memory vectors are
+ *        words of 3 bytes as signed lanes.
+ */
+
+#include <string.h>
+
+#include "vector.h"
+
+/**
+ * @def   VECTOR_LANE_COUNT
+ * @brief The number of word lanes computed at once by host SIMD.
+ */
+#define VECTOR_LANE_COUNT 4
+
+/**
+ * @brief Bytes of a register as lanes, and a lane of 0 to fill the host
+ *        vector.
+ */
+typedef unsigned char byte_lanes __attribute__((vector_size(4)));
+
+/**
+ * @brief Words of memory as lanes, sign extended.
+ */
+typedef int word_lanes __attribute__((vector_size(VECTOR_LANE_COUNT *
+                                                  sizeof(int))));
+
+/**
+ * @brief Operations on lanes of words.
+ */
+enum vector_operation
+{
+  VECTOR_ADD,
+  VECTOR_COMPARE,
+  VECTOR_MAX,
+  VECTOR_MIN,
+};
+
+/**
+ * @brief                    Apply an operation to full lanes of the target
+ *                           and the source, and store results in the target.
+ * @param[in,out] target     Words of the first operands, and the results.
+ * @param[in]     source     Words of the second operands.
+ * @param[in]     operation  An operation on lanes.
+ */
+static inline void vector_apply_lanes(unsigned char               *target,
+                                      const unsigned char         *source,
+                                      const enum vector_operation operation);
+
+/**
+ * @brief                    Apply an operation to words of the target and
+ *                           the source, and store results in the target.
+ * @param[in,out] target     Words of the first operands, and the results.
+ * @param[in]     source     Words of the second operands.
+ * @param[in]     word_count The number of words.
+ * @param[in]     operation  An operation on lanes.
+ */
+static inline void vector_apply_words(unsigned char               *target,
+                                      const unsigned char         *source,
+                                      const int                   word_count,
+                                      const enum vector_operation operation);
+
+/**
+ * @brief           Return the given value as lanes of bytes.
+ * @param[in] value A value of 3 packed bytes.
+ * @return          Lanes of bytes.
+ */
+static byte_lanes vector_load_bytes(const unsigned int value);
+
+/**
+ * @brief          Return a word of memory, sign extended.
+ * @param[in] word A word of 3 bytes.
+ * @return         A value of the word.
+ */
+static inline int vector_load_word(const unsigned char *word);
+
+/**
+ * @brief               Compute lanes of words by the given operation.
+ * @param[in] operation An operation on lanes.
+ * @param[in] a         Lanes of words.
+ * @param[in] b         Lanes of words.
+ * @return              Results. A comparison is -1 where lanes are equal,
+ *                      0 otherwise.
+ */
+static inline word_lanes vector_operate(const enum vector_operation operation,
+                                        const word_lanes            a,
+                                        const word_lanes            b);
+
+/**
+ * @brief           Return lanes of bytes as a value.
+ * @param[in] lanes Lanes of bytes.
+ * @return          A value of 3 packed bytes.
+ */
+static unsigned int vector_store_bytes(const byte_lanes lanes);
+
+/**
+ * @brief            Store the low 24 bits of the value to a word of memory.
+ * @param[out] word  A word of 3 bytes.
+ * @param[in]  value A value to be stored.
+ */
+static inline void vector_store_word(unsigned char *word, const int value);
+
+unsigned int vector_add_bytes(const unsigned int value1,
+                              const unsigned int value2)
+{
+  // Lanes wrap around, as host bytes do.
+  return vector_store_bytes(vector_load_bytes(value1) +
+                            vector_load_bytes(value2));
+}
+
+void vector_add_words(unsigned char       *target,
+                      const unsigned char *source,
+                      const int           word_count)
+{
+  vector_apply_words(target, source, word_count, VECTOR_ADD);
+}
+
+unsigned int vector_compare_bytes(const unsigned int value1,
+                                  const unsigned int value2)
+{
+  // A comparison of host vectors is -1, which is FF, where lanes are equal.
+  return vector_store_bytes((byte_lanes)(vector_load_bytes(value1) ==
+                                         vector_load_bytes(value2)));
+}
+
+void vector_compare_words(unsigned char       *target,
+                          const unsigned char *source,
+                          const int           word_count)
+{
+  vector_apply_words(target, source, word_count, VECTOR_COMPARE);
+}
+
+unsigned int vector_max_bytes(const unsigned int value1,
+                              const unsigned int value2)
+{
+  const byte_lanes a    = vector_load_bytes(value1);
+  const byte_lanes b    = vector_load_bytes(value2);
+  const byte_lanes mask = (byte_lanes)(a > b);
+
+  return vector_store_bytes((a & mask) | (b & ~mask));
+}
+
+void vector_max_words(unsigned char       *target,
+                      const unsigned char *source,
+                      const int           word_count)
+{
+  vector_apply_words(target, source, word_count, VECTOR_MAX);
+}
+
+unsigned int vector_min_bytes(const unsigned int value1,
+                              const unsigned int value2)
+{
+  const byte_lanes a    = vector_load_bytes(value1);
+  const byte_lanes b    = vector_load_bytes(value2);
+  const byte_lanes mask = (byte_lanes)(a < b);
+
+  return vector_store_bytes((a & mask) | (b & ~mask));
+}
+
+void vector_min_words(unsigned char       *target,
+                      const unsigned char *source,
+                      const int           word_count)
+{
+  vector_apply_words(target, source, word_count, VECTOR_MIN);
+}
+
+static inline void vector_apply_lanes(unsigned char               *target,
+                                      const unsigned char         *source,
+                                      const enum vector_operation operation)
+{
+  // Loops of a fixed count, which the compiler unrolls into host SIMD.
+  word_lanes a;
+  word_lanes b;
+  for(int i = 0; i < VECTOR_LANE_COUNT; ++i)
+  {
+    a[i] = vector_load_word(&target[i * VECTOR_WORD_LEN]);
+    b[i] = vector_load_word(&source[i * VECTOR_WORD_LEN]);
+  }
+
+  const word_lanes result = vector_operate(operation, a, b);
+  for(int i = 0; i < VECTOR_LANE_COUNT; ++i)
+  {
+    vector_store_word(&target[i * VECTOR_WORD_LEN], result[i]);
+  }
+}
+
+static inline void vector_apply_words(unsigned char               *target,
+                                      const unsigned char         *source,
+                                      const int                   word_count,
+                                      const enum vector_operation operation)
+{
+  int first = 0;
+  for(; first + VECTOR_LANE_COUNT <= word_count; first += VECTOR_LANE_COUNT)
+  {
+    vector_apply_lanes(&target[first * VECTOR_WORD_LEN],
+                       &source[first * VECTOR_WORD_LEN],
+                       operation);
+  }
+
+  if(first < word_count)
+  {
+    // Lanes past the last word are 0, and their results are dropped.
+    unsigned char target_tail[VECTOR_LANE_COUNT * VECTOR_WORD_LEN] = {0,};
+    unsigned char source_tail[VECTOR_LANE_COUNT * VECTOR_WORD_LEN] = {0,};
+    const int     tail_len = (word_count - first) * VECTOR_WORD_LEN;
+    memcpy(target_tail, &target[first * VECTOR_WORD_LEN], tail_len);
+    memcpy(source_tail, &source[first * VECTOR_WORD_LEN], tail_len);
+    vector_apply_lanes(target_tail, source_tail, operation);
+    memcpy(&target[first * VECTOR_WORD_LEN], target_tail, tail_len);
+  }
+}
+
+static byte_lanes vector_load_bytes(const unsigned int value)
+{
+  const byte_lanes lanes = {(value >> 16) & 0xFF, (value >> 8) & 0xFF,
+                            value & 0xFF,         0};
+  return lanes;
+}
+
+static inline int vector_load_word(const unsigned char *word)
+{
+  const int value = (word[0] << 16) | (word[1] << 8) | word[2];
+
+  // Sign extension of 24 bits.
+  return value - ((value & 0x800000) << 1);
+}
+
+static inline word_lanes vector_operate(const enum vector_operation operation,
+                                        const word_lanes            a,
+                                        const word_lanes            b)
+{
+  switch(operation)
+  {
+    case VECTOR_ADD:
+      return a + b;
+    case VECTOR_COMPARE:
+      return a == b;
+    case VECTOR_MAX:
+      return (a & (a > b)) | (b & ~(a > b));
+    case VECTOR_MIN:
+    default:
+      return (a & (a < b)) | (b & ~(a < b));
+  }
+}
+
+static unsigned int vector_store_bytes(const byte_lanes lanes)
+{
+  return (lanes[0] << 16) | (lanes[1] << 8) | lanes[2];
+}
+
+static inline void vector_store_word(unsigned char *word, const int value)
+{
+  word[0] = (value >> 16) & 0xFF;
+  word[1] = (value >> 8) & 0xFF;
+  word[2] = value & 0xFF;
+}
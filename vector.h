@@ -0,0 +1,97 @@
+/**
+ * @file  vector.h
+ * @brief Lanes of the vector extension, computed by host SIMD. Registers
+ *        are packed with 3 bytes as unsigned lanes, and memory vectors are
+ *        words of 3 bytes as signed lanes.
+ */
+
+#ifndef __VECTOR_H__
+#define __VECTOR_H__
+
+/**
+ * @def   VECTOR_WORD_LEN
+ * @brief The number of bytes of a word lane.
+ */
+#define VECTOR_WORD_LEN 3
+
+/**
+ * @brief            Add bytes of the given values, modulo 256.
+ * @param[in] value1 A value of 3 packed bytes.
+ * @param[in] value2 A value of 3 packed bytes.
+ * @return           Packed sums.
+ */
+unsigned int vector_add_bytes(const unsigned int value1,
+                              const unsigned int value2);
+
+/**
+ * @brief                    Add words of the source to the target, modulo
+ *                           2^24.
+ * @param[in,out] target     Words to be added to, and the sums.
+ * @param[in]     source     Words to add.
+ * @param[in]     word_count The number of words.
+ */
+void vector_add_words(unsigned char       *target,
+                      const unsigned char *source,
+                      const int           word_count);
+
+/**
+ * @brief            Compare bytes of the given values.
+ * @param[in] value1 A value of 3 packed bytes.
+ * @param[in] value2 A value of 3 packed bytes.
+ * @return           Packed bytes of FF where bytes are equal, 00 otherwise.
+ */
+unsigned int vector_compare_bytes(const unsigned int value1,
+                                  const unsigned int value2);
+
+/**
+ * @brief                    Compare words of the target with the source.
+ * @param[in,out] target     Words to be compared, and the results of
+ *                           FFFFFF where words are equal, 000000 otherwise.
+ * @param[in]     source     Words to compare with.
+ * @param[in]     word_count The number of words.
+ */
+void vector_compare_words(unsigned char       *target,
+                          const unsigned char *source,
+                          const int           word_count);
+
+/**
+ * @brief            Return the larger of each byte of the given values.
+ * @param[in] value1 A value of 3 packed bytes.
+ * @param[in] value2 A value of 3 packed bytes.
+ * @return           Packed maximums.
+ */
+unsigned int vector_max_bytes(const unsigned int value1,
+                              const unsigned int value2);
+
+/**
+ * @brief                    Keep the larger of each word of the target and
+ *                           the source in the target.
+ * @param[in,out] target     Words to be compared, and the maximums.
+ * @param[in]     source     Words to compare with.
+ * @param[in]     word_count The number of words.
+ */
+void vector_max_words(unsigned char       *target,
+                      const unsigned char *source,
+                      const int           word_count);
+
+/**
+ * @brief            Return the smaller of each byte of the given values.
+ * @param[in] value1 A value of 3 packed bytes.
+ * @param[in] value2 A value of 3 packed bytes.
+ * @return           Packed minimums.
+ */
+unsigned int vector_min_bytes(const unsigned int value1,
+                              const unsigned int value2);
+
+/**
+ * @brief                    Keep the smaller of each word of the target and
+ *                           the source in the target.
+ * @param[in,out] target     Words to be compared, and the minimums.
+ * @param[in]     source     Words to compare with.
+ * @param[in]     word_count The number of words.
+ */
+void vector_min_words(unsigned char       *target,
+                      const unsigned char *source,
+                      const int           word_count);
+
+#endif
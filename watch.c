@@ -0,0 +1,348 @@
+/**
+ * @file  watch.c
+ * @brief A handler of watch related commands. Re-assembles and reloads
+ *        a program whenever its source is saved.
+ */
+
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "watch.h"
+
+#include "assembler.h"
+#include "debugger.h"
+#include "json.h"
+#include "loader.h"
+#include "logger.h"
+#include "memspace.h"
+
+/**
+ * @brief A const variable that holds the length of buffer used for
+ *        file reading.
+ */
+static const int BUFFER_LEN = 0x1000;
+
+/**
+ * @brief A time to wait for more events after a save, in milliseconds.
+ *        Editors often write a file in several steps.
+ */
+static const int DEBOUNCE_MS = 20;
+
+/**
+ * @brief Equals to 16.
+ */
+static const int HEX = 16;
+
+/**
+ * @brief FNV-1a offset basis of 64 bits.
+ */
+static const uint64_t HASH_OFFSET = 0xCBF29CE484222325ULL;
+
+/**
+ * @brief FNV-1a prime of 64 bits.
+ */
+static const uint64_t HASH_PRIME = 0x100000001B3ULL;
+
+/**
+ * @brief The number of instructions run between checks for saves and
+ *        input, so that a long run does not block them.
+ */
+static const int RUN_SLICE_LEN = 0x10000;
+
+/**
+ * @brief A flag indicating whether command is executed or not.
+ */
+static bool _is_command_executed = false;
+
+/**
+ * @brief          Watch .asm file, and re-assemble and reload it on saves
+ *                 until a line is entered.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+static bool watch_execute_watch_build(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[]);
+
+/**
+ * @brief  Return the current time in milliseconds.
+ * @return A monotonic time.
+ */
+static double watch_get_time(void);
+
+/**
+ * @brief               Hash the content of the file.
+ * @param[in]  filename A name of the file.
+ * @param[out] hash     A FNV-1a hash of the content.
+ * @return              True on success, false otherwise.
+ */
+static bool watch_hash_file(const char *filename, uint64_t *hash);
+
+/**
+ * @brief                  Re-assemble and reload .asm file, unless its
+ *                         content is the same as the last build.
+ * @param[in] asm_filename A name of the .asm file.
+ * @param[in] obj_filename A name of the .obj file.
+ * @param[in] last_hash    A hash of the last built content, updated if
+ *                         the content is changed.
+ * @param[in] is_forced    True to build even if the content is the same.
+ * @return                 True if reloaded, false otherwise.
+ */
+static bool watch_rebuild(const char *asm_filename,
+                          const char *obj_filename,
+                          uint64_t   *last_hash,
+                          const bool is_forced);
+
+void watch_execute(const char *cmd,
+                   const int  argc,
+                   const char *argv[])
+{
+  if(!strcmp("watch-build", cmd))
+  {
+    _is_command_executed = watch_execute_watch_build(cmd, argc, argv);
+  }
+  else
+  {
+    json_printf("%s: command not found\n", cmd);
+  }
+
+  if(_is_command_executed)
+  {
+    logger_write_log(cmd, argc, argv);
+  }
+}
+
+static bool watch_execute_watch_build(const char *cmd,
+                                      const int  argc,
+                                      const char *argv[])
+{
+  if(1 > argc)
+  {
+    json_printf("watch-build: one .asm file is required\n");
+    return false;
+  }
+  if(2 < argc)
+  {
+    json_printf("watch-build: too many arguments\n");
+    return false;
+  }
+
+  const char *asm_filename = argv[0];
+  const int  filename_len  = strlen(asm_filename);
+  if(4 > filename_len || strcmp(".asm", &asm_filename[filename_len - 4]))
+  {
+    json_printf("watch-build: '%s' is not .asm file\n", asm_filename);
+    return false;
+  }
+
+  if(2 == argc)
+  {
+    char *endptr  = NULL;
+    int  progaddr = strtol(argv[1], &endptr, HEX);
+    if('\0' != *endptr)
+    {
+      json_printf("watch-build: address '%s' is invalid\n", argv[1]);
+      return false;
+    }
+    if(!memspace_set_progaddr(progaddr))
+    {
+      return false;
+    }
+  }
+
+  char obj_filename[PATH_MAX];
+  snprintf(obj_filename, sizeof(obj_filename), "%.*sobj",
+           filename_len - 3,
+           asm_filename);
+
+  // Watch the directory, since editors often save by renaming a new file
+  // over the old one.
+  char       directory[PATH_MAX];
+  const char *separator = strrchr(asm_filename, '/');
+  const char *basename  = separator ? separator + 1 : asm_filename;
+  if(separator)
+  {
+    snprintf(directory, sizeof(directory), "%.*s",
+             (int)(separator - asm_filename) + 1,
+             asm_filename);
+  }
+  else
+  {
+    strcpy(directory, ".");
+  }
+
+  int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(0 > inotify_fd ||
+     0 > inotify_add_watch(inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO))
+  {
+    json_printf("watch-build: cannot watch '%s'\n", directory);
+    if(0 <= inotify_fd)
+    {
+      close(inotify_fd);
+    }
+    return false;
+  }
+
+  json_printf("watch-build: watching '%s'. Enter a line to stop.\n",
+              asm_filename);
+  fflush(stdout);
+
+  uint64_t hash       = 0;
+  bool     is_running = watch_rebuild(asm_filename, obj_filename, &hash, true) &&
+                        debugger_is_breakpoint_set();
+  bool     is_pending = false;
+  double   deadline   = 0;
+  bool     is_stopped = false;
+  while(!is_stopped)
+  {
+    // A run or a pending save must not wait for events.
+    int timeout = -1;
+    if(is_running)
+    {
+      timeout = 0;
+    }
+    else if(is_pending)
+    {
+      timeout = deadline > watch_get_time() ?
+                (int)(deadline - watch_get_time()) + 1 :
+                0;
+    }
+
+    struct pollfd fds[2] = {{.fd = STDIN_FILENO, .events = POLLIN},
+                            {.fd = inotify_fd,   .events = POLLIN}};
+    if(0 > poll(fds, 2, timeout))
+    {
+      // Interrupted. Try again.
+      continue;
+    }
+
+    if(fds[0].revents)
+    {
+      char input[BUFFER_LEN];
+      if(!fgets(input, sizeof(input), stdin))
+      {
+        clearerr(stdin);
+      }
+      is_stopped = true;
+      continue;
+    }
+
+    if(fds[1].revents & POLLIN)
+    {
+      _Alignas(struct inotify_event) char events[BUFFER_LEN];
+      ssize_t                             len = 0;
+      while(0 < (len = read(inotify_fd, events, sizeof(events))))
+      {
+        for(char *walk = events; walk < events + len;)
+        {
+          const struct inotify_event *event = (struct inotify_event *)walk;
+          if(event->len && !strcmp(basename, event->name))
+          {
+            // Wait for more events before building.
+            is_pending = true;
+            deadline   = watch_get_time() + DEBOUNCE_MS;
+          }
+          walk += sizeof(*event) + event->len;
+        }
+      }
+    }
+
+    if(is_pending && deadline <= watch_get_time())
+    {
+      is_pending = false;
+      if(watch_rebuild(asm_filename, obj_filename, &hash, false))
+      {
+        // Reloading stops the previous run, if any.
+        is_running = debugger_is_breakpoint_set();
+      }
+    }
+
+    if(is_running)
+    {
+      bool is_break = false;
+      if(!debugger_run_slice(RUN_SLICE_LEN, &is_break) || is_break)
+      {
+        is_running = false;
+      }
+      fflush(stdout);
+    }
+  }
+
+  close(inotify_fd);
+
+  return true;
+}
+
+static double watch_get_time(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static bool watch_hash_file(const char *filename, uint64_t *hash)
+{
+  FILE *file = fopen(filename, "rb");
+  if(!file)
+  {
+    return false;
+  }
+
+  unsigned char buffer[BUFFER_LEN];
+  size_t        len = 0;
+  *hash = HASH_OFFSET;
+  while(0 < (len = fread(buffer, 1, sizeof(buffer), file)))
+  {
+    for(size_t i = 0; i < len; ++i)
+    {
+      *hash = (*hash ^ buffer[i]) * HASH_PRIME;
+    }
+  }
+  fclose(file);
+
+  return true;
+}
+
+static bool watch_rebuild(const char *asm_filename,
+                          const char *obj_filename,
+                          uint64_t   *last_hash,
+                          const bool is_forced)
+{
+  const double start = watch_get_time();
+
+  uint64_t hash = 0;
+  if(!watch_hash_file(asm_filename, &hash))
+  {
+    json_printf("watch-build: cannot read '%s'\n", asm_filename);
+    return false;
+  }
+  if(!is_forced && hash == *last_hash)
+  {
+    // Saved without any change.
+    return false;
+  }
+  *last_hash = hash;
+
+  const char *obj_filenames[] = {obj_filename};
+  bool is_success = assembler_assemble(asm_filename, false, true) &&
+                    loader_load(1, obj_filenames, false);
+  if(is_success)
+  {
+    json_printf("watch-build: reloaded '%s' in %.1f ms\n",
+                asm_filename,
+                watch_get_time() - start);
+  }
+  fflush(stdout);
+
+  return is_success;
+}
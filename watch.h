@@ -0,0 +1,20 @@
+/**
+ * @file  watch.h
+ * @brief A handler of watch related commands. Re-assembles and reloads
+ *        a program whenever its source is saved.
+ */
+
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+/**
+ * @brief          Receives command and executes the command.
+ * @param[in] cmd  A type of the command.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv An list of arguments.
+ */
+void watch_execute(const char *cmd,
+                   const int  argc,
+                   const char *argv[]);
+
+#endif
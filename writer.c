@@ -0,0 +1,402 @@
+/**
+ * @file  writer.c
+ * @brief An output pipeline. Formatted records are passed through a ring
+ *        to a writer thread, which writes them to files with large writes.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "writer.h"
+
+/**
+ * @def   WRITER_RECORD_LEN
+ * @brief The length of a record in the ring. Longer records are split.
+ */
+#define WRITER_RECORD_LEN 0x80
+
+/**
+ * @def   WRITER_RING_LEN
+ * @brief The number of records in the ring. Must be a power of 2.
+ */
+#define WRITER_RING_LEN 0x400
+
+/**
+ * @def   WRITER_FILES_MAX
+ * @brief The maximum number of files written at once.
+ */
+#define WRITER_FILES_MAX 4
+
+/**
+ * @brief Structure of a record, which is a piece of text to be written.
+ */
+struct writer_record
+{
+  /** A file to be written. */
+  FILE *file;
+  /** The length of text. */
+  int  len;
+  /** A text, which is not NULL-terminated. */
+  char text[WRITER_RECORD_LEN];
+};
+
+/**
+ * @brief Structure of a buffer of a file. Records are gathered in it before
+ *        they are written to the file.
+ */
+struct writer_buffer
+{
+  /** A file to be written. */
+  FILE *file;
+  /** The length of text in the buffer. */
+  int  len;
+  /** A text to be written. */
+  char text[];
+};
+
+/**
+ * @brief A const variable that holds the length of buffer of a file.
+ */
+static const int BUFFER_LEN = 0x10000;
+
+/**
+ * @brief Buffers of files being written. Used only by the writer thread,
+ *        or by the caller if the thread is not running.
+ */
+static struct writer_buffer *_buffers[WRITER_FILES_MAX];
+
+/**
+ * @brief The number of records written to the ring. Advanced only by the
+ *        producer.
+ */
+static atomic_size_t _head;
+
+/**
+ * @brief A flag indicating whether the producer has ended or not.
+ */
+static atomic_bool _is_ended;
+
+/**
+ * @brief A condition signalled when records are read from the full ring.
+ */
+static pthread_cond_t _is_not_full = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief A condition signalled when records are pushed to the empty ring,
+ *        or when the producer ends.
+ */
+static pthread_cond_t _is_not_empty = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief A flag indicating whether the producer sleeps on the full ring.
+ */
+static atomic_bool _is_producer_waiting;
+
+/**
+ * @brief A flag indicating whether the writer thread is running or not.
+ */
+static bool _is_running = false;
+
+/**
+ * @brief A mutex for sleeps on the ring. Records are passed without it, and
+ *        it is taken only to sleep or to wake a sleeping thread.
+ */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief A ring of records from the producer to the writer thread.
+ */
+static struct writer_record _ring[WRITER_RING_LEN];
+
+/**
+ * @brief The number of records read from the ring. Advanced only by the
+ *        writer thread.
+ */
+static atomic_size_t _tail;
+
+/**
+ * @brief The writer thread.
+ */
+static pthread_t _thread;
+
+/**
+ * @brief A flag indicating whether the writer thread sleeps on the empty
+ *        ring.
+ */
+static atomic_bool _is_writer_waiting;
+
+/**
+ * @brief          Append text to the buffer of the file, and write the
+ *                 buffer to the file when it is full.
+ * @param[in] file A file to be written.
+ * @param[in] text A text to be appended.
+ * @param[in] len  The length of text.
+ */
+static void writer_append(FILE *file, const char *text, const int len);
+
+/**
+ * @brief Write all buffers to their files, and release them.
+ */
+static void writer_flush(void);
+
+/**
+ * @brief  Check if the ring has a record, or the producer has ended.
+ * @return True if the writer thread has work to do, false otherwise.
+ */
+static bool writer_is_not_empty(void);
+
+/**
+ * @brief  Check if the ring has room for a record.
+ * @return True if the ring is not full, false otherwise.
+ */
+static bool writer_is_not_full(void);
+
+/**
+ * @brief          Pass a piece of text to the writer thread. Sleep if the
+ *                 ring is full.
+ * @param[in] file A file to be written.
+ * @param[in] text A text to be written.
+ * @param[in] len  The length of text, not longer than WRITER_RECORD_LEN.
+ */
+static void writer_push(FILE *file, const char *text, const int len);
+
+/**
+ * @brief          Drain records of the ring until the producer ends.
+ * @param[in] arg  Not used.
+ * @return         NULL.
+ */
+static void *writer_run(void *arg);
+
+/**
+ * @brief                Sleep until the other thread changes the ring. The
+ *                       flag is raised before the ring is checked again, so
+ *                       a change made meanwhile is seen either here or by
+ *                       the other thread, which then wakes this one.
+ * @param[in] condition  A condition to wait on.
+ * @param[in] is_waiting A flag of this thread.
+ * @param[in] is_ready   A function that checks the ring.
+ */
+static void writer_wait(pthread_cond_t *condition,
+                        atomic_bool    *is_waiting,
+                        bool           (*is_ready)(void));
+
+/**
+ * @brief                Wake the other thread if it sleeps on the ring.
+ * @param[in] condition  A condition the other thread waits on.
+ * @param[in] is_waiting A flag of the other thread.
+ */
+static void writer_wake(pthread_cond_t *condition, atomic_bool *is_waiting);
+
+void writer_begin(void)
+{
+  writer_end();
+
+  atomic_store(&_head, 0);
+  atomic_store(&_tail, 0);
+  atomic_store(&_is_ended, false);
+  atomic_store(&_is_producer_waiting, false);
+  atomic_store(&_is_writer_waiting, false);
+  _is_running = !pthread_create(&_thread, NULL, writer_run, NULL);
+}
+
+void writer_end(void)
+{
+  if(_is_running)
+  {
+    atomic_store(&_is_ended, true);
+    writer_wake(&_is_not_empty, &_is_writer_waiting);
+    pthread_join(_thread, NULL);
+    _is_running = false;
+  }
+
+  // The thread flushes its buffers, but synchronous writes are not yet.
+  writer_flush();
+}
+
+void writer_initialize(void)
+{
+  _is_running = false;
+  memset(_buffers, 0, sizeof(_buffers));
+}
+
+void writer_printf(FILE *file, const char *format, ...)
+{
+  if(!file)
+  {
+    return;
+  }
+
+  char    record[WRITER_RECORD_LEN];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(record, sizeof(record), format, args);
+  va_end(args);
+  if(0 > len)
+  {
+    return;
+  }
+
+  if(WRITER_RECORD_LEN > len)
+  {
+    writer_push(file, record, len);
+    return;
+  }
+
+  // The text is too long for a record, so format it again and split it.
+  char *text = malloc(len + 1);
+  va_start(args, format);
+  vsnprintf(text, len + 1, format, args);
+  va_end(args);
+  for(int i = 0; i < len; i += WRITER_RECORD_LEN)
+  {
+    writer_push(file,
+                &text[i],
+                len - i < WRITER_RECORD_LEN ? len - i : WRITER_RECORD_LEN);
+  }
+  free(text);
+}
+
+void writer_terminate(void)
+{
+  writer_end();
+}
+
+static void writer_append(FILE *file, const char *text, const int len)
+{
+  struct writer_buffer *buffer = NULL;
+  for(int i = 0; i < WRITER_FILES_MAX && !buffer; ++i)
+  {
+    if(!_buffers[i])
+    {
+      _buffers[i] = malloc(sizeof(*_buffers[i]) + BUFFER_LEN);
+      _buffers[i]->file = file;
+      _buffers[i]->len  = 0;
+    }
+    if(file == _buffers[i]->file)
+    {
+      buffer = _buffers[i];
+    }
+  }
+  if(!buffer)
+  {
+    // Too many files. Write it as is.
+    fwrite(text, 1, len, file);
+    return;
+  }
+
+  if(BUFFER_LEN < buffer->len + len)
+  {
+    fwrite(buffer->text, 1, buffer->len, buffer->file);
+    buffer->len = 0;
+  }
+  memcpy(&buffer->text[buffer->len], text, len);
+  buffer->len += len;
+}
+
+static void writer_flush(void)
+{
+  for(int i = 0; i < WRITER_FILES_MAX; ++i)
+  {
+    if(_buffers[i])
+    {
+      fwrite(_buffers[i]->text, 1, _buffers[i]->len, _buffers[i]->file);
+      free(_buffers[i]);
+      _buffers[i] = NULL;
+    }
+  }
+}
+
+static bool writer_is_not_empty(void)
+{
+  return atomic_load(&_head) != atomic_load(&_tail) || atomic_load(&_is_ended);
+}
+
+static bool writer_is_not_full(void)
+{
+  return WRITER_RING_LEN > atomic_load(&_head) - atomic_load(&_tail);
+}
+
+static void writer_push(FILE *file, const char *text, const int len)
+{
+  if(!_is_running)
+  {
+    writer_append(file, text, len);
+    return;
+  }
+
+  // Only this thread advances _head, and only the writer thread _tail.
+  const size_t head = atomic_load_explicit(&_head, memory_order_relaxed);
+  if(!writer_is_not_full())
+  {
+    writer_wait(&_is_not_full, &_is_producer_waiting, writer_is_not_full);
+  }
+
+  struct writer_record *record = &_ring[head & (WRITER_RING_LEN - 1)];
+  record->file = file;
+  record->len  = len;
+  memcpy(record->text, text, len);
+  atomic_store(&_head, head + 1);
+  writer_wake(&_is_not_empty, &_is_writer_waiting);
+}
+
+static void *writer_run(void *arg)
+{
+  size_t tail = atomic_load_explicit(&_tail, memory_order_relaxed);
+  while(true)
+  {
+    const size_t head = atomic_load(&_head);
+    if(tail == head)
+    {
+      // Records pushed before the end are seen once it is seen.
+      if(atomic_load(&_is_ended) && tail == atomic_load(&_head))
+      {
+        break;
+      }
+      writer_wait(&_is_not_empty, &_is_writer_waiting, writer_is_not_empty);
+      continue;
+    }
+
+    for(; tail != head; ++tail)
+    {
+      const struct writer_record *record = &_ring[tail & (WRITER_RING_LEN - 1)];
+      writer_append(record->file, record->text, record->len);
+    }
+    atomic_store(&_tail, tail);
+    writer_wake(&_is_not_full, &_is_producer_waiting);
+  }
+
+  writer_flush();
+
+  return NULL;
+}
+
+static void writer_wait(pthread_cond_t *condition,
+                        atomic_bool    *is_waiting,
+                        bool           (*is_ready)(void))
+{
+  pthread_mutex_lock(&_mutex);
+  atomic_store(is_waiting, true);
+  while(!is_ready())
+  {
+    pthread_cond_wait(condition, &_mutex);
+  }
+  atomic_store(is_waiting, false);
+  pthread_mutex_unlock(&_mutex);
+}
+
+static void writer_wake(pthread_cond_t *condition, atomic_bool *is_waiting)
+{
+  // The ring is changed before the flag is read, both sequentially
+  // consistent, so the mutex is taken only if the other thread may sleep.
+  if(atomic_load(is_waiting))
+  {
+    pthread_mutex_lock(&_mutex);
+    pthread_cond_signal(condition);
+    pthread_mutex_unlock(&_mutex);
+  }
+}
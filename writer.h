@@ -0,0 +1,41 @@
+/**
+ * @file  writer.h
+ * @brief An output pipeline. Formatted records are passed through a ring
+ *        to a writer thread, which writes them to files with large writes.
+ */
+
+#ifndef __WRITER_H__
+#define __WRITER_H__
+
+#include <stdio.h>
+
+/**
+ * @brief Start the writer thread. Records are written synchronously if the
+ *        thread cannot be started.
+ */
+void writer_begin(void);
+
+/**
+ * @brief Wait until all records are written to their files, and stop the
+ *        writer thread.
+ */
+void writer_end(void);
+
+/**
+ * @brief Initialize writer.
+ */
+void writer_initialize(void);
+
+/**
+ * @brief            Format a record and pass it to the writer thread.
+ * @param[in] file   A file to be written. Nothing is written if NULL.
+ * @param[in] format A format string as printf().
+ */
+void writer_printf(FILE *file, const char *format, ...);
+
+/**
+ * @brief Stop the writer thread if running.
+ */
+void writer_terminate(void);
+
+#endif